@@ -19,6 +19,9 @@
 
 /* disabled by default */
 #cmakedefine01 PANIC_SHOW_REGS
+#cmakedefine01 KRN_LOCK_STATS
+#cmakedefine01 KRN_SCHED_LAT_STATS
+#cmakedefine01 KRN_PREEMPTOFF_TRACE
 
 
 /*
@@ -8,6 +8,9 @@
 #pragma once
 #include <tilck_gen_headers/config_global.h>
 
+/* ------ Value-based config variables -------- */
+#define PRINTK_LOG_BUF_KB          @PRINTK_LOG_BUF_KB@
+
 /* --------- Boolean config variables --------- */
 #cmakedefine01 KRN_NO_SYS_WARN
 #cmakedefine01 KERNEL_FORCE_TC_ISYSTEM
@@ -37,8 +40,11 @@
 #define PROCESS_CMDLINE_BUF_SIZE                  256
 #define MAX_MOUNTPOINTS                            16
 #define MAX_NESTED_INTERRUPTS                      32
+#define MAX_PTYS                                    8
 
 #define WTH_MAX_THREADS                            64
 #define WTH_MAX_PRIO_QUEUE_SIZE                    32
 #define WTH_KB_QUEUE_SIZE                          32
 #define WTH_SERIAL_QUEUE_SIZE                      32
+#define WTH_AIO_QUEUE_SIZE                         64
+#define WTH_PRINTK_QUEUE_SIZE                       4
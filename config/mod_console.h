@@ -11,11 +11,13 @@
 
 #define TTY_COUNT              @TTY_COUNT@
 #define TERM_SCROLL_LINES      @TERM_SCROLL_LINES@
+#define TERM_DAMAGE_FPS        @TERM_DAMAGE_FPS@
 
 /* --------- Boolean config variables --------- */
 
 #cmakedefine01    MOD_console
 #cmakedefine01    TERM_BIG_SCROLL_BUF
+#cmakedefine01    TERM_DAMAGE_TRACKING
 #cmakedefine01    KERNEL_SHOW_LOGO
 #cmakedefine01    SERIAL_CON_IN_VIDEO_MODE
 #cmakedefine01    KRN_PRINTK_ON_CURR_TTY
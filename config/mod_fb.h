@@ -17,7 +17,9 @@
 #cmakedefine01    MOD_fb
 #cmakedefine01    FB_CONSOLE_BANNER
 #cmakedefine01    FB_CONSOLE_CURSOR_BLINK
+#cmakedefine01    FB_CONSOLE_SHADOW_BUF
 #cmakedefine01    FB_CONSOLE_USE_ALT_FONTS
+#cmakedefine01    FB_CONSOLE_LEAN_GLYPHS
 
 
 /*
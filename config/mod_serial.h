@@ -8,3 +8,9 @@
 #pragma once
 
 #cmakedefine01    MOD_serial
+
+/* Size of each port's TX ring buffer, drained by the THR empty interrupt */
+#define SERIAL_TX_BUF_SIZE                      1024
+
+/* Size of each port's RX ring buffer, filled directly by the IRQ handler */
+#define SERIAL_RX_BUF_SIZE                      1024
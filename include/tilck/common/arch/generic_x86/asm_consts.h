@@ -49,6 +49,10 @@
 
 #define MSR_IA32_PAT                    0x277
 
+#define MSR_IA32_PMC0                   0x0c1
+#define MSR_IA32_PERFEVTSEL0            0x186
+#define MSR_IA32_PERF_GLOBAL_CTRL       0x38f
+
 #define CR0_PE              (1u << 0)
 #define CR0_MP              (1u << 1)
 #define CR0_EM              (1u << 2)
@@ -11,6 +11,25 @@
 
 #include <x86intrin.h>
 
+#if defined(__TILCK_KERNEL__) && !defined(UNIT_TEST_ENVIRONMENT)
+   #if !defined(__MOD_ACPICA__)
+      #include <tilck_gen_headers/config_debug.h>
+   #endif
+#endif
+
+#if defined(KRN_PREEMPTOFF_TRACE) && KRN_PREEMPTOFF_TRACE
+
+   /* See <tilck/kernel/preemptoff_trace.h> */
+   void irqsoff_trace_begin(void);
+   void irqsoff_trace_end(void);
+
+   #define IRQSOFF_TRACE_ONLY(x) x
+
+#else
+
+   #define IRQSOFF_TRACE_ONLY(x)
+#endif
+
 #define X86_PC_TIMER_IRQ           0
 #define X86_PC_KEYBOARD_IRQ        1
 #define X86_PC_COM2_COM4_IRQ       3
@@ -214,12 +233,14 @@ static ALWAYS_INLINE void disable_interrupts(ulong *const var)
 
    if (*var & EFLAGS_IF) {
       disable_interrupts_forced();
+      IRQSOFF_TRACE_ONLY(irqsoff_trace_begin());
    }
 }
 
 static ALWAYS_INLINE void enable_interrupts(const ulong *const var)
 {
    if (*var & EFLAGS_IF) {
+      IRQSOFF_TRACE_ONLY(irqsoff_trace_end());
       enable_interrupts_forced();
    }
 }
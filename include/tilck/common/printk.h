@@ -14,6 +14,7 @@
    #if defined(__TILCK_KERNEL__) || defined(UNIT_TEST_ENVIRONMENT)
 
       #define PRINTK_CTRL_CHAR   '\x01'
+      #define PRINTK_CTRL_LEVEL  '\x02'
 
       void tilck_vprintk(u32 flags, const char *fmt, va_list args);
       static inline void vprintk(const char *fmt, va_list args) {
@@ -33,10 +34,22 @@
 
    #ifndef UNIT_TEST_ENVIRONMENT
       #define NO_PREFIX          "\x01\x01\x20\x20"
+      #define KERN_LEVEL(n)      "\x01\x02" #n "\x20"
    #else
       #define NO_PREFIX          ""
+      #define KERN_LEVEL(n)      ""
    #endif
 
+   /* Log levels, stored in printk's log and shown in /dev/kmsg */
+   #define KERN_EMERG            KERN_LEVEL(0)
+   #define KERN_ALERT            KERN_LEVEL(1)
+   #define KERN_CRIT             KERN_LEVEL(2)
+   #define KERN_ERR              KERN_LEVEL(3)
+   #define KERN_WARNING          KERN_LEVEL(4)
+   #define KERN_NOTICE           KERN_LEVEL(5)
+   #define KERN_INFO             KERN_LEVEL(6)
+   #define KERN_DEBUG            KERN_LEVEL(7)
+
 #else
 
    /*
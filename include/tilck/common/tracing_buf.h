@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/atomics.h>
+
+/*
+ * The syscall tracing buffer, shared between the kernel and the user space.
+ * ---------------------------------------------------------------------------
+ *
+ * /dev/tracing can be mmap()-ed (MAP_SHARED, PROT_READ | PROT_WRITE) in order
+ * to consume the trace events in batches, without any syscall per event. The
+ * mapping starts with a struct trace_buf_hdr, followed by the data area, at
+ * `data_off`, which is a byte ring of `data_size` bytes containing variable
+ * length records (struct trace_rec). The ring contains the records in the
+ * [tail, head) range: head == tail means empty.
+ *
+ *    - The kernel is the only producer: it writes a record and then advances
+ *      `head` with a release store. When there is no room for a record, the
+ *      event is dropped and `dropped` is incremented.
+ *
+ *    - The consumer reads `head` with an acquire load, reads the records in
+ *      the [tail, head) range and then advances `tail` with a release store.
+ *      Records never wrap around the end of the data area: when there's no
+ *      room at its end, the kernel writes a padding record (TRACE_REC_PAD) and
+ *      the next record starts at offset 0.
+ *
+ * While /dev/tracing is open (it can be opened only once), the kernel itself
+ * does not consume any events (e.g. the debug panel's tracing screen won't
+ * show them).
+ *
+ * Each record contains a struct trace_event truncated to the size of the
+ * parameter slots used by its syscall: the bytes past the end of a record
+ * must be considered zero.
+ */
+
+#define TRACE_BUF_MAGIC                                     0x7ace7ace
+#define TRACE_REC_PAD                                            (1 << 0)
+#define TRACE_REC_ALIGN                                                 8
+
+/* ioctl() requests for /dev/tracing, in a range not used by Linux */
+#define TILCK_TRACE_IOC_ENABLE            0x7AC0   /* arg: 0 or 1, by value */
+#define TILCK_TRACE_IOC_TRACE_TID         0x7AC1   /* arg: tid (< 0: untrace) */
+#define TILCK_TRACE_IOC_SET_FILTER        0x7AC2   /* arg: const char *expr */
+#define TILCK_TRACE_IOC_GET_SYS_NAME      0x7AC3   /* arg: struct trace_sys */
+
+enum trace_event_type {
+   te_invalid,
+   te_sys_enter,
+   te_sys_exit,
+};
+
+struct trace_event {
+
+   enum trace_event_type type;
+   int tid;
+
+   u64 sys_time;
+
+   u32 sys;
+   long retval;
+   ulong args[6];
+
+   union {
+
+      struct {
+         char d0[64];
+         char d1[64];
+         char d2[32];
+         char d3[16];
+      } fmt0;
+
+      struct {
+         char d0[128];
+         char d1[32];
+         char d2[16];
+      } fmt1;
+   };
+};
+
+STATIC_ASSERT(sizeof(struct trace_event) <= 256);
+
+struct trace_buf_hdr {
+
+   u32 magic;
+   u32 data_off;              /* offset of the data area from the header */
+   u32 data_size;             /* size of the data area */
+
+   ATOMIC(u32) head;          /* written by the kernel */
+   ATOMIC(u32) tail;          /* written by the consumer */
+
+   ATOMIC(u32) written;       /* number of events written */
+   ATOMIC(u32) dropped;       /* number of events dropped: buffer full */
+};
+
+struct trace_rec {
+
+   u32 size;                  /* size of the record, multiple of 8 */
+   u32 flags;                 /* TRACE_REC_* */
+
+   struct trace_event e;      /* truncated: see above */
+};
+
+struct trace_sys {
+
+   u32 sys;                   /* in */
+   char name[32];             /* out: without the "sys_" prefix */
+};
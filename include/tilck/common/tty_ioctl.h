@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+
+/*
+ * Tilck-specific tty ioctl() requests, in a range (0x54e0 - 0x54ef) not used
+ * by Linux. Their argument is an `int *`.
+ *
+ *    TILCK_TIOCGSCROLLBACK    get the max number of rows in the scrollback
+ *    TILCK_TIOCSSCROLLBACK    set it, keeping the newest rows in the history
+ *
+ * Both fail with EINVAL on ttys not having a scrollback (e.g. serial ttys).
+ */
+
+#define TILCK_TIOCGSCROLLBACK                                  0x54E0
+#define TILCK_TIOCSSCROLLBACK                                  0x54E1
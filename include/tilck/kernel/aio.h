@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/* Max number of events of a single AIO context (io_setup()) */
+#define AIO_MAX_EVENTS                1024
+
+void init_aio(void);
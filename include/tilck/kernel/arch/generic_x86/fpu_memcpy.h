@@ -103,6 +103,22 @@ fpu_cpy_single_256_avx2(void *dest, const void *src)
                : "memory");
 }
 
+/*
+ * Copy two 128-bit packets coming from different sources into a single 256-bit
+ * destination. Useful for composing 16 bpp glyph rows from pre-rendered
+ * scanlines. The destination must be 32-byte aligned.
+ */
+EXTERN ALWAYS_INLINE FASTCALL void
+fpu_cpy_2x128_nt_avx2(void *dest, const void *src1, const void *src2)
+{
+   asmVolatile("vmovdqa          (%0), %%xmm0\n\t"
+               "vinserti128  $1, (%1), %%ymm0, %%ymm0\n\t"
+               "vmovntdq     %%ymm0,   (%2)\n\t"
+               : /* no output */
+               : "r" (src1), "r" (src2), "r" (dest)
+               : "memory");
+}
+
 EXTERN ALWAYS_INLINE FASTCALL void
 fpu_cpy_single_512_nt_sse2(void *dest, const void *src)
 {
@@ -210,6 +226,26 @@ fpu_cpy_single_128_sse2(void *dest, const void *src)
                : "memory");
 }
 
+/*
+ * Copy two 192-bit packets (8 pixels at 24 bpp) coming from different sources
+ * into a contiguous 384-bit destination. The destination must be 16-byte
+ * aligned, the sources just 8-byte aligned.
+ */
+EXTERN ALWAYS_INLINE FASTCALL void
+fpu_cpy_2x192_nt_sse2(void *dest, const void *src1, const void *src2)
+{
+   asmVolatile("movdqu    (%0), %%xmm0\n\t"
+               "movq    16(%0), %%xmm1\n\t"
+               "movhps    (%1), %%xmm1\n\t"
+               "movdqu   8(%1), %%xmm2\n\t"
+               "movntdq %%xmm0,   (%2)\n\t"
+               "movntdq %%xmm1, 16(%2)\n\t"
+               "movntdq %%xmm2, 32(%2)\n\t"
+               : /* no output */
+               : "r" (src1), "r" (src2), "r" (dest)
+               : "memory");
+}
+
 EXTERN ALWAYS_INLINE FASTCALL void
 fpu_cpy_single_256_nt_sse(void *dest, const void *src)
 {
@@ -254,6 +290,21 @@ fpu_cpy_single_128_nt_sse(void *dest, const void *src)
                : "memory");
 }
 
+/* Copy 192 bits (8 pixels at 24 bpp): no alignment requirements */
+EXTERN ALWAYS_INLINE FASTCALL void
+fpu_cpy_single_192_nt_sse(void *dest, const void *src)
+{
+   asmVolatile("movq (%0), %%mm0\n\t"
+               "movq 8(%0), %%mm1\n\t"
+               "movq 16(%0), %%mm2\n\t"
+               "movntq %%mm0, (%1)\n\t"
+               "movntq %%mm1, 8(%1)\n\t"
+               "movntq %%mm2, 16(%1)\n\t"
+               : /* no output */
+               : "r" (src), "r" (dest)
+               : "memory");
+}
+
 EXTERN ALWAYS_INLINE FASTCALL void
 fpu_cpy_single_128_sse(void *dest, const void *src)
 {
@@ -39,6 +39,7 @@ struct x86_arch_proc_members {
 struct x86_arch_task_members {
    u16 fpu_regs_size;
    void *aligned_fpu_regs;
+   struct pmu_task_ctx *pmu_ctx; /* NULL unless the task uses HW counters */
 };
 
 NORETURN void context_switch(regs_t *r);
@@ -53,6 +54,21 @@ static ALWAYS_INLINE void set_return_register(regs_t *r, ulong value)
    r->eax = value;
 }
 
+static ALWAYS_INLINE ulong regs_get_ip(regs_t *r)
+{
+   return r->eip;
+}
+
+static ALWAYS_INLINE ulong regs_get_frame_ptr(regs_t *r)
+{
+   return r->ebp;
+}
+
+static ALWAYS_INLINE bool regs_in_user_mode(regs_t *r)
+{
+   return (r->cs & 3) == 3;
+}
+
 static ALWAYS_INLINE ulong get_rem_stack(void)
 {
    return (get_stack_ptr() & ((ulong)KERNEL_STACK_SIZE - 1));
@@ -21,6 +21,7 @@ struct x86_64_arch_proc_members {
 struct x86_64_arch_task_members {
    /* STUB struct */
    void *aligned_fpu_regs;
+   struct pmu_task_ctx *pmu_ctx;
 };
 
 static ALWAYS_INLINE int regs_intnum(regs_t *r)
@@ -34,6 +35,24 @@ static ALWAYS_INLINE void set_return_register(regs_t *r, ulong value)
    NOT_IMPLEMENTED();
 }
 
+static ALWAYS_INLINE ulong regs_get_ip(regs_t *r)
+{
+   NOT_IMPLEMENTED();
+   return 0;
+}
+
+static ALWAYS_INLINE ulong regs_get_frame_ptr(regs_t *r)
+{
+   NOT_IMPLEMENTED();
+   return 0;
+}
+
+static ALWAYS_INLINE bool regs_in_user_mode(regs_t *r)
+{
+   NOT_IMPLEMENTED();
+   return false;
+}
+
 NORETURN static ALWAYS_INLINE void context_switch(regs_t *r)
 {
    NOT_IMPLEMENTED();
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Boot-time profiler: the kernel init steps and the module inits record their
+ * start and end TSC values in a static table. The cycles are converted to
+ * time only when the table is read, because the TSC frequency is measured
+ * after most of the steps already ran.
+ */
+
+#define BOOT_TRACE_MAX_STEPS                 64
+#define BOOT_TRACE_MAX_DEPTH                  4
+
+struct boot_trace_step {
+
+   const char *name;
+   u64 start;           /* TSC value at the beginning of the step */
+   u64 end;             /* TSC value at the end of the step */
+   u32 depth;           /* nesting level: 0 for the top-level steps */
+};
+
+void boot_trace_start(void);
+void boot_trace_begin(const char *name);
+void boot_trace_end(void);
+void boot_trace_finish(void);
+
+/*
+ * Copies up to `max` steps in `buf` and returns their number. The kmain()
+ * and end of boot TSC values are returned in `start` and `end`, the latter
+ * being 0 while the kernel is still booting.
+ */
+u32 boot_trace_get_steps(struct boot_trace_step *buf,
+                         u32 max,
+                         u64 *start,
+                         u64 *end);
+
+#define BOOT_TRACE(func)                                                   \
+   do {                                                                    \
+      boot_trace_begin(#func);                                             \
+      func();                                                              \
+      boot_trace_end();                                                    \
+   } while (0)
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/kernel/fs/vfs_base.h>
+
+/* eventfd() flags, as in <linux/eventfd.h> */
+#define EFD_SEMAPHORE               (1 << 0)
+#define EFD_CLOEXEC                 O_CLOEXEC
+#define EFD_NONBLOCK                O_NONBLOCK
+
+/* The max value of an eventfd counter [Linux] */
+#define EFD_MAX_COUNT               (~0ULL - 1)
+
+/*
+ * Creates a new eventfd object and a handle for it, not installed in any file
+ * descriptor table. `flags` can contain EFD_SEMAPHORE and EFD_NONBLOCK.
+ */
+int eventfd_create_handle(u32 initval, int flags, fs_handle *out);
+
+bool is_eventfd_handle(fs_handle h);
+
+/*
+ * Adds `n` to the counter of the eventfd object behind `h`, saturating it
+ * at EFD_MAX_COUNT instead of blocking. Used by the kernel to notify the user
+ * space (e.g. AIO completions). It can be called from worker threads.
+ */
+void eventfd_signal(fs_handle h, u64 n);
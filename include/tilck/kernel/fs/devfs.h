@@ -34,6 +34,8 @@ struct devfs_file {
    tilck_ino_t inode;
 };
 
+struct devfs_dir;
+
 struct devfs_handle {
 
    /* struct fs_handle_base */
@@ -44,7 +46,10 @@ struct devfs_handle {
 
    union {
 
-      struct devfs_file *dpos;               /* valid only if type == VFS_DIR */
+      struct {
+         struct devfs_dir *dir;              /* valid only if type == VFS_DIR */
+         struct devfs_file *dpos;            /* valid only if type == VFS_DIR */
+      };
 
       struct {
          struct devfs_file *file;            /* valid only if type != VFS_DIR */
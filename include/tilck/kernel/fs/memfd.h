@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/kernel/fs/vfs_base.h>
+
+/* memfd_create() flags, as in <linux/memfd.h> */
+#define MFD_CLOEXEC                 0x0001U
+#define MFD_ALLOW_SEALING           0x0002U
+#define MFD_HUGETLB                 0x0004U
+
+/* Max length of memfd's name, not counting the "memfd:" prefix [Linux] */
+#define MFD_NAME_MAX_LEN            249
+
+void init_memfd(void);
+
+/*
+ * Creates a new anonymous memory-backed file, opened in R/W mode and not
+ * installed in any file descriptor table. Used by memfd_create() and by
+ * MAP_SHARED | MAP_ANONYMOUS mappings.
+ */
+int memfd_create_handle(fs_handle *out);
@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/fs/vfs_base.h>
+
+struct fs *ramfs_create(void);
+
+/*
+ * Creates a new regular file in the given ramfs instance, without linking it
+ * to any directory, and opens it in R/W mode. Since the inode has nlink == 0,
+ * it gets destroyed as soon as its last handle is closed. This is the building
+ * block of memfd_create() and MAP_SHARED | MAP_ANONYMOUS mappings.
+ */
+int ramfs_open_anon_file(struct fs *fs, mode_t mode, fs_handle *out);
@@ -88,6 +88,10 @@ typedef ssize_t        (*func_writev)       (fs_handle,
                                              int);
 
 typedef int            (*func_fsync)        (fs_handle);
+typedef int            (*func_fallocate)    (fs_handle, int, offt, offt);
+typedef offt           (*func_copy_range)   (fs_handle, offt,
+                                             fs_handle, offt,
+                                             offt, int);
 typedef void           (*func_syncfs)       (struct fs *);
 
 /*
@@ -151,6 +155,8 @@ struct file_ops {
    func_munmap munmap;                 /* if NULL -> -ENODEV */
    func_fsync sync;                    /* if NULL -> -EROFS or 0 */
    func_fsync datasync;                /* if NULL -> -EROFS or 0 */
+   func_fallocate fallocate;           /* if NULL -> -EOPNOTSUPP */
+   func_copy_range copy_range;         /* if NULL -> -EXDEV */
 
    func_readv readv;                   /* if NULL, emulated in non-atomic way */
    func_writev writev;                 /* if NULL, emulated in non-atomic way */
@@ -196,6 +202,9 @@ int vfs_fchmod(fs_handle h, mode_t mode);
 int vfs_futimens(fs_handle h, const struct k_timespec64 times[2]);
 int vfs_fsync(fs_handle h);
 int vfs_fdatasync(fs_handle h);
+int vfs_fallocate(fs_handle h, int mode, offt offset, offt len);
+int vfs_clone_range(fs_handle in, offt off_in,
+                    fs_handle out, offt off_out, offt len);
 offt vfs_seek(fs_handle h, s64 off, int whence);
 
 int vfs_read_ready(fs_handle h);
@@ -209,6 +218,8 @@ ssize_t vfs_read(fs_handle h, void *buf, size_t buf_size);
 ssize_t vfs_write(fs_handle h, void *buf, size_t buf_size);
 ssize_t vfs_readv(fs_handle h, const struct iovec *iov, int iovcnt);
 ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt);
+offt vfs_copy_file_range(fs_handle in, offt off_in,
+                         fs_handle out, offt off_out, offt len);
 
 int vfs_exlock_noblock(struct fs *fs, vfs_inode_ptr_t i);
 int vfs_exunlock(struct fs *fs, vfs_inode_ptr_t i);
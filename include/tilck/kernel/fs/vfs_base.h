@@ -113,6 +113,7 @@ struct fs_handle_base {
 #define VFS_SPFL_NO_USER_COPY                  (1 << 0)
 #define VFS_SPFL_MMAP_SUPPORTED                (1 << 1)
 #define VFS_SPFL_NO_LF                         (1 << 2)
+#define VFS_SPFL_ANON_MAPPING                  (1 << 3)
 
 /*
  * vfs_mmap()'s flags
@@ -132,6 +133,13 @@ struct fs_handle_base {
 #define VFS_MM_DONT_MMAP            (1 << 0)
 #define VFS_MM_DONT_REGISTER        (1 << 1)
 
+/*
+ * Flags for func_copy_range. VFS_CR_CLONE requires the whole range to be
+ * cloned (shared between the files, with copy-on-write), instead of copied:
+ * if that's not possible, -EINVAL is returned.
+ */
+#define VFS_CR_CLONE                (1 << 0)
+
 int vfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags);
 int vfs_munmap(fs_handle h, void *vaddr, size_t len);
 bool vfs_handle_fault(fs_handle h, void *va, bool p, bool rw);
@@ -145,3 +153,14 @@ is_mmap_supported(fs_handle h)
    struct fs_handle_base *hb = (struct fs_handle_base *)h;
    return !!(hb->spec_flags & VFS_SPFL_MMAP_SUPPORTED);
 }
+
+/*
+ * Handles flagged with VFS_SPFL_ANON_MAPPING are owned by MAP_SHARED |
+ * MAP_ANONYMOUS user mappings: they are not in any fd table.
+ */
+static ALWAYS_INLINE bool
+is_anon_mapping_handle(fs_handle h)
+{
+   struct fs_handle_base *hb = (struct fs_handle_base *)h;
+   return !!(hb->spec_flags & VFS_SPFL_ANON_MAPPING);
+}
@@ -10,6 +10,9 @@
 void set_fault_handler(int fault, void *ptr);
 void exit_fault_handler_state(void);
 
+/* Valid only in IRQ context: regs of the context interrupted by the IRQ */
+regs_t *get_irq_regs(void);
+
 static ALWAYS_INLINE bool in_irq(void)
 {
    extern ATOMIC(int) __in_irq_count;
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+struct kmutex;
+struct kcond;
+
+/*
+ * Interface to printk's log: a ring buffer of records, each one of them
+ * carrying a sequence number, a timestamp and a log level. The log is read
+ * through iterators, by the console flusher and by /dev/kmsg's readers.
+ */
+
+/* Max length of the text of a record */
+#define KMSG_REC_MAX_LEN               256
+
+/* Record flags */
+#define KMSG_FL_PREFIX                 (1 << 0)  /* print the timestamp */
+#define KMSG_FL_LOWSS                  (1 << 1)  /* low stack space printk */
+#define KMSG_FL_PAD                    (1 << 2)  /* internal: skip to start */
+
+struct kmsg_rec_info {
+
+   u64 ts;           /* get_sys_time() at the moment of the printk() */
+   u32 seq;
+   u16 len;          /* length of the text */
+   u8 level;
+   u8 flags;
+};
+
+struct kmsg_iter {
+   u32 pos;
+   u32 seq;
+};
+
+/*
+ * Reads the record pointed by `it` and its text (truncated to `bufsz` bytes),
+ * moving the iterator forward. Returns 1 when a record has been read, 0 when
+ * there are no new records and -1 when the records pointed by `it` have been
+ * overwritten: in that case the iterator is moved to the oldest record.
+ */
+int kmsg_read_rec(struct kmsg_iter *it,
+                  struct kmsg_rec_info *info,
+                  char *buf,
+                  u32 bufsz);
+
+void kmsg_iter_first(struct kmsg_iter *it);
+void kmsg_iter_last(struct kmsg_iter *it);
+bool kmsg_iter_has_data(struct kmsg_iter *it);
+u32 kmsg_get_dropped_count(void);
+
+/*
+ * Signaled, holding `kmsg_mutex`, by printk's worker thread every time new
+ * records are logged.
+ */
+extern struct kmutex kmsg_mutex;
+extern struct kcond kmsg_cond;
+
+void init_printk_worker(void);
+void init_kmsg(void);
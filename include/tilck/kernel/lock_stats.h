@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Lock statistics (KRN_LOCK_STATS=1).
+ *
+ * Locks are grouped in classes, keyed by their type and by their init site:
+ * the return address of kmutex_init(), kcond_init() and rwlock_*_init(). The
+ * locks statically initialized (e.g. STATIC_KMUTEX_INIT) have no init site:
+ * their key is their own address. Therefore, the rwlocks of all the ramfs
+ * instances share the same class, while a static mutex like `ptys_mutex` has
+ * its own. The kmutex and the kcond internally used by a rwlock are keyed by
+ * the rwlock's init site as well.
+ *
+ * All the times are in TSC cycles. The meaning of the counters is:
+ *
+ *    acquisitions   kmutex: locks (not counting the recursive ones)
+ *                   rwlocks: shared + exclusive locks
+ *                   kcond: waits
+ *
+ *    contended      the acquisitions that had to wait. For kcond, all of them
+ *
+ *    tot_wait,      time spent waiting in the contended acquisitions
+ *    max_wait
+ *
+ *    max_hold       kmutex and rwlocks (exclusive only): time between the
+ *                   acquisition and the release. Not used for kcond.
+ */
+
+enum lock_class_type {
+
+   LOCK_CL_KMUTEX,
+   LOCK_CL_RWLOCK_RP,
+   LOCK_CL_RWLOCK_WP,
+   LOCK_CL_KCOND,
+};
+
+struct lock_class_stats {
+
+   const void *key;                 /* init site or lock's address */
+   enum lock_class_type type;
+
+   u64 acquisitions;
+   u64 contended;
+   u64 tot_wait;
+   u64 max_wait;
+   u64 max_hold;
+};
+
+/* Max number of distinct lock classes. The extra ones go in "<other>" */
+#define LOCK_STATS_MAX_CLASSES                              256
+
+#if KRN_LOCK_STATS
+
+#define LOCK_STATS_ONLY(x) x
+
+struct lock_class_stats *
+lock_stats_get_class(const void *key, enum lock_class_type type);
+
+void
+lock_stats_account_acquire(struct lock_class_stats *cl,
+                           bool contended,
+                           u64 wait_cycles);
+
+void
+lock_stats_account_release(struct lock_class_stats *cl, u64 hold_cycles);
+
+/*
+ * Copies up to `max` classes having at least one acquisition in `buf` and
+ * returns their number.
+ */
+u32 lock_stats_get_all(struct lock_class_stats *buf, u32 max);
+void lock_stats_reset(void);
+
+#else
+
+#define LOCK_STATS_ONLY(x)
+
+static inline u32
+lock_stats_get_all(struct lock_class_stats *buf, u32 max)
+{
+   return 0;
+}
+
+static inline void lock_stats_reset(void) { }
+
+#endif
+
+const char *lock_stats_get_type_str(struct lock_class_stats *cl);
+
+/* Writes the name of the class (e.g. "vfs_init+0x1b") in `buf` */
+void
+lock_stats_get_class_name(struct lock_class_stats *cl, char *buf, size_t sz);
@@ -26,6 +26,7 @@ void register_module(struct module *m);
 /*           Order of initialization of Tilck's modules            */
 
 #define MOD_sysfs_prio                        10  /* first */
+#define MOD_procfs_prio                       15
 #define MOD_pci_prio                          20
 #define MOD_acpi_prio                         30
 #define MOD_kb_prio                           50
@@ -41,6 +41,12 @@ extern char zero_page[PAGE_SIZE];
 void early_init_paging();
 bool handle_potential_cow(void *r);
 
+/*
+ * Handle a write on the present page at `vaddr`, in the current page directory,
+ * in case it's a copy-on-write page. Returns true if it was.
+ */
+bool handle_cow(void *vaddr);
+
 /*
  * Map a pageframe at `paddr` at the virtual address `vaddr` in the page
  * directory `pdir`, using the arch-independent `pg_flags`. This last param
@@ -89,6 +95,7 @@ int get_mapping2(pdir_t *pdir, void *vaddrp, ulong *pa_ref);
 pdir_t *pdir_clone(pdir_t *pdir);
 pdir_t *pdir_deep_clone(pdir_t *pdir);
 void pdir_destroy(pdir_t *pdir);
+size_t pdir_count_user_pages(pdir_t *pdir); /* mapped non-zero user pages */
 void invalidate_page(ulong vaddr);
 void set_page_rw(pdir_t *pdir, void *vaddr, bool rw);
 void retain_pageframes_mapped_at(pdir_t *pdir, void *vaddr, size_t len);
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/kernel/fs/vfs_base.h>
+
+struct perf_event_attr;
+struct task;
+
+/*
+ * Creates a perf event counting on the task `ti` and a handle for it, not
+ * installed in any file descriptor table. Only the counting mode is
+ * supported: no sampling, no groups and read_format must be 0.
+ */
+int
+perf_event_create_handle(struct task *ti,
+                         struct perf_event_attr *attr,
+                         fs_handle *out);
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Hardware performance counters (PMU).
+ *
+ * A pmu_counter counts one event for a single task: the arch code programs it
+ * in a hardware counter only while its task is running, saving its value at
+ * every context switch. The counters are exposed to user space through
+ * perf_event_open() (see kernel/perf_event.c).
+ *
+ * When the CPU has no usable PMU (e.g. QEMU without KVM), pmu_is_available()
+ * returns false and pmu_counter_attach() fails with -ENOENT.
+ */
+
+enum pmu_event {
+
+   PMU_EV_CYCLES,
+   PMU_EV_INSTRUCTIONS,
+   PMU_EV_LLC_MISSES,
+   PMU_EV_BRANCH_MISSES,
+   PMU_EV_DTLB_MISSES,
+
+   PMU_EV_COUNT,
+};
+
+/* pmu_counter flags */
+#define PMU_CNT_USER                                (1 << 0)
+#define PMU_CNT_KERNEL                              (1 << 1)
+
+struct task;
+
+struct pmu_counter {
+
+   enum pmu_event ev;
+   u16 flags;                 /* PMU_CNT_* */
+   bool enabled;
+   s8 hw_idx;                 /* hw counter used, -1 when detached */
+   u64 count;                 /* accumulated until the last save */
+   struct task *ti;           /* NULL once the task is gone */
+};
+
+bool pmu_is_available(void);
+bool pmu_has_event(enum pmu_event ev);
+const char *pmu_get_event_name(enum pmu_event ev);
+
+/*
+ * Assigns a free hw counter of `ti` to `c`, initialized by the caller with its
+ * `ev` and `flags`. The counter starts disabled, with count = 0.
+ */
+int pmu_counter_attach(struct task *ti, struct pmu_counter *c);
+void pmu_counter_detach(struct pmu_counter *c);
+void pmu_counter_enable(struct pmu_counter *c, bool enabled);
+void pmu_counter_reset(struct pmu_counter *c);
+u64 pmu_counter_read(struct pmu_counter *c);
+
+/* Called by switch_to_task() with preemption disabled */
+void pmu_task_switch(struct task *next);
+
+/* Called by free_task(): detaches all the counters of `ti` */
+void pmu_free_task_ctx(struct task *ti);
+
+void init_pmu(void);
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Preemption-off and IRQs-off tracer (KRN_PREEMPTOFF_TRACE=1).
+ *
+ * The 0 -> 1 and 1 -> 0 transitions of the preemption disable counter and
+ * the interrupts disable/enable transitions done by disable_interrupts() and
+ * enable_interrupts() are timestamped with the TSC. For each kind of section,
+ * the longest POFF_TRACE_TOP_N ones are kept, each one with a distinct pair
+ * of start and end call sites: a section with the same sites as an already
+ * recorded one just updates its max duration.
+ *
+ * Limitations: the sections started by the CPU itself, like the interrupt
+ * gates disabling the interrupts, are not seen. The IRQs-off sections ending
+ * in a different task (e.g. through a context switch) are discarded, while
+ * the preemption-off sections crossing a context switch are legit and are
+ * accounted normally.
+ */
+
+#define POFF_TRACE_TOP_N                          16
+
+enum poff_type {
+
+   POFF_PREEMPT,
+   POFF_IRQS,
+};
+
+struct poff_entry {
+
+   u64 cycles;
+   ulong start_site;       /* where the section started */
+   ulong end_site;         /* where the section ended */
+   int tid;                /* the task that ended the section */
+};
+
+#if KRN_PREEMPTOFF_TRACE
+
+#define POFF_TRACE_ONLY(x) x
+
+/*
+ * The begin/end functions use __builtin_return_address() as call site: they
+ * must be called directly by the (always inline) functions changing the
+ * preemption counter or the interrupts flag. The __ variant is for the
+ * out-of-line callers passing their own return address.
+ */
+
+void preemptoff_trace_begin(void);
+void preemptoff_trace_end(void);
+void __preemptoff_trace_end(ulong site);
+
+void irqsoff_trace_begin(void);
+void irqsoff_trace_end(void);
+
+/*
+ * Copies up to `max` entries of the given type in `buf`, sorted by duration
+ * in descending order, and returns their number.
+ */
+u32 poff_trace_get(enum poff_type t, struct poff_entry *buf, u32 max);
+void poff_trace_reset(void);
+
+#else
+
+#define POFF_TRACE_ONLY(x)
+
+static inline u32
+poff_trace_get(enum poff_type t, struct poff_entry *buf, u32 max)
+{
+   return 0;
+}
+
+static inline void poff_trace_reset(void) { }
+
+#endif
+
+/* Writes the name of a call site (e.g. "kmalloc+0x1b") in `buf` */
+void poff_trace_get_site_name(ulong site, char *buf, size_t sz);
@@ -33,6 +33,12 @@ struct mappings_info {
    struct list mappings;
 };
 
+/* Resource usage of the waited children of a process (see rusage.c) */
+struct children_rusage {
+   struct sched_rusage ru;
+   u32 maxrss;                            /* max `maxrss` of the children */
+};
+
 struct process {
 
    REF_COUNTED_OBJECT;
@@ -59,6 +65,11 @@ struct process {
 
    int *set_child_tid;                    /* NOTE: this is an user pointer */
 
+   u32 rss;                               /* resident pages, see rusage.c */
+   u32 rss_gen;                           /* `rss` is valid if up to date */
+   u32 maxrss;                            /* max resident pages */
+   struct children_rusage *children_ru;   /* NULL for the kernel process */
+
    struct kmutex fslock;                  /* protects `handles` and `cwd` */
    mode_t umask;
 
@@ -151,4 +162,12 @@ void init_process_lists(struct process *pi);
 void process_set_cwd2_nolock(struct vfs_path *tp);
 void process_set_cwd2_nolock_raw(struct process *pi, struct vfs_path *tp);
 void terminate_process(int exit_code, int term_sig);
+
+u32 process_update_maxrss(struct process *pi);
+void process_account_user_pages(pdir_t *pdir, int delta);
+void process_account_reaped_child(struct process *pi, struct task *child);
+void process_get_children_rusage(struct process *pi,
+                                 struct sched_rusage *ru,
+                                 u32 *maxrss);
+void process_get_total_rusage(struct task *ti, struct k_rusage *kru);
 void close_cloexec_handles(struct process *pi);
@@ -33,6 +33,9 @@ void remove_all_mappings_of_handle(struct process *pi, fs_handle h);
 void remove_all_user_zero_mem_mappings(struct process *pi);
 struct user_mapping *process_get_user_mapping(void *vaddr);
 void remove_all_file_mappings(struct process *pi);
+void close_all_anon_shared_mappings(struct process *pi);
+bool is_handle_mapped(struct process *pi, fs_handle h);
+long mmap_anon_handle(fs_handle h, size_t len, int prot);
 struct mappings_info *
 duplicate_mappings_info(struct process *new_pi, struct mappings_info *mi);
 
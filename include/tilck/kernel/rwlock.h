@@ -17,6 +17,10 @@ struct rwlock_rp {
    struct task *ex_owner;
 #endif
 
+#if KRN_LOCK_STATS
+   struct lock_class_stats *stats;
+   u64 ex_lock_ts;                   /* TSC value at the last exlock */
+#endif
 };
 
 void rwlock_rp_init(struct rwlock_rp *r);
@@ -51,6 +55,11 @@ struct rwlock_wp {
    bool w;    /* writer waiting */
    bool rec;  /* is exlock operation recursive */
    u16 rc;    /* recursive locking count */
+
+#if KRN_LOCK_STATS
+   struct lock_class_stats *stats;
+   u64 ex_lock_ts;                   /* TSC value at the last exlock */
+#endif
 };
 
 void rwlock_wp_init(struct rwlock_wp *rw, bool recursive);
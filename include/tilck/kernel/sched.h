@@ -9,6 +9,8 @@
 #include <tilck/kernel/bintree.h>
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/sched_lat.h>
+#include <tilck/kernel/preemptoff_trace.h>
 
 #include <tilck_gen_headers/config_sched.h>
 
@@ -42,6 +44,32 @@ struct sched_ticks {
    u64 total_kernel;    /* total life-time ticks spent in kernel */
 };
 
+/* System-wide CPU time, in ticks (see sched_get_cpu_ticks()) */
+struct sched_cpu_ticks {
+
+   u64 user;            /* ticks spent running user tasks in user mode */
+   u64 kernel;          /* ticks spent in kernel, except the idle task */
+   u64 idle;            /* ticks spent running the idle task */
+};
+
+/*
+ * Per-task resource usage counters, see getrusage(2). The times are in TSC
+ * cycles: they are updated at each user/kernel transition and context switch.
+ */
+struct sched_rusage {
+
+   u64 utime;           /* TSC cycles spent in user mode */
+   u64 stime;           /* TSC cycles spent in kernel mode */
+   u32 nvcsw;           /* voluntary context switches */
+   u32 nivcsw;          /* involuntary context switches */
+   u32 minflt;          /* page faults handled without I/O */
+   u32 majflt;          /* page faults that required I/O */
+};
+
+/* Fixed-point format of the load averages (see sched_get_loadavg()) */
+#define LOADAVG_FSHIFT                                     11
+#define LOADAVG_FIXED_1                (1 << LOADAVG_FSHIFT)
+
 struct task {
 
    union {
@@ -84,6 +112,12 @@ struct task {
 
    s32 wstatus;                       /* waitpid's wstatus  */
    struct sched_ticks ticks;          /* scheduler counters */
+   struct sched_rusage ru;            /* resource usage counters */
+   u64 acct_ts;                       /* TSC value at the last ru update */
+
+#if KRN_SCHED_LAT_STATS
+   struct sched_lat_task lat;         /* wakeup and run-queue timestamps */
+#endif
 
    void *kernel_stack;
    void *args_copybuf;
@@ -157,12 +191,28 @@ static ALWAYS_INLINE bool need_reschedule(void)
 static ALWAYS_INLINE void disable_preemption(void)
 {
    extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
+
+#if KRN_PREEMPTOFF_TRACE
+   if (!atomic_fetch_add_explicit(&__disable_preempt, 1, mo_relaxed))
+      preemptoff_trace_begin();
+#else
    atomic_fetch_add_explicit(&__disable_preempt, 1, mo_relaxed);
+#endif
 }
 
 static ALWAYS_INLINE void enable_preemption_nosched(void)
 {
    extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
+
+   /*
+    * NOTE: end the trace *before* enabling the preemption: after that, an IRQ
+    * could start and end another preemption-off section.
+    */
+#if KRN_PREEMPTOFF_TRACE
+   if (atomic_load_explicit(&__disable_preempt, mo_relaxed) == 1)
+      preemptoff_trace_end();
+#endif
+
    atomic_fetch_sub_explicit(&__disable_preempt, 1, mo_relaxed);
 }
 
@@ -175,6 +225,7 @@ void enable_preemption(void);
 static ALWAYS_INLINE void force_enable_preemption(void)
 {
    extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
+   POFF_TRACE_ONLY(preemptoff_trace_end());
    atomic_store_explicit(&__disable_preempt, 0, mo_relaxed);
 }
 
@@ -374,6 +425,24 @@ NODISCARD int kthread_create2(kthread_func_ptr func,
 int iterate_over_tasks(bintree_visit_cb func, void *arg);
 int sched_count_proc_in_group(int pgid);
 int sched_get_session_of_group(int pgid);
+void sched_get_cpu_ticks(struct sched_cpu_ticks *t);
+int sched_get_runnable_count(void);
+void sched_get_loadavg(ulong loads[3]);
+
+void sched_account_cpu_time(struct task *ti);
+void sched_account_task_switch(struct task *prev, struct task *next);
+void sched_get_rusage(struct task *ti, struct sched_rusage *ru);
+
+static inline void
+sched_rusage_add(struct sched_rusage *dst, const struct sched_rusage *src)
+{
+   dst->utime += src->utime;
+   dst->stime += src->stime;
+   dst->nvcsw += src->nvcsw;
+   dst->nivcsw += src->nivcsw;
+   dst->minflt += src->minflt;
+   dst->majflt += src->majflt;
+}
 
 struct process *task_get_pi_opaque(struct task *ti);
 void process_set_tty(struct process *pi, void *t);
@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+/*
+ * Scheduler latency statistics (KRN_SCHED_LAT_STATS=1).
+ *
+ * Two latencies are measured, in TSC cycles, when a task gets the CPU:
+ *
+ *    wakeup      from the moment a sleeping task became runnable (timers,
+ *                kcond signals, tty input etc.) to the moment it ran.
+ *
+ *    runq        from the moment a task became runnable for any reason,
+ *                including preemption and yield, to the moment it ran.
+ *
+ * The idle task is not accounted. The histograms have log2 buckets: bucket
+ * `i` counts the latencies in [2^i, 2^(i+1)) cycles, while the last one
+ * counts all the longer ones too.
+ */
+
+#define SCHED_LAT_HIST_SIZE                   32
+
+struct task;
+
+struct sched_lat_hist {
+
+   u64 count;
+   u64 tot;
+   u64 max;
+   u32 hist[SCHED_LAT_HIST_SIZE];
+};
+
+/* The longest wakeup latency and what was going on when the task woke up */
+struct sched_lat_worst {
+
+   u64 latency;
+   int tid;                /* the woken task */
+   int waker_tid;          /* the task running when `tid` woke up */
+   int prev_tid;           /* the task that ran last, before `tid` */
+   int preempt_count;      /* get_preempt_disable_count() at the wakeup */
+   bool in_irq;            /* the wakeup happened in an IRQ handler */
+};
+
+struct sched_lat_stats {
+
+   struct sched_lat_hist wakeup;
+   struct sched_lat_hist runq;
+   struct sched_lat_worst worst;
+};
+
+/*
+ * Per-task data, in struct task: keep it small, because task+process must fit
+ * in 1 KB with any combination of debug options (see process32.c).
+ */
+struct sched_lat_task {
+
+   u64 runnable_ts;        /* TSC value when the task became runnable */
+   int waker_tid;
+   u16 preempt_count;      /* saturated at 0xffff */
+   bool was_sleeping;      /* the task became runnable by waking up */
+   bool in_irq;
+};
+
+#if KRN_SCHED_LAT_STATS
+
+#define SCHED_LAT_ONLY(x) x
+
+/* Called with interrupts disabled by task_change_state() */
+void sched_lat_on_runnable(struct task *ti, bool was_sleeping);
+void sched_lat_on_running(struct task *ti, struct task *prev);
+
+void sched_lat_get_stats(struct sched_lat_stats *s);
+void sched_lat_reset(void);
+
+#else
+
+#define SCHED_LAT_ONLY(x)
+
+static inline void sched_lat_get_stats(struct sched_lat_stats *s)
+{
+   bzero(s, sizeof(*s));
+}
+
+static inline void sched_lat_reset(void) { }
+
+#endif
+
+/*
+ * Why the task with the worst latency could not run right away, according to
+ * the context of its wakeup: "irq", "preempt-disabled" or "none".
+ */
+const char *sched_lat_get_reason_str(struct sched_lat_worst *w);
@@ -9,5 +9,8 @@ insertion_sort_ptr(void *arr, u32 elem_count, cmpfun_ptr cmp);
 void
 insertion_sort_generic(void *a, ulong elem_sz, u32 elem_count, cmpfun_ptr cmp);
 
+void
+heap_sort_generic(void *a, ulong elem_sz, u32 elem_count, cmpfun_ptr cmp);
+
 void
 array_reverse_ptr(void *a, u32 elem_count);
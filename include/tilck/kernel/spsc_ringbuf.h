@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * SPSC_RINGBUF: a lock-free, single-producer single-consumer, byte ring buffer
+ * designed for moving input data from an IRQ handler (the producer) to its
+ * bottom half (the consumer) without disabling interrupts and without
+ * compare-and-swap loops, unlike safe_ringbuf.
+ *
+ * The read and write positions are free-running counters, touched only by the
+ * consumer and the producer, respectively. Therefore, the size must be a power
+ * of 2. The ring contains the bytes in the [read_pos, write_pos) range.
+ *
+ * Rules:
+ *
+ *    - Only ONE producer: e.g. a single IRQ handler. Nested writes are NOT
+ *      supported.
+ *
+ *    - Only ONE consumer: e.g. a bottom half running on a single worker
+ *      thread. It's always fine for the producer to interrupt the consumer.
+ *
+ * When the ring is full, the new bytes are dropped and counted in `dropped`.
+ */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/atomics.h>
+
+struct spsc_ringbuf {
+
+   ATOMIC(u32) read_pos;
+   ATOMIC(u32) write_pos;
+   u32 size;
+   u8 *buf;
+
+   /* Stats: `batches` is updated by the consumer, the rest by the producer */
+   ulong written;
+   ulong dropped;
+   ulong batches;
+};
+
+void spsc_ringbuf_init(struct spsc_ringbuf *rb, u32 size, void *buf);
+bool spsc_ringbuf_is_empty(struct spsc_ringbuf *rb);
+
+/* Producer side: returns false (dropping the byte) if the ring is full */
+bool spsc_ringbuf_write_1(struct spsc_ringbuf *rb, u8 val);
+
+/* Consumer side: reads up to `len` bytes and returns their number */
+u32 spsc_ringbuf_read(struct spsc_ringbuf *rb, void *buf, u32 len);
@@ -7,6 +7,7 @@
 #include <tilck/kernel/list.h>
 
 struct task;
+struct lock_class_stats;
 
 enum wo_type {
 
@@ -151,6 +152,11 @@ struct kmutex {
    u32 num_waiters;
    u32 max_num_waiters;
 #endif
+
+#if KRN_LOCK_STATS
+   struct lock_class_stats *stats;   /* NULL until the first lock, if static */
+   u64 lock_ts;                      /* TSC value at the last acquisition */
+#endif
 };
 
 #define STATIC_KMUTEX_INIT(m, fl)                 \
@@ -190,6 +196,10 @@ bool kmutex_is_curr_task_holding_lock(struct kmutex *m);
 struct kcond {
 
    struct list wait_list;
+
+#if KRN_LOCK_STATS
+   struct lock_class_stats *stats;   /* NULL until the first wait, if static */
+#endif
 };
 
 #define STATIC_KCOND_INIT(s)                     \
@@ -32,6 +32,15 @@
 #include <sys/utsname.h>  // system header
 #include <sys/stat.h>     // system header
 #include <fcntl.h>        // system header
+#include <linux/falloc.h> // system header
+#include <linux/aio_abi.h> // system header
+#include <linux/perf_event.h> // system header
+
+/* Not exposed by libc's headers without _GNU_SOURCE */
+#ifndef SEEK_DATA
+   #define SEEK_DATA    3
+   #define SEEK_HOLE    4
+#endif
 
 typedef u64 tilck_ino_t;
 
@@ -133,7 +133,8 @@ CREATE_STUB_SYSCALL_IMPL(sys_sigpending)
 CREATE_STUB_SYSCALL_IMPL(sys_sethostname)
 CREATE_STUB_SYSCALL_IMPL(sys_setrlimit)
 CREATE_STUB_SYSCALL_IMPL(sys_old_getrlimit)
-CREATE_STUB_SYSCALL_IMPL(sys_getrusage)
+
+int sys_getrusage(int who, struct k_rusage *u_usage);
 
 int sys_gettimeofday(struct timeval *tv, struct timezone *tz);
 
@@ -359,11 +360,19 @@ CREATE_STUB_SYSCALL_IMPL(sys_sched_getaffinity)
 int sys_set_thread_area(void *u_info);
 
 CREATE_STUB_SYSCALL_IMPL(sys_get_thread_area)
-CREATE_STUB_SYSCALL_IMPL(sys_io_setup)
-CREATE_STUB_SYSCALL_IMPL(sys_io_destroy)
-CREATE_STUB_SYSCALL_IMPL(sys_io_getevents)
-CREATE_STUB_SYSCALL_IMPL(sys_io_submit)
-CREATE_STUB_SYSCALL_IMPL(sys_io_cancel)
+
+int sys_io_setup(u32 nr_events, aio_context_t *u_ctxp);
+int sys_io_destroy(aio_context_t ctx_id);
+
+int sys_io_getevents(aio_context_t ctx_id, long min_nr, long nr,
+                     struct io_event *u_events,
+                     struct k_timespec32 *u_timeout);
+
+int sys_io_submit(aio_context_t ctx_id, long nr, struct iocb **u_iocbpp);
+
+int sys_io_cancel(aio_context_t ctx_id, struct iocb *u_iocb,
+                  struct io_event *u_result);
+
 CREATE_STUB_SYSCALL_IMPL(sys_fadvise64)
 
 NORETURN int sys_exit_group(int status);
@@ -449,12 +458,21 @@ int sys_utimensat_time32(int dirfd, const char *u_path,
 
 CREATE_STUB_SYSCALL_IMPL(sys_signalfd)
 CREATE_STUB_SYSCALL_IMPL(sys_timerfd_create)
-CREATE_STUB_SYSCALL_IMPL(sys_eventfd)
-CREATE_STUB_SYSCALL_IMPL(sys_fallocate)
+
+int sys_eventfd(unsigned int initval);
+
+int sys_fallocate(int fd, int mode, s64 offset, s64 len);
+
+int sys_copy_file_range(int fd_in, s64 *u_off_in,
+                        int fd_out, s64 *u_off_out,
+                        size_t len, u32 flags);
+
 CREATE_STUB_SYSCALL_IMPL(sys_timerfd_settime32)
 CREATE_STUB_SYSCALL_IMPL(sys_timerfd_gettime32)
 CREATE_STUB_SYSCALL_IMPL(sys_signalfd4)
-CREATE_STUB_SYSCALL_IMPL(sys_eventfd2)
+
+int sys_eventfd2(unsigned int initval, int flags);
+
 CREATE_STUB_SYSCALL_IMPL(sys_epoll_create1)
 CREATE_STUB_SYSCALL_IMPL(sys_dup3)
 
@@ -464,7 +482,10 @@ CREATE_STUB_SYSCALL_IMPL(sys_inotify_init1)
 CREATE_STUB_SYSCALL_IMPL(sys_preadv)
 CREATE_STUB_SYSCALL_IMPL(sys_pwritev)
 CREATE_STUB_SYSCALL_IMPL(sys_rt_tgsigqueueinfo)
-CREATE_STUB_SYSCALL_IMPL(sys_perf_event_open)
+
+int sys_perf_event_open(struct perf_event_attr *u_attr,
+                        int pid, int cpu, int group_fd, ulong flags);
+
 CREATE_STUB_SYSCALL_IMPL(sys_recvmmsg_time32)
 
 CREATE_STUB_SYSCALL_IMPL(sys_fanotify_init)
@@ -487,7 +508,9 @@ CREATE_STUB_SYSCALL_IMPL(sys_sched_getattr)
 CREATE_STUB_SYSCALL_IMPL(sys_renameat2)
 CREATE_STUB_SYSCALL_IMPL(sys_seccomp)
 CREATE_STUB_SYSCALL_IMPL(sys_getrandom)
-CREATE_STUB_SYSCALL_IMPL(sys_memfd_create)
+
+int sys_memfd_create(const char *u_name, unsigned int flags);
+
 CREATE_STUB_SYSCALL_IMPL(sys_bpf)
 CREATE_STUB_SYSCALL_IMPL(sys_execveat)
 CREATE_STUB_SYSCALL_IMPL(sys_socket)
@@ -508,7 +531,6 @@ CREATE_STUB_SYSCALL_IMPL(sys_shutdown)
 CREATE_STUB_SYSCALL_IMPL(sys_userfaultfd)
 CREATE_STUB_SYSCALL_IMPL(sys_membarrier)
 CREATE_STUB_SYSCALL_IMPL(sys_mlock2)
-CREATE_STUB_SYSCALL_IMPL(sys_copy_file_range)
 CREATE_STUB_SYSCALL_IMPL(sys_preadv2)
 CREATE_STUB_SYSCALL_IMPL(sys_pwritev2)
 CREATE_STUB_SYSCALL_IMPL(sys_pkey_mprotect)
@@ -516,7 +538,12 @@ CREATE_STUB_SYSCALL_IMPL(sys_pkey_alloc)
 CREATE_STUB_SYSCALL_IMPL(sys_pkey_free)
 CREATE_STUB_SYSCALL_IMPL(sys_statx)
 CREATE_STUB_SYSCALL_IMPL(sys_arch_prctl)
-CREATE_STUB_SYSCALL_IMPL(sys_io_pgetevents_time32)
+
+int sys_io_pgetevents_time32(aio_context_t ctx_id, long min_nr, long nr,
+                             struct io_event *u_events,
+                             struct k_timespec32 *u_timeout,
+                             const void *u_sig);
+
 CREATE_STUB_SYSCALL_IMPL(sys_rseq)
 
 CREATE_STUB_SYSCALL_IMPL(sys_semget)
@@ -545,7 +572,12 @@ CREATE_STUB_SYSCALL_IMPL(sys_timerfd_settime)
 CREATE_STUB_SYSCALL_IMPL(sys_utimensat)
 CREATE_STUB_SYSCALL_IMPL(sys_pselect6_time32)
 CREATE_STUB_SYSCALL_IMPL(sys_ppoll_time32)
-CREATE_STUB_SYSCALL_IMPL(sys_io_pgetevents)
+
+int sys_io_pgetevents(aio_context_t ctx_id, long min_nr, long nr,
+                      struct io_event *u_events,
+                      struct k_timespec64 *u_timeout,
+                      const void *u_sig);
+
 CREATE_STUB_SYSCALL_IMPL(sys_recvmmsg)
 CREATE_STUB_SYSCALL_IMPL(sys_mq_timedsend)
 CREATE_STUB_SYSCALL_IMPL(sys_mq_timedreceive)
@@ -34,6 +34,7 @@ struct video_interface {
 enum term_type {
    term_type_video,
    term_type_serial,
+   term_type_pty,
 };
 
 struct term_params {
@@ -66,7 +67,23 @@ struct term_interface {
    void (*set_col_offset)(term *t, int off);
    void (*pause_video_output)(term *t);
    void (*restart_video_output)(term *t);
-   void (*set_filter)(term *t, term_filter func, void *ctx);
+
+   /*
+    * `ascii_passthrough` tells the term that `func` writes the printable ASCII
+    * chars [0x20, 0x7e] unchanged, without any side effect. In that case, the
+    * term is allowed to write whole runs of them without calling `func`.
+    */
+   void (*set_filter)(term *t,
+                      term_filter func,
+                      void *ctx,
+                      bool ascii_passthrough);
+
+   /*
+    * Optional: the max number of rows in the scrollback history. Shrinking
+    * the history drops its oldest rows.
+    */
+   u32 (*get_scrollback)(term *t);
+   int (*set_scrollback)(term *t, u32 rows);
 
    /*
     * The first term must be pre-allocated but _not_ pre-initialized.
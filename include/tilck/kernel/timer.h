@@ -14,5 +14,26 @@ ms_to_ticks(u64 ms)
    return ms / (1000 / TIMER_HZ);
 }
 
+/*
+ * The unit of clock_t in the user space ABI, sysconf(_SC_CLK_TCK). It's 100,
+ * like on Linux, whatever TIMER_HZ is.
+ */
+#define USER_HZ                                          100
+
+static ALWAYS_INLINE u64
+ticks_to_clock_t(u64 ticks)
+{
+   return ticks * USER_HZ / TIMER_HZ;
+}
+
+static ALWAYS_INLINE u64
+ns_to_clock_t(u64 ns)
+{
+   return ns / (1000 * 1000 * 1000 / USER_HZ);
+}
+
 u64 get_ticks(void);
 void init_timer(void);
+
+u32 get_tsc_khz(void);         /* TSC frequency in kHz, 0 until measured */
+u64 tsc_to_ns(u64 cycles);     /* convert TSC cycles to nanoseconds */
@@ -13,8 +13,10 @@ static ALWAYS_INLINE struct tty *get_curr_tty(void)
 }
 
 void tty_send_keyevent(struct tty *t, struct key_event ke, bool block);
+void tty_send_input(struct tty *t, const char *buf, size_t len, bool block);
 void tty_setup_for_panic(struct tty *t);
 int tty_get_num(struct tty *t);
+int tty_get_dev_nr(struct tty *t);
 void tty_restore_kd_text_mode(struct tty *t);
 struct tty *get_serial_tty(int n);
 void tty_reset_termios(struct tty *t);
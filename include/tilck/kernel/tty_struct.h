@@ -13,6 +13,7 @@
 #include <linux/kd.h>     // system header
 
 struct tty;
+struct pty;
 typedef bool (*tty_ctrl_sig_func)(struct tty *, bool);
 
 void tty_reset_filter_ctx(struct tty *t);
@@ -36,8 +37,10 @@ struct tty {
    int end_line_delim_count;
 
    bool mediumraw_mode;
+   bool hung_up;                /* pty slaves only: the master got closed */
    u8 curr_color;
    u16 serial_port_fwd;
+   struct pty *pty;             /* != NULL only for pty slaves */
 
    char *input_buf;
    u32 kd_gfx_mode;
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Sampling profiler, part of the tracing module.
+ *
+ * When enabled, every `interval` timer ticks the timer IRQ handler records the
+ * interrupted context (tid, user/kernel mode, instruction pointer and a short
+ * frame-pointer backtrace) in a ring of PROF_MAX_SAMPLES samples, overwriting
+ * the oldest ones. The samples are exported as folded stacks (the input format
+ * of the flame graph tools) in /syst/profiler/folded.
+ */
+
+#define PROF_MAX_SAMPLES                                2048
+#define PROF_MAX_DEPTH                                     8
+
+#define PROF_SAMPLE_USER                            (1 << 0)
+
+struct prof_sample {
+
+   int tid;
+   u16 flags;                    /* PROF_SAMPLE_* */
+   u16 depth;                    /* number of valid `pcs` */
+   ulong pcs[PROF_MAX_DEPTH];    /* pcs[0]: the IP, then the return addrs */
+};
+
+int prof_set_enabled(bool enabled);
+void prof_set_interval(u32 ticks);
+u32 prof_get_interval(void);
+void prof_reset(void);
+
+/* Called by the timer IRQ handler */
+void prof_timer_tick(void);
+
+/*
+ * Calls `cb` on each sample, from the oldest one. The profiler is paused
+ * meanwhile. Must be called in process context.
+ */
+void prof_foreach_sample(void (*cb)(struct prof_sample *, void *), void *arg);
+
+/* Symbol name of the function containing the n-th pc of a kernel sample */
+const char *prof_get_kernel_sym(struct prof_sample *s, u32 n);
+
+static ALWAYS_INLINE bool
+prof_is_enabled(void)
+{
+   extern bool __prof_on;
+   return __prof_on;
+}
@@ -13,9 +13,16 @@ char serial_read(u16 port);
 bool serial_write_ready(u16 port);
 void serial_wait_for_write(u16 port);
 void serial_write(u16 port, char c);
+void serial_write_nowait(u16 port, char c);
+u32 serial_get_tx_fifo_size(u16 port);
+void serial_set_tx_intr(u16 port, bool enabled);
+
+void serial_write_buf(u16 port, const char *buf, size_t len);
 
 #if MOD_serial
    void early_init_serial_ports(void);
+   void serial_flush_tx_all(void);
 #else
    static inline void early_init_serial_ports(void) { }
+   static inline void serial_flush_tx_all(void) { }
 #endif
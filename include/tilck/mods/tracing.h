@@ -2,47 +2,13 @@
 
 #pragma once
 #include <tilck/common/basic_defs.h>
+#include <tilck/common/tracing_buf.h>
 #include <tilck/kernel/syscalls.h>
 
 #define INVALID_SYSCALL           ((u32) -1)
 #define NO_SLOT                           -1
 #define TRACED_SYSCALLS_STR_LEN         128u
-
-enum trace_event_type {
-   te_invalid,
-   te_sys_enter,
-   te_sys_exit,
-};
-
-struct trace_event {
-
-   enum trace_event_type type;
-   int tid;
-
-   u64 sys_time;
-
-   u32 sys;
-   long retval;
-   ulong args[6];
-
-   union {
-
-      struct {
-         char d0[64];
-         char d1[64];
-         char d2[32];
-         char d3[16];
-      } fmt0;
-
-      struct {
-         char d0[128];
-         char d1[32];
-         char d2[16];
-      } fmt1;
-   };
-};
-
-STATIC_ASSERT(sizeof(struct trace_event) <= 256);
+#define SYS_STATS_HIST_SIZE              32
 
 enum sys_param_ui_type {
 
@@ -125,6 +91,20 @@ struct syscall_info {
    struct sys_param_info params[6];
 };
 
+/*
+ * Per-syscall latency statistics, in TSC cycles. The latency is measured
+ * around the call of the syscall's function and includes the time spent
+ * blocked, if any. hist[i] counts the calls which took [2^i, 2^(i+1)) cycles,
+ * while the last bucket counts all the slower ones too.
+ */
+struct syscall_stats {
+
+   u64 calls;
+   u64 tot_cycles;
+   u64 max_cycles;
+   u32 hist[SYS_STATS_HIST_SIZE];
+};
+
 void
 init_tracing(void);
 
@@ -186,6 +166,21 @@ set_traced_syscalls(const char *str);
 int
 tracing_get_in_buffer_events_count(void);
 
+int
+syscall_stats_set_enabled(bool enabled);
+
+void
+syscall_stats_reset(void);
+
+bool
+syscall_stats_get(u32 sys_n, struct syscall_stats *out);
+
+void
+syscall_stats_account(u32 sys_n, u64 cycles);
+
+u32
+tracing_get_dropped_events_count(void);
+
 extern const struct syscall_info *tracing_metadata;
 extern const struct sys_param_type ptype_int;
 extern const struct sys_param_type ptype_voidp;
@@ -263,6 +258,13 @@ tracing_set_dump_big_bufs_opt(bool enabled)
    __tracing_dump_big_bufs = enabled;
 }
 
+static ALWAYS_INLINE bool
+syscall_stats_is_enabled(void)
+{
+   extern bool __syscall_stats_on;
+   return __syscall_stats_on;
+}
+
 #define trace_sys_enter(sn, ...)                                               \
    if (MOD_tracing && tracing_is_enabled() && tracing_is_enabled_on_sys(sn)) { \
       trace_syscall_enter_int(sn, __VA_ARGS__);                                \
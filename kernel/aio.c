@@ -0,0 +1,988 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/atomics.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/aio.h>
+#include <tilck/kernel/eventfd.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/worker_thread.h>
+
+#include <sys/mman.h>      // system header
+
+/*
+ * Asynchronous I/O (io_setup, io_submit, io_getevents etc.)
+ * -----------------------------------------------------------
+ *
+ * Each AIO context owns a ring buffer of completion events, which is mapped in
+ * the user space exactly like on Linux: the context ID is the address of the
+ * ring and the user space can reap the events directly from there, without
+ * calling io_getevents(). The ring is a kernelfs object owned by its mapping
+ * (see VFS_SPFL_ANON_MAPPING): un-mapping it destroys the context as well.
+ *
+ * Each request is executed by a worker thread, on a private duplicate of the
+ * file handle, in order to have a private file position. Worker threads cannot
+ * handle page faults in the user space of the process owning the context:
+ * they look up the physical pages of the user buffers in the page directory of
+ * the owner, with preemption disabled, and use a bounce buffer. Because of
+ * that, the pages of the buffers of the read requests are made writable at
+ * submit time and requests fail with -EFAULT if the buffers get un-mapped (or
+ * become read-only because of a fork()) before the requests are executed.
+ *
+ * Each request retains its context: closing the owner's handle doesn't wait
+ * for the in-flight requests. It cancels the ones not started yet and marks
+ * the context as dead: from that moment, no request touches the user space of
+ * the owner anymore, which therefore is free to go away.
+ */
+
+#define AIO_RING_MAGIC                   0xa10a10a1
+#define AIO_RING_COMPAT_FEATURES                  1
+#define AIO_RING_INCOMPAT_FEATURES                0
+
+#define AIO_WTH_PRIO                             10
+#define AIO_BOUNCE_BUF_SIZE          (4 * PAGE_SIZE)
+
+/* Max in-flight requests per context, on the queue of the AIO worker */
+#define AIO_CTX_MAX_IN_FLIGHT    (WTH_AIO_QUEUE_SIZE / 4)
+
+/* The layout of the ring is part of the ABI [Linux] */
+struct aio_ring {
+
+   u32 id;
+   u32 nr;                    /* number of slots in the `io_events` array */
+   ATOMIC(u32) head;          /* written by the user space */
+   ATOMIC(u32) tail;          /* written by the kernel */
+
+   u32 magic;
+   u32 compat_features;
+   u32 incompat_features;
+   u32 header_length;         /* size of this struct */
+
+   struct io_event io_events[];
+};
+
+STATIC_ASSERT(sizeof(struct aio_ring) == 32);
+
+struct aio_ctx {
+
+   KOBJ_BASE_FIELDS
+
+   struct process *pi;        /* owner process */
+   struct aio_ring *ring;
+   size_t ring_size;
+   u32 nr;                    /* copy of ring->nr, not writable by the user */
+   u32 tail;                  /* copy of ring->tail, as above */
+   u32 in_flight;             /* submitted requests not completed yet */
+   bool dead;                 /* the owner's handle has been closed */
+
+   struct kmutex lock;
+   struct kcond cond;         /* signaled on every completion */
+   struct list reqs;          /* in-flight requests */
+};
+
+struct aio_req {
+
+   struct list_node node;
+   struct aio_ctx *ctx;
+   fs_handle h;               /* private dup of the iocb's file handle */
+   fs_handle resfd;           /* dup of the eventfd handle or NULL */
+
+   struct iovec *iov;
+   int iovcnt;
+   struct iovec single_iov;
+
+   u64 data;                  /* iocb->aio_data */
+   u64 obj;                   /* user address of the iocb */
+   u16 opcode;
+   bool started;
+   bool cancelled;
+};
+
+static const struct file_ops static_ops_aio_ring;
+static struct worker_thread *aio_wth;
+
+/* Number of events in the ring, not reaped by the user space yet */
+static u32 aio_ring_used(struct aio_ctx *ctx)
+{
+   const u32 head = atomic_load_explicit(&ctx->ring->head, mo_acquire);
+   return (ctx->tail + ctx->nr - head % ctx->nr) % ctx->nr;
+}
+
+/*
+ * Copy data from/to the user space of the owner of `ctx`, without relying on
+ * page faults. Works in any context, including worker threads.
+ */
+static int
+aio_user_copy(struct aio_ctx *ctx, ulong uva, char *buf, size_t len, bool to)
+{
+   struct process *pi = ctx->pi;
+   size_t n;
+   ulong pa;
+   int rc = 0;
+
+   if (user_out_of_range((void *)uva, len))
+      return -EFAULT;
+
+   while (len > 0) {
+
+      n = MIN(len, PAGE_SIZE - (uva & OFFSET_IN_PAGE_MASK));
+
+      disable_preemption();
+      {
+         if (ctx->dead)
+            rc = -EFAULT; /* the owner's user space might be gone */
+         else if (to && !is_rw_mapped(pi->pdir, (void *)uva))
+            rc = -EFAULT;
+         else if (get_mapping2(pi->pdir, (void *)uva, &pa) < 0)
+            rc = -EFAULT;
+         else if (pa >= LINEAR_MAPPING_SIZE)
+            rc = -EFAULT; /* not RAM (e.g. the framebuffer) */
+
+         if (!rc) {
+
+            if (to)
+               memcpy(KERNEL_PA_TO_VA(pa), buf, n);
+            else
+               memcpy(buf, KERNEL_PA_TO_VA(pa), n);
+         }
+      }
+      enable_preemption();
+
+      if (rc)
+         break;
+
+      uva += n;
+      buf += n;
+      len -= n;
+   }
+
+   return rc;
+}
+
+static s64 aio_do_rw(struct aio_req *req, bool write)
+{
+   struct aio_ctx *ctx = req->ctx;
+   s64 tot = 0;
+   ssize_t rc = 0;
+   size_t rem, n;
+   ulong ubuf;
+   char *buf;
+
+   if (!(buf = kmalloc(AIO_BOUNCE_BUF_SIZE)))
+      return -ENOMEM;
+
+   for (int i = 0; i < req->iovcnt; i++) {
+
+      ubuf = (ulong)req->iov[i].iov_base;
+      rem = req->iov[i].iov_len;
+
+      while (rem > 0) {
+
+         n = MIN(rem, AIO_BOUNCE_BUF_SIZE);
+
+         if (write) {
+
+            if ((rc = aio_user_copy(ctx, ubuf, buf, n, false)))
+               goto out;
+
+            rc = vfs_write(req->h, buf, n);
+
+         } else {
+
+            rc = vfs_read(req->h, buf, n);
+
+            if (rc > 0 && aio_user_copy(ctx, ubuf, buf, (size_t)rc, true)) {
+               rc = -EFAULT;
+               goto out;
+            }
+         }
+
+         if (rc <= 0)
+            goto out;
+
+         tot += rc;
+         ubuf += (size_t)rc;
+         rem -= (size_t)rc;
+
+         if ((size_t)rc < n)
+            goto out; /* short read or write */
+      }
+   }
+
+out:
+   kfree2(buf, AIO_BOUNCE_BUF_SIZE);
+   return tot > 0 ? tot : rc;
+}
+
+static void aio_destroy_ctx(struct aio_ctx *ctx);
+
+static void aio_free_req(struct aio_req *req)
+{
+   if (req->iov != &req->single_iov)
+      kfree_array_obj(req->iov, struct iovec, req->iovcnt);
+
+   if (req->resfd)
+      vfs_close(req->resfd);
+
+   if (req->h)
+      vfs_close(req->h);
+
+   /* The owner's handle might have been closed in the meanwhile */
+   if (!release_obj(req->ctx))
+      aio_destroy_ctx(req->ctx);
+
+   kfree_obj(req, struct aio_req);
+}
+
+static void aio_complete(struct aio_req *req, s64 res)
+{
+   struct aio_ctx *ctx = req->ctx;
+
+   kmutex_lock(&ctx->lock);
+   {
+      ctx->ring->io_events[ctx->tail] = (struct io_event) {
+         .data = req->data,
+         .obj = req->obj,
+         .res = res,
+         .res2 = 0,
+      };
+
+      ctx->tail = (ctx->tail + 1) % ctx->nr;
+      atomic_store_explicit(&ctx->ring->tail, ctx->tail, mo_release);
+      list_remove(&req->node);
+      ctx->in_flight--;
+      kcond_signal_all(&ctx->cond);
+   }
+   kmutex_unlock(&ctx->lock);
+
+   if (req->resfd)
+      eventfd_signal(req->resfd, 1);
+
+   aio_free_req(req);
+}
+
+/* Runs in a worker thread */
+static void aio_run_req(void *arg)
+{
+   struct aio_req *req = arg;
+   struct aio_ctx *ctx = req->ctx;
+   bool cancelled;
+   s64 res;
+
+   kmutex_lock(&ctx->lock);
+   {
+      req->started = true;
+      cancelled = req->cancelled;
+   }
+   kmutex_unlock(&ctx->lock);
+
+   if (cancelled) {
+      aio_complete(req, -ECANCELED);
+      return;
+   }
+
+   switch (req->opcode) {
+
+      case IOCB_CMD_PREAD:
+      case IOCB_CMD_PREADV:
+         res = aio_do_rw(req, false);
+         break;
+
+      case IOCB_CMD_PWRITE:
+      case IOCB_CMD_PWRITEV:
+         res = aio_do_rw(req, true);
+         break;
+
+      case IOCB_CMD_FSYNC:
+         res = vfs_fsync(req->h);
+         break;
+
+      case IOCB_CMD_FDSYNC:
+         res = vfs_fdatasync(req->h);
+         break;
+
+      default:
+         NOT_REACHED();
+   }
+
+   aio_complete(req, res);
+}
+
+static void aio_on_handle_close(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct aio_ctx *ctx = (void *)kh->kobj;
+   struct aio_req *pos;
+
+   if (kh->pi != ctx->pi)
+      return; /* handle inherited by a child process: it doesn't own ctx */
+
+   kmutex_lock(&ctx->lock);
+   {
+      /*
+       * Don't wait for the in-flight requests: they retain `ctx` and, once
+       * it's dead, they don't touch the owner's address space anymore (see
+       * aio_user_copy()). The ones not started yet will complete with
+       * -ECANCELED without even trying.
+       */
+      ctx->dead = true;
+
+      list_for_each_ro(pos, &ctx->reqs, node) {
+         pos->cancelled = true;
+      }
+   }
+   kmutex_unlock(&ctx->lock);
+}
+
+static void aio_destroy_ctx(struct aio_ctx *ctx)
+{
+   ASSERT(ctx->in_flight == 0);
+
+   release_pageframes_mapped_at(get_kernel_pdir(), ctx->ring, ctx->ring_size);
+   kfree2(ctx->ring, ctx->ring_size);
+   kcond_destory(&ctx->cond);
+   kmutex_destroy(&ctx->lock);
+   kfree_obj(ctx, struct aio_ctx);
+}
+
+static struct aio_ctx *aio_create_ctx(u32 nr_events)
+{
+   struct aio_ctx *ctx;
+   size_t size;
+
+   /* One slot is always left empty, to distinguish a full ring */
+   size = sizeof(struct aio_ring) + (nr_events + 1) * sizeof(struct io_event);
+   size = roundup_next_power_of_2(MAX(size, (size_t)PAGE_SIZE));
+
+   if (!(ctx = kzalloc_obj(struct aio_ctx)))
+      return NULL;
+
+   if (!(ctx->ring = kzmalloc(size))) {
+      kfree_obj(ctx, struct aio_ctx);
+      return NULL;
+   }
+
+   ASSERT(IS_PAGE_ALIGNED(ctx->ring));
+
+   /* The pages of the ring get mapped in the user space */
+   retain_pageframes_mapped_at(get_kernel_pdir(), ctx->ring, size);
+
+   ctx->on_handle_close = &aio_on_handle_close;
+   ctx->destory_obj = (void *)&aio_destroy_ctx;
+   ctx->pi = get_curr_proc();
+   ctx->ring_size = size;
+   ctx->nr = (u32)((size - sizeof(struct aio_ring)) / sizeof(struct io_event));
+   kmutex_init(&ctx->lock, 0);
+   kcond_init(&ctx->cond);
+   list_init(&ctx->reqs);
+
+   ctx->ring->nr = ctx->nr;
+   ctx->ring->magic = AIO_RING_MAGIC;
+   ctx->ring->compat_features = AIO_RING_COMPAT_FEATURES;
+   ctx->ring->incompat_features = AIO_RING_INCOMPAT_FEATURES;
+   ctx->ring->header_length = sizeof(struct aio_ring);
+   return ctx;
+}
+
+static int aio_ring_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
+{
+   struct kfs_handle *kh = um->h;
+   struct aio_ctx *ctx = (void *)kh->kobj;
+   const size_t pg_count = um->len >> PAGE_SHIFT;
+   size_t mapped_cnt;
+
+   if (um->off + um->len > ctx->ring_size)
+      return -EINVAL;
+
+   if (flags & VFS_MM_DONT_MMAP)
+      return 0;
+
+   mapped_cnt = map_pages(pdir,
+                          um->vaddrp,
+                          KERNEL_VA_TO_PA(ctx->ring) + um->off,
+                          pg_count,
+                          PAGING_FL_RWUS | PAGING_FL_SHARED);
+
+   if (mapped_cnt != pg_count) {
+      unmap_pages_permissive(pdir, um->vaddrp, mapped_cnt, false);
+      return -ENOMEM;
+   }
+
+   return 0;
+}
+
+static const struct file_ops static_ops_aio_ring =
+{
+   .mmap = aio_ring_mmap,
+   .munmap = generic_fs_munmap,
+};
+
+/* Returns the context with the given ID, if it's owned by this process */
+static struct aio_ctx *aio_get_ctx(aio_context_t ctx_id, fs_handle *h_ref)
+{
+   struct process *pi = get_curr_proc();
+   struct user_mapping *um;
+   struct kfs_handle *kh = NULL;
+   struct aio_ctx *ctx = NULL;
+
+   disable_preemption();
+   {
+      um = process_get_user_mapping((void *)ctx_id);
+
+      if (um && um->vaddr == ctx_id && um->h) {
+
+         kh = um->h;
+
+         if (kh->fops == &static_ops_aio_ring && um->off == 0)
+            ctx = (void *)kh->kobj;
+      }
+   }
+   enable_preemption();
+
+   if (!ctx || ctx->dead || ctx->pi != pi || kh->pi != pi)
+      return NULL;
+
+   if (h_ref)
+      *h_ref = kh;
+
+   return ctx;
+}
+
+int sys_io_setup(u32 nr_events, aio_context_t *u_ctxp)
+{
+   struct fs_handle_base *h;
+   struct aio_ctx *ctx;
+   aio_context_t ctx_id;
+   long vaddr;
+
+   if (copy_from_user(&ctx_id, u_ctxp, sizeof(ctx_id)))
+      return -EFAULT;
+
+   if (ctx_id || !nr_events)
+      return -EINVAL;
+
+   if (nr_events > AIO_MAX_EVENTS)
+      return -EAGAIN;
+
+   if (!(ctx = aio_create_ctx(nr_events)))
+      return -ENOMEM;
+
+   h = (void *)kfs_create_new_handle(&static_ops_aio_ring, (void *)ctx, O_RDWR);
+
+   if (!h) {
+      aio_destroy_ctx(ctx);
+      return -ENOMEM;
+   }
+
+   /* From now on, the handle is owned by its mapping, as in MAP_ANONYMOUS */
+   h->spec_flags |= VFS_SPFL_ANON_MAPPING;
+   vaddr = mmap_anon_handle(h, ctx->ring_size, PROT_READ | PROT_WRITE);
+
+   if (vaddr < 0)
+      return (int)vaddr;
+
+   ctx_id = (aio_context_t)vaddr;
+
+   if (copy_to_user(u_ctxp, &ctx_id, sizeof(ctx_id))) {
+      vfs_close(h);
+      return -EFAULT;
+   }
+
+   return 0;
+}
+
+int sys_io_destroy(aio_context_t ctx_id)
+{
+   fs_handle h;
+
+   if (!aio_get_ctx(ctx_id, &h))
+      return -EINVAL;
+
+   /*
+    * Closing the handle removes the ring's mapping and cancels the requests
+    * not started yet. The in-flight ones won't touch the user buffers anymore
+    * (see aio_on_handle_close()).
+    */
+   vfs_close(h);
+   return 0;
+}
+
+/*
+ * Make the buffer writable now, while we're in the context of its process: at
+ * least because of copy-on-write, that's not always the case. Resolve the
+ * write faults like the page fault handler would, without touching the user
+ * memory: writing it here could undo concurrent writes of other threads.
+ */
+static bool aio_prefault_write_page(pdir_t *pdir, void *va)
+{
+   struct user_mapping *um;
+
+   ASSERT(!is_preemption_enabled());
+
+   if (is_rw_mapped(pdir, va))
+      return true;
+
+   if (is_mapped(pdir, va) && handle_cow(va))
+      return true;
+
+   um = process_get_user_mapping(va);
+
+   if (!um || !um->h || !(um->prot & PROT_WRITE))
+      return false;
+
+   return vfs_handle_fault(um->h, va, is_mapped(pdir, va), true);
+}
+
+static int aio_prefault_write(ulong ubuf, size_t len)
+{
+   pdir_t *pdir = get_curr_proc()->pdir;
+   const ulong end = ubuf + len;
+   bool ok = true;
+
+   for (ulong va = ubuf & PAGE_MASK; ok && va < end; va += PAGE_SIZE) {
+
+      disable_preemption();
+      {
+         ok = aio_prefault_write_page(pdir, TO_PTR(va));
+      }
+      enable_preemption();
+   }
+
+   return ok ? 0 : -EFAULT;
+}
+
+static int aio_prepare_rw(struct aio_req *req, struct iocb *cb, bool write)
+{
+   const struct fs_handle_base *hb = req->h;
+   ssize_t tot = 0;
+   offt off;
+   int rc;
+
+   if (write && !(hb->fl_flags & (O_WRONLY | O_RDWR)))
+      return -EBADF;
+
+   if (!write && (hb->fl_flags & O_WRONLY))
+      return -EBADF;
+
+   if ((s64)cb->aio_offset < 0)
+      return -EINVAL;
+
+   if (cb->aio_lio_opcode == IOCB_CMD_PREADV ||
+       cb->aio_lio_opcode == IOCB_CMD_PWRITEV)
+   {
+      if (!cb->aio_nbytes)
+         return -EINVAL;
+
+      if (sizeof(struct iovec) * cb->aio_nbytes > ARGS_COPYBUF_SIZE)
+         return -EINVAL;
+
+      req->iovcnt = (int)cb->aio_nbytes;
+      req->iov = kalloc_array_obj(struct iovec, (size_t)req->iovcnt);
+
+      if (!req->iov) {
+         req->iov = &req->single_iov;
+         return -ENOMEM;
+      }
+
+      if (copy_from_user(req->iov,
+                         (void *)(ulong)cb->aio_buf,
+                         sizeof(struct iovec) * (size_t)req->iovcnt))
+      {
+         return -EFAULT;
+      }
+
+   } else {
+
+      req->single_iov = (struct iovec) {
+         .iov_base = (void *)(ulong)cb->aio_buf,
+         .iov_len = (size_t)cb->aio_nbytes,
+      };
+   }
+
+   for (int i = 0; i < req->iovcnt; i++) {
+
+      const ulong base = (ulong)req->iov[i].iov_base;
+      const size_t len = req->iov[i].iov_len;
+
+      if ((tot += (ssize_t)len) < 0)
+         return -EINVAL; /* overflow */
+
+      if (user_out_of_range((void *)base, len))
+         return -EFAULT;
+
+      if (!write && (rc = aio_prefault_write(base, len)))
+         return rc;
+   }
+
+   off = vfs_seek(req->h, (s64)cb->aio_offset, SEEK_SET);
+   return off < 0 ? (int)off : 0;
+}
+
+static int aio_submit_one(struct aio_ctx *ctx, struct iocb *u_iocb)
+{
+   struct aio_req *req;
+   fs_handle h, resfd;
+   struct iocb cb;
+   int rc;
+
+   if (copy_from_user(&cb, u_iocb, sizeof(cb)))
+      return -EFAULT;
+
+   if (cb.aio_reserved2 || cb.aio_rw_flags)
+      return -EINVAL;
+
+   if (cb.aio_flags & ~IOCB_FLAG_RESFD)
+      return -EINVAL;
+
+   if (!(h = get_fs_handle((int)cb.aio_fildes)))
+      return -EBADF;
+
+   if (!(req = kzalloc_obj(struct aio_req)))
+      return -ENOMEM;
+
+   list_node_init(&req->node);
+   req->ctx = ctx;
+   retain_obj(ctx);
+   req->data = cb.aio_data;
+   req->obj = (ulong)u_iocb;
+   req->opcode = cb.aio_lio_opcode;
+   req->iov = &req->single_iov;
+   req->iovcnt = 1;
+
+   if ((rc = vfs_dup(h, &req->h))) {
+      req->h = NULL;
+      goto err;
+   }
+
+   if (cb.aio_flags & IOCB_FLAG_RESFD) {
+
+      if (!(resfd = get_fs_handle((int)cb.aio_resfd))) {
+         rc = -EBADF;
+         goto err;
+      }
+
+      if (!is_eventfd_handle(resfd)) {
+         rc = -EINVAL;
+         goto err;
+      }
+
+      if ((rc = vfs_dup(resfd, &req->resfd))) {
+         req->resfd = NULL;
+         goto err;
+      }
+   }
+
+   switch (cb.aio_lio_opcode) {
+
+      case IOCB_CMD_PREAD:
+      case IOCB_CMD_PREADV:
+         rc = aio_prepare_rw(req, &cb, false);
+         break;
+
+      case IOCB_CMD_PWRITE:
+      case IOCB_CMD_PWRITEV:
+         rc = aio_prepare_rw(req, &cb, true);
+         break;
+
+      case IOCB_CMD_FSYNC:
+      case IOCB_CMD_FDSYNC:
+         rc = 0;
+         break;
+
+      default:
+         rc = -EINVAL;
+   }
+
+   if (rc)
+      goto err;
+
+   kmutex_lock(&ctx->lock);
+   {
+      if (aio_ring_used(ctx) + ctx->in_flight + 1 >= ctx->nr) {
+         rc = -EAGAIN; /* no room for the completion event */
+      } else if (ctx->in_flight >= AIO_CTX_MAX_IN_FLIGHT) {
+         rc = -EAGAIN; /* leave room for the other contexts */
+      } else {
+         ctx->in_flight++;
+         list_add_tail(&ctx->reqs, &req->node);
+      }
+   }
+   kmutex_unlock(&ctx->lock);
+
+   if (rc)
+      goto err;
+
+   if (!wth_enqueue_on(aio_wth, &aio_run_req, req)) {
+
+      /* The queue of the AIO worker is full */
+      kmutex_lock(&ctx->lock);
+      {
+         list_remove(&req->node);
+         ctx->in_flight--;
+      }
+      kmutex_unlock(&ctx->lock);
+      rc = -EAGAIN;
+      goto err;
+   }
+
+   return 0;
+
+err:
+   aio_free_req(req);
+   return rc;
+}
+
+int sys_io_submit(aio_context_t ctx_id, long nr, struct iocb **u_iocbpp)
+{
+   struct aio_ctx *ctx;
+   struct iocb *u_iocb;
+   int rc = 0;
+   long i;
+
+   if (!(ctx = aio_get_ctx(ctx_id, NULL)))
+      return -EINVAL;
+
+   if (nr < 0)
+      return -EINVAL;
+
+   for (i = 0; i < nr; i++) {
+
+      if (copy_from_user(&u_iocb, &u_iocbpp[i], sizeof(u_iocb))) {
+         rc = -EFAULT;
+         break;
+      }
+
+      if ((rc = aio_submit_one(ctx, u_iocb)))
+         break;
+   }
+
+   return i > 0 ? (int)i : rc;
+}
+
+int sys_io_cancel(aio_context_t ctx_id,
+                  struct iocb *u_iocb,
+                  struct io_event *u_result)
+{
+   struct aio_ctx *ctx;
+   struct aio_req *pos;
+   int rc = -EINVAL;
+   u32 key;
+
+   if (!(ctx = aio_get_ctx(ctx_id, NULL)))
+      return -EINVAL;
+
+   if (copy_from_user(&key, &u_iocb->aio_key, sizeof(key)))
+      return -EFAULT;
+
+   if (key != 0)
+      return -EINVAL;
+
+   kmutex_lock(&ctx->lock);
+   {
+      list_for_each_ro(pos, &ctx->reqs, node) {
+
+         if (pos->obj != (ulong)u_iocb)
+            continue;
+
+         if (pos->started) {
+            rc = -EAGAIN; /* too late: the request cannot be canceled */
+         } else {
+            pos->cancelled = true;
+            rc = -EINPROGRESS;
+         }
+
+         break;
+      }
+   }
+   kmutex_unlock(&ctx->lock);
+
+   /*
+    * Like on Linux, `u_result` is not used: the event of the canceled request
+    * is always delivered through the ring, with res = -ECANCELED.
+    */
+   return rc;
+}
+
+/* Move at most `max` events from the ring to the user buffer */
+static long
+aio_reap_events(struct aio_ctx *ctx, struct io_event *u_ev, long max)
+{
+   struct aio_ring *ring = ctx->ring;
+   const u32 tail = ctx->tail;
+   u32 head = atomic_load_explicit(&ring->head, mo_acquire) % ctx->nr;
+   long cnt = 0;
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&ctx->lock));
+
+   while (cnt < max && head != tail) {
+
+      if (copy_to_user(&u_ev[cnt], &ring->io_events[head], sizeof(*u_ev)))
+         return cnt > 0 ? cnt : -EFAULT;
+
+      head = (head + 1) % ctx->nr;
+      atomic_store_explicit(&ring->head, head, mo_release);
+      cnt++;
+   }
+
+   return cnt;
+}
+
+static int
+aio_getevents(aio_context_t ctx_id,
+              long min_nr,
+              long nr,
+              struct io_event *u_events,
+              const struct k_timespec64 *timeout)
+{
+   struct aio_ctx *ctx;
+   u64 deadline = 0, now;
+   long cnt = 0, rc;
+
+   if (!(ctx = aio_get_ctx(ctx_id, NULL)))
+      return -EINVAL;
+
+   if (min_nr < 0 || nr < min_nr)
+      return -EINVAL;
+
+   if (timeout) {
+
+      if (timeout->tv_sec < 0 || !IN_RANGE(timeout->tv_nsec, 0, 1000000000))
+         return -EINVAL;
+
+      deadline = (u64)timeout->tv_sec * TIMER_HZ;
+      deadline += (u64)timeout->tv_nsec / (1000000000 / TIMER_HZ);
+
+      if (!deadline && timeout->tv_nsec)
+         deadline = 1;
+
+      deadline += get_ticks();
+   }
+
+   kmutex_lock(&ctx->lock);
+   {
+      while (true) {
+
+         if ((rc = aio_reap_events(ctx, u_events + cnt, nr - cnt)) < 0) {
+            cnt = cnt > 0 ? cnt : rc;
+            break;
+         }
+
+         cnt += rc;
+
+         if (cnt >= min_nr)
+            break;
+
+         if (timeout) {
+
+            if ((now = get_ticks()) >= deadline)
+               break;
+
+            kcond_wait(&ctx->cond,
+                       &ctx->lock,
+                       (u32)MIN(deadline - now, (u64)UINT32_MAX));
+
+         } else {
+
+            kcond_wait(&ctx->cond, &ctx->lock, KCOND_WAIT_FOREVER);
+         }
+
+         if (pending_signals()) {
+            cnt = cnt > 0 ? cnt : -EINTR;
+            break;
+         }
+      }
+   }
+   kmutex_unlock(&ctx->lock);
+   return (int)cnt;
+}
+
+int sys_io_getevents(aio_context_t ctx_id,
+                     long min_nr,
+                     long nr,
+                     struct io_event *u_events,
+                     struct k_timespec32 *u_timeout)
+{
+   return sys_io_pgetevents_time32(ctx_id,
+                                   min_nr,
+                                   nr,
+                                   u_events,
+                                   u_timeout,
+                                   NULL);
+}
+
+int sys_io_pgetevents_time32(aio_context_t ctx_id,
+                             long min_nr,
+                             long nr,
+                             struct io_event *u_events,
+                             struct k_timespec32 *u_timeout,
+                             const void *u_sig)
+{
+   struct k_timespec32 ts32;
+   struct k_timespec64 ts;
+
+   /* NOTE: `u_sig` is ignored because sigprocmask() is not supported */
+
+   if (!u_timeout)
+      return aio_getevents(ctx_id, min_nr, nr, u_events, NULL);
+
+   if (copy_from_user(&ts32, u_timeout, sizeof(ts32)))
+      return -EFAULT;
+
+   ts = (struct k_timespec64) {
+      .tv_sec = ts32.tv_sec,
+      .tv_nsec = ts32.tv_nsec,
+   };
+
+   return aio_getevents(ctx_id, min_nr, nr, u_events, &ts);
+}
+
+int sys_io_pgetevents(aio_context_t ctx_id,
+                      long min_nr,
+                      long nr,
+                      struct io_event *u_events,
+                      struct k_timespec64 *u_timeout,
+                      const void *u_sig)
+{
+   struct k_timespec64 ts;
+
+   /* NOTE: `u_sig` is ignored because sigprocmask() is not supported */
+
+   if (!u_timeout)
+      return aio_getevents(ctx_id, min_nr, nr, u_events, NULL);
+
+   if (copy_from_user(&ts, u_timeout, sizeof(ts)))
+      return -EFAULT;
+
+   return aio_getevents(ctx_id, min_nr, nr, u_events, &ts);
+}
+
+void init_aio(void)
+{
+   /*
+    * A dedicated (but unnamed) low-priority worker thread, in order to not
+    * delay the jobs of the generic worker thread. The requests never fall back
+    * to other threads: when its queue is full, io_submit() fails with -EAGAIN.
+    *
+    * Why a single thread for all the contexts? Tilck runs on a single CPU and
+    * AIO works only on seekable files, whose I/O never sleeps waiting for
+    * external events: more worker threads would just interleave the requests,
+    * without completing any of them sooner. To be fair, each context can have
+    * at most AIO_CTX_MAX_IN_FLIGHT requests in the queue.
+    */
+   aio_wth = wth_create_thread(NULL, AIO_WTH_PRIO, WTH_AIO_QUEUE_SIZE);
+
+   if (!aio_wth)
+      panic("AIO: unable to create the worker thread");
+}
@@ -11,6 +11,7 @@
 #include <tilck/kernel/fault_resumable.h>
 #include <tilck/kernel/interrupts.h>
 #include <tilck/kernel/hal.h>
+#include <tilck/kernel/pmu.h>
 
 extern const char *x86_exception_names[32];
 
@@ -177,6 +178,8 @@ out:
    if (x86_cpu_features.edx1.pat)
       init_pat();
 
+   init_pmu();
+
    printk("CPU: Physical addr bits: %u\n", x86_cpu_features.phys_addr_bits);
 }
 
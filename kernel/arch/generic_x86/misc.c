@@ -9,10 +9,13 @@
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/mods/acpi.h>
+#include <tilck/mods/serial.h>
 
 NORETURN void poweroff(void)
 {
    printk("Halting the system...\n");
+   printk_flush_ringbuf();
+   serial_flush_tx_all();
 
    disable_preemption();
 
@@ -54,6 +57,8 @@ NORETURN void poweroff(void)
 NORETURN void reboot(void)
 {
    printk("Rebooting the machine...\n");
+   printk_flush_ringbuf();
+   serial_flush_tx_all();
 
    disable_preemption();
    disable_interrupts_forced();
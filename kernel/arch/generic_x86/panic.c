@@ -155,6 +155,9 @@ NORETURN void panic(const char *fmt, ...)
    }
 
 
+   /* Flush the messages logged before the panic, if any */
+   fault_resumable_call(ALL_FAULTS_MASK, printk_flush_ringbuf, 0);
+
    /* Hopefully, we can print something on screen */
 
    printk("*********************************"
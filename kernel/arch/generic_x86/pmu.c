@@ -0,0 +1,367 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/utils.h>
+#include <tilck/common/arch/generic_x86/x86_utils.h>
+#include <tilck/common/arch/generic_x86/cpu_features.h>
+
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/fault_resumable.h>
+#include <tilck/kernel/pmu.h>
+
+/*
+ * Driver for Intel's architectural performance monitoring (CPUID leaf 0xA),
+ * using only the general purpose counters (IA32_PMCx + IA32_PERFEVTSELx).
+ *
+ * Each task using counters has a pmu_task_ctx mapping its hw counters to
+ * pmu_counter objects. Only one ctx at a time is loaded in the hardware: the
+ * one of the running task. The counters are not multiplexed: when a task has
+ * no free hw counter left, pmu_counter_attach() fails with -EBUSY.
+ */
+
+#define PMU_MAX_HW_COUNTERS                                     8
+
+#define EVTSEL_USR                                      (1u << 16)
+#define EVTSEL_OS                                       (1u << 17)
+#define EVTSEL_EN                                       (1u << 22)
+
+struct pmu_task_ctx {
+   struct pmu_counter *cnt[PMU_MAX_HW_COUNTERS];
+};
+
+struct pmu_hw_event {
+
+   const char *name;
+   u8 event;
+   u8 umask;
+   s8 arch_bit;         /* bit in CPUID[0xA].EBX, -1 if model-specific */
+};
+
+static const struct pmu_hw_event pmu_events[PMU_EV_COUNT] =
+{
+   [PMU_EV_CYCLES]        = { "cycles",        0x3c, 0x00,  0 },
+   [PMU_EV_INSTRUCTIONS]  = { "instructions",  0xc0, 0x00,  1 },
+   [PMU_EV_LLC_MISSES]    = { "llc-misses",    0x2e, 0x41,  4 },
+   [PMU_EV_BRANCH_MISSES] = { "branch-misses", 0xc5, 0x00,  6 },
+
+   /* DTLB_LOAD_MISSES.MISS_CAUSES_A_WALK: Intel family 6 only */
+   [PMU_EV_DTLB_MISSES]   = { "dtlb-misses",   0x08, 0x01, -1 },
+};
+
+static u8 pmu_version;
+static u8 pmu_hw_counters;
+static u64 pmu_value_mask;
+static u32 pmu_events_mask;               /* bit N set: pmu_events[N] works */
+static struct pmu_task_ctx *pmu_hw_ctx;   /* the ctx loaded in the hardware */
+
+static ALWAYS_INLINE struct pmu_task_ctx *
+get_pmu_ctx(struct task *ti)
+{
+   return get_task_arch_fields(ti)->pmu_ctx;
+}
+
+static ALWAYS_INLINE u32
+pmu_get_evtsel(struct pmu_counter *c)
+{
+   const struct pmu_hw_event *e = &pmu_events[c->ev];
+   u32 val = e->event | ((u32)e->umask << 8) | EVTSEL_EN;
+
+   if (c->flags & PMU_CNT_USER)
+      val |= EVTSEL_USR;
+
+   if (c->flags & PMU_CNT_KERNEL)
+      val |= EVTSEL_OS;
+
+   return val;
+}
+
+static void
+pmu_hw_start(struct pmu_counter *c)
+{
+   wrmsr(MSR_IA32_PMC0 + (u32)c->hw_idx, 0);
+   wrmsr(MSR_IA32_PERFEVTSEL0 + (u32)c->hw_idx, pmu_get_evtsel(c));
+}
+
+static void
+pmu_hw_stop(struct pmu_counter *c)
+{
+   wrmsr(MSR_IA32_PERFEVTSEL0 + (u32)c->hw_idx, 0);
+   c->count += rdmsr(MSR_IA32_PMC0 + (u32)c->hw_idx) & pmu_value_mask;
+}
+
+static ALWAYS_INLINE bool
+pmu_is_counting(struct pmu_counter *c)
+{
+   return c->enabled && c->ti && get_pmu_ctx(c->ti) == pmu_hw_ctx;
+}
+
+bool pmu_is_available(void)
+{
+   return pmu_hw_counters > 0;
+}
+
+bool pmu_has_event(enum pmu_event ev)
+{
+   return ev < PMU_EV_COUNT && (pmu_events_mask & (1u << ev));
+}
+
+const char *pmu_get_event_name(enum pmu_event ev)
+{
+   return ev < PMU_EV_COUNT ? pmu_events[ev].name : NULL;
+}
+
+void pmu_task_switch(struct task *next)
+{
+   struct pmu_task_ctx *ctx = get_pmu_ctx(next);
+   struct pmu_counter *c;
+
+   ASSERT(!is_preemption_enabled());
+
+   if (LIKELY(ctx == pmu_hw_ctx))
+      return;
+
+   if (pmu_hw_ctx) {
+      for (int i = 0; i < pmu_hw_counters; i++)
+         if ((c = pmu_hw_ctx->cnt[i]) && c->enabled)
+            pmu_hw_stop(c);
+   }
+
+   if (ctx) {
+      for (int i = 0; i < pmu_hw_counters; i++)
+         if ((c = ctx->cnt[i]) && c->enabled)
+            pmu_hw_start(c);
+   }
+
+   pmu_hw_ctx = ctx;
+}
+
+int pmu_counter_attach(struct task *ti, struct pmu_counter *c)
+{
+   arch_task_members_t *arch = get_task_arch_fields(ti);
+   struct pmu_task_ctx *new_ctx = NULL;
+   int rc = -EBUSY;
+
+   if (!pmu_has_event(c->ev))
+      return -ENOENT;
+
+   if (!arch->pmu_ctx) {
+      if (!(new_ctx = kzalloc_obj(struct pmu_task_ctx)))
+         return -ENOMEM;
+   }
+
+   c->count = 0;
+   c->enabled = false;
+   c->hw_idx = -1;
+   c->ti = NULL;
+
+   disable_preemption();
+   {
+      if (!arch->pmu_ctx) {
+
+         arch->pmu_ctx = new_ctx;
+         new_ctx = NULL;
+
+         /* The running task's ctx must always be the one in the hardware */
+         if (ti == get_curr_task())
+            pmu_task_switch(ti);
+      }
+
+      for (int i = 0; i < pmu_hw_counters; i++) {
+
+         if (!arch->pmu_ctx->cnt[i]) {
+            arch->pmu_ctx->cnt[i] = c;
+            c->hw_idx = (s8)i;
+            c->ti = ti;
+            rc = 0;
+            break;
+         }
+      }
+   }
+   enable_preemption();
+
+   if (new_ctx)
+      kfree_obj(new_ctx, struct pmu_task_ctx);
+
+   return rc;
+}
+
+void pmu_counter_detach(struct pmu_counter *c)
+{
+   disable_preemption();
+   {
+      if (c->ti) {
+
+         if (pmu_is_counting(c))
+            pmu_hw_stop(c);
+
+         get_pmu_ctx(c->ti)->cnt[c->hw_idx] = NULL;
+         c->ti = NULL;
+         c->hw_idx = -1;
+      }
+
+      c->enabled = false;
+   }
+   enable_preemption();
+}
+
+void pmu_counter_enable(struct pmu_counter *c, bool enabled)
+{
+   disable_preemption();
+   {
+      if (c->ti && c->enabled != enabled) {
+
+         if (enabled) {
+
+            c->enabled = true;
+
+            if (pmu_is_counting(c))
+               pmu_hw_start(c);
+
+         } else {
+
+            if (pmu_is_counting(c))
+               pmu_hw_stop(c);
+
+            c->enabled = false;
+         }
+      }
+   }
+   enable_preemption();
+}
+
+void pmu_counter_reset(struct pmu_counter *c)
+{
+   disable_preemption();
+   {
+      c->count = 0;
+
+      if (pmu_is_counting(c))
+         wrmsr(MSR_IA32_PMC0 + (u32)c->hw_idx, 0);
+   }
+   enable_preemption();
+}
+
+u64 pmu_counter_read(struct pmu_counter *c)
+{
+   u64 val;
+
+   disable_preemption();
+   {
+      val = c->count;
+
+      if (pmu_is_counting(c))
+         val += rdmsr(MSR_IA32_PMC0 + (u32)c->hw_idx) & pmu_value_mask;
+   }
+   enable_preemption();
+   return val;
+}
+
+void pmu_free_task_ctx(struct task *ti)
+{
+   arch_task_members_t *arch = get_task_arch_fields(ti);
+   struct pmu_task_ctx *ctx = arch->pmu_ctx;
+   struct pmu_counter *c;
+
+   if (!ctx)
+      return;
+
+   /* The counters survive the task: they just stop counting */
+   disable_preemption();
+   {
+      for (int i = 0; i < pmu_hw_counters; i++) {
+
+         if (!(c = ctx->cnt[i]))
+            continue;
+
+         if (pmu_is_counting(c))
+            pmu_hw_stop(c);
+
+         c->ti = NULL;
+         c->hw_idx = -1;
+         c->enabled = false;
+      }
+
+      if (pmu_hw_ctx == ctx)
+         pmu_hw_ctx = NULL;
+
+      arch->pmu_ctx = NULL;
+   }
+   enable_preemption();
+   kfree_obj(ctx, struct pmu_task_ctx);
+}
+
+static void pmu_reset_hw(void)
+{
+   for (u32 i = 0; i < pmu_hw_counters; i++) {
+      wrmsr(MSR_IA32_PERFEVTSEL0 + i, 0);
+      wrmsr(MSR_IA32_PMC0 + i, 0);
+   }
+
+   /* Enable all the GP counters, keep the fixed-function ones disabled */
+   if (pmu_version >= 2)
+      wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, (1ull << pmu_hw_counters) - 1);
+}
+
+void init_pmu(void)
+{
+   u32 a, b, c, d, family, bits, ebx_len;
+   u32 res;
+
+   if (strcmp((const char *)x86_cpu_features.vendor_id, "GenuineIntel"))
+      return;
+
+   if (!x86_cpu_features.edx1.msr || x86_cpu_features.max_basic_cpuid_cmd < 10)
+      return;
+
+   cpuid(10, &a, &b, &c, &d);
+
+   pmu_version = a & 0xff;
+   pmu_hw_counters = (u8)MIN((a >> 8) & 0xff, (u32)PMU_MAX_HW_COUNTERS);
+   bits = (a >> 16) & 0xff;
+   ebx_len = a >> 24;
+
+   if (!pmu_version || !pmu_hw_counters || !bits) {
+      pmu_hw_counters = 0;
+      printk("CPU: no architectural PMU\n");
+      return;
+   }
+
+   pmu_value_mask = bits < 64 ? (1ull << bits) - 1 : ~0ull;
+
+   /*
+    * Hypervisors might advertise a PMU without emulating its MSRs: in that
+    * case, just behave like there's no PMU at all.
+    */
+   if ((res = fault_resumable_call(ALL_FAULTS_MASK, &pmu_reset_hw, 0))) {
+      pmu_hw_counters = 0;
+      printk("CPU: PMU init failed: fault %u\n", get_first_set_bit_index(res));
+      return;
+   }
+
+   cpuid(1, &a, &b, &c, &d);
+   family = (a >> 8) & 0xf;
+   cpuid(10, &a, &b, &c, &d);
+
+   for (u32 i = 0; i < PMU_EV_COUNT; i++) {
+
+      const s8 bit = pmu_events[i].arch_bit;
+
+      if (bit < 0) {
+
+         if (family == 6 && pmu_version >= 2)
+            pmu_events_mask |= (1u << i);
+
+      } else if ((u32)bit < ebx_len && !(b & (1u << bit))) {
+
+         pmu_events_mask |= (1u << i);
+      }
+   }
+
+   printk("CPU: PMU v%u, %u counters, %u bits\n",
+          pmu_version, pmu_hw_counters, bits);
+}
@@ -485,6 +485,8 @@ void handle_syscall(regs_t *r)
 {
    struct task *const curr = get_curr_task();
    const bool traced = curr->traced;
+   const bool stats = MOD_tracing && syscall_stats_is_enabled();
+   u64 start = 0;
 
    /*
     * In case of a sysenter syscall, the eflags are saved in kernel mode after
@@ -513,8 +515,15 @@ void handle_syscall(regs_t *r)
          trace_sys_enter(sn,r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
 
       *(void **)(&fptr) = syscalls[sn];
+
+      if (MOD_tracing && stats)
+         start = RDTSC();
+
       r->eax = (u32) fptr(r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
 
+      if (MOD_tracing && stats)
+         syscall_stats_account(sn, RDTSC() - start);
+
       if (traced)
          trace_sys_exit(sn,r->eax,r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
 
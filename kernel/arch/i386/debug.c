@@ -9,6 +9,7 @@
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/paging_hw.h>
+#include <tilck/mods/serial.h>
 
 #include <elf.h>
 #include <multiboot.h>
@@ -110,6 +111,8 @@ void debug_qemu_turn_off_machine(void)
    if (!in_hypervisor())
       return;
 
+   printk_flush_ringbuf();
+   serial_flush_tx_all();
    outb(0xf4, 0x00);
 }
 
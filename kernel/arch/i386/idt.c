@@ -134,8 +134,10 @@ void handle_fault(regs_t *r)
       }
       disable_interrupts_forced();
 
-      if (was_cow)
+      if (was_cow) {
+         get_curr_task()->ru.minflt++;
          return;
+      }
    }
 
    if (is_fault_resumable(int_num))
@@ -36,6 +36,7 @@ static struct list irq_handlers_lists[16] = {
    STATIC_LIST_INIT(irq_handlers_lists[15]),
 };
 
+u32 irq_count[16];
 u32 unhandled_irq_count[256];
 u32 spur_irq_count;
 
@@ -135,6 +136,7 @@ void arch_irq_handling(regs_t *r)
       return;
    }
 
+   irq_count[irq]++;
    push_nested_interrupt(r->int_num);
    handle_irq_set_mask_and_eoi(irq);
    enable_interrupts_forced();
@@ -19,6 +19,7 @@
 #include <tilck/kernel/system_mmap.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/signal.h>
+#include <tilck/kernel/process.h>
 #include <tilck/kernel/process_mm.h>
 
 #include "paging_int.h"
@@ -143,7 +144,12 @@ bool handle_potential_cow(void *context)
       return false;
 
    asmVolatile("movl %%cr2, %0" : "=r"(vaddr));
+   return handle_cow((void *)vaddr);
+}
 
+bool handle_cow(void *vaddrp)
+{
+   const u32 vaddr = (u32)vaddrp;
    const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
    const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
    void *const page_vaddr = (void *)(vaddr & PAGE_MASK);
@@ -190,6 +196,10 @@ bool handle_potential_cow(void *context)
 
    invalidate_page_hw(vaddr);
 
+   /* The zero page does not count as resident, while its private copy does */
+   if (orig_page_paddr == KERNEL_VA_TO_PA(zero_page))
+      process_account_user_pages(get_curr_pdir(), 1);
+
    // Copy back the page.
    memcpy32(page_vaddr, page_size_buf, PAGE_SIZE / 4);
    return true;
@@ -238,8 +248,12 @@ void handle_page_fault_int(regs_t *r)
        */
       if (!!(um->prot & PROT_WRITE) || !rw) {
 
-         if (vfs_handle_fault(um->h, (void *)vaddr, p, rw))
+         if (vfs_handle_fault(um->h, (void *)vaddr, p, rw)) {
+
+            /* Tilck has no swap nor page cache: no fault requires I/O */
+            get_curr_task()->ru.minflt++;
             return;
+         }
 
          sig = SIGBUS;
       }
@@ -353,6 +367,9 @@ __unmap_page(pdir_t *pdir, void *vaddrp, bool free_pageframe, bool permissive)
    pt->pages[pt_index].raw = 0;
    invalidate_page_hw(vaddr);
 
+   if (pd_index < KERNEL_BASE_PD_IDX && paddr != KERNEL_VA_TO_PA(zero_page))
+      process_account_user_pages(pdir, -1);
+
    if (!pf_ref_count_dec(paddr) && free_pageframe) {
       ASSERT(paddr != KERNEL_VA_TO_PA(zero_page));
       kfree2(KERNEL_PA_TO_VA(paddr), PAGE_SIZE);
@@ -512,6 +529,9 @@ map_page_int(pdir_t *pdir, void *vaddrp, ulong paddr, u32 hw_flags)
    pt->pages[pt_index].raw = PG_PRESENT_BIT | hw_flags | paddr;
    pf_ref_count_inc(paddr);
    invalidate_page_hw(vaddr);
+
+   if (pd_index < KERNEL_BASE_PD_IDX && paddr != KERNEL_VA_TO_PA(zero_page))
+      process_account_user_pages(pdir, 1);
    return 0;
 }
 
@@ -848,6 +868,29 @@ oom_exit:
    return NULL;
 }
 
+size_t pdir_count_user_pages(pdir_t *pdir)
+{
+   const u32 zero_pg = SHR_BITS(KERNEL_VA_TO_PA(&zero_page), PAGE_SHIFT, u32);
+   size_t count = 0;
+
+   for (u32 i = 0; i < KERNEL_BASE_PD_IDX; i++) {
+
+      if (!pdir->entries[i].present)
+         continue;
+
+      page_table_t *pt = pdir_get_page_table(pdir, i);
+
+      for (u32 j = 0; j < 1024; j++) {
+
+         /* The pages mapped to the zero page are not really resident */
+         if (pt->pages[j].present && pt->pages[j].pageAddr != zero_pg)
+            count++;
+      }
+   }
+
+   return count;
+}
+
 void pdir_destroy(pdir_t *pdir)
 {
    // Kernel's pdir cannot be destroyed!
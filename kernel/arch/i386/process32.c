@@ -19,6 +19,7 @@
 #include <tilck/kernel/syscalls.h>
 #include <tilck/kernel/paging_hw.h>
 #include <tilck/kernel/irq.h>
+#include <tilck/kernel/pmu.h>
 
 #include "gdt_int.h"
 
@@ -377,6 +378,7 @@ int setup_process(struct elf_program_info *pinfo,
       }
 
       pi->pdir = pinfo->pdir;
+      pi->rss_gen = 0;  /* the RSS counter is not valid anymore */
       old_pdir = NULL;
 
       /* NOTE: not calling arch_specific_free_task() */
@@ -418,6 +420,7 @@ void set_current_task_in_user_mode(void)
    ASSERT(!is_preemption_enabled());
    struct task *curr = get_curr_task();
 
+   sched_account_cpu_time(curr);
    curr->running_in_kernel = false;
 
    task_info_reset_kernel_stack(curr);
@@ -470,12 +473,15 @@ NORETURN void switch_to_task(struct task *ti)
    ASSERT(state->eflags & EFLAGS_IF);
 
    /* Do as much as possible work before disabling the interrupts */
+   sched_account_task_switch(curr, ti);
    task_change_state(ti, TASK_STATE_RUNNING);
    ti->ticks.timeslice = 0;
 
    if (!is_kernel_thread(curr) && curr->state != TASK_STATE_ZOMBIE)
       save_curr_fpu_ctx_if_enabled();
 
+   pmu_task_switch(ti);
+
    if (!is_kernel_thread(ti)) {
 
       if (get_curr_pdir() != ti->pi->pdir) {
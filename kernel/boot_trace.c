@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/boot_trace.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/datetime.h>
+
+/*
+ * NOTE: the steps are recorded only by kmain() and, after it, by the
+ * do_async_init() kthread, which never run concurrently. Therefore, no
+ * locking is needed on the write side. Readers use the table only after
+ * boot_trace_finish().
+ */
+
+static struct boot_trace_step steps[BOOT_TRACE_MAX_STEPS];
+static u32 steps_count;
+static u32 open_steps[BOOT_TRACE_MAX_DEPTH];
+static u32 depth;
+static u32 dropped_steps;
+static u64 boot_start;
+static u64 boot_end;
+
+void boot_trace_start(void)
+{
+   boot_start = RDTSC();
+}
+
+void boot_trace_begin(const char *name)
+{
+   struct boot_trace_step *s;
+
+   if (boot_end)
+      return;
+
+   if (steps_count == ARRAY_SIZE(steps) || depth == ARRAY_SIZE(open_steps)) {
+
+      /* Still keep track of the depth, in order to match boot_trace_end() */
+      dropped_steps++;
+      depth++;
+      return;
+   }
+
+   s = &steps[steps_count];
+   s->name = name;
+   s->depth = depth;
+   s->end = 0;
+   open_steps[depth++] = steps_count++;
+   s->start = RDTSC();
+}
+
+void boot_trace_end(void)
+{
+   const u64 now = RDTSC();
+   u32 idx;
+
+   if (boot_end)
+      return;
+
+   ASSERT(depth > 0);
+   depth--;
+
+   if (depth >= ARRAY_SIZE(open_steps))
+      return; /* the step was dropped */
+
+   idx = open_steps[depth];
+
+   if (steps[idx].end || steps[idx].depth != depth)
+      return; /* the step was dropped */
+
+   steps[idx].end = now;
+}
+
+u32 boot_trace_get_steps(struct boot_trace_step *buf,
+                         u32 max,
+                         u64 *start,
+                         u64 *end)
+{
+   u32 n;
+
+   disable_preemption();
+   {
+      n = MIN(max, steps_count);
+      memcpy(buf, steps, n * sizeof(steps[0]));
+      *start = boot_start;
+      *end = boot_end;
+   }
+   enable_preemption();
+   return n;
+}
+
+static void
+boot_trace_print_duration(const char *name, u32 indent, u64 cycles)
+{
+   const u64 us = tsc_to_ns(cycles) / 1000;
+
+   if (get_tsc_khz()) {
+      printk("   %*s%-*s %6" PRIu64 ".%03" PRIu64 " ms\n",
+             (int)indent, "", (int)(32 - indent), name,
+             us / 1000, us % 1000);
+   } else {
+      printk("   %*s%-*s %12" PRIu64 " cycles\n",
+             (int)indent, "", (int)(32 - indent), name, cycles);
+   }
+}
+
+/*
+ * Stops the recording and prints the total kernel boot time. The time spent
+ * before kmain() approximates the firmware plus bootloader time, because the
+ * TSC counts from the CPU reset. The detailed breakdown is printed only with
+ * the -boottrace kernel option.
+ */
+void boot_trace_finish(void)
+{
+   const u32 khz = get_tsc_khz();
+   u64 kern_us, pre_us;
+
+   ASSERT(depth == 0);
+   boot_end = RDTSC();
+
+   if (!khz) {
+      printk("Boot trace: kernel init %" PRIu64 " cycles "
+             "(TSC not calibrated)\n", boot_end - boot_start);
+   } else {
+      kern_us = tsc_to_ns(boot_end - boot_start) / 1000;
+      pre_us = tsc_to_ns(boot_start) / 1000;
+      printk("Boot trace: kernel init %" PRIu64 ".%03" PRIu64 " ms, "
+             "before kmain: %" PRIu64 ".%03" PRIu64 " ms\n",
+             kern_us / 1000, kern_us % 1000, pre_us / 1000, pre_us % 1000);
+   }
+
+   if (!kopt_boottrace)
+      return;
+
+   for (u32 i = 0; i < steps_count; i++) {
+
+      struct boot_trace_step *s = &steps[i];
+      boot_trace_print_duration(s->name, s->depth * 2, s->end - s->start);
+   }
+
+   if (dropped_steps)
+      printk("Boot trace: %u steps dropped\n", dropped_steps);
+}
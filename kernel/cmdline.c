@@ -17,6 +17,7 @@ int kopt_tty_count = TTY_COUNT;
 bool kopt_sched_alive_thread; /* false */
 bool kopt_serial_console = !MOD_console;
 bool kopt_noacpi; /* false */
+bool kopt_boottrace; /* false */
 
 /* static variables */
 
@@ -116,6 +117,11 @@ parse_arg_state_initial(int arg_num, const char *arg, size_t arg_len)
       return;
    }
 
+   if (!strcmp(arg, "-boottrace")) {
+      kopt_boottrace = true;
+      return;
+   }
+
    /* Internal options, used by tests */
 
    if (!strcmp(arg, "-sat")) {
@@ -445,20 +445,14 @@ void monotonic_time_get_timespec(struct k_timespec64 *tp)
 static void
 task_cpu_get_timespec(struct k_timespec64 *tp)
 {
-   struct task *ti = get_curr_task();
+   struct sched_rusage ru;
+   u64 tot;
 
-   disable_preemption();
-   {
-      const u64 tot = ti->ticks.total * __tick_duration;
-
-      tp->tv_sec = (s64)(tot / TS_SCALE);
+   sched_get_rusage(get_curr_task(), &ru);
+   tot = tsc_to_ns(ru.utime + ru.stime);
 
-      if (TS_SCALE <= BILLION)
-         tp->tv_nsec = (tot % TS_SCALE) * (BILLION / TS_SCALE);
-      else
-         tp->tv_nsec = (tot % TS_SCALE) / (TS_SCALE / BILLION);
-   }
-   enable_preemption();
+   tp->tv_sec = (s64)(tot / BILLION);
+   tp->tv_nsec = (long)(tot % BILLION);
 }
 
 int sys_gettimeofday(struct timeval *user_tv, struct timezone *user_tz)
@@ -0,0 +1,223 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/eventfd.h>
+#include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/signal.h>
+
+/*
+ * An eventfd object is just a 64-bit counter living in kernelfs, like pipes.
+ * Writing adds the given value to the counter, while reading returns it and
+ * resets it to 0 (or returns 1 and decrements it by 1, in semaphore mode).
+ * Reads block while the counter is 0, writes block while adding the value
+ * would exceed EFD_MAX_COUNT.
+ */
+
+struct eventfd {
+
+   KOBJ_BASE_FIELDS
+
+   u64 count;
+   int flags;
+   struct kmutex mutex;
+   struct kcond rcond;     /* signaled when the counter becomes > 0 */
+   struct kcond wcond;     /* signaled when the counter decreases */
+};
+
+static ssize_t eventfd_read(fs_handle h, char *buf, size_t size)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   ssize_t rc = sizeof(u64);
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   kmutex_lock(&e->mutex);
+   {
+      while (!e->count) {
+
+         if (kh->fl_flags & O_NONBLOCK) {
+            rc = -EAGAIN;
+            goto end;
+         }
+
+         kcond_wait(&e->rcond, &e->mutex, KCOND_WAIT_FOREVER);
+
+         if (pending_signals()) {
+            rc = -EINTR;
+            goto end;
+         }
+      }
+
+      val = (e->flags & EFD_SEMAPHORE) ? 1 : e->count;
+      e->count -= val;
+      memcpy(buf, &val, sizeof(val));
+      kcond_signal_all(&e->wcond);
+
+   end:;
+   }
+   kmutex_unlock(&e->mutex);
+   return rc;
+}
+
+static ssize_t eventfd_write(fs_handle h, char *buf, size_t size)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   ssize_t rc = sizeof(u64);
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   memcpy(&val, buf, sizeof(val));
+
+   if (val > EFD_MAX_COUNT)
+      return -EINVAL;
+
+   kmutex_lock(&e->mutex);
+   {
+      while (EFD_MAX_COUNT - e->count < val) {
+
+         if (kh->fl_flags & O_NONBLOCK) {
+            rc = -EAGAIN;
+            goto end;
+         }
+
+         kcond_wait(&e->wcond, &e->mutex, KCOND_WAIT_FOREVER);
+
+         if (pending_signals()) {
+            rc = -EINTR;
+            goto end;
+         }
+      }
+
+      e->count += val;
+
+      if (e->count)
+         kcond_signal_all(&e->rcond);
+
+   end:;
+   }
+   kmutex_unlock(&e->mutex);
+   return rc;
+}
+
+static int eventfd_read_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   bool ret;
+
+   kmutex_lock(&e->mutex);
+   {
+      ret = e->count > 0;
+   }
+   kmutex_unlock(&e->mutex);
+   return ret;
+}
+
+static int eventfd_write_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   bool ret;
+
+   kmutex_lock(&e->mutex);
+   {
+      ret = e->count < EFD_MAX_COUNT;
+   }
+   kmutex_unlock(&e->mutex);
+   return ret;
+}
+
+static struct kcond *eventfd_get_rready_cond(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   return &e->rcond;
+}
+
+static struct kcond *eventfd_get_wready_cond(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   return &e->wcond;
+}
+
+static const struct file_ops static_ops_eventfd =
+{
+   .read = eventfd_read,
+   .write = eventfd_write,
+   .read_ready = eventfd_read_ready,
+   .write_ready = eventfd_write_ready,
+   .get_rready_cond = eventfd_get_rready_cond,
+   .get_wready_cond = eventfd_get_wready_cond,
+};
+
+static void destroy_eventfd(struct eventfd *e)
+{
+   kcond_destory(&e->wcond);
+   kcond_destory(&e->rcond);
+   kmutex_destroy(&e->mutex);
+   kfree_obj(e, struct eventfd);
+}
+
+int eventfd_create_handle(u32 initval, int flags, fs_handle *out)
+{
+   struct eventfd *e;
+   fs_handle h;
+
+   if (!(e = (void *)kzalloc_obj(struct eventfd)))
+      return -ENOMEM;
+
+   e->destory_obj = (void *)&destroy_eventfd;
+   e->count = initval;
+   e->flags = flags & EFD_SEMAPHORE;
+   kmutex_init(&e->mutex, 0);
+   kcond_init(&e->rcond);
+   kcond_init(&e->wcond);
+
+   h = kfs_create_new_handle(&static_ops_eventfd,
+                             (void *)e,
+                             O_RDWR | (flags & EFD_NONBLOCK));
+
+   if (!h) {
+      destroy_eventfd(e);
+      return -ENOMEM;
+   }
+
+   *out = h;
+   return 0;
+}
+
+bool is_eventfd_handle(fs_handle h)
+{
+   struct fs_handle_base *hb = h;
+   return hb->fops == &static_ops_eventfd;
+}
+
+void eventfd_signal(fs_handle h, u64 n)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+
+   ASSERT(is_eventfd_handle(h));
+
+   kmutex_lock(&e->mutex);
+   {
+      e->count += MIN(n, EFD_MAX_COUNT - e->count);
+
+      if (e->count)
+         kcond_signal_all(&e->rcond);
+   }
+   kmutex_unlock(&e->mutex);
+}
@@ -4,6 +4,7 @@
 #include <tilck/common/basic_defs.h>
 
 #include <tilck/kernel/process.h>
+#include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/user.h>
@@ -266,8 +267,18 @@ do_execve_int(struct execve_ctx *ctx, const char *path, const char *const *argv)
    if ((rc = execve_load_elf(ctx, path, argv, &pinfo)))
       return rc;                 /* load failed */
 
+   /*
+    * The handles of the shared anonymous mappings have to be closed here,
+    * with preemption enabled, because setup_process() cannot do that.
+    */
+   if (ctx->curr_user_task)
+      close_all_anon_shared_mappings(ctx->curr_user_task->pi);
+
    disable_preemption();
    {
+      if (ctx->curr_user_task && !ctx->curr_user_task->pi->vforked)
+         process_update_maxrss(ctx->curr_user_task->pi);
+
       rc = setup_process(&pinfo,
                          ctx->curr_user_task,
                          argv,
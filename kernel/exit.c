@@ -93,12 +93,17 @@ close_all_handles(void)
    struct process *pi = get_curr_proc();
    ASSERT(is_preemption_enabled());
 
-   for (int i = 0; i < MAX_HANDLES; i++) {
-      if (pi->handles[i]) {
-         vfs_close(pi->handles[i]);
-         pi->handles[i] = NULL;
+   /* Other processes might be reading our fd table (e.g. procfs) */
+   kmutex_lock(&pi->fslock);
+   {
+      for (int i = 0; i < MAX_HANDLES; i++) {
+         if (pi->handles[i]) {
+            vfs_close(pi->handles[i]);
+            pi->handles[i] = NULL;
+         }
       }
    }
+   kmutex_unlock(&pi->fslock);
 }
 
 /*
@@ -169,11 +174,13 @@ void terminate_process(int exit_code, int term_sig)
    ASSERT(ti->state == TASK_STATE_RUNNING || ti->state == TASK_STATE_RUNNABLE);
 
    /*
-    * Close all the handles, keeping the preemption enabled while doing so.
+    * Close all the handles, including the ones owned by shared anonymous
+    * mappings, keeping the preemption enabled while doing so.
     */
    enable_preemption();
    {
       close_all_handles();
+      close_all_anon_shared_mappings(pi);
    }
    disable_preemption();
 
@@ -185,6 +192,7 @@ void terminate_process(int exit_code, int term_sig)
 
    if (!vforked) {
 
+      process_update_maxrss(pi);
       remove_all_user_zero_mem_mappings(pi);
 
       if (pi->elf)
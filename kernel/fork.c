@@ -55,6 +55,90 @@ static int fork_dup_all_handles(struct process *pi)
    return 0;
 }
 
+static void fork_close_anon_mapping_handles(struct process *pi)
+{
+   struct user_mapping *um;
+   struct fs_handle_base *h;
+
+   ASSERT(!is_preemption_enabled());
+
+   while (true) {
+
+      h = NULL;
+
+      list_for_each_ro(um, &pi->mi->mappings, pi_node) {
+
+         if (um->h && is_anon_mapping_handle(um->h)) {
+            if (((struct fs_handle_base *)um->h)->pi == pi) {
+               h = um->h;
+               break;
+            }
+         }
+      }
+
+      if (!h)
+         break;
+
+      list_for_each_ro(um, &pi->mi->mappings, pi_node) {
+         if (um->h == h)
+            um->h = NULL;
+      }
+
+      enable_preemption();
+      {
+         vfs_close(h);
+      }
+      disable_preemption();
+   }
+}
+
+/*
+ * Handles of MAP_SHARED | MAP_ANONYMOUS mappings are not in the fd table, but
+ * must be duplicated as well, in order for parent and child to keep sharing
+ * the same memory after fork().
+ */
+static int fork_dup_anon_mapping_handles(struct process *pi)
+{
+   struct user_mapping *um, *um2;
+   fs_handle h, dup_h;
+   int rc;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(!pi->vforked);
+
+   if (!pi->mi)
+      return 0;
+
+   list_for_each_ro(um, &pi->mi->mappings, pi_node) {
+
+      h = um->h;
+      dup_h = NULL;
+
+      if (!h || !is_anon_mapping_handle(h))
+         continue;
+
+      if (((struct fs_handle_base *)h)->pi == pi)
+         continue; /* Already duplicated */
+
+      rc = vfs_dup(h, &dup_h);
+
+      if (rc < 0 || !dup_h) {
+         fork_close_anon_mapping_handles(pi);
+         return -ENOMEM;
+      }
+
+      /* Update file handle's process pointer to the new process */
+      ((struct fs_handle_base *)dup_h)->pi = pi;
+
+      list_for_each_ro(um2, &pi->mi->mappings, pi_node) {
+         if (um2->h == h)
+            um2->h = dup_h;
+      }
+   }
+
+   return 0;
+}
+
 // Returns child's pid
 int do_fork(bool vfork)
 {
@@ -110,6 +194,18 @@ int do_fork(bool vfork)
    if (fork_dup_all_handles(child->pi) < 0)
       goto oom_case;
 
+   if (!vfork && fork_dup_anon_mapping_handles(child->pi) < 0) {
+
+      enable_preemption();
+      {
+         for (u32 i = 0; i < MAX_HANDLES; i++)
+            if (child->pi->handles[i])
+               vfs_close(child->pi->handles[i]);
+      }
+      disable_preemption();
+      goto oom_case;
+   }
+
    add_task(child);
 
    if (vfork) {
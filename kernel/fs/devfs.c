@@ -80,12 +80,15 @@ register_driver(struct driver_info *info, int arg_major)
 struct devfs_dir {
 
    /*
-    * Yes, sub-directories are NOT supported by devfs. The whole filesystem is
-    * just one flat directory.
+    * devfs supports only one level of sub-directories (e.g. /dev/pts), created
+    * on-demand by create_dev_file(), and no removal of entries.
     */
    enum vfs_entry_type type;     /* Must be FIRST, because of devfs_file */
    struct list files_list;
    tilck_ino_t inode;
+   struct devfs_dir *parent;     /* The root dir is its own parent */
+   struct devfs_file entry;      /* Entry in the parent dir (not for root) */
+   char name[16];
 };
 
 struct devfs_data {
@@ -102,13 +105,67 @@ devfs_get_next_inode(struct devfs_data *d)
    return d->next_inode++;
 }
 
+static void
+devfs_init_dir(struct devfs_data *d,
+               struct devfs_dir *dir,
+               struct devfs_dir *parent)
+{
+   dir->type = VFS_DIR;
+   dir->inode = devfs_get_next_inode(d);
+   dir->parent = parent ? parent : dir;
+   list_init(&dir->files_list);
+
+   dir->entry.type = VFS_DIR;
+   dir->entry.name = dir->name;
+   dir->entry.inode = dir->inode;
+   list_node_init(&dir->entry.dir_node);
+}
+
+/* Gets the sub-directory `name` of the root dir, creating it if necessary */
+static int
+devfs_get_subdir(struct devfs_data *d,
+                 const char *name,
+                 size_t nl,
+                 struct devfs_dir **out)
+{
+   struct devfs_file *pos;
+   struct devfs_dir *dir;
+
+   list_for_each_ro(pos, &d->root_dir.files_list, dir_node) {
+      if (pos->type == VFS_DIR && !strncmp(pos->name, name, nl)) {
+         if (!pos->name[nl]) {
+            *out = CONTAINER_OF(pos, struct devfs_dir, entry);
+            return 0;
+         }
+      }
+   }
+
+   if (!nl || nl >= sizeof(dir->name))
+      return -EINVAL;
+
+   if (!(dir = kzalloc_obj(struct devfs_dir)))
+      return -ENOMEM;
+
+   memcpy(dir->name, name, nl);
+   devfs_init_dir(d, dir, &d->root_dir);
+   list_add_tail(&d->root_dir.files_list, &dir->entry.dir_node);
+   *out = dir;
+   return 0;
+}
+
+/*
+ * Creates the device file `filename`, which can be either a simple name or
+ * a "dir/name" path: in that case, the sub-directory is created if necessary.
+ */
 int
 create_dev_file(const char *filename, u16 major, u16 minor, void **devfile)
 {
    struct fs *fs = devfs;
    struct driver_info *dinfo;
    struct devfs_data *d;
+   struct devfs_dir *dir;
    struct devfs_file *f;
+   const char *p;
    int rc;
 
    ASSERT(devfs != NULL);
@@ -116,11 +173,22 @@ create_dev_file(const char *filename, u16 major, u16 minor, void **devfile)
    if (!(dinfo = get_driver_info(major)))
       return -EINVAL;
 
+   d = fs->device_data;
+   dir = &d->root_dir;
+
+   for (p = filename; *p && *p != '/'; p++) { }
+
+   if (*p) {
+
+      if ((rc = devfs_get_subdir(d, filename, (size_t)(p - filename), &dir)))
+         return rc;
+
+      filename = p + 1;
+   }
+
    if (!(f = kzalloc_obj(struct devfs_file)))
       return -ENOMEM;
 
-   d = fs->device_data;
-
    f->inode = devfs_get_next_inode(d);
    f->name = filename;
    f->dev_major = major;
@@ -143,7 +211,7 @@ create_dev_file(const char *filename, u16 major, u16 minor, void **devfile)
       return -EINVAL;
    }
 
-   list_add_tail(&d->root_dir.files_list, &f->dir_node);
+   list_add_tail(&dir->files_list, &f->dir_node);
 
    if (devfile)
       *devfile = f;
@@ -167,14 +235,13 @@ static offt
 devfs_dir_seek(fs_handle h, offt target_off, int whence)
 {
    struct devfs_handle *dh = h;
-   struct devfs_data *d = dh->fs->device_data;
    struct devfs_file *pos;
    offt off = 0;
 
    if (target_off < 0 || whence != SEEK_SET)
       return -EINVAL;
 
-   list_for_each_ro(pos, &d->root_dir.files_list, dir_node) {
+   list_for_each_ro(pos, &dh->dir->files_list, dir_node) {
 
       if (off == target_off)
          break;
@@ -210,9 +277,8 @@ devfs_stat(struct fs *fs, vfs_inode_ptr_t i, struct stat64 *statbuf)
    switch (df->type) {
 
       case VFS_DIR:
-         ASSERT(i == &ddata->root_dir);
          statbuf->st_mode = 0555 | S_IFDIR;
-         statbuf->st_ino = ddata->root_dir.inode;
+         statbuf->st_ino = ((struct devfs_dir *)i)->inode;
          break;
 
       case VFS_CHAR_DEV:
@@ -253,7 +319,7 @@ static const struct file_ops static_ops_devfs =
 };
 
 static int
-devfs_open_root_dir(struct fs *fs, fs_handle *out)
+devfs_open_dir(struct fs *fs, struct devfs_dir *dir, fs_handle *out)
 {
    struct devfs_handle *h;
 
@@ -261,6 +327,7 @@ devfs_open_root_dir(struct fs *fs, fs_handle *out)
       return -ENOMEM;
 
    h->type = VFS_DIR;
+   h->dir = dir;
    *out = h;
    return 0;
 }
@@ -297,7 +364,7 @@ devfs_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mod)
    if (dp->inode) {
 
       if (dp->type == VFS_DIR)
-         return devfs_open_root_dir(p->fs, out);
+         return devfs_open_dir(p->fs, (void *)dp->inode, out);
 
       if ((fl & O_CREAT) && (fl & O_EXCL))
          return -EEXIST;
@@ -368,7 +435,6 @@ static int
 devfs_getdents(fs_handle h, get_dents_func_cb vfs_cb, void *arg)
 {
    struct devfs_handle *dh = h;
-   struct devfs_data *d = dh->fs->device_data;
    int rc = 0;
 
    if (dh->type != VFS_DIR)
@@ -376,11 +442,11 @@ devfs_getdents(fs_handle h, get_dents_func_cb vfs_cb, void *arg)
 
    if (!dh->dpos) {
       dh->dpos = list_first_obj(
-         &d->root_dir.files_list, struct devfs_file, dir_node
+         &dh->dir->files_list, struct devfs_file, dir_node
       );
    }
 
-   list_for_each_ro_kp(dh->dpos, &d->root_dir.files_list, dir_node) {
+   list_for_each_ro_kp(dh->dpos, &dh->dir->files_list, dir_node) {
 
       struct vfs_dent64 dent = {
          .ino  = dh->dpos->inode,
@@ -404,14 +470,17 @@ devfs_get_entry(struct fs *fs,
                 struct fs_path *fs_path)
 {
    struct devfs_data *d = fs->device_data;
-   struct devfs_dir *dir;
+   struct devfs_dir *dir = dir_inode ? dir_inode : &d->root_dir;
    struct devfs_file *pos;
 
-   if ((!dir_inode && !name) || is_dot_or_dotdot(name, (int)nl)) {
+   if (!name || is_dot_or_dotdot(name, (int)nl)) {
+
+      if (name && nl == 2)
+         dir = dir->parent;
 
       *fs_path = (struct fs_path) {
-         .inode      = &d->root_dir,
-         .dir_inode  = &d->root_dir,
+         .inode      = dir,
+         .dir_inode  = dir->parent,
          .dir_entry  = NULL,
          .type       = VFS_DIR,
       };
@@ -419,7 +488,6 @@ devfs_get_entry(struct fs *fs,
       return;
    }
 
-   dir = dir_inode;
    bzero(fs_path, sizeof(*fs_path));
 
    list_for_each_ro(pos, &dir->files_list, dir_node) {
@@ -429,8 +497,14 @@ devfs_get_entry(struct fs *fs,
    }
 
    if (&pos->dir_node != (struct list_node *) &dir->files_list) {
+
+      /* The inode of a sub-directory is its devfs_dir, not its entry */
+      void *inode = pos->type == VFS_DIR
+         ? (void *)CONTAINER_OF(pos, struct devfs_dir, entry)
+         : (void *)pos;
+
       *fs_path = (struct fs_path) {
-         .inode         = pos,
+         .inode         = inode,
          .dir_inode     = dir,
          .dir_entry     = pos,
          .type          = pos->type,
@@ -442,12 +516,11 @@ static vfs_inode_ptr_t
 devfs_get_inode(fs_handle h)
 {
    struct devfs_handle *dh = h;
-   struct devfs_data *ddata = dh->fs->device_data;
 
    switch (dh->type) {
 
       case VFS_DIR:
-         return &ddata->root_dir;
+         return dh->dir;
 
       case VFS_CHAR_DEV:
          return dh->file;
@@ -518,9 +591,7 @@ create_devfs(void)
    }
 
    d->next_inode = 1;
-   d->root_dir.type = VFS_DIR;
-   d->root_dir.inode = devfs_get_next_inode(d);
-   list_init(&d->root_dir.files_list);
+   devfs_init_dir(d, &d->root_dir, NULL);
    rwlock_wp_init(&d->rwlock, false);
    d->wrt_time = (time_t)get_timestamp();
 
@@ -11,8 +11,12 @@
 #include <tilck/kernel/fault_resumable.h>
 #include <tilck/kernel/syscalls.h>
 #include <tilck/kernel/pipe.h>
+#include <tilck/kernel/fs/memfd.h>
+#include <tilck/kernel/eventfd.h>
+#include <tilck/kernel/perf_event.h>
 
 #include <fcntl.h>      // system header
+#include <linux/fs.h>   // system header
 
 static inline bool is_fd_in_valid_range(int fd)
 {
@@ -229,6 +233,47 @@ int sys_write(int fd, const void *u_buf, size_t count)
    return (int)vfs_write(h, (char *)curr->io_copybuf, count);
 }
 
+static int ioctl_clone_range(fs_handle h, ulong request, void *argp)
+{
+   struct file_clone_range args;
+   fs_handle src_h;
+
+   if (request == FICLONE) {
+
+      args = (struct file_clone_range) {
+         .src_fd = (s64)(long)argp,
+         .src_offset = 0,
+         .src_length = 0,   /* 0 means up to the EOF */
+         .dest_offset = 0,
+      };
+
+   } else {
+
+      if (copy_from_user(&args, argp, sizeof(args)))
+         return -EFAULT;
+   }
+
+   if (args.src_fd != (int)args.src_fd)
+      return -EBADF;
+
+   if (!(src_h = get_fs_handle((int)args.src_fd)))
+      return -EBADF;
+
+   /* offt might be just 32-bit wide */
+   if ((u64)(offt)args.src_offset != args.src_offset ||
+       (u64)(offt)args.src_length != args.src_length ||
+       (u64)(offt)args.dest_offset != args.dest_offset)
+   {
+      return -EFBIG;
+   }
+
+   return vfs_clone_range(src_h,
+                          (offt)args.src_offset,
+                          h,
+                          (offt)args.dest_offset,
+                          (offt)args.src_length);
+}
+
 int sys_ioctl(int fd, ulong request, void *argp)
 {
    fs_handle handle = get_fs_handle(fd);
@@ -236,6 +281,9 @@ int sys_ioctl(int fd, ulong request, void *argp)
    if (!handle)
       return -EBADF;
 
+   if (request == FICLONE || request == FICLONERANGE)
+      return ioctl_clone_range(handle, request, argp);
+
    return vfs_ioctl(handle, request, argp);
 }
 
@@ -767,6 +815,88 @@ int sys_fdatasync(int fd)
    return vfs_fsync(hb);
 }
 
+int sys_fallocate(int fd, int mode, s64 offset, s64 len)
+{
+   fs_handle h;
+
+   if (!(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   /* offt might be just 32-bit wide */
+   if (offset != (offt)offset || len != (offt)len)
+      return -EFBIG;
+
+   return vfs_fallocate(h, mode, (offt)offset, (offt)len);
+}
+
+/*
+ * NOTE: `off_in` and `off_out` are pointers to 64-bit offsets (loff_t), while
+ * `len` is a size_t. A NULL offset pointer means that the current position of
+ * the file has to be used and then updated, like read() and write() do.
+ */
+int sys_copy_file_range(int fd_in, s64 *u_off_in,
+                        int fd_out, s64 *u_off_out,
+                        size_t len, u32 flags)
+{
+   fs_handle in, out;
+   s64 off_in, off_out;
+   offt rc;
+
+   if (flags)
+      return -EINVAL;
+
+   if (!(in = get_fs_handle(fd_in)) || !(out = get_fs_handle(fd_out)))
+      return -EBADF;
+
+   if (u_off_in) {
+      if (copy_from_user(&off_in, u_off_in, sizeof(off_in)))
+         return -EFAULT;
+   } else {
+      off_in = vfs_seek(in, 0, SEEK_CUR);
+   }
+
+   if (u_off_out) {
+      if (copy_from_user(&off_out, u_off_out, sizeof(off_out)))
+         return -EFAULT;
+   } else {
+      off_out = vfs_seek(out, 0, SEEK_CUR);
+   }
+
+   if (off_in < 0 || off_out < 0)
+      return -EINVAL; /* negative offset or not seekable file */
+
+   /* offt might be just 32-bit wide */
+   if (off_in != (offt)off_in || off_out != (offt)off_out)
+      return -EFBIG;
+
+   /* The return value must fit in an int */
+   len = MIN(len, (size_t)INT32_MAX & PAGE_MASK);
+
+   rc = vfs_copy_file_range(in, (offt)off_in, out, (offt)off_out, (offt)len);
+
+   if (rc <= 0)
+      return (int)rc;
+
+   off_in += rc;
+   off_out += rc;
+
+   if (u_off_in) {
+      if (copy_to_user(u_off_in, &off_in, sizeof(off_in)))
+         return -EFAULT;
+   } else {
+      vfs_seek(in, off_in, SEEK_SET);
+   }
+
+   if (u_off_out) {
+      if (copy_to_user(u_off_out, &off_out, sizeof(off_out)))
+         return -EFAULT;
+   } else {
+      vfs_seek(out, off_out, SEEK_SET);
+   }
+
+   return (int)rc;
+}
+
 int sys_syncfs(int fd)
 {
    struct fs_handle_base *hb = get_fs_handle(fd);
@@ -954,3 +1084,130 @@ no_fds:
    ret = -EMFILE;
    goto err_end;
 }
+
+int sys_memfd_create(const char *u_name, unsigned int flags)
+{
+   struct task *curr = get_curr_task();
+   char *name = curr->args_copybuf;
+   fs_handle h;
+   int fd, rc;
+
+   if (flags & ~(MFD_CLOEXEC | MFD_ALLOW_SEALING))
+      return -EINVAL; /* MFD_HUGETLB and unknown flags are not supported */
+
+   rc = copy_str_from_user(name, u_name, MFD_NAME_MAX_LEN + 1, NULL);
+
+   if (rc < 0)
+      return -EFAULT;
+
+   if (rc > 0)
+      return -EINVAL; /* name too long [Linux behavior] */
+
+   /*
+    * NOTE: the name is used only for debugging purposes on Linux (it appears
+    * as the target of the /proc/self/fd/ symlinks). Tilck's handles don't have
+    * a name and the targets of those symlinks are just "<fs type>:[<inode>]",
+    * so the name is just validated and then discarded.
+    *
+    * NOTE: MFD_ALLOW_SEALING is accepted, but sealing is not supported: the
+    * F_ADD_SEALS fcntl() command will just fail.
+    */
+
+   kmutex_lock(&curr->pi->fslock);
+   {
+      if ((fd = get_free_handle_num(curr->pi)) >= 0) {
+
+         if (!(rc = memfd_create_handle(&h))) {
+
+            if (flags & MFD_CLOEXEC)
+               ((struct fs_handle_base *)h)->fd_flags |= FD_CLOEXEC;
+
+            curr->pi->handles[fd] = h;
+            rc = fd;
+         }
+
+      } else {
+         rc = -EMFILE;
+      }
+   }
+   kmutex_unlock(&curr->pi->fslock);
+   return rc;
+}
+
+int sys_eventfd2(unsigned int initval, int flags)
+{
+   struct task *curr = get_curr_task();
+   fs_handle h;
+   int fd, rc;
+
+   if (flags & ~(EFD_SEMAPHORE | EFD_CLOEXEC | EFD_NONBLOCK))
+      return -EINVAL;
+
+   kmutex_lock(&curr->pi->fslock);
+   {
+      if ((fd = get_free_handle_num(curr->pi)) >= 0) {
+
+         if (!(rc = eventfd_create_handle(initval, flags, &h))) {
+
+            if (flags & EFD_CLOEXEC)
+               ((struct fs_handle_base *)h)->fd_flags |= FD_CLOEXEC;
+
+            curr->pi->handles[fd] = h;
+            rc = fd;
+         }
+
+      } else {
+         rc = -EMFILE;
+      }
+   }
+   kmutex_unlock(&curr->pi->fslock);
+   return rc;
+}
+
+int sys_eventfd(unsigned int initval)
+{
+   return sys_eventfd2(initval, 0);
+}
+
+int sys_perf_event_open(struct perf_event_attr *u_attr,
+                        int pid, int cpu, int group_fd, ulong flags)
+{
+   struct task *curr = get_curr_task();
+   struct perf_event_attr attr;
+   fs_handle h;
+   int fd, rc;
+
+   /* Only counting on the current task is supported, on any CPU */
+   if ((pid && pid != curr->tid) || (cpu != -1 && cpu != 0))
+      return -EINVAL;
+
+   if (group_fd != -1 || (flags & ~PERF_FLAG_FD_CLOEXEC))
+      return -EINVAL;
+
+   /* All the fields we care about are in the first version of the struct */
+   if (copy_from_user(&attr, u_attr, PERF_ATTR_SIZE_VER0))
+      return -EFAULT;
+
+   if (attr.size && attr.size < PERF_ATTR_SIZE_VER0)
+      return -EINVAL;
+
+   kmutex_lock(&curr->pi->fslock);
+   {
+      if ((fd = get_free_handle_num(curr->pi)) >= 0) {
+
+         if (!(rc = perf_event_create_handle(curr, &attr, &h))) {
+
+            if (flags & PERF_FLAG_FD_CLOEXEC)
+               ((struct fs_handle_base *)h)->fd_flags |= FD_CLOEXEC;
+
+            curr->pi->handles[fd] = h;
+            rc = fd;
+         }
+
+      } else {
+         rc = -EMFILE;
+      }
+   }
+   kmutex_unlock(&curr->pi->fslock);
+   return rc;
+}
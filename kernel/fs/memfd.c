@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#include <tilck/kernel/fs/memfd.h>
+#include <tilck/kernel/fs/ramfs.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/errno.h>
+
+/*
+ * Memfd files live in a private, unmounted, ramfs instance. Their inodes are
+ * never linked to any directory: they get destroyed when their last handle is
+ * closed. Therefore, the whole ramfs machinery (read, write, truncate, mmap,
+ * page faults) is re-used as it is.
+ */
+
+static struct fs *memfd_fs;
+
+void init_memfd(void)
+{
+   memfd_fs = ramfs_create();
+
+   if (!memfd_fs)
+      panic("Unable to create memfd's ramfs instance");
+
+   /* As for kernelfs, there's no mount point keeping this FS alive */
+   memfd_fs->ref_count = 1;
+}
+
+int memfd_create_handle(fs_handle *out)
+{
+   ASSERT(memfd_fs != NULL);
+   return ramfs_open_anon_file(memfd_fs, 0600, out);
+}
@@ -1,40 +1,474 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
-static struct ramfs_block *ramfs_new_block(offt page)
+/*
+ * Ramfs blocks
+ * ---------------
+ *
+ * The data of a ramfs file is stored in a set of non-overlapping blocks, kept
+ * in an AVL tree ordered by file offset. Each block is an *extent* of up to
+ * RAMFS_MAX_BLOCK_PAGES physically contiguous pages, obtained with a single
+ * kmalloc() call. That way, large files need a small number of tree nodes and
+ * sequential reads and writes need one tree lookup per extent, not per page.
+ *
+ * Because mmap() works at page granularity, the ref-count of each pageframe
+ * is still retained and released individually. At the same way, blocks can
+ * be shrunk (e.g. by truncate) by freeing just some of their pages: that is
+ * possible thanks to kmalloc's KFREE_FL_ALLOW_SPLIT flag.
+ *
+ * After a clone operation, the data of a block can be shared with other blocks
+ * (see struct ramfs_shared_data). Shared blocks are never written in-place nor
+ * mapped in R/W mode: they're copied first, by ramfs_block_prepare_write().
+ */
+
+static long ramfs_block_cmp_off(const void *obj, const void *valptr)
+{
+   const struct ramfs_block *b = obj;
+   const offt off = *(const offt *)valptr;
+
+   if (off < b->offset)
+      return 1;
+
+   if (off >= b->offset + (offt)b->size)
+      return -1;
+
+   return 0;
+}
+
+/* Returns the block containing the given offset, or NULL (hole) */
+static struct ramfs_block *
+ramfs_find_block(struct ramfs_inode *i, offt off)
+{
+   return bintree_find(i->blocks_tree_root,
+                       &off,
+                       ramfs_block_cmp_off,
+                       struct ramfs_block,
+                       node);
+}
+
+/*
+ * Returns the first block ending after `off` (i.e. the block containing `off`,
+ * if any, or the next one) or NULL, if there are no blocks after `off`.
+ */
+static struct ramfs_block *
+ramfs_find_block_after(struct ramfs_inode *i, offt off)
+{
+   struct ramfs_block *b = i->blocks_tree_root;
+   struct ramfs_block *res = NULL;
+
+   while (b) {
+
+      if (b->offset + (offt)b->size > off) {
+         res = b;
+         b = b->node.left_obj;
+      } else {
+         b = b->node.right_obj;
+      }
+   }
+
+   return res;
+}
+
+/*
+ * Like ramfs_find_block(), but first try handle's cached block. This makes
+ * sequential reads and writes not to require any tree lookup, except when
+ * moving from one block to the next one.
+ */
+static struct ramfs_block *
+ramfs_get_block(struct ramfs_handle *rh, offt off)
+{
+   struct ramfs_inode *i = rh->inode;
+   struct ramfs_block *b = rh->cb;
+
+   if (b && rh->cb_gen == i->blocks_gen) {
+      if (off >= b->offset && off < b->offset + (offt)b->size)
+         return b;
+   }
+
+   if ((b = ramfs_find_block(i, off))) {
+      rh->cb = b;
+      rh->cb_gen = i->blocks_gen;
+   }
+
+   return b;
+}
+
+static void ramfs_kfree_pages(void *vaddr, size_t size)
+{
+   ulong va = (ulong)vaddr;
+   const ulong end = va + size;
+   size_t chunk, actual_chunk;
+
+   ASSERT(IS_PAGE_ALIGNED(va));
+   ASSERT(IS_PAGE_ALIGNED(size));
+
+   /*
+    * Free the memory in the biggest naturally-aligned power-of-two chunks
+    * possible. The range might be just a part of the original allocation.
+    */
+   while (va < end) {
+
+      chunk = PAGE_SIZE;
+
+      while (!(va & (2 * chunk - 1)) && va + 2 * chunk <= end)
+         chunk *= 2;
+
+      actual_chunk = chunk;
+      general_kfree((void *)va, &actual_chunk, KFREE_FL_ALLOW_SPLIT);
+      ASSERT(actual_chunk == chunk);
+      va += chunk;
+   }
+}
+
+static void ramfs_free_block_pages(void *vaddr, size_t size)
+{
+   /* Release the pageframes used by this range */
+   release_pageframes_mapped_at(get_kernel_pdir(), vaddr, size);
+   ramfs_kfree_pages(vaddr, size);
+}
+
+/*
+ * Allocate `size` bytes (page-aligned, not zeroed) of data for a block. The
+ * memory is allocated already split in pages (like user_valloc_and_map()
+ * does), because any sub-range of it can be later freed by
+ * ramfs_kfree_pages() with KFREE_FL_ALLOW_SPLIT.
+ */
+static void *ramfs_alloc_block_data(size_t size)
+{
+   size_t actual_size = size;
+   void *vaddr;
+
+   ASSERT(IS_PAGE_ALIGNED(size));
+
+   vaddr = general_kmalloc(&actual_size, KMALLOC_FL_MULTI_STEP | PAGE_SIZE);
+
+   if (!vaddr)
+      return NULL;
+
+   ASSERT(actual_size == size);
+
+   /* Retain the pageframes used by this block */
+   retain_pageframes_mapped_at(get_kernel_pdir(), vaddr, size);
+   return vaddr;
+}
+
+static struct ramfs_block *ramfs_new_block(offt page, size_t size)
 {
    struct ramfs_block *b;
 
+   ASSERT(IS_PAGE_ALIGNED(size));
+   ASSERT(roundup_next_power_of_2(size) == size);
+
    /* Allocate memory for the block object */
    if (!(b = kalloc_obj(struct ramfs_block)))
       return NULL;
 
    /* Allocate block's data */
-   if (!(b->vaddr = kzmalloc(PAGE_SIZE))) {
+   if (!(b->vaddr = ramfs_alloc_block_data(size))) {
       kfree_obj(b, struct ramfs_block);
       return NULL;
    }
 
-   /* Retain the pageframe used by this block */
-   retain_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
+   bzero(b->vaddr, size);
 
    /* Init the block object */
    bintree_node_init(&b->node);
    b->offset = page;
+   b->size = size;
+   b->sd = NULL;
    return b;
 }
 
-static void ramfs_destroy_block(struct ramfs_block *b)
+/*
+ * Make the data of `b` shareable with other blocks, by moving its ownership
+ * to a new ramfs_shared_data object. Returns false in case of OOM.
+ */
+static bool ramfs_block_share(struct ramfs_block *b)
 {
-   /* Release the pageframe used by this block */
-   release_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
+   struct ramfs_shared_data *sd;
+
+   if (b->sd)
+      return true;
+
+   if (!(sd = kalloc_obj(struct ramfs_shared_data)))
+      return false;
+
+   sd->ref_count = 1;
+   sd->vaddr = b->vaddr;
+   sd->size = b->size;
+   b->sd = sd;
+   return true;
+}
+
+/* Drop the reference of `b` to its shared data, freeing it if it's the last */
+static void ramfs_block_put_shared(struct ramfs_block *b)
+{
+   struct ramfs_shared_data *sd = b->sd;
+
+   b->sd = NULL;
+
+   if (!release_obj(sd)) {
+      ramfs_free_block_pages(sd->vaddr, sd->size);
+      kfree_obj(sd, struct ramfs_shared_data);
+   }
+}
 
+/*
+ * When `b` is the only block left referring to its shared data, make it own
+ * again its data, freeing the pages not belonging to it.
+ */
+static void ramfs_block_try_unshare(struct ramfs_block *b)
+{
+   struct ramfs_shared_data *sd = b->sd;
+
+   if (!sd || get_ref_count(sd) > 1)
+      return;
+
+   ramfs_free_block_pages(sd->vaddr, (size_t)(b->vaddr - sd->vaddr));
+   ramfs_free_block_pages(b->vaddr + b->size,
+                          (size_t)((sd->vaddr + sd->size) -
+                                   (b->vaddr + b->size)));
+
+   kfree_obj(sd, struct ramfs_shared_data);
+   b->sd = NULL;
+}
+
+/* Free some pages of `b`, unless they're still shared with other blocks */
+static void
+ramfs_block_free_pages(struct ramfs_block *b, void *vaddr, size_t len)
+{
+   ramfs_block_try_unshare(b);
+
+   if (!b->sd)
+      ramfs_free_block_pages(vaddr, len);
+}
+
+static void ramfs_destroy_block(struct ramfs_block *b)
+{
    /* Free the memory pointed by this block */
-   kfree2(b->vaddr, PAGE_SIZE);
+   if (b->sd)
+      ramfs_block_put_shared(b);
+   else
+      ramfs_free_block_pages(b->vaddr, b->size);
 
    /* Free the memory used by the block object itself */
    kfree_obj(b, struct ramfs_block);
 }
 
+/*
+ * Shrink the block `b` to `new_size` bytes, freeing its last pages.
+ * NOTE: the caller has to update inode's `blocks_count` and `blocks_gen`.
+ */
+static void ramfs_shrink_block(struct ramfs_block *b, size_t new_size)
+{
+   ASSERT(IS_PAGE_ALIGNED(new_size));
+   ASSERT(0 < new_size && new_size < b->size);
+
+   ramfs_block_free_pages(b, b->vaddr + new_size, b->size - new_size);
+   b->size = new_size;
+}
+
+/*
+ * Free the first `len` bytes of the block `b`. Changing `b->offset` in-place is
+ * safe because the block does not move relative to the other blocks.
+ * NOTE: the caller has to update inode's `blocks_count` and `blocks_gen`.
+ */
+static void ramfs_cut_block_head(struct ramfs_block *b, size_t len)
+{
+   ASSERT(IS_PAGE_ALIGNED(len));
+   ASSERT(0 < len && len < b->size);
+
+   ramfs_block_free_pages(b, b->vaddr, len);
+   b->vaddr += len;
+   b->offset += (offt)len;
+   b->size -= len;
+}
+
+/*
+ * Free the pages of `b` in the range [begin, end), strictly inside the block,
+ * splitting it in two blocks. Returns false in case of OOM.
+ * NOTE: the caller has to update inode's `blocks_count` and `blocks_gen`.
+ */
+static bool
+ramfs_split_block(struct ramfs_inode *i,
+                  struct ramfs_block *b,
+                  offt begin,
+                  offt end)
+{
+   struct ramfs_block *tail;
+   const offt b_end = b->offset + (offt)b->size;
+
+   ASSERT(IS_PAGE_ALIGNED(begin));
+   ASSERT(IS_PAGE_ALIGNED(end));
+   ASSERT(b->offset < begin && begin < end && end < b_end);
+
+   if (!(tail = kalloc_obj(struct ramfs_block)))
+      return false;
+
+   ramfs_block_free_pages(b,
+                          b->vaddr + (begin - b->offset),
+                          (size_t)(end - begin));
+
+   bintree_node_init(&tail->node);
+   tail->offset = end;
+   tail->size = (size_t)(b_end - end);
+   tail->vaddr = b->vaddr + (end - b->offset);
+   tail->sd = b->sd;
+   b->size = (size_t)(begin - b->offset);
+
+   if (tail->sd)
+      retain_obj(tail->sd);
+
+   DEBUG_ONLY_UNSAFE(bool success =)
+      bintree_insert_ptr(&i->blocks_tree_root,
+                         tail,
+                         struct ramfs_block,
+                         node,
+                         offset);
+
+   ASSERT(success);
+   return true;
+}
+
+static long ramfs_block_cmp_range(const void *obj, const void *valptr)
+{
+   const struct ramfs_block *b = obj;
+   const offt *range = valptr; /* [range[0], range[1]) */
+
+   if (range[1] <= b->offset)
+      return 1;
+
+   if (range[0] >= b->offset + (offt)b->size)
+      return -1;
+
+   return 0;
+}
+
+static bool
+ramfs_is_range_free(struct ramfs_inode *i, offt begin, offt end)
+{
+   const offt range[2] = { begin, end };
+
+   return !bintree_find(i->blocks_tree_root,
+                        range,
+                        ramfs_block_cmp_range,
+                        struct ramfs_block,
+                        node);
+}
+
+/*
+ * Read faults on holes of a memory-mapped file get the zero page mapped,
+ * read-only. When a block for a such hole is created, the zero page has to be
+ * replaced with the new block in all the mappings of the inode, otherwise
+ * processes sharing the file would not see each other's writes.
+ */
+static void
+ramfs_remap_hole_in_mappings(struct ramfs_inode *i, struct ramfs_block *b)
+{
+   const size_t b_begin = (size_t)b->offset;
+   const size_t b_end = b_begin + b->size;
+   struct user_mapping *um;
+   size_t off, begin, end;
+   ulong va, pa;
+   u32 pg_flags;
+
+   disable_preemption();
+
+   list_for_each_ro(um, &i->mappings_list, inode_node) {
+
+      begin = MAX(b_begin, um->off);
+      end = MIN(b_end, um->off + um->len);
+
+      pg_flags = PAGING_FL_US | PAGING_FL_SHARED;
+
+      if ((um->prot & PROT_WRITE) && !b->sd)
+         pg_flags |= PAGING_FL_RW;
+
+      for (off = begin; off < end; off += PAGE_SIZE) {
+
+         va = um->vaddr + (off - um->off);
+
+         if (get_mapping2(um->pi->pdir, (void *)va, &pa) < 0)
+            continue; /* not mapped: the next access will fault */
+
+         if (pa != KERNEL_VA_TO_PA(&zero_page))
+            continue;
+
+         unmap_page_permissive(um->pi->pdir, (void *)va, false);
+
+         /* In case of failure, the page will just fault again */
+         if (!map_page(um->pi->pdir,
+                       (void *)va,
+                       KERNEL_VA_TO_PA(b->vaddr + (off - b_begin)),
+                       pg_flags))
+         {
+            invalidate_page(va);
+         }
+      }
+   }
+
+   enable_preemption();
+}
+
+/*
+ * Unmap the pages in the range [begin, end) of the file from all of its
+ * memory mappings. The next access to those pages will trigger a page fault,
+ * handled by ramfs_handle_fault(). See ramfs_unmap_past_eof_mappings().
+ */
+static void
+ramfs_unmap_range_in_mappings(struct ramfs_inode *i, offt begin, offt end)
+{
+   struct user_mapping *um;
+   size_t off, r_begin, r_end;
+   ulong va;
+   ASSERT(!is_preemption_enabled());
+
+   list_for_each_ro(um, &i->mappings_list, inode_node) {
+
+      r_begin = MAX((size_t)begin, um->off);
+      r_end = MIN((size_t)end, um->off + um->len);
+
+      for (off = r_begin; off < r_end; off += PAGE_SIZE) {
+         va = um->vaddr + (off - um->off);
+         unmap_page_permissive(um->pi->pdir, (void *)va, false);
+         invalidate_page(va);
+      }
+   }
+}
+
+/*
+ * Make sure that the data of `b` is not shared with any other block, before
+ * writing to it, by making a private copy of it (copy-on-write). The pages of
+ * the block get un-mapped from all the memory mappings of the inode, because
+ * they would still point to the shared data. Returns 0 or -ENOMEM.
+ */
+static int
+ramfs_block_prepare_write(struct ramfs_inode *i, struct ramfs_block *b)
+{
+   void *data;
+
+   if (!b->sd)
+      return 0;
+
+   ramfs_block_try_unshare(b);
+
+   if (!b->sd)
+      return 0;
+
+   if (!(data = ramfs_alloc_block_data(b->size)))
+      return -ENOMEM;
+
+   memcpy(data, b->vaddr, b->size);
+
+   disable_preemption();
+   {
+      ramfs_unmap_range_in_mappings(i, b->offset, b->offset + (offt)b->size);
+      b->vaddr = data;
+      ramfs_block_put_shared(b);
+   }
+   enable_preemption();
+   return 0;
+}
+
 static void
 ramfs_append_new_block(struct ramfs_inode *inode, struct ramfs_block *block)
 {
@@ -46,7 +480,54 @@ ramfs_append_new_block(struct ramfs_inode *inode, struct ramfs_block *block)
                          offset);
 
    ASSERT(success);
-   inode->blocks_count++;
+   inode->blocks_count += block->size >> PAGE_SHIFT;
+
+   if (!list_is_empty(&inode->mappings_list))
+      ramfs_remap_hole_in_mappings(inode, block);
+}
+
+/*
+ * Allocate a new block at `page`, trying to make it big enough to contain
+ * `len` bytes. When appending data to the file, the size of the new block is
+ * proportional to the size of the file (up to 1/8 of it), in order to need
+ * a logarithmic number of blocks in case of small sequential writes. The
+ * block is never allowed to overlap with existing blocks and, in case of
+ * memory pressure, smaller blocks are tried, down to a single page.
+ */
+static struct ramfs_block *
+ramfs_alloc_block(struct ramfs_inode *i, offt page, offt len)
+{
+   struct ramfs_block *b = NULL;
+   size_t pages = (size_t)((len + PAGE_SIZE - 1) >> PAGE_SHIFT);
+   size_t p2;
+
+   ASSERT(IS_PAGE_ALIGNED(page));
+   ASSERT(len > 0);
+
+   if (page >= i->fsize)
+      pages = MAX(pages, i->blocks_count / 8);
+
+   /* Round-down `pages` to a power of 2, not bigger than the max */
+   pages = MIN(pages, RAMFS_MAX_BLOCK_PAGES);
+   p2 = roundup_next_power_of_2(pages);
+   pages = p2 > pages ? p2 / 2 : p2;
+
+   for (; pages > 1; pages /= 2) {
+
+      if (!ramfs_is_range_free(i, page, page + (offt)(pages << PAGE_SHIFT)))
+         continue;
+
+      if ((b = ramfs_new_block(page, pages << PAGE_SHIFT)))
+         break;
+   }
+
+   if (pages == 1) {
+      if (!(b = ramfs_new_block(page, PAGE_SIZE)))
+         return NULL;
+   }
+
+   ramfs_append_new_block(i, b);
+   return b;
 }
 
 static int ramfs_inode_extend(struct ramfs_inode *i, offt new_len)
@@ -0,0 +1,265 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Reflink clones and copy_file_range()
+ * --------------------------------------
+ *
+ * Cloning a range of a file into another (or the same) file does not copy any
+ * data: the destination gets new block objects pointing to the same pages of
+ * the source blocks, which become shared (see struct ramfs_shared_data). The
+ * first write to a shared block, from either file, makes a private copy of it.
+ *
+ * copy_file_range() clones the largest page-aligned part of the range, when
+ * the source and destination offsets have the same alignment, and copies the
+ * rest (at most two partial pages) through a bounce buffer.
+ */
+
+/*
+ * Share the blocks of `si` in [s_off, s_off + len) with `di`, at `d_off`.
+ * All the offsets and `len` must be page-aligned. The blocks previously in the
+ * destination range are freed. Returns 0 or -ENOMEM.
+ */
+static int
+ramfs_inode_clone_blocks(struct ramfs_inode *si,
+                         offt s_off,
+                         struct ramfs_inode *di,
+                         offt d_off,
+                         offt len)
+{
+   const offt s_end = s_off + len;
+   const offt delta = d_off - s_off;
+   struct ramfs_block *b, *nb;
+   offt begin, end;
+   int rc;
+
+   ASSERT(IS_PAGE_ALIGNED(s_off));
+   ASSERT(IS_PAGE_ALIGNED(d_off));
+   ASSERT(IS_PAGE_ALIGNED(len));
+
+   if ((rc = ramfs_inode_punch_hole(di, d_off, len)))
+      return rc;
+
+   for (; s_off < s_end; s_off = end) {
+
+      b = ramfs_find_block_after(si, s_off);
+
+      if (!b || b->offset >= s_end)
+         break;
+
+      begin = MAX(s_off, b->offset);
+      end = MIN(s_end, b->offset + (offt)b->size);
+
+      if (!(nb = kalloc_obj(struct ramfs_block)))
+         return -ENOMEM;
+
+      if (!b->sd) {
+
+         if (!ramfs_block_share(b)) {
+            kfree_obj(nb, struct ramfs_block);
+            return -ENOMEM;
+         }
+
+         /* The mappings of the source must stop writing on the block */
+         disable_preemption();
+         {
+            ramfs_unmap_range_in_mappings(si,
+                                          b->offset,
+                                          b->offset + (offt)b->size);
+         }
+         enable_preemption();
+      }
+
+      bintree_node_init(&nb->node);
+      nb->offset = begin + delta;
+      nb->size = (size_t)(end - begin);
+      nb->vaddr = b->vaddr + (begin - b->offset);
+      nb->sd = b->sd;
+      retain_obj(nb->sd);
+
+      ramfs_append_new_block(di, nb);
+   }
+
+   di->blocks_gen++;
+   return 0;
+}
+
+/* Copy `len` bytes, using the positions of the handles and a bounce buffer */
+static offt
+ramfs_copy_bytes(struct ramfs_handle *src,
+                 offt s_off,
+                 struct ramfs_handle *dst,
+                 offt d_off,
+                 offt len,
+                 char *buf)
+{
+   const offt saved_src_pos = src->pos;
+   const offt saved_dst_pos = dst->pos;
+   offt tot = 0;
+   ssize_t rc = 0;
+
+   while (tot < len) {
+
+      const size_t chunk = (size_t)MIN(len - tot, (offt)PAGE_SIZE);
+
+      src->pos = s_off + tot;
+
+      if ((rc = ramfs_read_nolock(src, buf, chunk)) != (ssize_t)chunk)
+         break;
+
+      dst->pos = d_off + tot;
+
+      if ((rc = ramfs_write_nolock(dst, buf, chunk)) < 0)
+         break;
+
+      tot += rc;
+
+      if (rc < (ssize_t)chunk)
+         break;
+   }
+
+   src->pos = saved_src_pos;
+   dst->pos = saved_dst_pos;
+   return tot > 0 ? tot : (offt)MIN(rc, 0);
+}
+
+static offt
+ramfs_copy_range_nolock(struct ramfs_handle *src,
+                        offt s_off,
+                        struct ramfs_handle *dst,
+                        offt d_off,
+                        offt len,
+                        int flags)
+{
+   struct ramfs_inode *si = src->inode;
+   struct ramfs_inode *di = dst->inode;
+   offt s_end, c_begin, c_end, head, tail, rc;
+   char *buf;
+
+   if (s_off >= si->fsize)
+      return 0;
+
+   len = MIN(len, si->fsize - s_off);
+   s_end = s_off + len;
+
+   if (si == di && s_off < d_off + len && d_off < s_end)
+      return -EINVAL; /* overlapping ranges in the same file */
+
+   if ((s_off ^ d_off) & (offt)OFFSET_IN_PAGE_MASK) {
+
+      /* Different alignment: cloning is not possible */
+      c_begin = c_end = s_end;
+
+   } else {
+
+      head = ((offt)PAGE_SIZE - (s_off & (offt)OFFSET_IN_PAGE_MASK));
+      head &= (offt)OFFSET_IN_PAGE_MASK;
+      c_begin = MIN(s_off + head, s_end);
+      c_end = s_end & (offt)PAGE_MASK;
+
+      /*
+       * The last partial page can be cloned as well, when it's the last page
+       * of the source and the destination's data after it, if any, would be
+       * overwritten anyway. That's because the data past EOF is always zero.
+       */
+      if (s_end == si->fsize && d_off + len >= di->fsize)
+         c_end = (offt)pow2_round_up_at((ulong)s_end, PAGE_SIZE);
+
+      c_end = MAX(c_end, c_begin);
+   }
+
+   if (flags & VFS_CR_CLONE) {
+      if (c_begin != s_off || c_end < s_end)
+         return -EINVAL; /* cloning the whole range is not possible */
+   }
+
+   if (c_end > c_begin) {
+
+      rc = ramfs_inode_clone_blocks(si,
+                                    c_begin,
+                                    di,
+                                    c_begin + (d_off - s_off),
+                                    c_end - c_begin);
+      if (rc)
+         return rc;
+
+      if (d_off + len > di->fsize)
+         di->fsize = d_off + len;
+   }
+
+   if (c_begin == s_off && c_end >= s_end)
+      return len; /* everything has been cloned */
+
+   if (!(buf = kmalloc(PAGE_SIZE))) {
+
+      /* Report the cloned bytes only if there's no head to copy before them */
+      if (c_end > c_begin && c_begin == s_off)
+         return MIN(c_end, s_end) - s_off;
+
+      return -ENOMEM;
+   }
+
+   if (c_end > c_begin) {
+
+      /* Copy the head and the tail around the cloned part */
+      rc = ramfs_copy_bytes(src, s_off, dst, d_off, c_begin - s_off, buf);
+
+      if (rc == c_begin - s_off) {
+
+         /* The head is complete: count the cloned part as well */
+         rc += MIN(c_end, s_end) - c_begin;
+
+         if (s_end > c_end) {
+
+            tail = ramfs_copy_bytes(src,
+                                    c_end,
+                                    dst,
+                                    c_end + (d_off - s_off),
+                                    s_end - c_end,
+                                    buf);
+            if (tail > 0)
+               rc += tail;
+         }
+      }
+
+   } else {
+
+      rc = ramfs_copy_bytes(src, s_off, dst, d_off, len, buf);
+   }
+
+   kfree2(buf, PAGE_SIZE);
+   return rc;
+}
+
+static offt
+ramfs_copy_range(fs_handle in,
+                 offt off_in,
+                 fs_handle out,
+                 offt off_out,
+                 offt len,
+                 int flags)
+{
+   struct ramfs_handle *src = in;
+   struct ramfs_handle *dst = out;
+   struct ramfs_inode *si = src->inode;
+   struct ramfs_inode *di = dst->inode;
+   struct ramfs_inode *first = si < di ? si : di;
+   struct ramfs_inode *second = si < di ? di : si;
+   offt rc;
+
+   if (si->type != VFS_FILE || di->type != VFS_FILE)
+      return -EINVAL;
+
+   /* Always lock the two inodes in the same order, to avoid deadlocks */
+   rwlock_wp_exlock(&first->rwlock);
+
+   if (second != first)
+      rwlock_wp_exlock(&second->rwlock);
+
+   rc = ramfs_copy_range_nolock(src, off_in, dst, off_out, len, flags);
+
+   if (second != first)
+      rwlock_wp_exunlock(&second->rwlock);
+
+   rwlock_wp_exunlock(&first->rwlock);
+   return rc;
+}
@@ -0,0 +1,187 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Sparse files support: fallocate(), hole punching and SEEK_DATA/SEEK_HOLE.
+ *
+ * Ramfs files are naturally sparse: ranges not covered by any block are holes
+ * and read as zeros, without allocating anything. With fallocate() the user
+ * can both allocate blocks for the holes in a given range (default mode) and
+ * free the blocks in a given range (FALLOC_FL_PUNCH_HOLE).
+ */
+
+/* Returns the offset of the first byte of data at or after `off` */
+static offt ramfs_next_data(struct ramfs_inode *i, offt off)
+{
+   struct ramfs_block *b = ramfs_find_block_after(i, off);
+
+   if (!b || b->offset >= i->fsize)
+      return -ENXIO;
+
+   return MAX(off, b->offset);
+}
+
+/* Returns the offset of the first hole at or after `off` (EOF included) */
+static offt ramfs_next_hole(struct ramfs_inode *i, offt off)
+{
+   struct ramfs_block *b;
+
+   while ((b = ramfs_find_block_after(i, off)) && b->offset <= off)
+      off = b->offset + (offt)b->size;
+
+   return MIN(off, i->fsize);
+}
+
+/* Zero the data in the range [begin, end), without allocating anything */
+static int ramfs_zero_range(struct ramfs_inode *i, offt begin, offt end)
+{
+   struct ramfs_block *b;
+   offt r_end;
+   int rc;
+
+   while (begin < end) {
+
+      b = ramfs_find_block_after(i, begin);
+
+      if (!b || b->offset >= end)
+         break;
+
+      if ((rc = ramfs_block_prepare_write(i, b)))
+         return rc;
+
+      begin = MAX(begin, b->offset);
+      r_end = MIN(end, b->offset + (offt)b->size);
+      bzero(b->vaddr + (begin - b->offset), (size_t)(r_end - begin));
+      begin = r_end;
+   }
+
+   return 0;
+}
+
+/* Allocate blocks for all the holes in the range [off, off + len) */
+static int ramfs_inode_alloc_range(struct ramfs_inode *i, offt off, offt len)
+{
+   const offt end = off + len;
+   offt page = off & (offt)PAGE_MASK;
+   offt hole_end;
+   struct ramfs_block *b;
+
+   while (page < end) {
+
+      b = ramfs_find_block_after(i, page);
+
+      if (b && b->offset <= page) {
+         page = b->offset + (offt)b->size; /* skip the allocated block */
+         continue;
+      }
+
+      hole_end = b ? MIN(b->offset, end) : end;
+
+      if (!(b = ramfs_alloc_block(i, page, hole_end - page)))
+         return -ENOSPC;
+
+      page = b->offset + (offt)b->size;
+   }
+
+   return 0;
+}
+
+/* Free the blocks in the range [off, off + len), zeroing partial pages */
+static int ramfs_inode_punch_hole(struct ramfs_inode *i, offt off, offt len)
+{
+   const offt end = off + len;
+   const offt p_begin = (offt)pow2_round_up_at((ulong)off, PAGE_SIZE);
+   const offt p_end = end & (offt)PAGE_MASK;
+   struct ramfs_block *b;
+   offt b_end;
+   int rc = 0;
+
+   if (p_begin >= p_end) {
+      /* No whole page in the range: just zero it */
+      return ramfs_zero_range(i, off, end);
+   }
+
+   if ((rc = ramfs_zero_range(i, off, p_begin)))
+      return rc;
+
+   if ((rc = ramfs_zero_range(i, p_end, end)))
+      return rc;
+
+   /*
+    * Prevent page faults from looking at the blocks while we're changing
+    * them. That's what ramfs_handle_fault() relies on.
+    */
+   disable_preemption();
+
+   ramfs_unmap_range_in_mappings(i, p_begin, p_end);
+
+   while ((b = ramfs_find_block_after(i, p_begin)) && b->offset < p_end) {
+
+      b_end = b->offset + (offt)b->size;
+
+      if (b->offset >= p_begin && b_end <= p_end) {
+
+         /* The whole block is inside the hole: destroy it */
+         bintree_remove_ptr(&i->blocks_tree_root,
+                            b,
+                            struct ramfs_block,
+                            node,
+                            offset);
+
+         i->blocks_count -= b->size >> PAGE_SHIFT;
+         ramfs_destroy_block(b);
+
+      } else if (b->offset >= p_begin) {
+
+         /* The hole covers the head of the block */
+         i->blocks_count -= (size_t)(p_end - b->offset) >> PAGE_SHIFT;
+         ramfs_cut_block_head(b, (size_t)(p_end - b->offset));
+
+      } else if (b_end <= p_end) {
+
+         /* The hole covers the tail of the block */
+         i->blocks_count -= (size_t)(b_end - p_begin) >> PAGE_SHIFT;
+         ramfs_shrink_block(b, (size_t)(p_begin - b->offset));
+
+      } else {
+
+         /* The hole is in the middle of the block */
+         if (ramfs_split_block(i, b, p_begin, p_end))
+            i->blocks_count -= (size_t)(p_end - p_begin) >> PAGE_SHIFT;
+         else
+            rc = -ENOMEM;
+
+         break;
+      }
+   }
+
+   i->blocks_gen++;
+   enable_preemption();
+   return rc;
+}
+
+static int ramfs_fallocate(fs_handle h, int mode, offt off, offt len)
+{
+   struct ramfs_handle *rh = h;
+   struct ramfs_inode *i = rh->inode;
+   int rc = 0;
+
+   if (i->type != VFS_FILE)
+      return -ENODEV;
+
+   ramfs_file_exlock(h);
+   {
+      if (mode & FALLOC_FL_PUNCH_HOLE) {
+
+         rc = ramfs_inode_punch_hole(i, off, len);
+
+      } else {
+
+         rc = ramfs_inode_alloc_range(i, off, len);
+
+         if (!rc && !(mode & FALLOC_FL_KEEP_SIZE) && off + len > i->fsize)
+            rc = ramfs_inode_extend(i, off + len);
+      }
+   }
+   ramfs_file_exunlock(h);
+   return rc;
+}
@@ -10,14 +10,18 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
 {
    struct ramfs_handle *rh = um->h;
    struct ramfs_inode *i = rh->inode;
-   ulong vaddr = um->vaddr;
+   ulong vaddr;
+   size_t off;
    struct bintree_walk_ctx ctx;
    struct ramfs_block *b;
    u32 pg_flags;
    int rc;
 
    const size_t off_begin = um->off;
-   const size_t off_end = off_begin + um->len;
+   const size_t eof_end = pow2_round_up_at((size_t)i->fsize, PAGE_SIZE);
+
+   /* Blocks past EOF (see FALLOC_FL_KEEP_SIZE) must never be mapped */
+   const size_t off_end = MIN(off_begin + um->len, eof_end);
 
    ASSERT(IS_PAGE_ALIGNED(um->len));
 
@@ -33,37 +37,40 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
                                 node,
                                 false);
 
-   pg_flags = PAGING_FL_US | PAGING_FL_SHARED;
-
-   if ((rh->fl_flags & O_RDWR) == O_RDWR)
-      pg_flags |= PAGING_FL_RW;
-
    while ((b = bintree_in_order_visit_next(&ctx))) {
 
-      if ((size_t)b->offset < off_begin)
+      const size_t b_begin = (size_t)b->offset;
+      const size_t b_end = b_begin + b->size;
+      const size_t end = MIN(b_end, off_end);
+
+      if (b_end <= off_begin)
          continue; /* skip this block */
 
-      if ((size_t)b->offset >= off_end)
+      if (b_begin >= off_end)
          break;
 
-      rc = map_page(pdir,
-                    (void *)vaddr,
-                    KERNEL_VA_TO_PA(b->vaddr),
-                    pg_flags);
+      pg_flags = PAGING_FL_US | PAGING_FL_SHARED;
 
-      if (rc) {
+      /* Shared blocks are mapped read-only: see ramfs_handle_fault_int() */
+      if ((um->prot & PROT_WRITE) && !b->sd)
+         pg_flags |= PAGING_FL_RW;
 
-         /* mmap failed, we have to unmap the pages already mapped */
-         vaddr -= PAGE_SIZE;
+      /*
+       * Map each page of the block in the range. Holes are skipped: they'll
+       * be handled by ramfs_handle_fault().
+       */
+      for (off = MAX(b_begin, off_begin); off < end; off += PAGE_SIZE) {
 
-         for (; vaddr >= um->vaddr; vaddr -= PAGE_SIZE) {
-            unmap_page_permissive(pdir, (void *)vaddr, false);
-         }
+         vaddr = um->vaddr + (off - off_begin);
 
-         return rc;
-      }
+         rc = map_page(pdir,
+                       (void *)vaddr,
+                       KERNEL_VA_TO_PA(b->vaddr + (off - b_begin)),
+                       pg_flags);
 
-      vaddr += PAGE_SIZE;
+         if (rc)
+            goto err_unmap;
+      }
    }
 
 register_mapping:
@@ -72,6 +79,14 @@ register_mapping:
    }
 
    return 0;
+
+err_unmap:
+
+   /* mmap failed, we have to unmap the pages already mapped */
+   for (vaddr = um->vaddr; vaddr < um->vaddr + um->len; vaddr += PAGE_SIZE)
+      unmap_page_permissive(pdir, (void *)vaddr, false);
+
+   return rc;
 }
 
 static bool
@@ -81,9 +96,12 @@ ramfs_handle_fault_int(struct process *pi,
                        bool p,
                        bool rw)
 {
-   ulong vaddr = (ulong) vaddrp;
-   ulong abs_off;
+   struct ramfs_inode *i = rh->inode;
+   const ulong vaddr = (ulong)vaddrp & PAGE_MASK;
+   ulong abs_off, pa;
    struct ramfs_block *block;
+   offt page;
+   u32 pg_flags;
    int rc;
    struct user_mapping *um = process_get_user_mapping(vaddrp);
 
@@ -91,37 +109,79 @@ ramfs_handle_fault_int(struct process *pi,
       return false; /* Weird, but it's OK */
 
    ASSERT(um->h == rh);
+   abs_off = um->off + (vaddr - um->vaddr);
+
+   if (abs_off >= (ulong)i->fsize)
+      return false; /* Read/write past EOF */
+
+   page = (offt)(abs_off & PAGE_MASK);
+   block = ramfs_find_block(i, page);
 
    if (p) {
 
       /*
-       * The page is present, just is read-only and the user code tried to
-       * write: there's nothing we can do.
+       * The page is present, but it's read-only and the user code tried to
+       * write. That's fine only when the mapping allows writing and the page
+       * is either the zero page, mapped on a previous read fault on a hole,
+       * or a page of a block, mapped read-only because it was shared.
        */
 
       ASSERT(rw);
-      ASSERT((um->prot & PROT_WRITE) == 0);
-      return false;
+
+      if (!(um->prot & PROT_WRITE))
+         return false;
+
+      if (get_mapping2(pi->pdir, (void *)vaddr, &pa) < 0)
+         return false;
+
+      if (pa != KERNEL_VA_TO_PA(&zero_page)) {
+
+         if (!block)
+            return false;
+
+         if (pa != KERNEL_VA_TO_PA(block->vaddr + (page - block->offset)))
+            return false;
+      }
+
+      unmap_page_permissive(pi->pdir, (void *)vaddr, false);
    }
 
-   /* The page is *not* present */
-   abs_off = um->off + (vaddr - um->vaddr);
+   if (!block && !rw) {
 
-   if (abs_off >= (ulong)rh->inode->fsize)
-      return false; /* Read/write past EOF */
+      /*
+       * Reading a hole: map the zero page, read-only. In case of a write,
+       * we'll get here again with p == true.
+       */
+      if (map_zero_page(pi->pdir, (void *)vaddr, PAGING_FL_US))
+         panic("Out-of-memory: unable to map the zero page. No OOM killer");
+
+      invalidate_page(vaddr);
+      return true;
+   }
+
+   if (!block) {
 
-   if (rw) {
       /* Create and map on-the-fly a struct ramfs_block */
-      if (!(block = ramfs_new_block((offt)(abs_off & PAGE_MASK))))
+      if (!(block = ramfs_alloc_block(i, page, PAGE_SIZE)))
          panic("Out-of-memory: unable to alloc a ramfs_block. No OOM killer");
+   }
+
+   if (rw && block->sd) {
 
-      ramfs_append_new_block(rh->inode, block);
+      /* Writing on a shared block: copy it first */
+      if (ramfs_block_prepare_write(i, block))
+         panic("Out-of-memory: unable to copy a ramfs_block. No OOM killer");
    }
 
+   pg_flags = PAGING_FL_US | PAGING_FL_SHARED;
+
+   if ((um->prot & PROT_WRITE) && !block->sd)
+      pg_flags |= PAGING_FL_RW;
+
    rc = map_page(pi->pdir,
-                 (void *)(vaddr & PAGE_MASK),
-                 KERNEL_VA_TO_PA(rw ? block->vaddr : &zero_page),
-                 PAGING_FL_US | PAGING_FL_RW | PAGING_FL_SHARED);
+                 (void *)vaddr,
+                 KERNEL_VA_TO_PA(block->vaddr + (page - block->offset)),
+                 pg_flags);
 
    if (rc)
       panic("Out-of-memory: unable to map a ramfs_block. No OOM killer");
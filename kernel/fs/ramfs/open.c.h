@@ -11,6 +11,8 @@ static const struct file_ops static_ops_ramfs =
    .mmap = ramfs_mmap,
    .munmap = ramfs_munmap,
    .handle_fault = ramfs_handle_fault,
+   .fallocate = ramfs_fallocate,
+   .copy_range = ramfs_copy_range,
 };
 
 static int
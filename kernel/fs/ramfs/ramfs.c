@@ -7,6 +7,7 @@
 
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/fs/flock.h>
+#include <tilck/kernel/fs/ramfs.h>
 
 #include <sys/mman.h>      // system header
 
@@ -17,8 +18,10 @@
 #include "inodes.c.h"
 #include "stat.c.h"
 #include "blocks.c.h"
+#include "falloc.c.h"
 #include "mmap.c.h"
 #include "rw_ops.c.h"
+#include "clone.c.h"
 #include "open.c.h"
 #include "mkdir.c.h"
 
@@ -365,3 +368,37 @@ struct fs *ramfs_create(void)
    return fs;
 }
 
+int ramfs_open_anon_file(struct fs *fs, mode_t mode, fs_handle *out)
+{
+   struct ramfs_data *d = fs->device_data;
+   struct ramfs_inode *i;
+   struct fs_handle_base *hb;
+   int rc;
+
+   ASSERT(!strcmp(fs->fs_type_name, "ramfs"));
+
+   vfs_fs_exlock(fs);
+   {
+      i = ramfs_create_inode_file(d, mode, d->root);
+   }
+   vfs_fs_exunlock(fs);
+
+   if (!i)
+      return -ENOSPC;
+
+   if ((rc = ramfs_open_int(fs, i, out, O_RDWR))) {
+      ramfs_destroy_inode(d, i);
+      return rc;
+   }
+
+   hb = *out;
+   hb->fl_flags = O_RDWR;
+
+   /*
+    * As in kfs_create_new_handle(), there's no vfs_open() call here that would
+    * retain the FS on our behalf: we have to do that here.
+    */
+   retain_obj(fs);
+   return 0;
+}
+
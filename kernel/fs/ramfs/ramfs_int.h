@@ -20,11 +20,32 @@
 
 struct ramfs_inode;
 
+/*
+ * Max size of a ramfs_block, in pages. Blocks are extents of physically
+ * contiguous pages, allocated with a single kmalloc() call, when possible.
+ */
+#define RAMFS_MAX_BLOCK_PAGES    16u
+
+/*
+ * Data shared by multiple blocks, possibly belonging to different inodes, after
+ * a clone operation (FICLONE, copy_file_range()). The pages in the range
+ * [vaddr, vaddr + size) are freed only when the last block referring to them
+ * is destroyed. Blocks having shared data are copied on the first write.
+ */
+struct ramfs_shared_data {
+
+   REF_COUNTED_OBJECT;           /* number of blocks referring to the data */
+   void *vaddr;
+   size_t size;
+};
+
 struct ramfs_block {
 
    struct bintree_node node;
    offt offset;                  /* MUST BE divisible by PAGE_SIZE */
+   size_t size;                  /* MUST BE divisible by PAGE_SIZE */
    void *vaddr;
+   struct ramfs_shared_data *sd; /* NULL if the data is owned by the block */
 };
 
 /*
@@ -66,7 +87,7 @@ struct ramfs_inode {
    struct rwlock_wp rwlock;
    nlink_t nlink;
    mode_t mode;
-   size_t blocks_count;                /* count of page-size blocks */
+   size_t blocks_count;                /* count of pages in all the blocks */
    struct ramfs_inode *parent_dir;
    struct list mappings_list;          /* see ramfs_unmap_past_eof_mappings() */
 
@@ -76,6 +97,7 @@ struct ramfs_inode {
       struct {
          offt fsize;
          struct ramfs_block *blocks_tree_root;
+         u32 blocks_gen;         /* incremented when blocks shrink or die */
       };
 
       /* valid when type == VFS_DIR */
@@ -106,10 +128,19 @@ struct ramfs_handle {
    /* ramfs-specific fields */
    struct ramfs_inode *inode;
 
-   /* valid only if inode->type == VFS_DIR */
-   struct {
-      struct list_node node;        /* node in inode->handles_list */
-      struct ramfs_entry *dpos;     /* current entry position */
+   union {
+
+      /* valid only if inode->type == VFS_DIR */
+      struct {
+         struct list_node node;     /* node in inode->handles_list */
+         struct ramfs_entry *dpos;  /* current entry position */
+      };
+
+      /* valid only if inode->type == VFS_FILE */
+      struct {
+         struct ramfs_block *cb;    /* cached block, see ramfs_get_block() */
+         u32 cb_gen;                /* value of inode->blocks_gen for `cb` */
+      };
    };
 };
 
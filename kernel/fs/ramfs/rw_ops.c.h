@@ -45,6 +45,22 @@ ramfs_seek_nolock(struct ramfs_handle *rh, offt off, int whence)
       return ramfs_dir_seek(rh, off);
    }
 
+   if (whence == SEEK_DATA || whence == SEEK_HOLE) {
+
+      if (off < 0 || off >= i->fsize)
+         return -ENXIO;
+
+      if (whence == SEEK_DATA)
+         off = ramfs_next_data(i, off);
+      else
+         off = ramfs_next_hole(i, off);
+
+      if (off >= 0)
+         rh->pos = off;
+
+      return off;
+   }
+
    switch (whence) {
 
       case SEEK_SET:
@@ -191,6 +207,18 @@ static int ramfs_inode_truncate(struct ramfs_inode *i, offt len)
     */
    ASSERT(i->type == VFS_FILE);
 
+   const offt rlen = (offt)pow2_round_up_at((ulong) len, PAGE_SIZE);
+   struct ramfs_block *b;
+
+   /*
+    * The part of the last page past the new EOF will be zeroed: in case its
+    * block is shared, we have to copy it before changing anything.
+    */
+   if (len < rlen && (b = ramfs_find_block(i, len))) {
+      if (ramfs_block_prepare_write(i, b))
+         return -ENOMEM;
+   }
+
    disable_preemption();
    {
       ramfs_unmap_past_eof_mappings(i, (size_t) len);
@@ -199,11 +227,19 @@ static int ramfs_inode_truncate(struct ramfs_inode *i, offt len)
 
    while (true) {
 
-      struct ramfs_block *b =
-         bintree_get_last_obj(i->blocks_tree_root, struct ramfs_block, node);
+      b = bintree_get_last_obj(i->blocks_tree_root, struct ramfs_block, node);
+
+      if (!b || b->offset + (offt)b->size <= rlen)
+         break;
+
+      if (b->offset < rlen) {
 
-      if (!b || b->offset < len)
+         /* The block is only partially past the new EOF: shrink it */
+         const size_t new_size = (size_t)(rlen - b->offset);
+         i->blocks_count -= (b->size - new_size) >> PAGE_SHIFT;
+         ramfs_shrink_block(b, new_size);
          break;
+      }
 
       /* Remove the block object from the tree */
       bintree_remove_ptr(&i->blocks_tree_root,
@@ -212,11 +248,19 @@ static int ramfs_inode_truncate(struct ramfs_inode *i, offt len)
                          node,
                          offset);
 
+      i->blocks_count -= b->size >> PAGE_SHIFT;
       ramfs_destroy_block(b);
    }
 
+   /*
+    * Zero the part of the last page past the new EOF, otherwise its old
+    * content would re-appear after extending again the file.
+    */
+   if (len < rlen && (b = ramfs_find_block(i, len)))
+      bzero(b->vaddr + (len - b->offset), (size_t)(rlen - len));
+
+   i->blocks_gen++;
    i->fsize = len;
-   i->blocks_count = pow2_round_up_at((ulong) len, PAGE_SIZE);
    return 0;
 }
 
@@ -262,34 +306,31 @@ ramfs_read_nolock(struct ramfs_handle *rh, char *buf, size_t len)
    while (buf_rem > 0) {
 
       struct ramfs_block *block;
-      const offt page     = rh->pos & (offt)PAGE_MASK;
       const offt page_off = rh->pos & (offt)OFFSET_IN_PAGE_MASK;
-      const offt page_rem = (offt)PAGE_SIZE - page_off;
       const offt file_rem = inode->fsize - rh->pos;
-      const offt to_read  = MIN3(page_rem, buf_rem, file_rem);
+      offt to_read;
 
       if (rh->pos >= inode->fsize)
          break;
 
-      ASSERT(to_read >= 0);
+      if ((block = ramfs_get_block(rh, rh->pos))) {
 
-      if (!to_read)
-         break;
+         /* reading a regular block: read as much as possible from it */
+         const offt blk_off = rh->pos - block->offset;
+         const offt blk_rem = (offt)block->size - blk_off;
 
-      block = bintree_find_ptr(inode->blocks_tree_root,
-                               page,
-                               struct ramfs_block,
-                               node,
-                               offset);
+         to_read = MIN3(blk_rem, buf_rem, file_rem);
+         memcpy(buf + tot_read, block->vaddr + blk_off, (size_t)to_read);
 
-      if (block) {
-         /* reading a regular block */
-         memcpy(buf + tot_read, block->vaddr + page_off, (size_t)to_read);
       } else {
+
          /* reading a hole */
+         to_read = MIN3((offt)PAGE_SIZE - page_off, buf_rem, file_rem);
          memset(buf + tot_read, 0, (size_t)to_read);
       }
 
+      ASSERT(to_read > 0);
+
       tot_read += to_read;
       rh->pos  += to_read;
       buf_rem  -= to_read;
@@ -329,29 +370,28 @@ ramfs_write_nolock(struct ramfs_handle *rh, char *buf, size_t len)
       struct ramfs_block *block;
       const offt page     = rh->pos & (offt)PAGE_MASK;
       const offt page_off = rh->pos & (offt)OFFSET_IN_PAGE_MASK;
-      const offt page_rem = (offt)PAGE_SIZE - page_off;
-      const offt to_write = MIN(page_rem, buf_rem);
-
-      ASSERT(to_write > 0);
-
-      block = bintree_find_ptr(inode->blocks_tree_root,
-                               page,
-                               struct ramfs_block,
-                               node,
-                               offset);
-
-      /* Assert that if page_off > 0, the block is present */
-      ASSERT(!page_off || block);
-
-      if (!block) {
-
-         if (!(block = ramfs_new_block(page)))
+      offt blk_off, to_write;
+
+      /*
+       * NOTE: the block might be missing even if page_off > 0, in case we're
+       * writing in a hole (e.g. after ftruncate() extended the file).
+       */
+      if (!(block = ramfs_get_block(rh, rh->pos))) {
+         if (!(block = ramfs_alloc_block(inode, page, page_off + buf_rem)))
             break;
 
-         ramfs_append_new_block(inode, block);
+         rh->cb = block;
+         rh->cb_gen = inode->blocks_gen;
       }
 
-      memcpy(block->vaddr + page_off, buf + tot_written, (size_t)to_write);
+      if (block->sd && ramfs_block_prepare_write(inode, block))
+         break;
+
+      blk_off = rh->pos - block->offset;
+      to_write = MIN((offt)block->size - blk_off, buf_rem);
+      ASSERT(to_write > 0);
+
+      memcpy(block->vaddr + blk_off, buf + tot_written, (size_t)to_write);
       tot_written += to_write;
       buf_rem     -= to_write;
       rh->pos     += to_write;
@@ -144,8 +144,8 @@ offt vfs_seek(fs_handle h, s64 off, int whence)
    NO_TEST_ASSERT(is_preemption_enabled());
    ASSERT(h != NULL);
 
-   if (whence != SEEK_SET && whence != SEEK_CUR && whence != SEEK_END)
-      return -EINVAL; /* Tilck does NOT support SEEK_DATA and SEEK_HOLE */
+   if (whence < SEEK_SET || whence > SEEK_HOLE)
+      return -EINVAL; /* NOTE: SEEK_DATA and SEEK_HOLE are up to the FS */
 
    struct fs_handle_base *hb = (struct fs_handle_base *) h;
 
@@ -228,6 +228,109 @@ int vfs_fdatasync(fs_handle h)
    return rc;
 }
 
+int vfs_fallocate(fs_handle h, int mode, offt offset, offt len)
+{
+   struct fs_handle_base *hb = h;
+   const int supported = FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE;
+   NO_TEST_ASSERT(is_preemption_enabled());
+
+   if (!(hb->fl_flags & (O_WRONLY | O_RDWR)))
+      return -EBADF; /* file not opened for writing */
+
+   if (offset < 0 || len <= 0)
+      return -EINVAL;
+
+   if (offset + len < 0)
+      return -EFBIG; /* overflow: NOTE the kernel is compiled with -fwrapv */
+
+   if (mode & ~supported)
+      return -EOPNOTSUPP;
+
+   /* Like on Linux, punching a hole requires to keep the size unchanged */
+   if ((mode & FALLOC_FL_PUNCH_HOLE) && !(mode & FALLOC_FL_KEEP_SIZE))
+      return -EOPNOTSUPP;
+
+   if (~hb->fs->flags & VFS_FS_RW)
+      return -EROFS;
+
+   if (!hb->fops->fallocate)
+      return -EOPNOTSUPP;
+
+   return hb->fops->fallocate(h, mode, offset, len);
+}
+
+static offt
+vfs_copy_range_int(fs_handle in, offt off_in,
+                   fs_handle out, offt off_out, offt len, int flags)
+{
+   struct fs_handle_base *hb_in = in;
+   struct fs_handle_base *hb_out = out;
+   NO_TEST_ASSERT(is_preemption_enabled());
+
+   if (hb_in->fl_flags & O_WRONLY)
+      return -EBADF; /* input file not opened for reading */
+
+   if (!(hb_out->fl_flags & (O_WRONLY | O_RDWR)))
+      return -EBADF; /* output file not opened for writing */
+
+   if (hb_out->fl_flags & O_APPEND)
+      return -EBADF;
+
+   if (off_in < 0 || off_out < 0 || len < 0)
+      return -EINVAL;
+
+   if (off_in + len < 0 || off_out + len < 0)
+      return -EFBIG; /* overflow: NOTE the kernel is compiled with -fwrapv */
+
+   if (~hb_out->fs->flags & VFS_FS_RW)
+      return -EROFS;
+
+   /*
+    * Copying (or cloning) data is supported only between files of the same
+    * type of file system, which has to implement it.
+    */
+   if (!hb_in->fops->copy_range || hb_in->fops != hb_out->fops)
+      return -EXDEV;
+
+   if (!len)
+      return 0;
+
+   return hb_in->fops->copy_range(in, off_in, out, off_out, len, flags);
+}
+
+offt vfs_copy_file_range(fs_handle in, offt off_in,
+                         fs_handle out, offt off_out, offt len)
+{
+   return vfs_copy_range_int(in, off_in, out, off_out, len, 0);
+}
+
+int vfs_clone_range(fs_handle in, offt off_in,
+                    fs_handle out, offt off_out, offt len)
+{
+   struct fs_handle_base *hb_in = in;
+   struct fs_handle_base *hb_out = out;
+   struct stat64 st;
+   offt rc;
+
+   if (hb_in->fs != hb_out->fs)
+      return -EXDEV;
+
+   if (!len) {
+
+      /* Like on Linux, len == 0 means "clone up to the EOF" */
+      if ((rc = vfs_fstat64(in, &st)))
+         return (int)rc;
+
+      if (off_in >= st.st_size)
+         return 0;
+
+      len = (offt)st.st_size - off_in;
+   }
+
+   rc = vfs_copy_range_int(in, off_in, out, off_out, len, VFS_CR_CLONE);
+   return rc < 0 ? (int)rc : 0;
+}
+
 /* ----------- path-based functions -------------- */
 
 typedef int (*vfs_func_impl)(struct fs*, struct vfs_path*, ulong, ulong, ulong);
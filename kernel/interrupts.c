@@ -37,6 +37,15 @@ static ALWAYS_INLINE void dec_irq_count(void)
    ASSERT(oldval > 0);
 }
 
+/* The registers of the context interrupted by the innermost IRQ */
+static regs_t *irq_regs;
+
+regs_t *get_irq_regs(void)
+{
+   ASSERT(in_irq());
+   return irq_regs;
+}
+
 #if KRN_TRACK_NESTED_INTERR
 
 static int nested_interrupts_count;
@@ -202,6 +211,7 @@ static void irq_resched(regs_t *r)
 
 void irq_entry(regs_t *r)
 {
+   regs_t *prev_irq_regs;
    ASSERT(get_curr_task() != NULL);
    DEBUG_check_not_same_interrupt_nested(regs_intnum(r));
 
@@ -214,9 +224,15 @@ void irq_entry(regs_t *r)
    /* Increase the always-enabled in_irq_count counter */
    inc_irq_count();
 
+   /* Save the regs for get_irq_regs(), supporting nested IRQs */
+   prev_irq_regs = irq_regs;
+   irq_regs = r;
+
    /* Call the arch-dependent IRQ handling logic */
    arch_irq_handling(r);
 
+   irq_regs = prev_irq_regs;
+
    /* Decrease the always-enabled in_irq_count counter */
    dec_irq_count();
 
@@ -4,11 +4,31 @@
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/interrupts.h>
+#include <tilck/kernel/lock_stats.h>
+
+#if KRN_LOCK_STATS
+
+static void
+kcond_stats_waited(struct kcond *c, u64 wait_cycles)
+{
+   /* Statically initialized kcond: its class is keyed by its address */
+   if (UNLIKELY(!c->stats))
+      c->stats = lock_stats_get_class(c, LOCK_CL_KCOND);
+
+   lock_stats_account_acquire(c->stats, true, wait_cycles);
+}
+
+#endif
 
 void kcond_init(struct kcond *c)
 {
    DEBUG_ONLY(check_not_in_irq_handler());
    list_init(&c->wait_list);
+
+   LOCK_STATS_ONLY(
+      c->stats = lock_stats_get_class(__builtin_return_address(0),
+                                      LOCK_CL_KCOND)
+   );
 }
 
 bool kcond_is_anyone_waiting(struct kcond *c)
@@ -28,6 +48,7 @@ bool kcond_wait(struct kcond *c, struct kmutex *m, u32 timeout_ticks)
    ASSERT(!m || kmutex_is_curr_task_holding_lock(m));
    struct task *curr = get_curr_task();
    bool ret;
+   LOCK_STATS_ONLY(const u64 start = RDTSC());
 
    disable_preemption();
 
@@ -55,6 +76,7 @@ bool kcond_wait(struct kcond *c, struct kmutex *m, u32 timeout_ticks)
     */
 
    ret = !wait_obj_reset(&curr->wobj);
+   LOCK_STATS_ONLY(kcond_stats_waited(c, RDTSC() - start));
 
    if (m) {
       kmutex_lock(m); // Re-acquire the lock [if any]
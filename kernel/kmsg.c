@@ -0,0 +1,237 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/kmsg.h>
+
+#include <linux/major.h> // system header
+
+/*
+ * /dev/kmsg, like on Linux: every read() returns exactly one record of
+ * printk's log, formatted as:
+ *
+ *    <level>,<seq>,<timestamp in usec>,<flags>;<text>\n
+ *
+ * where <flags> is 'c' for records continuing the previous line (NO_PREFIX)
+ * and '-' for all the others. Non-printable chars in <text> are escaped as
+ * \xNN. A read() blocks until a new record is logged, unless O_NONBLOCK is
+ * set. When the next record has been overwritten in the meanwhile, read()
+ * fails with EPIPE and the following one returns the oldest record in the log.
+ *
+ * Writing to /dev/kmsg logs the data with printk(). An optional "<N>" prefix
+ * sets the log level of the message.
+ */
+
+#define KMSG_MINOR                                 11
+
+STATIC_ASSERT(sizeof(struct kmsg_iter) <= DEVFS_EXTRA_SIZE);
+
+static ALWAYS_INLINE struct kmsg_iter *
+kmsg_get_iter(fs_handle h)
+{
+   return (void *)((struct devfs_handle *)h)->extra;
+}
+
+static ssize_t
+kmsg_format_rec(char *buf,
+                size_t size,
+                struct kmsg_rec_info *info,
+                const char *text)
+{
+   static const char hex_digits[] = "0123456789abcdef";
+   u32 len = MIN((u32)info->len, (u32)KMSG_REC_MAX_LEN);
+   size_t n;
+   int rc;
+
+   /* Every record is a line on its own */
+   if (len > 0 && text[len - 1] == '\n')
+      len--;
+
+   rc = snprintk(buf, size, "%u,%u,%llu,%c;",
+                 info->level,
+                 info->seq,
+                 (unsigned long long)(info->ts / 1000),
+                 (info->flags & KMSG_FL_PREFIX) ? '-' : 'c');
+
+   if (rc < 0 || (size_t)rc >= size)
+      return -EINVAL;
+
+   n = (size_t)rc;
+
+   for (u32 i = 0; i < len; i++) {
+
+      const u8 c = (u8)text[i];
+
+      if (c >= ' ' && c < 0x7f && c != '\\') {
+
+         if (n + 1 >= size)
+            return -EINVAL;
+
+         buf[n++] = (char)c;
+         continue;
+      }
+
+      if (n + 4 >= size)
+         return -EINVAL;
+
+      buf[n++] = '\\';
+      buf[n++] = 'x';
+      buf[n++] = hex_digits[c >> 4];
+      buf[n++] = hex_digits[c & 0xf];
+   }
+
+   buf[n++] = '\n';
+   return (ssize_t)n;
+}
+
+static ssize_t
+kmsg_read(fs_handle h, char *buf, size_t size)
+{
+   struct devfs_handle *dh = h;
+   struct kmsg_iter *it = kmsg_get_iter(h);
+   struct kmsg_rec_info info;
+   char text[KMSG_REC_MAX_LEN];
+   struct kmsg_iter saved;
+   ssize_t rc = 0;
+
+   kmutex_lock(&kmsg_mutex);
+   {
+      while (true) {
+
+         saved = *it;
+         rc = kmsg_read_rec(it, &info, text, sizeof(text));
+
+         if (rc > 0)
+            break;
+
+         if (rc < 0) {
+            rc = -EPIPE;
+            goto end;
+         }
+
+         if (dh->fl_flags & O_NONBLOCK) {
+            rc = -EAGAIN;
+            goto end;
+         }
+
+         kcond_wait(&kmsg_cond, &kmsg_mutex, KCOND_WAIT_FOREVER);
+
+         if (pending_signals()) {
+            rc = -EINTR;
+            goto end;
+         }
+      }
+
+      /* In case the buffer is too small, the record is NOT consumed */
+      if ((rc = kmsg_format_rec(buf, size, &info, text)) < 0)
+         *it = saved;
+
+   end:;
+   }
+   kmutex_unlock(&kmsg_mutex);
+   return rc;
+}
+
+static ssize_t
+kmsg_write(fs_handle h, char *buf, size_t size)
+{
+   char fmt[] = { PRINTK_CTRL_CHAR, PRINTK_CTRL_LEVEL, '6', ' ', '%', 's', 0 };
+   char text[KMSG_REC_MAX_LEN + 1];
+   size_t off = 0, len;
+
+   if (size >= 3 && buf[0] == '<' && isdigit(buf[1]) && buf[2] == '>') {
+      fmt[2] = (char)('0' + ((buf[1] - '0') & 7));
+      off = 3;
+   }
+
+   len = MIN(size - off, (size_t)KMSG_REC_MAX_LEN);
+   memcpy(text, buf + off, len);
+   text[len] = 0;
+
+   printk(fmt, text);
+   return (ssize_t)size;
+}
+
+static offt
+kmsg_seek(fs_handle h, offt off, int whence)
+{
+   struct kmsg_iter *it = kmsg_get_iter(h);
+
+   if (off != 0)
+      return -EINVAL;
+
+   kmutex_lock(&kmsg_mutex);
+   {
+      if (whence == SEEK_SET)
+         kmsg_iter_first(it);
+      else if (whence == SEEK_END)
+         kmsg_iter_last(it);
+      else
+         off = -EINVAL;
+   }
+   kmutex_unlock(&kmsg_mutex);
+   return off;
+}
+
+static int
+kmsg_read_ready(fs_handle h)
+{
+   return kmsg_iter_has_data(kmsg_get_iter(h));
+}
+
+static struct kcond *
+kmsg_get_rready_cond(fs_handle h)
+{
+   return &kmsg_cond;
+}
+
+static int
+kmsg_create_extra(int minor, void *extra)
+{
+   /* New readers start from the oldest record in the log */
+   kmsg_iter_first(extra);
+   return 0;
+}
+
+static int
+kmsg_create_device_file(int minor,
+                        enum vfs_entry_type *type,
+                        struct devfs_file_info *nfo)
+{
+   static const struct file_ops static_ops_kmsg = {
+
+      .read = kmsg_read,
+      .write = kmsg_write,
+      .seek = kmsg_seek,
+      .read_ready = kmsg_read_ready,
+      .get_rready_cond = kmsg_get_rready_cond,
+   };
+
+   *type = VFS_CHAR_DEV;
+   nfo->fops = &static_ops_kmsg;
+   nfo->create_extra = &kmsg_create_extra;
+   return 0;
+}
+
+void init_kmsg(void)
+{
+   struct driver_info *di = kzalloc_obj(struct driver_info);
+
+   if (!di)
+      panic("kmsg: no enough memory for struct driver_info");
+
+   di->name = "kmsg";
+   di->create_dev_file = kmsg_create_device_file;
+   register_driver(di, MEM_MAJOR);
+
+   if (create_dev_file("kmsg", MEM_MAJOR, KMSG_MINOR, NULL) < 0)
+      panic("kmsg: unable to create /dev/kmsg");
+}
@@ -6,6 +6,35 @@
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/irq.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/lock_stats.h>
+
+#if KRN_LOCK_STATS
+
+static void
+kmutex_stats_acquired(struct kmutex *m, bool contended, u64 wait_cycles)
+{
+   /* Skip the recursive locks: they're not real acquisitions */
+   if ((m->flags & KMUTEX_FL_RECURSIVE) && m->lock_count != 1)
+      return;
+
+   /* Statically initialized mutex: its class is keyed by its address */
+   if (UNLIKELY(!m->stats))
+      m->stats = lock_stats_get_class(m, LOCK_CL_KMUTEX);
+
+   m->lock_ts = RDTSC();
+   lock_stats_account_acquire(m->stats, contended, wait_cycles);
+}
+
+static void
+kmutex_stats_released(struct kmutex *m)
+{
+   /* Called only when the last recursive lock is released */
+   ASSERT(m->lock_count == 0);
+   lock_stats_account_release(m->stats, RDTSC() - m->lock_ts);
+}
+
+#endif
 
 bool kmutex_is_curr_task_holding_lock(struct kmutex *m)
 {
@@ -18,6 +47,11 @@ void kmutex_init(struct kmutex *m, u32 flags)
    bzero(m, sizeof(struct kmutex));
    m->flags = flags;
    list_init(&m->wait_list);
+
+   LOCK_STATS_ONLY(
+      m->stats = lock_stats_get_class(__builtin_return_address(0),
+                                      LOCK_CL_KMUTEX)
+   );
 }
 
 void kmutex_destroy(struct kmutex *m)
@@ -38,6 +72,8 @@ kmutex_lock_enable_preemption_wrapper(struct kmutex *m)
 
 void kmutex_lock(struct kmutex *m)
 {
+   LOCK_STATS_ONLY(const u64 start = RDTSC());
+
    disable_preemption();
    DEBUG_ONLY(check_not_in_irq_handler());
 
@@ -51,6 +87,7 @@ void kmutex_lock(struct kmutex *m)
          m->lock_count++;
       }
 
+      LOCK_STATS_ONLY(kmutex_stats_acquired(m, false, 0));
       kmutex_lock_enable_preemption_wrapper(m);
       enable_preemption();
       return;
@@ -100,6 +137,8 @@ void kmutex_lock(struct kmutex *m)
    if (m->flags & KMUTEX_FL_RECURSIVE) {
       ASSERT(m->lock_count == 1);
    }
+
+   LOCK_STATS_ONLY(kmutex_stats_acquired(m, true, RDTSC() - start));
 }
 
 bool kmutex_trylock(struct kmutex *m)
@@ -118,6 +157,8 @@ bool kmutex_trylock(struct kmutex *m)
       if (m->flags & KMUTEX_FL_RECURSIVE)
          m->lock_count++;
 
+      LOCK_STATS_ONLY(kmutex_stats_acquired(m, false, 0));
+
    } else {
 
       /*
@@ -157,6 +198,7 @@ void kmutex_unlock(struct kmutex *m)
       // m->lock_count == 0: we have to really unlock the mutex
    }
 
+   LOCK_STATS_ONLY(kmutex_stats_released(m));
    m->owner_task = NULL;
 
    /* Unlock one task waiting to acquire the mutex 'm' (if any) */
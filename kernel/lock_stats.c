@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/lock_stats.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/elf_utils.h>
+
+static const char *lock_class_type_str[] =
+{
+   [LOCK_CL_KMUTEX]     = "kmutex",
+   [LOCK_CL_RWLOCK_RP]  = "rwlock_rp",
+   [LOCK_CL_RWLOCK_WP]  = "rwlock_wp",
+   [LOCK_CL_KCOND]      = "kcond",
+};
+
+const char *lock_stats_get_type_str(struct lock_class_stats *cl)
+{
+   return cl->key ? lock_class_type_str[cl->type] : "-";
+}
+
+void
+lock_stats_get_class_name(struct lock_class_stats *cl, char *buf, size_t sz)
+{
+   const char *sym;
+   long off;
+
+   if (!cl->key) {
+      snprintk(buf, sz, "<other>");
+      return;
+   }
+
+   if (!(sym = find_sym_at_addr((ulong)cl->key, &off, NULL))) {
+      snprintk(buf, sz, "%p", cl->key);
+      return;
+   }
+
+   if (off)
+      snprintk(buf, sz, "%s+0x%lx", sym, off);
+   else
+      snprintk(buf, sz, "%s", sym);
+}
+
+#if KRN_LOCK_STATS
+
+static struct lock_class_stats lock_classes[LOCK_STATS_MAX_CLASSES];
+static u32 lock_classes_count;
+
+/* Class with key = NULL, used when `lock_classes` is full */
+static struct lock_class_stats lock_class_other;
+
+struct lock_class_stats *
+lock_stats_get_class(const void *key, enum lock_class_type type)
+{
+   struct lock_class_stats *cl = &lock_class_other;
+
+   disable_preemption();
+   {
+      for (u32 i = 0; i < lock_classes_count; i++) {
+         if (lock_classes[i].key == key && lock_classes[i].type == type) {
+            cl = &lock_classes[i];
+            goto out;
+         }
+      }
+
+      if (lock_classes_count < ARRAY_SIZE(lock_classes)) {
+         cl = &lock_classes[lock_classes_count++];
+         cl->key = key;
+         cl->type = type;
+      }
+   }
+out:
+   enable_preemption();
+   return cl;
+}
+
+void
+lock_stats_account_acquire(struct lock_class_stats *cl,
+                           bool contended,
+                           u64 wait_cycles)
+{
+   disable_preemption();
+   {
+      cl->acquisitions++;
+
+      if (contended) {
+         cl->contended++;
+         cl->tot_wait += wait_cycles;
+         cl->max_wait = MAX(cl->max_wait, wait_cycles);
+      }
+   }
+   enable_preemption();
+}
+
+void
+lock_stats_account_release(struct lock_class_stats *cl, u64 hold_cycles)
+{
+   disable_preemption();
+   {
+      cl->max_hold = MAX(cl->max_hold, hold_cycles);
+   }
+   enable_preemption();
+}
+
+u32 lock_stats_get_all(struct lock_class_stats *buf, u32 max)
+{
+   u32 n = 0;
+
+   disable_preemption();
+   {
+      for (u32 i = 0; i < lock_classes_count && n < max; i++)
+         if (lock_classes[i].acquisitions)
+            buf[n++] = lock_classes[i];
+
+      if (lock_class_other.acquisitions && n < max)
+         buf[n++] = lock_class_other;
+   }
+   enable_preemption();
+   return n;
+}
+
+void lock_stats_reset(void)
+{
+   disable_preemption();
+   {
+      for (u32 i = 0; i < lock_classes_count; i++) {
+         struct lock_class_stats *cl = &lock_classes[i];
+         *cl = (struct lock_class_stats) { .key = cl->key, .type = cl->type };
+      }
+
+      lock_class_other = (struct lock_class_stats) { .key = NULL };
+   }
+   enable_preemption();
+}
+
+#endif // #if KRN_LOCK_STATS
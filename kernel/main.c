@@ -32,6 +32,11 @@
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/fs/kernelfs.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/ramfs.h>
+#include <tilck/kernel/fs/memfd.h>
+#include <tilck/kernel/aio.h>
+#include <tilck/kernel/kmsg.h>
+#include <tilck/kernel/boot_trace.h>
 
 #include <tilck/mods/console.h>
 #include <tilck/mods/fb_console.h>
@@ -246,9 +251,6 @@ out:
 static void
 mount_initrd(void)
 {
-   /* declare the ramfs_create() function */
-   struct fs *ramfs_create(void);
-
    struct fs *initrd, *ramfs;
    void *ramdisk;
    size_t ramdisk_size;
@@ -324,12 +326,14 @@ static void do_async_init()
    /* declare the show_hello_message() function */
    void show_hello_message(void);
 
-   mount_initrd();
-   init_devfs();
-   init_modules();
-   init_extra_debug_features();
+   BOOT_TRACE(mount_initrd);
+   BOOT_TRACE(init_devfs);
+   BOOT_TRACE(init_kmsg);
+   BOOT_TRACE(init_modules);
+   BOOT_TRACE(init_extra_debug_features);
 
    show_hello_message();
+   boot_trace_finish();
    run_init_or_selftest();
 }
 
@@ -343,33 +347,37 @@ async_init(void)
 void
 kmain(u32 multiboot_magic, u32 mbi_addr)
 {
+   boot_trace_start();
    call_kernel_global_ctors();
    save_multiboot_info(multiboot_magic, mbi_addr);
 
-   early_init_serial_ports();
-   init_cpu_exception_handling();
-   early_init_paging();
-   early_init_kmalloc();
-
-   read_multiboot_info();
-   enable_cpu_features();
-   kmain_early_checks();
-   init_segmentation();
-   init_fpu_memcpy();
-   init_kmalloc();
-   init_paging();
-
-   acpi_mod_init_tables();
-
-   init_console();
-   init_self_tests();
-   init_irq_handling();
-   init_sched();
-   init_syscall_interfaces();
-   init_worker_threads();
-   init_timer();
-   init_system_time();
-   init_kernelfs();
+   BOOT_TRACE(early_init_serial_ports);
+   BOOT_TRACE(init_cpu_exception_handling);
+   BOOT_TRACE(early_init_paging);
+   BOOT_TRACE(early_init_kmalloc);
+
+   BOOT_TRACE(read_multiboot_info);
+   BOOT_TRACE(enable_cpu_features);
+   BOOT_TRACE(kmain_early_checks);
+   BOOT_TRACE(init_segmentation);
+   BOOT_TRACE(init_fpu_memcpy);
+   BOOT_TRACE(init_kmalloc);
+   BOOT_TRACE(init_paging);
+
+   BOOT_TRACE(acpi_mod_init_tables);
+
+   BOOT_TRACE(init_console);
+   BOOT_TRACE(init_self_tests);
+   BOOT_TRACE(init_irq_handling);
+   BOOT_TRACE(init_sched);
+   BOOT_TRACE(init_syscall_interfaces);
+   BOOT_TRACE(init_worker_threads);
+   BOOT_TRACE(init_timer);
+   BOOT_TRACE(init_system_time);
+   BOOT_TRACE(init_kernelfs);
+   BOOT_TRACE(init_memfd);
+   BOOT_TRACE(init_aio);
+   BOOT_TRACE(init_printk_worker);
 
    async_init();
    schedule();
@@ -10,7 +10,9 @@
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/errno.h>
+#include <tilck/kernel/fs/vfs.h>
 #include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/fs/memfd.h>
 #include <tilck/kernel/syscalls.h>
 
 #include <sys/mman.h>      // system header
@@ -24,6 +26,7 @@ static inline void sys_brk_internal(struct process *pi, void *new_brk)
    if (new_brk < pi->brk) {
 
       /* we have to free pages */
+      process_update_maxrss(pi);
 
       for (void *vaddr = new_brk; vaddr < pi->brk; vaddr += PAGE_SIZE) {
          unmap_page(pi->pdir, vaddr, true);
@@ -142,6 +145,32 @@ static int create_process_mmap_heap(struct process *pi)
    return 0;
 }
 
+static int
+create_anon_shared_mapping_handle(struct fs_handle_base **out, size_t len)
+{
+   fs_handle h;
+   int rc;
+
+   if ((rc = memfd_create_handle(&h)))
+      return rc;
+
+   if ((rc = vfs_ftruncate(h, (offt)len))) {
+      vfs_close(h);
+      return rc;
+   }
+
+   *out = h;
+   (*out)->spec_flags |= VFS_SPFL_ANON_MAPPING;
+   return 0;
+}
+
+static void
+close_anon_shared_mapping_handle(struct fs_handle_base *h)
+{
+   if (h && is_anon_mapping_handle(h))
+      vfs_close(h);
+}
+
 static inline void
 mmap_err_case_free(struct process *pi, void *ptr, size_t actual_len)
 {
@@ -201,6 +230,77 @@ mmap_on_user_heap(struct process *pi,
    return um;
 }
 
+/*
+ * Maps `handle` (or anonymous memory, if it's NULL) in the process' mmap heap.
+ * In case of failure, handles flagged with VFS_SPFL_ANON_MAPPING are closed.
+ */
+static long
+mmap_int(struct process *pi,
+         struct fs_handle_base *handle,
+         size_t actual_len,
+         u32 per_heap_kmalloc_flags,
+         size_t off,
+         int prot)
+{
+   const size_t req_len = actual_len;
+   struct user_mapping *um = NULL;
+   int rc;
+
+   if (!pi->mi) {
+      if ((rc = create_process_mmap_heap(pi))) {
+         close_anon_shared_mapping_handle(handle);
+         return rc;
+      }
+   }
+
+   disable_preemption();
+   {
+      um = mmap_on_user_heap(pi,
+                             &actual_len,
+                             handle,
+                             per_heap_kmalloc_flags,
+                             off,
+                             prot);
+   }
+   enable_preemption();
+
+   if (!um) {
+      close_anon_shared_mapping_handle(handle);
+      return -ENOMEM;
+   }
+
+   ASSERT(actual_len == req_len);
+
+   if (handle) {
+
+      if ((rc = vfs_mmap(um, pi->pdir, 0))) {
+
+         /*
+          * Everything was apparently OK and the allocation in the user virtual
+          * address space succeeded, but for some reason the actual mapping of
+          * the device to the user vaddr failed.
+          */
+
+         disable_preemption();
+         {
+            mmap_err_case_free(pi, um->vaddrp, actual_len);
+            process_remove_user_mapping(um);
+         }
+         enable_preemption();
+         close_anon_shared_mapping_handle(handle);
+         return rc;
+      }
+
+
+   } else {
+
+      if (MMAP_NO_COW)
+         bzero(um->vaddrp, actual_len);
+   }
+
+   return (long)um->vaddr;
+}
+
 long
 sys_mmap_pgoff(void *addr, size_t len, int prot,
                int flags, int fd, size_t pgoffset)
@@ -209,7 +309,6 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
    struct task *curr = get_curr_task();
    struct process *pi = curr->pi;
    struct fs_handle_base *handle = NULL;
-   struct user_mapping *um = NULL;
    size_t actual_len;
    int rc, fl;
 
@@ -232,17 +331,31 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
       if (!(flags & MAP_ANONYMOUS))
          return -EINVAL;
 
-      if (flags & MAP_SHARED)
-         return -EINVAL; /* MAP_SHARED not supported for anonymous mappings */
+      if (pgoffset != 0)
+         return -EINVAL; /* pgoffset != 0 does not make sense here */
 
-      if (!(flags & MAP_PRIVATE))
-         return -EINVAL;
+      if (flags & MAP_SHARED) {
 
-      if ((prot & (PROT_READ | PROT_WRITE)) != (PROT_READ | PROT_WRITE))
-         return -EINVAL;
+         /*
+          * Shared anonymous mappings are backed by an unnamed memfd file,
+          * exactly like it happens on Linux with shmem. The handle is owned
+          * by the mapping(s) and it's not installed in the fd table: it will
+          * be closed when the last mapping referring to it is removed.
+          */
 
-      if (pgoffset != 0)
-         return -EINVAL; /* pgoffset != 0 does not make sense here */
+         if ((rc = create_anon_shared_mapping_handle(&handle, actual_len)))
+            return rc;
+
+         per_heap_kmalloc_flags |= KMALLOC_FL_NO_ACTUAL_ALLOC;
+
+      } else {
+
+         if (!(flags & MAP_PRIVATE))
+            return -EINVAL;
+
+         if ((prot & (PROT_READ | PROT_WRITE)) != (PROT_READ | PROT_WRITE))
+            return -EINVAL;
+      }
 
    } else {
 
@@ -270,53 +383,25 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
       per_heap_kmalloc_flags |= KMALLOC_FL_NO_ACTUAL_ALLOC;
    }
 
-   if (!pi->mi)
-      if ((rc = create_process_mmap_heap(pi)))
-         return rc;
-
-   disable_preemption();
-   {
-      um = mmap_on_user_heap(pi,
-                             &actual_len,
-                             handle,
-                             per_heap_kmalloc_flags,
-                             pgoffset << PAGE_SHIFT,
-                             prot);
-   }
-   enable_preemption();
-
-   if (!um)
-      return -ENOMEM;
-
-   ASSERT(actual_len == pow2_round_up_at(len, PAGE_SIZE));
-
-   if (handle) {
-
-      if ((rc = vfs_mmap(um, pi->pdir, 0))) {
-
-         /*
-          * Everything was apparently OK and the allocation in the user virtual
-          * address space succeeded, but for some reason the actual mapping of
-          * the device to the user vaddr failed.
-          */
-
-         disable_preemption();
-         {
-            mmap_err_case_free(pi, um->vaddrp, actual_len);
-            process_remove_user_mapping(um);
-         }
-         enable_preemption();
-         return rc;
-      }
-
-
-   } else {
-
-      if (MMAP_NO_COW)
-         bzero(um->vaddrp, actual_len);
-   }
+   return mmap_int(pi,
+                   handle,
+                   actual_len,
+                   per_heap_kmalloc_flags,
+                   pgoffset << PAGE_SHIFT,
+                   prot);
+}
 
-   return (long)um->vaddr;
+long mmap_anon_handle(fs_handle h, size_t len, int prot)
+{
+   ASSERT(is_anon_mapping_handle(h));
+
+   return mmap_int(get_curr_proc(),
+                   h,
+                   pow2_round_up_at(len, PAGE_SIZE),
+                   KMALLOC_FL_MULTI_STEP | PAGE_SIZE |
+                   KMALLOC_FL_NO_ACTUAL_ALLOC,
+                   0,
+                   prot);
 }
 
 static int munmap_int(struct process *pi, void *vaddrp, size_t len)
@@ -421,16 +506,37 @@ static int munmap_int(struct process *pi, void *vaddrp, size_t len)
    return 0;
 }
 
+static struct user_mapping *
+get_first_user_mapping_in_range(struct process *pi, ulong vaddr, ulong vend)
+{
+   struct user_mapping *pos;
+   ASSERT(!is_preemption_enabled());
+
+   list_for_each_ro(pos, &pi->mi->mappings, pi_node) {
+
+      if (pos->vaddr < vend && vaddr < pos->vaddr + pos->len)
+         return pos;
+   }
+
+   return NULL;
+}
+
 int sys_munmap(void *vaddrp, size_t len)
 {
    struct task *curr = get_curr_task();
    struct process *pi = curr->pi;
-   ulong vaddr = (ulong) vaddrp;
-   int rc;
+   const ulong vaddr = (ulong) vaddrp;
+   struct user_mapping *um;
+   fs_handle anon_h;
+   ulong vend, start, end;
+   int rc = 0;
 
    if (!len || !pi->mi->mmap_heap)
       return -EINVAL;
 
+   if (vaddr & OFFSET_IN_PAGE_MASK)
+      return -EINVAL;
+
    if (!IN_RANGE(vaddr,
                  USER_MMAP_BEGIN,
                  USER_MMAP_BEGIN + pi->mi->mmap_heap_size))
@@ -438,10 +544,42 @@ int sys_munmap(void *vaddrp, size_t len)
       return -EINVAL;
    }
 
-   disable_preemption();
-   {
-      rc = munmap_int(pi, vaddrp, len);
-   }
-   enable_preemption();
+   vend = vaddr + pow2_round_up_at(len, PAGE_SIZE);
+
+   /*
+    * The range might intersect any number of user mappings: un-map its
+    * intersection with each one of them, closing the anonymous shared
+    * mapping handles that don't have any mapped part left.
+    */
+   do {
+
+      anon_h = NULL;
+
+      disable_preemption();
+      {
+         um = get_first_user_mapping_in_range(pi, vaddr, vend);
+
+         if (um) {
+
+            start = MAX(vaddr, um->vaddr);
+            end = MIN(vend, um->vaddr + um->len);
+
+            if (um->h && is_anon_mapping_handle(um->h))
+               anon_h = um->h;
+
+            process_update_maxrss(pi);
+            rc = munmap_int(pi, TO_PTR(start), end - start);
+
+            if (anon_h && (rc || is_handle_mapped(pi, anon_h)))
+               anon_h = NULL; /* other parts of the mapping are still there */
+         }
+      }
+      enable_preemption();
+
+      if (anon_h)
+         vfs_close(anon_h);
+
+   } while (um && !rc);
+
    return rc;
 }
@@ -125,6 +125,68 @@ void full_remove_user_mapping(struct process *pi, struct user_mapping *um)
    process_remove_user_mapping(um);
 }
 
+bool is_handle_mapped(struct process *pi, fs_handle h)
+{
+   struct user_mapping *um;
+   ASSERT(!is_preemption_enabled());
+
+   if (!pi->mi)
+      return false;
+
+   list_for_each_ro(um, &pi->mi->mappings, pi_node) {
+      if (um->h == h)
+         return true;
+   }
+
+   return false;
+}
+
+static fs_handle get_first_anon_mapping_handle(struct process *pi)
+{
+   struct user_mapping *um;
+   ASSERT(!is_preemption_enabled());
+
+   if (!pi->mi)
+      return NULL;
+
+   list_for_each_ro(um, &pi->mi->mappings, pi_node) {
+      if (um->h && is_anon_mapping_handle(um->h))
+         return um->h;
+   }
+
+   return NULL;
+}
+
+/*
+ * Remove all the MAP_SHARED | MAP_ANONYMOUS mappings of the current process,
+ * closing their handles. Must be called with preemption enabled, because of
+ * vfs_close(): that's why the handles are looked up one at a time.
+ */
+void close_all_anon_shared_mappings(struct process *pi)
+{
+   fs_handle h;
+   ASSERT(is_preemption_enabled());
+   ASSERT(pi == get_curr_proc());
+
+   if (pi->vforked)
+      return; /* the mappings belong to the parent */
+
+   while (true) {
+
+      disable_preemption();
+      {
+         h = get_first_anon_mapping_handle(pi);
+      }
+      enable_preemption();
+
+      if (!h)
+         break;
+
+      /* NOTE: vfs_close() removes all the mappings of `h` */
+      vfs_close(h);
+   }
+}
+
 void remove_all_file_mappings(struct process *pi)
 {
    fs_handle *h;
@@ -5,6 +5,7 @@
 
 #include <tilck/kernel/modules.h>
 #include <tilck/kernel/sort.h>
+#include <tilck/kernel/boot_trace.h>
 
 static int mods_count;
 static struct module *modules[32];
@@ -29,6 +30,8 @@ void init_modules(void)
    for (int i = 0; i < mods_count; i++) {
       struct module *m = modules[i];
       printk("*** Init kernel module: %s\n", m->name);
+      boot_trace_begin(m->name);
       m->init();
+      boot_trace_end();
    }
 }
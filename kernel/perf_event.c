@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/pmu.h>
+#include <tilck/kernel/perf_event.h>
+
+#include <linux/perf_event.h> // system header
+
+/*
+ * A perf event object is just a pmu_counter living in kernelfs, like pipes.
+ * A read() returns the current value of the counter as an u64, like on Linux
+ * with read_format = 0. The PERF_EVENT_IOC_{ENABLE,DISABLE,RESET} ioctls are
+ * supported as well.
+ */
+
+struct perf_event {
+
+   KOBJ_BASE_FIELDS
+
+   struct pmu_counter cnt;
+};
+
+#define PERF_HW_CACHE_EV(cache, op, result)                 \
+   ((PERF_COUNT_HW_CACHE_##cache)        |                  \
+    (PERF_COUNT_HW_CACHE_OP_##op << 8)   |                  \
+    (PERF_COUNT_HW_CACHE_RESULT_##result << 16))
+
+static int perf_attr_to_pmu_event(struct perf_event_attr *attr)
+{
+   if (attr->type == PERF_TYPE_HARDWARE) {
+
+      switch (attr->config) {
+         case PERF_COUNT_HW_CPU_CYCLES:
+            return PMU_EV_CYCLES;
+         case PERF_COUNT_HW_INSTRUCTIONS:
+            return PMU_EV_INSTRUCTIONS;
+         case PERF_COUNT_HW_CACHE_MISSES:
+            return PMU_EV_LLC_MISSES;
+         case PERF_COUNT_HW_BRANCH_MISSES:
+            return PMU_EV_BRANCH_MISSES;
+      }
+
+   } else if (attr->type == PERF_TYPE_HW_CACHE) {
+
+      switch (attr->config) {
+         case PERF_HW_CACHE_EV(LL, READ, MISS):
+            return PMU_EV_LLC_MISSES;
+         case PERF_HW_CACHE_EV(DTLB, READ, MISS):
+            return PMU_EV_DTLB_MISSES;
+      }
+   }
+
+   return -ENOENT;
+}
+
+static ssize_t perf_event_read(fs_handle h, char *buf, size_t size)
+{
+   struct kfs_handle *kh = h;
+   struct perf_event *e = (void *)kh->kobj;
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -ENOSPC;
+
+   val = pmu_counter_read(&e->cnt);
+   memcpy(buf, &val, sizeof(val));
+   return sizeof(u64);
+}
+
+static int perf_event_ioctl(fs_handle h, ulong request, void *argp)
+{
+   struct kfs_handle *kh = h;
+   struct perf_event *e = (void *)kh->kobj;
+
+   switch (request) {
+
+      case PERF_EVENT_IOC_ENABLE:
+         pmu_counter_enable(&e->cnt, true);
+         return 0;
+
+      case PERF_EVENT_IOC_DISABLE:
+         pmu_counter_enable(&e->cnt, false);
+         return 0;
+
+      case PERF_EVENT_IOC_RESET:
+         pmu_counter_reset(&e->cnt);
+         return 0;
+
+      default:
+         return -EINVAL;
+   }
+}
+
+static const struct file_ops static_ops_perf_event =
+{
+   .read = perf_event_read,
+   .ioctl = perf_event_ioctl,
+};
+
+static void destroy_perf_event(struct perf_event *e)
+{
+   pmu_counter_detach(&e->cnt);
+   kfree_obj(e, struct perf_event);
+}
+
+int
+perf_event_create_handle(struct task *ti,
+                         struct perf_event_attr *attr,
+                         fs_handle *out)
+{
+   struct perf_event *e;
+   fs_handle h;
+   int ev, rc;
+
+   if (attr->sample_period || attr->freq || attr->read_format)
+      return -EINVAL;
+
+   if (attr->inherit || attr->exclusive || attr->pinned)
+      return -EINVAL;
+
+   if (attr->exclude_user && attr->exclude_kernel)
+      return -EINVAL;
+
+   if ((ev = perf_attr_to_pmu_event(attr)) < 0)
+      return ev;
+
+   if (!(e = (void *)kzalloc_obj(struct perf_event)))
+      return -ENOMEM;
+
+   e->destory_obj = (void *)&destroy_perf_event;
+   e->cnt.ev = (enum pmu_event)ev;
+   e->cnt.flags = (attr->exclude_user ? 0 : PMU_CNT_USER) |
+                  (attr->exclude_kernel ? 0 : PMU_CNT_KERNEL);
+
+   if ((rc = pmu_counter_attach(ti, &e->cnt))) {
+      kfree_obj(e, struct perf_event);
+      return rc;
+   }
+
+   h = kfs_create_new_handle(&static_ops_perf_event, (void *)e, O_RDONLY);
+
+   if (!h) {
+      destroy_perf_event(e);
+      return -ENOMEM;
+   }
+
+   if (!attr->disabled)
+      pmu_counter_enable(&e->cnt, true);
+
+   *out = h;
+   return 0;
+}
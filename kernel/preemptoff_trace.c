@@ -0,0 +1,207 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/preemptoff_trace.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/elf_utils.h>
+#include <tilck/kernel/sort.h>
+
+void poff_trace_get_site_name(ulong site, char *buf, size_t sz)
+{
+   const char *sym;
+   long off;
+
+   if (!(sym = find_sym_at_addr(site, &off, NULL))) {
+      snprintk(buf, sz, "%p", TO_PTR(site));
+      return;
+   }
+
+   if (off)
+      snprintk(buf, sz, "%s+0x%lx", sym, off);
+   else
+      snprintk(buf, sz, "%s", sym);
+}
+
+#if KRN_PREEMPTOFF_TRACE
+
+struct poff_state {
+
+   u64 start;              /* TSC value at the beginning, 0 if not tracing */
+   ulong start_site;
+   int start_tid;
+
+   u32 count;              /* number of valid entries in `top` */
+   u64 threshold;          /* min duration in `top`, when it's full */
+   struct poff_entry top[POFF_TRACE_TOP_N];
+};
+
+static struct poff_state poff_states[2];
+
+static void
+poff_record(struct poff_state *s, u64 cycles, ulong end_site)
+{
+   struct poff_entry *e = NULL;
+   u32 min_idx = 0;
+
+   /* Same start and end sites: just update the max */
+   for (u32 i = 0; i < s->count; i++) {
+
+      struct poff_entry *pos = &s->top[i];
+
+      if (pos->start_site == s->start_site && pos->end_site == end_site) {
+
+         if (cycles <= pos->cycles)
+            return;
+
+         e = pos;
+         break;
+      }
+   }
+
+   if (!e) {
+
+      if (s->count < ARRAY_SIZE(s->top)) {
+
+         e = &s->top[s->count++];
+
+      } else {
+
+         /* Replace the shortest section */
+         for (u32 i = 1; i < s->count; i++)
+            if (s->top[i].cycles < s->top[min_idx].cycles)
+               min_idx = i;
+
+         e = &s->top[min_idx];
+      }
+   }
+
+   *e = (struct poff_entry) {
+      .cycles = cycles,
+      .start_site = s->start_site,
+      .end_site = end_site,
+      .tid = get_curr_tid(),
+   };
+
+   if (s->count == ARRAY_SIZE(s->top)) {
+
+      s->threshold = s->top[0].cycles;
+
+      for (u32 i = 1; i < s->count; i++)
+         s->threshold = MIN(s->threshold, s->top[i].cycles);
+   }
+}
+
+static ALWAYS_INLINE void
+poff_begin(struct poff_state *s, ulong site)
+{
+   s->start_site = site;
+   s->start_tid = get_curr_tid();
+   s->start = RDTSC();
+}
+
+/* Called with the interrupts disabled */
+static void
+poff_end(struct poff_state *s, ulong site, bool same_task)
+{
+   const u64 start = s->start;
+   u64 cycles;
+
+   if (!start)
+      return; /* no begin: e.g. early boot or after fault_resumable_call() */
+
+   cycles = RDTSC() - start;
+   s->start = 0;
+
+   if (same_task && s->start_tid != get_curr_tid())
+      return;
+
+   if (cycles > s->threshold)
+      poff_record(s, cycles, site);
+}
+
+void preemptoff_trace_begin(void)
+{
+   poff_begin(&poff_states[POFF_PREEMPT], (ulong)__builtin_return_address(0));
+}
+
+void __preemptoff_trace_end(ulong site)
+{
+   /*
+    * NOTE: don't use disable_interrupts() here, in order to not trace this
+    * (short) IRQs-off section too.
+    */
+   const ulong eflags = get_eflags();
+   disable_interrupts_forced();
+   {
+      poff_end(&poff_states[POFF_PREEMPT], site, false);
+   }
+   if (eflags & EFLAGS_IF)
+      enable_interrupts_forced();
+}
+
+void preemptoff_trace_end(void)
+{
+   __preemptoff_trace_end((ulong)__builtin_return_address(0));
+}
+
+void irqsoff_trace_begin(void)
+{
+   poff_begin(&poff_states[POFF_IRQS], (ulong)__builtin_return_address(0));
+}
+
+void irqsoff_trace_end(void)
+{
+   poff_end(&poff_states[POFF_IRQS],
+            (ulong)__builtin_return_address(0),
+            true);
+}
+
+static long poff_entry_cmpf(const void *a, const void *b)
+{
+   const struct poff_entry *x = a;
+   const struct poff_entry *y = b;
+
+   if (x->cycles == y->cycles)
+      return 0;
+
+   return y->cycles > x->cycles ? 1 : -1;
+}
+
+u32 poff_trace_get(enum poff_type t, struct poff_entry *buf, u32 max)
+{
+   struct poff_state *s = &poff_states[t];
+   ulong eflags;
+   u32 n;
+
+   eflags = get_eflags();
+   disable_interrupts_forced();
+   {
+      n = MIN(max, s->count);
+      memcpy(buf, s->top, n * sizeof(buf[0]));
+   }
+   if (eflags & EFLAGS_IF)
+      enable_interrupts_forced();
+
+   insertion_sort_generic(buf, sizeof(buf[0]), n, &poff_entry_cmpf);
+   return n;
+}
+
+void poff_trace_reset(void)
+{
+   ulong eflags = get_eflags();
+   disable_interrupts_forced();
+   {
+      for (u32 i = 0; i < ARRAY_SIZE(poff_states); i++) {
+         poff_states[i].count = 0;
+         poff_states[i].threshold = 0;
+      }
+   }
+   if (eflags & EFLAGS_IF)
+      enable_interrupts_forced();
+}
+
+#endif // #if KRN_PREEMPTOFF_TRACE
@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <tilck_gen_headers/config_kernel.h>
 #include <tilck_gen_headers/mod_console.h>
 
 #include <tilck/common/basic_defs.h>
@@ -13,6 +14,9 @@
 #include <tilck/kernel/term.h>
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/datetime.h>
+#include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/kmsg.h>
 
 #define PRINTK_BUF_SZ                         224
 #define PRINTK_PREFIXBUF_SZ                   32
@@ -26,21 +30,67 @@
 
 
 #define PRINTK_COLOR                          COLOR_GREEN
-#define PRINTK_RINGBUF_FLUSH_COLOR            COLOR_CYAN
-#define PRINTK_NOSPACE_IN_RBUF_FLUSH_COLOR    COLOR_MAGENTA
+#define PRINTK_DROPPED_COLOR                  COLOR_MAGENTA
 #define PRINTK_PANIC_COLOR                    COLOR_GREEN
 
-struct ringbuf_stat {
+#define PRINTK_DEFAULT_LEVEL                  6      /* KERN_INFO */
+#define PRINTK_WTH_PRIO                       5
+
+#if TINY_KERNEL
+   #define PRINTK_LOG_BUF_SIZE                (2 * KB)
+#else
+   #define PRINTK_LOG_BUF_SIZE                (PRINTK_LOG_BUF_KB * KB)
+#endif
+
+/*
+ * printk's log is a ring buffer of variable-size records, each one of them
+ * starting at a LOG_UNIT boundary. A record never wraps around: when there's
+ * not enough space before the end of the buffer, the remaining units are
+ * taken by a padding record (KMSG_FL_PAD) and the record starts at offset 0.
+ *
+ * The head, the tail and the count of the reservations in progress fit in a
+ * single 32-bit word, updated with CAS. Therefore, printk() can reserve space
+ * from any context, including IRQ handlers interrupting another printk().
+ * Reservations happen with preemption disabled: in-progress ones are visible
+ * only to IRQ handlers, which cannot read the log in that case.
+ *
+ * Records don't store their sequence number: readers count them, starting
+ * from the seq number of the oldest record in the log (`log_tail_seq`). That
+ * saves space and makes possible to always assign the seq numbers in order,
+ * even when a reservation gets interrupted by another one.
+ *
+ * When the log is full, the oldest records get overwritten. That's possible
+ * only when there are no other reservations in progress: otherwise, the new
+ * message is dropped. Readers detect that the records they were going to read
+ * have been overwritten by checking that their position is still between
+ * the tail and the head of the log, after having copied a record.
+ */
+
+#define LOG_UNIT                              16
+#define LOG_UNITS                             (PRINTK_LOG_BUF_SIZE / LOG_UNIT)
+#define LOG_POS_BITS                          14
+#define LOG_POS_MASK                          ((1u << LOG_POS_BITS) - 1)
+#define LOG_MAX_BUSY                          3
+
+struct printk_rec {
+
+   u64 ts;
+   u16 len;
+   u8 level;
+   u8 flags;
+   u32 unused;
+   char text[];
+};
+
+struct printk_log_state {
 
    union {
 
       struct {
-         u32 read_pos              : 14;
-         u32 write_pos             : 14;
-         u32 full                  :  1;
-         u32 first_printk          :  1;
-         u32 newline               :  1;
-         u32 unused0               :  1;
+         u32 head                  : 14;   /* position of the next record  */
+         u32 tail                  : 14;   /* position of the oldest one   */
+         u32 busy                  :  2;   /* reservations in progress     */
+         u32 unused0               :  2;
       };
 
       ATOMIC(u32) raw;
@@ -48,24 +98,43 @@ struct ringbuf_stat {
    };
 };
 
-#if TINY_KERNEL
-   static char printk_rbuf[2 * KB];
-#else
-   static char printk_rbuf[8 * KB];
-#endif
-
-static volatile struct ringbuf_stat printk_rbuf_stat =
-{
-   .newline = 1
+/* Consistent snapshot of the whole log's state */
+struct printk_log_snap {
+   struct printk_log_state st;
+   u32 tail_seq;
+   u32 head_seq;
 };
 
-bool __in_printk;
+STATIC_ASSERT(sizeof(struct printk_rec) == LOG_UNIT);
+STATIC_ASSERT((PRINTK_LOG_BUF_SIZE & (PRINTK_LOG_BUF_SIZE - 1)) == 0);
+STATIC_ASSERT(PRINTK_LOG_BUF_SIZE >= 1 * KB);
 
 /*
- * NOTE: the ring buf cannot be larger than 16K elems because of the size of the
- * read_pos and write_pos bit-fields.
+ * NOTE: positions are stored modulo 2^LOG_POS_BITS, therefore the log cannot
+ * be larger than 2^(LOG_POS_BITS - 1) units, in order to tell apart its
+ * used part from the free one.
  */
-STATIC_ASSERT(sizeof(printk_rbuf) <= 16 * KB);
+STATIC_ASSERT(LOG_UNITS <= (1u << (LOG_POS_BITS - 1)));
+STATIC_ASSERT(PRINTK_BUF_SZ <= KMSG_REC_MAX_LEN);
+
+static char printk_log_buf[PRINTK_LOG_BUF_SIZE] ALIGNED_AT(LOG_UNIT);
+static volatile struct printk_log_state printk_log_state;
+static ATOMIC(u32) log_tail_seq;
+static ATOMIC(u32) log_head_seq;
+static ATOMIC(u32) printk_log_dropped;
+
+/* Console flusher's state: accessed only holding printk_con_busy */
+static ATOMIC(bool) printk_con_busy;
+static struct kmsg_iter printk_con_iter;
+static bool printk_con_newline = true;
+static char printk_con_buf[PRINTK_PREFIXBUF_SZ + KMSG_REC_MAX_LEN];
+
+static struct worker_thread *printk_wth;
+static ATOMIC(bool) printk_flush_pending;
+
+struct kmutex kmsg_mutex;
+struct kcond kmsg_cond;
+bool __in_printk;
 
 static void
 printk_direct_flush_no_tty(const char *buf, size_t size, u8 color)
@@ -106,150 +175,397 @@ printk_direct_flush(const char *buf, size_t size, u8 color)
    return;
 }
 
-static ALWAYS_INLINE u32
-printk_calc_used(const struct ringbuf_stat *cs)
+static ALWAYS_INLINE void
+log_get_state(struct printk_log_state *s)
 {
-   u32 used = (cs->write_pos - cs->read_pos) % sizeof(printk_rbuf);
-
-   if (!used)
-      used = cs->full ? sizeof(printk_rbuf) : 0;
-
-   return used;
+   s->__raw = atomic_load_explicit(&printk_log_state.raw, mo_relaxed);
 }
 
-static void
-__printk_flush_ringbuf(char *tmpbuf, u32 buf_size)
+static ALWAYS_INLINE u32
+log_used(const struct printk_log_state *s)
 {
-   struct ringbuf_stat cs, ns;
-   u32 used, to_read = 0;
+   return (s->head - s->tail) & LOG_POS_MASK;
+}
 
-   while (true) {
+static ALWAYS_INLINE bool
+log_pos_in_window(const struct printk_log_state *s, u32 pos)
+{
+   return ((pos - s->tail) & LOG_POS_MASK) < log_used(s);
+}
 
-      do {
-         cs = printk_rbuf_stat;
-         ns = printk_rbuf_stat;
-         used = printk_calc_used(&cs);
+static ALWAYS_INLINE struct printk_rec *
+log_rec_at(u32 pos)
+{
+   return (void *)(printk_log_buf + (pos % LOG_UNITS) * LOG_UNIT);
+}
 
-         /* We can read at most 'buf_size' bytes at a time */
-         to_read = UNSAFE_MIN(buf_size, used);
+static ALWAYS_INLINE u32
+log_rec_units(u32 len)
+{
+   return (u32)(sizeof(struct printk_rec) + len + LOG_UNIT - 1) / LOG_UNIT;
+}
 
-         /* And copy them to our minibuf */
-         for (u32 i = 0; i < to_read; i++)
-            tmpbuf[i] = printk_rbuf[(cs.read_pos + i) % sizeof(printk_rbuf)];
+/*
+ * Takes a consistent snapshot of the log's state. Fails only when called by an
+ * IRQ handler which interrupted a reservation: see the comment above.
+ */
+static bool
+log_snapshot(struct printk_log_snap *s)
+{
+   struct printk_log_state st;
 
-         /* Increase read_pos and decrease used */
-         ns.read_pos = (ns.read_pos + to_read) % sizeof(printk_rbuf);
+   do {
 
-         if (!to_read)
-            ns.first_printk = 0;
+      log_get_state(&s->st);
 
-         /* Repeat that until we were able to do that atomically */
+      if (s->st.busy)
+         return false;
 
-      } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                                &cs.__raw,
-                                ns.__raw,
-                                mo_relaxed,
-                                mo_relaxed));
+      s->tail_seq = atomic_load_explicit(&log_tail_seq, mo_relaxed);
+      s->head_seq = atomic_load_explicit(&log_head_seq, mo_relaxed);
+      log_get_state(&st);
 
-      /* Note: we checked that `first_printk` in `cs` was unset! */
-      if (!to_read)
-         break;
+   } while (st.__raw != s->st.__raw);
 
-      printk_direct_flush(tmpbuf, to_read, PRINTK_RINGBUF_FLUSH_COLOR);
-   }
+   return true;
 }
 
-void
-printk_flush_ringbuf(void)
+static void
+log_write_rec(u32 pos, u8 level, u8 flags, const char *text, u32 len)
 {
-   char minibuf[80];
-   __printk_flush_ringbuf(minibuf, sizeof(minibuf));
+   struct printk_rec *r = log_rec_at(pos);
+
+   r->ts = (flags & KMSG_FL_PAD) ? 0 : get_sys_time();
+   r->len = (u16)len;
+   r->level = level;
+   r->flags = flags;
+   memcpy(r->text, text, len);
 }
 
-static void printk_append_to_ringbuf(const char *buf, size_t size)
+static void
+log_store(u8 level, u8 flags, const char *text, u32 len)
 {
-   static const char err_msg[] = "{_DROPPED_}\n";
-   struct ringbuf_stat cs, ns;
-   u32 used;
+   struct printk_log_state cs, ns;
+   u32 units, pad, used, pos, t, n, dropped;
 
-   if (!size)
-      return;
+   len = MIN(len, (u32)KMSG_REC_MAX_LEN);
+   units = log_rec_units(len);
+   disable_preemption();
 
    do {
-      cs = printk_rbuf_stat;
-      ns = printk_rbuf_stat;
-      used = printk_calc_used(&cs);
 
-      if (used + size >= sizeof(printk_rbuf)) {
+      log_get_state(&cs);
+      ns = cs;
+      pos = cs.head % LOG_UNITS;
+      pad = pos + units > LOG_UNITS ? LOG_UNITS - pos : 0;
+      used = log_used(&cs);
+      dropped = 0;
 
-         /* Corner case: the ring buffer is full */
+      if (cs.busy == LOG_MAX_BUSY)
+         goto drop;
 
-         if (term_is_initialized()) {
-            printk_direct_flush(buf, size, PRINTK_NOSPACE_IN_RBUF_FLUSH_COLOR);
-            return;
-         }
+      if (used + pad + units > LOG_UNITS) {
+
+         /* Corner case: no space, we have to overwrite the oldest records */
+
+         if (cs.busy)
+            goto drop;
+
+         for (t = cs.tail; used + pad + units > LOG_UNITS; t += n) {
+
+            struct printk_rec *r = log_rec_at(t);
 
-         if (buf != err_msg && used < sizeof(printk_rbuf) - 1) {
-            size = MIN(sizeof(printk_rbuf) - used - 1, sizeof(err_msg));
-            printk_append_to_ringbuf(err_msg, size);
+            if (r->flags & KMSG_FL_PAD) {
+               n = LOG_UNITS - t % LOG_UNITS;
+            } else {
+               n = log_rec_units(r->len);
+               dropped++;
+            }
+
+            used = n < used ? used - n : 0;
          }
 
-         return;
+         ns.tail = used ? t & LOG_POS_MASK : cs.head;
       }
 
-      ns.write_pos = (ns.write_pos + size) % sizeof(printk_rbuf);
-
-      if (ns.write_pos == ns.read_pos)
-         ns.full = 1;
+      ns.head = (cs.head + pad + units) & LOG_POS_MASK;
+      ns.busy = cs.busy + 1;
 
-   } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
+   } while (!atomic_cas_weak(&printk_log_state.raw,
                              &cs.__raw,
                              ns.__raw,
                              mo_relaxed,
                              mo_relaxed));
 
-   // Now we have some allocated space in the ringbuf
+   /* Now we have some reserved space in the log */
 
-   for (u32 i = 0; i < size; i++)
-      printk_rbuf[(cs.write_pos + i) % sizeof(printk_rbuf)] = buf[i];
-}
+   atomic_fetch_add_explicit(&log_tail_seq, dropped, mo_relaxed);
+   atomic_fetch_add_explicit(&log_head_seq, 1, mo_relaxed);
 
-/*
- * Sets atomically first_printk=1 and returns the old ringbuf_stat.
- */
-static struct ringbuf_stat
-try_set_first_printk_on_stack(bool newline)
-{
-   struct ringbuf_stat cs, ns;
+   if (pad)
+      log_write_rec(cs.head, 0, KMSG_FL_PAD, NULL, 0);
+
+   log_write_rec(cs.head + pad, level, flags, text, len);
 
+   /* Commit */
    do {
-      cs = printk_rbuf_stat;
-      ns = printk_rbuf_stat;
-      ns.first_printk = 1;
-      ns.newline = newline;
-   } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
+      log_get_state(&cs);
+      ns = cs;
+      ns.busy = cs.busy - 1;
+   } while (!atomic_cas_weak(&printk_log_state.raw,
                              &cs.__raw,
                              ns.__raw,
                              mo_relaxed,
                              mo_relaxed));
 
-   return cs;
+   enable_preemption();
+   return;
+
+drop:
+   atomic_fetch_add_explicit(&printk_log_dropped, 1, mo_relaxed);
+   enable_preemption();
+}
+
+void
+kmsg_iter_first(struct kmsg_iter *it)
+{
+   struct printk_log_snap s;
+
+   if (log_snapshot(&s)) {
+      it->pos = s.st.tail;
+      it->seq = s.tail_seq;
+   }
+}
+
+void
+kmsg_iter_last(struct kmsg_iter *it)
+{
+   struct printk_log_snap s;
+
+   if (log_snapshot(&s)) {
+      it->pos = s.st.head;
+      it->seq = s.head_seq;
+   }
+}
+
+bool
+kmsg_iter_has_data(struct kmsg_iter *it)
+{
+   struct printk_log_snap s;
+   return log_snapshot(&s) && it->seq != s.head_seq;
+}
+
+u32
+kmsg_get_dropped_count(void)
+{
+   return atomic_load_explicit(&printk_log_dropped, mo_relaxed);
+}
+
+int
+kmsg_read_rec(struct kmsg_iter *it,
+              struct kmsg_rec_info *info,
+              char *buf,
+              u32 bufsz)
+{
+   struct printk_log_snap s;
+   struct printk_log_state st;
+   struct printk_rec *r;
+
+   while (true) {
+
+      if (!log_snapshot(&s))
+         return 0;         /* we interrupted a printk(): retry later */
+
+      if (it->seq == s.head_seq)
+         return 0;         /* no new records */
+
+      if (!log_pos_in_window(&s.st, it->pos))
+         break;            /* overwritten */
+
+      r = log_rec_at(it->pos);
+
+      if (r->flags & KMSG_FL_PAD) {
+
+         asmVolatile("" ::: "memory");
+         log_get_state(&st);
+
+         if (!log_pos_in_window(&st, it->pos))
+            break;
+
+         it->pos = (it->pos + LOG_UNITS - it->pos % LOG_UNITS) & LOG_POS_MASK;
+         continue;
+      }
+
+      *info = (struct kmsg_rec_info) {
+         .ts = r->ts,
+         .seq = it->seq,
+         .len = r->len,
+         .level = r->level,
+         .flags = r->flags,
+      };
+
+      memcpy(buf, r->text, MIN((u32)info->len, bufsz));
+
+      /* Check that the record has not been overwritten while copying it */
+      asmVolatile("" ::: "memory");
+      log_get_state(&st);
+
+      if (!log_pos_in_window(&st, it->pos))
+         break;
+
+      it->pos = (it->pos + log_rec_units(info->len)) & LOG_POS_MASK;
+      it->seq++;
+      return 1;
+   }
+
+   kmsg_iter_first(it);
+   return -1;
+}
+
+static bool
+printk_con_trylock(void)
+{
+   bool exp = false;
+   return atomic_cas_strong(&printk_con_busy,
+                            &exp,
+                            true,
+                            mo_relaxed,
+                            mo_relaxed);
 }
 
 static void
-restore_first_printk_value(void)
+printk_con_unlock(void)
 {
-   struct ringbuf_stat cs, ns;
+   atomic_store_explicit(&printk_con_busy, false, mo_relaxed);
+}
 
-   do {
-      cs = printk_rbuf_stat;
-      ns = printk_rbuf_stat;
-      ns.first_printk = 0;
-   } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                             &cs.__raw,
-                             ns.__raw,
-                             mo_relaxed,
-                             mo_relaxed));
+static void
+printk_flush_log_to_console(void)
+{
+   static const char lost_msg[] = "{_DROPPED_}\n";
+   char *const text = printk_con_buf + PRINTK_PREFIXBUF_SZ;
+   struct kmsg_rec_info info;
+   int rc, prefix_sz;
+
+   while ((rc = kmsg_read_rec(&printk_con_iter, &info, text, KMSG_REC_MAX_LEN))) {
+
+      if (rc < 0) {
+         printk_direct_flush(lost_msg, sizeof(lost_msg)-1, PRINTK_DROPPED_COLOR);
+         printk_con_newline = true;
+         continue;
+      }
+
+      if ((info.flags & KMSG_FL_PREFIX) && printk_con_newline) {
+
+         prefix_sz = snprintk(
+            printk_con_buf, PRINTK_PREFIXBUF_SZ, "[%5u.%03u] %s",
+            (u32)(info.ts / TS_SCALE),
+            (u32)((info.ts % TS_SCALE) / (TS_SCALE / 1000)),
+            (info.flags & KMSG_FL_LOWSS) ? "[LOWSS] " : ""
+         );
+
+         printk_direct_flush(printk_con_buf, (size_t)prefix_sz, PRINTK_COLOR);
+      }
+
+      printk_direct_flush(text, info.len, PRINTK_COLOR);
+      printk_con_newline = false;
+
+      for (u32 i = 0; i < info.len; i++) {
+         if (text[i] == '\n') {
+            printk_con_newline = true;
+            break;
+         }
+      }
+   }
+}
+
+void
+printk_flush_ringbuf(void)
+{
+   if (!term_is_initialized())
+      return;
+
+   if (in_panic()) {
+
+      /*
+       * Ignore printk_con_busy: the flush we might have interrupted is never
+       * going to be resumed.
+       */
+      printk_flush_log_to_console();
+      return;
+   }
+
+   disable_preemption();
+   {
+      /*
+       * Loop because, while we were releasing the lock, a printk() from an IRQ
+       * handler might have logged a record without being able to flush it.
+       */
+      while (kmsg_iter_has_data(&printk_con_iter)) {
+
+         if (!printk_con_trylock())
+            break; /* somebody else is flushing: it will flush our records */
+
+         printk_flush_log_to_console();
+         printk_con_unlock();
+      }
+   }
+   enable_preemption();
+}
+
+static void
+printk_flush_job(void *arg)
+{
+   atomic_store_explicit(&printk_flush_pending, false, mo_relaxed);
+   printk_flush_ringbuf();
+
+   /* Wake up /dev/kmsg's readers */
+   kmutex_lock(&kmsg_mutex);
+   {
+      kcond_signal_all(&kmsg_cond);
+   }
+   kmutex_unlock(&kmsg_mutex);
+}
+
+static bool
+printk_schedule_flush(void)
+{
+   if (!printk_wth)
+      return false;
+
+   if (atomic_exchange_explicit(&printk_flush_pending, true, mo_relaxed))
+      return true; /* a flush is already pending */
+
+   if (!wth_enqueue_on(printk_wth, &printk_flush_job, NULL)) {
+      atomic_store_explicit(&printk_flush_pending, false, mo_relaxed);
+      return false;
+   }
+
+   return true;
+}
+
+static bool
+printk_on_caller_tty(void)
+{
+   /*
+    * Without KRN_PRINTK_ON_CURR_TTY, printk() writes on the tty of the calling
+    * process: the worker thread cannot do that on its behalf.
+    */
+   return !KRN_PRINTK_ON_CURR_TTY &&
+          !in_irq() &&
+          get_curr_tty() != NULL &&
+          get_curr_process_tty() != NULL;
+}
+
+void init_printk_worker(void)
+{
+   kmutex_init(&kmsg_mutex, 0);
+   kcond_init(&kmsg_cond);
+   printk_wth =
+      wth_create_thread("printk", PRINTK_WTH_PRIO, WTH_PRINTK_QUEUE_SIZE);
+
+   if (!printk_wth)
+      printk("WARNING: unable to create printk's worker thread\n");
 }
 
 STATIC int
@@ -277,131 +593,74 @@ vsnprintk_with_truc_suffix(char *buf, u32 bufsz, const char *fmt, va_list args)
 }
 
 static void
-__tilck_vprintk(char *prefixbuf,
-                char *buf,
+__tilck_vprintk(char *buf,
                 u32 bufsz,
                 u32 flags,
                 const char *fmt,
                 va_list args)
 {
-   bool prefix = !in_panic();
-   bool has_newline = false;
-   struct ringbuf_stat old;
-   int written, prefix_sz = 0;
+   u8 level = PRINTK_DEFAULT_LEVEL;
+   u8 rec_flags = KMSG_FL_PREFIX;
+   int written;
 
    if (*fmt == PRINTK_CTRL_CHAR) {
       u32 cmd = *(u32 *)fmt;
-      fmt += 4;
 
       if (cmd == *(u32 *)NO_PREFIX)
-         prefix = false;
-   }
+         rec_flags = 0;
+      else if (fmt[1] == PRINTK_CTRL_LEVEL)
+         level = (u8)(fmt[2] - '0') & 7;
 
-   if (flags & PRINTK_FL_NO_PREFIX)
-      prefix = false;
-
-   written = vsnprintk_with_truc_suffix(buf, bufsz, fmt, args);
-
-   for (int i = 0; i < written; i++) {
-      if (buf[i] == '\n') {
-         has_newline = true;
-         break;
-      }
+      fmt += 4;
    }
 
-   old = try_set_first_printk_on_stack(has_newline);
-
-   if (prefix && old.newline) {
-
-      const u64 systime = get_sys_time();
-
-      prefix_sz = snprintk(
-         prefixbuf, PRINTK_PREFIXBUF_SZ, "[%5u.%03u] %s",
-         (u32)(systime / TS_SCALE),
-         (u32)((systime % TS_SCALE) / (TS_SCALE / 1000)),
-         bufsz < PRINTK_BUF_SZ ? "[LOWSS] " : ""
-      );
-
-   } else {
-
-      prefix = false;
-   }
+   if (flags & PRINTK_FL_NO_PREFIX)
+      rec_flags = 0;
 
+   if (bufsz < PRINTK_BUF_SZ)
+      rec_flags |= KMSG_FL_LOWSS;
 
-   if (!term_is_initialized()) {
-      printk_append_to_ringbuf(prefixbuf, (size_t) prefix_sz);
-      printk_append_to_ringbuf(buf, (size_t) written);
-      restore_first_printk_value();
-      return;
-   }
+   written = vsnprintk_with_truc_suffix(buf, bufsz, fmt, args);
 
    if (in_panic()) {
       printk_direct_flush(buf, (size_t) written, PRINTK_PANIC_COLOR);
-      restore_first_printk_value();
       return;
    }
 
-   disable_preemption();
-   {
-      if (!old.first_printk) {
-
-         /*
-          * OK, we were the first. Now, flush our buffer directly and loop
-          * flushing anything that, in the meanwhile, printk() calls from IRQs
-          * generated.
-          */
+   log_store(level, rec_flags, buf, (u32) written);
 
-         printk_direct_flush(prefixbuf, (size_t) prefix_sz, PRINTK_COLOR);
-         printk_direct_flush(buf, (size_t) written, PRINTK_COLOR);
-         __printk_flush_ringbuf(buf, bufsz);
-
-         /*
-          * No need to call restore_first_printk_value(): printk_flush_ringbuf
-          * clears the `first_printk` bit for us.
-          */
-
-      } else {
-
-         /*
-          * We were NOT the first printk on the stack: we're in an IRQ handler
-          * and can only append our data to the ringbuf. On return, at some
-          * point, the first printk(), in printk_flush_ringbuf() [case above]
-          * will flush our data.
-          */
-
-         printk_append_to_ringbuf(prefixbuf, (size_t) prefix_sz);
-         printk_append_to_ringbuf(buf, (size_t) written);
-      }
-   }
-   enable_preemption();
+   /*
+    * Flush the log on the console from the worker thread, unless it has not
+    * been created yet (early boot). In that case, the first printk() on the
+    * stack flushes the records logged by the nested ones (from IRQs), while
+    * before the term is initialized, records just stay in the log until
+    * printk_flush_ringbuf() is called.
+    */
+   if (!printk_schedule_flush() || printk_on_caller_tty())
+      printk_flush_ringbuf();
 }
 
 static void
 __regular_tilck_vprintk(u32 flags, const char *fmt, va_list args)
 {
-   char prefixbuf[PRINTK_PREFIXBUF_SZ];
    char buf[PRINTK_BUF_SZ];
-
-   __tilck_vprintk(prefixbuf, buf, sizeof(buf), flags, fmt, args);
+   __tilck_vprintk(buf, sizeof(buf), flags, fmt, args);
 }
 
 static void
 __low_ssp_tilck_vprintk(u32 flags, const char *fmt, va_list args)
 {
-   char prefixbuf[PRINTK_PREFIXBUF_SZ];
    char buf[64];
-
-   __tilck_vprintk(prefixbuf, buf, sizeof(buf), flags, fmt, args);
+   __tilck_vprintk(buf, sizeof(buf), flags, fmt, args);
 }
 
 void
 tilck_vprintk(u32 flags, const char *fmt, va_list args)
 {
-   static char p_prefixbuf[PRINTK_PREFIXBUF_SZ];
    static char p_buf[PRINTK_BUF_SZ];
 
    if (in_panic())
-      __tilck_vprintk(p_prefixbuf, p_buf, sizeof(p_buf), flags, fmt, args);
+      __tilck_vprintk(p_buf, sizeof(p_buf), flags, fmt, args);
    else if (get_rem_stack() < PRINTK_SAFE_STACK_SPACE)
       panic("No stack space for vprintk(\"%s\")", fmt);
    else if (get_rem_stack() < PRINTK_SAFE_STACK_SPACE + 512)
@@ -15,6 +15,7 @@
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/pmu.h>
 
 #include <sys/prctl.h>        // system header
 
@@ -201,6 +202,7 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
 
    memcpy(ti, parent, sizeof(struct task));
    memcpy(pi, parent_pi, sizeof(struct process));
+   pi->children_ru = NULL;
 
    if (MOD_debugpanel) {
 
@@ -241,8 +243,16 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
    ti->is_main_thread = true;
    ti->timer_ready = false;
 
-   /* Reset sched ticks in the new process */
+   /* Reset sched ticks and the resource usage in the new process */
    bzero(&ti->ticks, sizeof(ti->ticks));
+   bzero(&ti->ru, sizeof(ti->ru));
+   ti->acct_ts = 0;
+   SCHED_LAT_ONLY(bzero(&ti->lat, sizeof(ti->lat)));
+   pi->rss_gen = 0;  /* the RSS counter is not valid */
+   pi->maxrss = 0;
+
+   if (UNLIKELY(!(pi->children_ru = kzalloc_obj(struct children_rusage))))
+      goto oom_case;
 
    /* Copy parent's `cwd` while retaining the `fs` and the inode obj */
    process_set_cwd2_nolock_raw(pi, &parent_pi->cwd);
@@ -278,6 +288,9 @@ oom_case:
 
       process_free_mappings_info(ti->pi);
 
+      if (pi->children_ru)
+         kfree_obj(pi->children_ru, struct children_rusage);
+
       if (MOD_debugpanel && pi->debug_cmdline)
          kfree2(pi->debug_cmdline, PROCESS_CMDLINE_BUF_SIZE);
 
@@ -317,6 +330,10 @@ static void free_process_int(struct process *pi)
    if (release_obj(pi) == 0) {
 
       arch_specific_free_proc(pi);
+
+      if (pi->children_ru)
+         kfree_obj(pi->children_ru, struct children_rusage);
+
       kfree2(get_process_task(pi), TOT_PROC_AND_TASK_SIZE);
 
       if (MOD_debugpanel)
@@ -341,6 +358,7 @@ void free_task(struct task *ti)
 {
    ASSERT_TASK_STATE(ti->state, TASK_STATE_ZOMBIE);
    arch_specific_free_task(ti);
+   pmu_free_task_ctx(ti);
 
    ASSERT(!ti->kernel_stack);
    ASSERT(!ti->io_copybuf);
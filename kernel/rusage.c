@@ -0,0 +1,201 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/syscalls.h>
+
+#include <sys/resource.h>   // system header
+
+#ifndef RUSAGE_THREAD
+   #define RUSAGE_THREAD   1  /* Linux-specific, requires _GNU_SOURCE */
+#endif
+
+/*
+ * The RSS of a process is counted incrementally by the paging code, through
+ * process_account_user_pages(), as long as its page tables are changed only by
+ * the process itself. When that's not the case (fork, execve, vfork children,
+ * shared ramfs mappings etc.) `rss_gen` is bumped instead: that invalidates
+ * the counters of all the processes, which re-count their pages by walking
+ * their page tables, but only the next time their RSS is needed. The max RSS
+ * is updated on every increment and on every re-count: therefore, it's exact.
+ */
+static u32 rss_gen = 1;
+
+void process_account_user_pages(pdir_t *pdir, int delta)
+{
+   struct task *curr = get_curr_task();
+   struct process *pi = curr ? curr->pi : NULL;
+
+   disable_preemption();
+   {
+      if (pi && pi->pdir == pdir && !pi->vforked) {
+
+         if (pi->rss_gen == rss_gen) {
+            pi->rss = (u32)((int)pi->rss + delta);
+            pi->maxrss = MAX(pi->maxrss, pi->rss);
+         }
+
+      } else {
+
+         /* Zero means "not valid" for pi->rss_gen: skip it */
+         if (!++rss_gen)
+            rss_gen++;
+      }
+   }
+   enable_preemption();
+}
+
+/* Update pi->maxrss and return the current RSS of `pi`, in pages */
+u32 process_update_maxrss(struct process *pi)
+{
+   u32 pages;
+   ASSERT(!is_preemption_enabled());
+
+   if (pi->rss_gen == rss_gen)
+      return pi->rss;       /* the counter is valid: maxrss is up to date */
+
+   pages = (u32)pdir_count_user_pages(pi->pdir);
+
+   /*
+    * Only the process itself can re-validate its counter, because it cannot
+    * be in the middle of a page table change while it's here.
+    */
+   if (pi == get_curr_proc() && !pi->vforked) {
+      pi->rss = pages;
+      pi->rss_gen = rss_gen;
+   }
+
+   pi->maxrss = MAX(pi->maxrss, pages);
+   return pages;
+}
+
+/* Called when `child`, a zombie, is reaped by its parent `pi` */
+void process_account_reaped_child(struct process *pi, struct task *child)
+{
+   struct children_rusage *cru = pi->children_ru;
+   struct children_rusage *ccru = child->pi->children_ru;
+   ASSERT(!is_preemption_enabled());
+
+   if (!cru)
+      return; /* the kernel process */
+
+   sched_rusage_add(&cru->ru, &child->ru);
+   cru->maxrss = MAX(cru->maxrss, child->pi->maxrss);
+
+   if (ccru) {
+      sched_rusage_add(&cru->ru, &ccru->ru);
+      cru->maxrss = MAX(cru->maxrss, ccru->maxrss);
+   }
+}
+
+/* The resource usage of the waited children of `pi` */
+void process_get_children_rusage(struct process *pi,
+                                 struct sched_rusage *ru,
+                                 u32 *maxrss)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (pi->children_ru) {
+      *ru = pi->children_ru->ru;
+      *maxrss = pi->children_ru->maxrss;
+   } else {
+      bzero(ru, sizeof(*ru));
+      *maxrss = 0;
+   }
+}
+
+static void
+tsc_to_timeval(u64 cycles, struct timeval *tv)
+{
+   const u64 ns = tsc_to_ns(cycles);
+
+   tv->tv_sec = (long)(ns / BILLION);
+   tv->tv_usec = (long)(ns % BILLION / 1000);
+}
+
+static void
+fill_k_rusage(struct k_rusage *kru, struct sched_rusage *ru, u32 maxrss)
+{
+   bzero(kru, sizeof(*kru));
+   tsc_to_timeval(ru->utime, &kru->ru_utime);
+   tsc_to_timeval(ru->stime, &kru->ru_stime);
+
+   kru->ru_maxrss = (long)(maxrss * (PAGE_SIZE / KB));
+   kru->ru_minflt = (long)ru->minflt;
+   kru->ru_majflt = (long)ru->majflt;
+   kru->ru_nvcsw = (long)ru->nvcsw;
+   kru->ru_nivcsw = (long)ru->nivcsw;
+}
+
+/*
+ * The resource usage of `ti` and of all of its waited children, as returned
+ * by wait4(). Note: `ti` must be a zombie or a stopped task.
+ */
+void process_get_total_rusage(struct task *ti, struct k_rusage *kru)
+{
+   struct process *pi = ti->pi;
+   struct sched_rusage ru, cru;
+   u32 maxrss;
+
+   disable_preemption();
+   {
+      process_get_children_rusage(pi, &cru, &maxrss);
+      ru = ti->ru;
+      sched_rusage_add(&ru, &cru);
+      maxrss = MAX(pi->maxrss, maxrss);
+   }
+   enable_preemption();
+
+   fill_k_rusage(kru, &ru, maxrss);
+}
+
+int sys_getrusage(int who, struct k_rusage *user_usage)
+{
+   struct task *curr = get_curr_task();
+   struct process *pi = curr->pi;
+   struct sched_rusage ru;
+   struct k_rusage kru;
+   u32 maxrss;
+
+   switch (who) {
+
+      case RUSAGE_SELF:
+      case RUSAGE_THREAD: /* no multi-threading support, for the moment */
+
+         sched_get_rusage(curr, &ru);
+
+         disable_preemption();
+         {
+            process_update_maxrss(pi);
+            maxrss = pi->maxrss;
+         }
+         enable_preemption();
+         break;
+
+      case RUSAGE_CHILDREN:
+
+         disable_preemption();
+         {
+            process_get_children_rusage(pi, &ru, &maxrss);
+         }
+         enable_preemption();
+         break;
+
+      default:
+         return -EINVAL;
+   }
+
+   fill_k_rusage(&kru, &ru, maxrss);
+
+   if (copy_to_user(user_usage, &kru, sizeof(kru)))
+      return -EFAULT;
+
+   return 0;
+}
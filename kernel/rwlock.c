@@ -2,6 +2,39 @@
 
 #include <tilck/kernel/rwlock.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/lock_stats.h>
+
+#if KRN_LOCK_STATS
+
+/*
+ * For the rwlocks, `contended` is just a hint: it's computed by checking the
+ * state of the lock before acquiring it.
+ */
+static void
+rwlock_stats_acquired(struct lock_class_stats *cl, bool contended, u64 start)
+{
+   lock_stats_account_acquire(cl, contended, RDTSC() - start);
+}
+
+static void
+rwlock_rp_init_stats(struct rwlock_rp *r, const void *site)
+{
+   r->stats = lock_stats_get_class(site, LOCK_CL_RWLOCK_RP);
+   r->readers_lock.stats = lock_stats_get_class(site, LOCK_CL_KMUTEX);
+   r->ex_lock_ts = 0;
+}
+
+static void
+rwlock_wp_init_stats(struct rwlock_wp *rw, const void *site)
+{
+   rw->stats = lock_stats_get_class(site, LOCK_CL_RWLOCK_WP);
+   rw->m.stats = lock_stats_get_class(site, LOCK_CL_KMUTEX);
+   rw->c.stats = lock_stats_get_class(site, LOCK_CL_KCOND);
+   rw->ex_lock_ts = 0;
+}
+
+#endif
 
 void rwlock_rp_init(struct rwlock_rp *r)
 {
@@ -9,6 +42,7 @@ void rwlock_rp_init(struct rwlock_rp *r)
    ksem_init(&r->writers_sem, 1, 1);
    r->readers_count = 0;
    DEBUG_ONLY(r->ex_owner = NULL);
+   LOCK_STATS_ONLY(rwlock_rp_init_stats(r, __builtin_return_address(0)));
 }
 
 void rwlock_rp_destroy(struct rwlock_rp *r)
@@ -21,12 +55,18 @@ void rwlock_rp_destroy(struct rwlock_rp *r)
 
 void rwlock_rp_shlock(struct rwlock_rp *r)
 {
+   LOCK_STATS_ONLY(const u64 start = RDTSC());
+   LOCK_STATS_ONLY(bool contended = !!r->readers_lock.owner_task);
+
    kmutex_lock(&r->readers_lock);
    {
-      if (++r->readers_count == 1)
+      if (++r->readers_count == 1) {
+         LOCK_STATS_ONLY(contended |= r->writers_sem.counter < 1);
          ksem_wait(&r->writers_sem, 1, KSEM_WAIT_FOREVER);
+      }
    }
    kmutex_unlock(&r->readers_lock);
+   LOCK_STATS_ONLY(rwlock_stats_acquired(r->stats, contended, start));
 }
 
 void rwlock_rp_shunlock(struct rwlock_rp *r)
@@ -41,10 +81,16 @@ void rwlock_rp_shunlock(struct rwlock_rp *r)
 
 void rwlock_rp_exlock(struct rwlock_rp *r)
 {
+   LOCK_STATS_ONLY(const u64 start = RDTSC());
+   LOCK_STATS_ONLY(const bool contended = r->writers_sem.counter < 1);
+
    ksem_wait(&r->writers_sem, 1, KSEM_WAIT_FOREVER);
 
    ASSERT(r->ex_owner == NULL);
    DEBUG_ONLY(r->ex_owner = get_curr_task());
+
+   LOCK_STATS_ONLY(rwlock_stats_acquired(r->stats, contended, start));
+   LOCK_STATS_ONLY(r->ex_lock_ts = RDTSC());
 }
 
 void rwlock_rp_exunlock(struct rwlock_rp *r)
@@ -52,6 +98,10 @@ void rwlock_rp_exunlock(struct rwlock_rp *r)
    ASSERT(r->ex_owner == get_curr_task());
    DEBUG_ONLY(r->ex_owner = NULL);
 
+   LOCK_STATS_ONLY(
+      lock_stats_account_release(r->stats, RDTSC() - r->ex_lock_ts)
+   );
+
    ksem_signal(&r->writers_sem, 1);
 }
 
@@ -65,6 +115,7 @@ void rwlock_wp_init(struct rwlock_wp *rw, bool recursive)
    rw->r = 0;
    rw->w = false;
    rw->rec = recursive;
+   LOCK_STATS_ONLY(rwlock_wp_init_stats(rw, __builtin_return_address(0)));
 }
 
 void rwlock_wp_destroy(struct rwlock_wp *rw)
@@ -78,8 +129,13 @@ void rwlock_wp_destroy(struct rwlock_wp *rw)
 
 void rwlock_wp_shlock(struct rwlock_wp *rw)
 {
+   LOCK_STATS_ONLY(const u64 start = RDTSC());
+   LOCK_STATS_ONLY(bool contended = !!rw->m.owner_task);
+
    kmutex_lock(&rw->m);
    {
+      LOCK_STATS_ONLY(contended |= rw->w);
+
       /* Wait until there's at least one writer waiting (they have priority) */
       while (rw->w) {
          kcond_wait(&rw->c, &rw->m, KCOND_WAIT_FOREVER);
@@ -93,6 +149,7 @@ void rwlock_wp_shlock(struct rwlock_wp *rw)
       rw->r++;
    }
    kmutex_unlock(&rw->m);
+   LOCK_STATS_ONLY(rwlock_stats_acquired(rw->stats, contended, start));
 }
 
 void rwlock_wp_shunlock(struct rwlock_wp *rw)
@@ -155,11 +212,24 @@ static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
 
 void rwlock_wp_exlock(struct rwlock_wp *rw)
 {
+   LOCK_STATS_ONLY(const u64 start = RDTSC());
+   LOCK_STATS_ONLY(bool contended = !!rw->m.owner_task);
+
    kmutex_lock(&rw->m);
    {
+      LOCK_STATS_ONLY(contended |= rw->w || rw->r > 0);
       rwlock_wp_exlock_int(rw);
    }
    kmutex_unlock(&rw->m);
+
+#if KRN_LOCK_STATS
+
+   /* Skip the recursive locks: they're not real acquisitions */
+   if (!rw->rec || rw->rc == 1) {
+      rwlock_stats_acquired(rw->stats, contended, start);
+      rw->ex_lock_ts = RDTSC();
+   }
+#endif
 }
 
 static void rwlock_wp_exunlock_int(struct rwlock_wp *rw)
@@ -193,6 +263,11 @@ void rwlock_wp_exunlock(struct rwlock_wp *rw)
 {
    kmutex_lock(&rw->m);
    {
+#if KRN_LOCK_STATS
+      if (!rw->rec || rw->rc == 1)
+         lock_stats_account_release(rw->stats, RDTSC() - rw->ex_lock_ts);
+#endif
+
       rwlock_wp_exunlock_int(rw);
    }
    kmutex_unlock(&rw->m);
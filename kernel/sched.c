@@ -30,6 +30,16 @@ static int runnable_tasks_count;
 static int current_max_pid = -1;
 static int current_max_kernel_tid = -1;
 static struct task *idle_task;
+static struct sched_cpu_ticks cpu_ticks;
+
+/*
+ * Load averages, computed every LOADAVG_FREQ ticks like on Linux: `exp` is
+ * LOADAVG_FIXED_1 / e^(5 sec / 1, 5, 15 min), in fixed-point format.
+ */
+#define LOADAVG_FREQ                          (5 * TIMER_HZ + 1)
+static const ulong loadavg_exp[3] = { 1884, 2014, 2037 };
+static ulong loadavg[3];
+static u32 loadavg_ticks;
 
 const char *const task_state_str[5] = {
    [TASK_STATE_INVALID]  = "invalid",
@@ -41,8 +51,14 @@ const char *const task_state_str[5] = {
 
 void enable_preemption(void)
 {
-   int oldval =
-      atomic_fetch_sub_explicit(&__disable_preempt, 1, mo_relaxed);
+   int oldval;
+
+#if KRN_PREEMPTOFF_TRACE
+   if (get_preempt_disable_count() == 1)
+      __preemptoff_trace_end((ulong)__builtin_return_address(0));
+#endif
+
+   oldval = atomic_fetch_sub_explicit(&__disable_preempt, 1, mo_relaxed);
 
    ASSERT(oldval > 0);
 
@@ -360,6 +376,120 @@ int create_new_kernel_tid(void)
    return -1;
 }
 
+void sched_get_cpu_ticks(struct sched_cpu_ticks *t)
+{
+   ulong var;
+
+   /* The counters are updated by the timer IRQ handler */
+   disable_interrupts(&var);
+   {
+      *t = cpu_ticks;
+   }
+   enable_interrupts(&var);
+}
+
+int sched_get_runnable_count(void)
+{
+   return runnable_tasks_count;
+}
+
+void sched_get_loadavg(ulong loads[3])
+{
+   ulong var;
+
+   /* The load averages are updated by the timer IRQ handler */
+   disable_interrupts(&var);
+   {
+      for (int i = 0; i < 3; i++)
+         loads[i] = loadavg[i];
+   }
+   enable_interrupts(&var);
+}
+
+static void sched_update_loadavg(void)
+{
+   struct task *curr = get_curr_task();
+   ulong active = (ulong)runnable_tasks_count;
+   ulong var;
+
+   /*
+    * The idle task never sleeps: when it's not running, it's in the runnable
+    * list, taking the place of the running task, which is not in the list.
+    * Therefore, `runnable_tasks_count` is exactly the number of active tasks,
+    * unless the current task is about to sleep.
+    */
+   if (curr != idle_task && get_curr_task_state() != TASK_STATE_RUNNING)
+      active = active > 0 ? active - 1 : 0;
+
+   active *= LOADAVG_FIXED_1;
+
+   disable_interrupts(&var);
+   {
+      for (int i = 0; i < 3; i++) {
+
+         const ulong e = loadavg_exp[i];
+         u64 val = (u64)loadavg[i] * e + (u64)active * (LOADAVG_FIXED_1 - e);
+
+         /* Round up when the load is increasing, like Linux does */
+         if (active >= loadavg[i])
+            val += LOADAVG_FIXED_1 - 1;
+
+         loadavg[i] = (ulong)(val >> LOADAVG_FSHIFT);
+      }
+   }
+   enable_interrupts(&var);
+}
+
+/*
+ * Charge the TSC cycles since the last update to the user or the kernel time
+ * of `ti`, depending on where it's running. Called at each user/kernel
+ * transition (before changing `running_in_kernel`) and context switch.
+ */
+void sched_account_cpu_time(struct task *ti)
+{
+   const u64 now = RDTSC();
+   const u64 delta = ti->acct_ts ? now - ti->acct_ts : 0;
+
+   ASSERT(!is_preemption_enabled());
+
+   if (ti->running_in_kernel)
+      ti->ru.stime += delta;
+   else
+      ti->ru.utime += delta;
+
+   ti->acct_ts = now;
+}
+
+void sched_account_task_switch(struct task *prev, struct task *next)
+{
+   ASSERT(!is_preemption_enabled());
+   sched_account_cpu_time(prev);
+
+   /*
+    * Like on Linux, a switch is involuntary when the previous task could
+    * still run: it has been preempted or it yielded.
+    */
+   if (prev->state == TASK_STATE_RUNNABLE)
+      prev->ru.nivcsw++;
+   else
+      prev->ru.nvcsw++;
+
+   next->acct_ts = RDTSC();
+}
+
+void sched_get_rusage(struct task *ti, struct sched_rusage *ru)
+{
+   disable_preemption();
+   {
+      /* Include the time since the last update, if `ti` is running */
+      if (ti == get_curr_task())
+         sched_account_cpu_time(ti);
+
+      *ru = ti->ru;
+   }
+   enable_preemption();
+}
+
 int iterate_over_tasks(bintree_visit_cb func, void *arg)
 {
    ASSERT(!is_preemption_enabled());
@@ -458,6 +588,7 @@ void init_sched(void)
 void set_current_task_in_kernel(void)
 {
    ASSERT(!is_preemption_enabled());
+   sched_account_cpu_time(get_curr_task());
    get_curr_task()->running_in_kernel = true;
 }
 
@@ -519,6 +650,24 @@ static void task_remove_from_state_list(struct task *ti)
    }
 }
 
+#if KRN_SCHED_LAT_STATS
+
+static void
+task_change_state_lat(struct task *ti, enum task_state new_state)
+{
+   const enum task_state old_state = ti->state;
+
+   if (ti == idle_task)
+      return;
+
+   if (new_state == TASK_STATE_RUNNABLE)
+      sched_lat_on_runnable(ti, old_state == TASK_STATE_SLEEPING);
+   else if (new_state == TASK_STATE_RUNNING)
+      sched_lat_on_running(ti, get_curr_task());
+}
+
+#endif
+
 void task_change_state(struct task *ti, enum task_state new_state)
 {
    ulong var;
@@ -528,6 +677,7 @@ void task_change_state(struct task *ti, enum task_state new_state)
 
    disable_interrupts(&var);
    {
+      SCHED_LAT_ONLY(task_change_state_lat(ti, new_state));
       task_remove_from_state_list(ti);
       ti->state = new_state;
       task_add_to_state_list(ti);
@@ -585,6 +735,18 @@ void sched_account_ticks(void)
    if (curr->running_in_kernel)
       t->total_kernel++;
 
+   if (curr == idle_task)
+      cpu_ticks.idle++;
+   else if (curr->running_in_kernel)
+      cpu_ticks.kernel++;
+   else
+      cpu_ticks.user++;
+
+   if (++loadavg_ticks == LOADAVG_FREQ) {
+      loadavg_ticks = 0;
+      sched_update_loadavg();
+   }
+
    if (curr->stopped                                 ||
        state != TASK_STATE_RUNNING                   ||
          (!runner && t->timeslice >= TIME_SLICE_TICKS)
@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/sched_lat.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/interrupts.h>
+
+const char *sched_lat_get_reason_str(struct sched_lat_worst *w)
+{
+   /*
+    * The IRQ handlers run with preemption disabled: the woken task could run
+    * only after the IRQ handler returned, even if it had the priority.
+    */
+   if (w->in_irq)
+      return "irq";
+
+   if (w->preempt_count > 0)
+      return "preempt-disabled";
+
+   return "none";
+}
+
+#if KRN_SCHED_LAT_STATS
+
+static struct sched_lat_stats lat_stats;
+
+static void
+sched_lat_hist_add(struct sched_lat_hist *h, u64 cycles)
+{
+   u32 bucket = 0;
+
+   if (cycles)
+      bucket = MIN((u32)(63 - __builtin_clzll(cycles)),
+                   SCHED_LAT_HIST_SIZE - 1u);
+
+   h->count++;
+   h->tot += cycles;
+   h->max = MAX(h->max, cycles);
+   h->hist[bucket]++;
+}
+
+void sched_lat_on_runnable(struct task *ti, bool was_sleeping)
+{
+   struct sched_lat_task *lt = &ti->lat;
+   const u64 now = RDTSC();
+
+   lt->runnable_ts = now;
+   lt->was_sleeping = was_sleeping;
+
+   if (was_sleeping) {
+      lt->waker_tid = get_curr_tid();
+      lt->preempt_count = (u16)MIN(get_preempt_disable_count(), 0xffff);
+      lt->in_irq = in_irq();
+   }
+}
+
+void sched_lat_on_running(struct task *ti, struct task *prev)
+{
+   struct sched_lat_task *lt = &ti->lat;
+   const u64 now = RDTSC();
+   u64 lat;
+
+   if (!lt->runnable_ts)
+      return; /* e.g. a new task, added directly as runnable */
+
+   lat = now - lt->runnable_ts;
+   lt->runnable_ts = 0;
+   sched_lat_hist_add(&lat_stats.runq, lat);
+
+   if (!lt->was_sleeping)
+      return;
+
+   lt->was_sleeping = false;
+   sched_lat_hist_add(&lat_stats.wakeup, lat);
+
+   if (lat > lat_stats.worst.latency) {
+      lat_stats.worst = (struct sched_lat_worst) {
+         .latency = lat,
+         .tid = ti->tid,
+         .waker_tid = lt->waker_tid,
+         .prev_tid = prev->tid,
+         .preempt_count = lt->preempt_count,
+         .in_irq = lt->in_irq,
+      };
+   }
+}
+
+void sched_lat_get_stats(struct sched_lat_stats *s)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      *s = lat_stats;
+   }
+   enable_interrupts(&var);
+}
+
+void sched_lat_reset(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      bzero(&lat_stats, sizeof(lat_stats));
+   }
+   enable_interrupts(&var);
+}
+
+#endif // #if KRN_SCHED_LAT_STATS
@@ -130,6 +130,7 @@ static const action_type signal_default_actions[_NSIG] =
    [SIGTRAP] = action_terminate,
 
    [SIGURG] = action_ignore,
+   [SIGWINCH] = action_ignore,
 
    [SIGVTALRM] = action_terminate,
    [SIGXCPU] = action_terminate,
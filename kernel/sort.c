@@ -51,6 +51,63 @@ insertion_sort_generic(void *a, ulong elem_size, u32 elem_count, cmpfun_ptr cmp)
    }
 }
 
+static ALWAYS_INLINE void
+swap_elems(void *a, void *b, ulong elem_size)
+{
+   char *x = a, *y = b, tmp;
+
+   for (ulong i = 0; i < elem_size; i++) {
+      tmp = x[i];
+      x[i] = y[i];
+      y[i] = tmp;
+   }
+}
+
+static void
+heap_sift_down(void *a, ulong elem_size, u32 root, u32 end, cmpfun_ptr cmp)
+{
+   u32 child;
+
+   while ((child = 2 * root + 1) < end) {
+
+      /* Pick the biggest child */
+      if (child + 1 < end &&
+          cmp(a + child * elem_size, a + (child + 1) * elem_size) < 0)
+      {
+         child++;
+      }
+
+      if (cmp(a + root * elem_size, a + child * elem_size) >= 0)
+         break;
+
+      swap_elems(a + root * elem_size, a + child * elem_size, elem_size);
+      root = child;
+   }
+}
+
+/*
+ * Generic heap sort implementation for objects of size 'elem_size'. Unlike
+ * insertion_sort_generic(), it's O(n log n) in the worst case and it's not
+ * stable.
+ */
+
+void
+heap_sort_generic(void *a, ulong elem_size, u32 elem_count, cmpfun_ptr cmp)
+{
+   if (elem_count < 2)
+      return;
+
+   /* Build a max-heap */
+   for (u32 i = elem_count / 2; i > 0; i--)
+      heap_sift_down(a, elem_size, i - 1, elem_count, cmp);
+
+   /* Move the max at the end, one by one */
+   for (u32 end = elem_count - 1; end > 0; end--) {
+      swap_elems(a, a + end * elem_size, elem_size);
+      heap_sift_down(a, elem_size, 0, end, cmp);
+   }
+}
+
 /* Reverse an array of pointer-sized elements */
 
 void
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/atomics.h>
+
+#include <tilck/kernel/spsc_ringbuf.h>
+
+void spsc_ringbuf_init(struct spsc_ringbuf *rb, u32 size, void *buf)
+{
+   ASSERT(size > 0 && (size & (size - 1)) == 0);
+
+   bzero(rb, sizeof(*rb));
+   rb->size = size;
+   rb->buf = buf;
+}
+
+bool spsc_ringbuf_is_empty(struct spsc_ringbuf *rb)
+{
+   const u32 r = atomic_load_explicit(&rb->read_pos, mo_relaxed);
+   const u32 w = atomic_load_explicit(&rb->write_pos, mo_acquire);
+   return r == w;
+}
+
+bool spsc_ringbuf_write_1(struct spsc_ringbuf *rb, u8 val)
+{
+   const u32 w = atomic_load_explicit(&rb->write_pos, mo_relaxed);
+   const u32 r = atomic_load_explicit(&rb->read_pos, mo_acquire);
+
+   if (w - r == rb->size) {
+      rb->dropped++;
+      return false;
+   }
+
+   rb->buf[w & (rb->size - 1)] = val;
+
+   /* Publish the byte: the consumer reads `write_pos` with mo_acquire */
+   atomic_store_explicit(&rb->write_pos, w + 1, mo_release);
+   rb->written++;
+   return true;
+}
+
+u32 spsc_ringbuf_read(struct spsc_ringbuf *rb, void *buf, u32 len)
+{
+   const u32 r = atomic_load_explicit(&rb->read_pos, mo_relaxed);
+   const u32 w = atomic_load_explicit(&rb->write_pos, mo_acquire);
+   const u32 mask = rb->size - 1;
+   const u32 n = MIN(len, w - r);
+   const u32 n1 = MIN(n, rb->size - (r & mask));
+
+   if (!n)
+      return 0;
+
+   /* At most two chunks: up to the end of `buf` and from its beginning */
+   memcpy(buf, rb->buf + (r & mask), n1);
+   memcpy((u8 *)buf + n1, rb->buf, n - n1);
+
+   /* Release the slots only after having copied the data out of them */
+   atomic_store_explicit(&rb->read_pos, r + n, mo_release);
+   rb->batches++;
+   return n;
+}
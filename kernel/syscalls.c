@@ -164,28 +164,30 @@ int sys_kill(int pid, int sig)
 ulong sys_times(struct tms *user_buf)
 {
    struct task *curr = get_curr_task();
+   struct sched_rusage ru, cru;
    struct tms buf;
+   u32 cmaxrss;
 
    // TODO (threads): when threads are supported, update sys_times()
-   // TODO: consider supporting tms_cutime and tms_cstime in sys_times()
+   sched_get_rusage(curr, &ru);
 
    disable_preemption();
    {
-
-      buf = (struct tms) {
-         .tms_utime = (clock_t) curr->ticks.total,
-         .tms_stime = (clock_t) curr->ticks.total_kernel,
-         .tms_cutime = 0,
-         .tms_cstime = 0,
-      };
-
+      process_get_children_rusage(curr->pi, &cru, &cmaxrss);
    }
    enable_preemption();
 
+   buf = (struct tms) {
+      .tms_utime = (clock_t) ns_to_clock_t(tsc_to_ns(ru.utime)),
+      .tms_stime = (clock_t) ns_to_clock_t(tsc_to_ns(ru.stime)),
+      .tms_cutime = (clock_t) ns_to_clock_t(tsc_to_ns(cru.utime)),
+      .tms_cstime = (clock_t) ns_to_clock_t(tsc_to_ns(cru.stime)),
+   };
+
    if (copy_to_user(user_buf, &buf, sizeof(buf)) != 0)
       return (ulong) -EBADF;
 
-   return (ulong) get_ticks();
+   return (ulong) ticks_to_clock_t(get_ticks());
 }
 
 int sys_fork(void)
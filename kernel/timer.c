@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
 #include <tilck_gen_headers/config_debug.h>
+#include <tilck_gen_headers/mod_tracing.h>
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
@@ -14,6 +15,8 @@
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/datetime.h>
 
+#include <tilck/mods/profiler.h>
+
 /* Jiffies */
 static u64 __ticks;        /* ticks since the timer started */
 
@@ -33,6 +36,7 @@ volatile ATOMIC(u32) __bogo_loops;
 static struct list timer_wakeup_list = STATIC_LIST_INIT(timer_wakeup_list);
 static u32 loops_per_tick;        /* Tilck bogoMips expressed as loops/tick */
 static u32 loops_per_us = 5000;   /* loops/microsecond (initial value) */
+static u32 tsc_khz;               /* TSC freq., measured with the bogoMips */
 
 u64 get_ticks(void)
 {
@@ -47,6 +51,22 @@ u64 get_ticks(void)
    return curr_ticks;
 }
 
+u32 get_tsc_khz(void)
+{
+   return tsc_khz;
+}
+
+u64 tsc_to_ns(u64 cycles)
+{
+   const u32 khz = tsc_khz;
+
+   if (!khz)
+      return 0;
+
+   /* Split the conversion in two steps to avoid overflow in `cycles * M` */
+   return cycles / khz * MILLION + cycles % khz * MILLION / khz;
+}
+
 void task_set_wakeup_timer(struct task *ti, u32 ticks)
 {
    ulong var;
@@ -298,6 +318,10 @@ static enum irq_action timer_irq_handler(void *ctx)
    enable_interrupts_forced();
 
    sched_account_ticks();
+
+   if (MOD_tracing && prof_is_enabled())
+      prof_timer_tick();
+
    tick_all_timers();
    return IRQ_HANDLED;
 }
@@ -311,6 +335,7 @@ struct bogo_measure_ctx {
    bool started;
    bool pass_start;
    u32 ticks;
+   u64 tsc_start;
 };
 
 static enum irq_action measure_bogomips_irq_handler(void *arg)
@@ -332,6 +357,7 @@ static enum irq_action measure_bogomips_irq_handler(void *arg)
        * from now, when the timer IRQ just arrived.
        */
       __bogo_loops = 0;
+      ctx->tsc_start = RDTSC();
       ctx->pass_start = true;
       return IRQ_NOT_HANDLED;
    }
@@ -342,6 +368,15 @@ static enum irq_action measure_bogomips_irq_handler(void *arg)
       /* We're done */
       irq_uninstall_handler(X86_PC_TIMER_IRQ, &measure_bogomips);
 
+      /*
+       * Measure the TSC frequency over the same ticks. Note: use the actual
+       * duration of a tick, which is not exactly TS_SCALE / TIMER_HZ.
+       */
+      tsc_khz = (u32)(
+         (RDTSC() - ctx->tsc_start) / MEASURE_BOGOMIPS_TICKS
+            * MILLION / __tick_duration
+      );
+
       disable_interrupts_forced();
       {
          loops_per_tick = __bogo_loops * BOGOMIPS_CONST/MEASURE_BOGOMIPS_TICKS;
@@ -367,6 +402,7 @@ static void do_bogomips_loop(void *arg)
    }
    enable_preemption();
    printk("Tilck bogoMips: %u\n", loops_per_us);
+   printk("TSC frequency: %u kHz\n", tsc_khz);
 }
 
 void delay_us(u32 us)
@@ -0,0 +1,687 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/ringbuf.h>
+#include <tilck/kernel/signal.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/user.h>
+
+#include <linux/major.h> // system header
+#include <sys/ioctl.h>    // system header
+
+#include "tty_int.h"
+
+/*
+ * UNIX98 pseudo-terminals. Every open() of /dev/ptmx allocates a free pty
+ * and returns its master side, while the slave side is /dev/pts/N.
+ *
+ * The slave is a regular struct tty, with its line discipline, termios and
+ * job control: what's written on the master is fed to the slave's input
+ * exactly like keypresses on a video tty. The slave's term is the pty itself:
+ * its output (echo included) is written into `out_rb`, from where it's read
+ * by the master side.
+ *
+ * Because devfs cannot remove files, the /dev/pts/N files and the pty slots
+ * are fixed (MAX_PTYS). Slots are allocated on first use and never freed,
+ * only recycled: that keeps valid any `proc_tty` pointers to a slave whose
+ * master has been closed.
+ */
+
+#define PTY_OUT_BUF_SIZE                   PAGE_SIZE
+#define PTY_DEFAULT_ROWS                          25
+#define PTY_DEFAULT_COLS                          80
+
+struct pty {
+
+   int num;
+   struct tty *slave;
+
+   char *out_buf;
+   struct ringbuf out_rb;        /* slave output, read by the master */
+   struct kcond out_rcond;       /* signal when we can read from out_rb */
+   struct kcond out_wcond;       /* signal when we can write to out_rb */
+
+   int master_refs;
+   int slave_refs;
+   bool in_use;
+   bool locked;                  /* see TIOCSPTLCK */
+   bool slave_opened;
+};
+
+/* The master's per-handle extra data */
+struct ptmx_handle_extra {
+   struct pty *pty;
+};
+
+STATIC_ASSERT(sizeof(struct ptmx_handle_extra) <= DEVFS_EXTRA_SIZE);
+
+static struct pty *ptys[MAX_PTYS];
+static struct kmutex ptys_mutex = STATIC_KMUTEX_INIT(ptys_mutex, 0);
+
+/* ---------------------- The pty term interface ---------------------- */
+
+/*
+ * Writes `len` bytes of the slave's output into `out_rb`, applying ONLCR.
+ * Never blocks: returns the number of bytes of `buf` actually written.
+ * Must be called with preemption disabled.
+ */
+static size_t
+pty_out_write(struct pty *p, const char *buf, size_t len)
+{
+   const tcflag_t oflag = p->slave->c_term.c_oflag;
+   struct ringbuf *rb = &p->out_rb;
+   size_t i;
+
+   ASSERT(!is_preemption_enabled());
+
+   if ((oflag & (OPOST | ONLCR)) != (OPOST | ONLCR))
+      return ringbuf_write_bytes(rb, (u8 *)buf, len);
+
+   for (i = 0; i < len; i++) {
+
+      if (buf[i] == '\n') {
+
+         if (rb->max_elems - rb->elems < 2)
+            break;
+
+         ringbuf_write_elem1(rb, '\r');
+      }
+
+      if (!ringbuf_write_elem1(rb, (u8)buf[i]))
+         break;
+   }
+
+   return i;
+}
+
+static enum term_type pty_term_get_type(void)
+{
+   return term_type_pty;
+}
+
+static bool pty_term_is_initialized(term *t)
+{
+   return true;
+}
+
+static void pty_term_get_params(term *t, struct term_params *out)
+{
+   *out = (struct term_params) {
+      .rows = PTY_DEFAULT_ROWS,
+      .cols = PTY_DEFAULT_COLS,
+      .type = term_type_pty,
+      .vi = NULL,
+   };
+}
+
+/*
+ * Used by the echo of the slave's input and by printk() on the current tty:
+ * it cannot block and data not fitting in `out_rb` is dropped.
+ */
+static void pty_term_write(term *t, const char *buf, size_t len, u8 color)
+{
+   struct pty *p = t;
+
+   disable_preemption();
+   {
+      if (pty_out_write(p, buf, len))
+         kcond_signal_all(&p->out_rcond);
+   }
+   enable_preemption();
+}
+
+static void pty_term_no_op(term *t) { }
+static void pty_term_no_op_u32(term *t, u32 val) { }
+static void pty_term_no_op_int(term *t, int val) { }
+
+static void
+pty_term_set_filter(term *t, term_filter func, void *ctx, bool passthrough)
+{
+   /* The pty has no console: no filters, just bytes */
+}
+
+static const struct term_interface pty_term_intf = {
+
+   .get_type = pty_term_get_type,
+   .is_initialized = pty_term_is_initialized,
+   .get_params = pty_term_get_params,
+
+   .write = pty_term_write,
+   .scroll_up = pty_term_no_op_u32,
+   .scroll_down = pty_term_no_op_u32,
+   .set_col_offset = pty_term_no_op_int,
+   .pause_video_output = pty_term_no_op,
+   .restart_video_output = pty_term_no_op,
+   .set_filter = pty_term_set_filter,
+
+   /* The pty and its slave tty are never freed, see the comment on top */
+   .free = pty_term_no_op,
+   .dispose = pty_term_no_op,
+};
+
+/* ---------------------- Slot management ---------------------- */
+
+static struct pty *pty_alloc_slot(int num)
+{
+   struct pty *p;
+
+   if (!(p = kzalloc_obj(struct pty)))
+      return NULL;
+
+   if (!(p->out_buf = kmalloc(PTY_OUT_BUF_SIZE))) {
+      kfree_obj(p, struct pty);
+      return NULL;
+   }
+
+   p->num = num;
+   p->slave = create_tty_for_term((u16)num, p, &pty_term_intf);
+
+   if (!p->slave) {
+      kfree2(p->out_buf, PTY_OUT_BUF_SIZE);
+      kfree_obj(p, struct pty);
+      return NULL;
+   }
+
+   snprintk(p->slave->dev_filename, sizeof(p->slave->dev_filename),
+            "pts/%d", num);
+
+   p->slave->pty = p;
+   ringbuf_init(&p->out_rb, PTY_OUT_BUF_SIZE, 1, p->out_buf);
+   kcond_init(&p->out_rcond);
+   kcond_init(&p->out_wcond);
+   return p;
+}
+
+/* Brings a recycled slot back to the state of a brand new pty */
+static void pty_reset_slot(struct pty *p)
+{
+   struct tty *t = p->slave;
+
+   tty_reset_termios(t);
+   tty_update_ctrl_handlers(t);
+   tty_inbuf_reset(t);
+   t->tintf->get_params(t->tstate, &t->tparams);
+
+   disable_preemption();
+   {
+      ringbuf_reset(&p->out_rb);
+      t->hung_up = false;
+      t->fg_pgid = 0;
+   }
+   enable_preemption();
+
+   p->locked = true;
+   p->slave_opened = false;
+   p->master_refs = 1;
+   p->slave_refs = 0;
+   p->in_use = true;
+}
+
+static struct pty *pty_get_new(void)
+{
+   struct pty *p = NULL;
+
+   kmutex_lock(&ptys_mutex);
+   {
+      for (int i = 0; i < MAX_PTYS; i++) {
+
+         if (ptys[i] && ptys[i]->in_use)
+            continue;
+
+         if (!ptys[i] && !(ptys[i] = pty_alloc_slot(i)))
+            break;
+
+         p = ptys[i];
+         pty_reset_slot(p);
+         break;
+      }
+   }
+   kmutex_unlock(&ptys_mutex);
+   return p;
+}
+
+/* Called holding `ptys_mutex` */
+static void pty_hangup(struct pty *p)
+{
+   struct tty *t = p->slave;
+
+   disable_preemption();
+   {
+      t->hung_up = true;
+      kcond_signal_all(&t->input_cond);
+      kcond_signal_all(&t->output_cond);
+      kcond_signal_all(&p->out_wcond);
+   }
+   enable_preemption();
+
+   if (t->fg_pgid)
+      send_signal_to_group(t->fg_pgid, SIGHUP);
+}
+
+/* Called holding `ptys_mutex` */
+static void pty_put_if_unused(struct pty *p)
+{
+   if (!p->master_refs && !p->slave_refs)
+      p->in_use = false;
+}
+
+/* ---------------------- The master side ---------------------- */
+
+static ALWAYS_INLINE struct pty *ptmx_get_pty(fs_handle h)
+{
+   struct devfs_handle *dh = h;
+   return ((struct ptmx_handle_extra *)(void *)dh->extra)->pty;
+}
+
+static ssize_t ptmx_read(fs_handle h, char *buf, size_t size)
+{
+   struct devfs_handle *dh = h;
+   struct pty *p = ptmx_get_pty(h);
+   size_t n;
+
+   if (!size)
+      return 0;
+
+   while (true) {
+
+      disable_preemption();
+      {
+         n = ringbuf_read_bytes(&p->out_rb, (u8 *)buf, size);
+
+         if (n)
+            kcond_signal_all(&p->out_wcond);
+      }
+      enable_preemption();
+
+      if (n)
+         return (ssize_t)n;
+
+      if (p->slave_opened && !p->slave_refs)
+         return -EIO; /* Like on Linux: all the slave's handles got closed */
+
+      if (dh->fl_flags & O_NONBLOCK)
+         return -EAGAIN;
+
+      kcond_wait(&p->out_rcond, NULL, TIME_SLICE_TICKS);
+
+      if (pending_signals())
+         return -EINTR;
+   }
+}
+
+static inline bool pty_slave_inbuf_is_full(struct tty *t)
+{
+   bool ret;
+   disable_preemption();
+   {
+      ret = ringbuf_is_full(&t->input_ringbuf);
+   }
+   enable_preemption();
+   return ret;
+}
+
+static ssize_t ptmx_write(fs_handle h, char *buf, size_t size)
+{
+   struct devfs_handle *dh = h;
+   struct pty *p = ptmx_get_pty(h);
+   struct tty *t = p->slave;
+   size_t i = 0;
+
+   while (i < size) {
+
+      if (pty_slave_inbuf_is_full(t)) {
+
+         if (dh->fl_flags & O_NONBLOCK)
+            return i ? (ssize_t)i : -EAGAIN;
+
+         /* Wake up the readers and wait for them to consume some input */
+         kcond_signal_all(&t->input_cond);
+         kcond_wait(&t->output_cond, NULL, TIME_SLICE_TICKS);
+
+         if (pending_signals())
+            return i ? (ssize_t)i : -EINTR;
+
+         continue;
+      }
+
+      tty_send_keyevent(t, make_key_event(0, buf[i], true), false);
+      i++;
+   }
+
+   return (ssize_t)size;
+}
+
+static int ptmx_ioctl(fs_handle h, ulong request, void *argp)
+{
+   struct pty *p = ptmx_get_pty(h);
+   int val;
+
+   switch (request) {
+
+      case TIOCGPTN:
+
+         val = p->num;
+
+         if (copy_to_user(argp, &val, sizeof(val)))
+            return -EFAULT;
+
+         return 0;
+
+      case TIOCSPTLCK:
+
+         if (copy_from_user(&val, argp, sizeof(val)))
+            return -EFAULT;
+
+         p->locked = !!val;
+         return 0;
+
+      case TIOCGPTLCK:
+
+         val = p->locked;
+
+         if (copy_to_user(argp, &val, sizeof(val)))
+            return -EFAULT;
+
+         return 0;
+
+      default:
+         /* termios, window size etc. are the slave's ones */
+         return tty_ioctl_int(p->slave, h, request, argp);
+   }
+}
+
+static int ptmx_read_ready(fs_handle h)
+{
+   struct pty *p = ptmx_get_pty(h);
+   bool ret;
+
+   disable_preemption();
+   {
+      ret = !ringbuf_is_empty(&p->out_rb) ||
+            (p->slave_opened && !p->slave_refs);
+   }
+   enable_preemption();
+   return ret;
+}
+
+static struct kcond *ptmx_get_rready_cond(fs_handle h)
+{
+   return &ptmx_get_pty(h)->out_rcond;
+}
+
+static int ptmx_write_ready(fs_handle h)
+{
+   return !pty_slave_inbuf_is_full(ptmx_get_pty(h)->slave);
+}
+
+static struct kcond *ptmx_get_wready_cond(fs_handle h)
+{
+   return &ptmx_get_pty(h)->slave->output_cond;
+}
+
+static int ptmx_create_extra(int minor, void *extra)
+{
+   struct ptmx_handle_extra *eh = extra;
+
+   if (!(eh->pty = pty_get_new()))
+      return -ENOSPC;
+
+   return 0;
+}
+
+static int ptmx_on_dup_extra(int minor, void *extra)
+{
+   struct ptmx_handle_extra *eh = extra;
+
+   kmutex_lock(&ptys_mutex);
+   {
+      eh->pty->master_refs++;
+   }
+   kmutex_unlock(&ptys_mutex);
+   return 0;
+}
+
+static void ptmx_destroy_extra(int minor, void *extra)
+{
+   struct ptmx_handle_extra *eh = extra;
+   struct pty *p = eh->pty;
+
+   kmutex_lock(&ptys_mutex);
+   {
+      ASSERT(p->master_refs > 0);
+
+      if (!--p->master_refs) {
+         pty_hangup(p);
+         pty_put_if_unused(p);
+      }
+   }
+   kmutex_unlock(&ptys_mutex);
+}
+
+int
+ptmx_create_device_file(int minor,
+                        enum vfs_entry_type *type,
+                        struct devfs_file_info *nfo)
+{
+   static const struct file_ops static_ops_ptmx = {
+
+      .read = ptmx_read,
+      .write = ptmx_write,
+      .ioctl = ptmx_ioctl,
+      .read_ready = ptmx_read_ready,
+      .write_ready = ptmx_write_ready,
+      .get_rready_cond = ptmx_get_rready_cond,
+      .get_wready_cond = ptmx_get_wready_cond,
+   };
+
+   *type = VFS_CHAR_DEV;
+   nfo->fops = &static_ops_ptmx;
+   nfo->create_extra = &ptmx_create_extra;
+   nfo->destroy_extra = &ptmx_destroy_extra;
+   nfo->on_dup_extra = &ptmx_on_dup_extra;
+   return 0;
+}
+
+/* ---------------------- The slave side ---------------------- */
+
+ssize_t
+pty_slave_write(struct tty *t, struct devfs_handle *h, char *buf, size_t size)
+{
+   struct pty *p = t->pty;
+   size_t written = 0, n;
+
+   while (written < size) {
+
+      if (t->hung_up)
+         return written ? (ssize_t)written : -EIO;
+
+      disable_preemption();
+      {
+         if ((n = pty_out_write(p, buf + written, size - written)))
+            kcond_signal_all(&p->out_rcond);
+      }
+      enable_preemption();
+
+      if (n) {
+         written += n;
+         continue;
+      }
+
+      if (h->fl_flags & O_NONBLOCK)
+         return written ? (ssize_t)written : -EAGAIN;
+
+      kcond_wait(&p->out_wcond, NULL, TIME_SLICE_TICKS);
+
+      if (pending_signals())
+         return written ? (ssize_t)written : -EINTR;
+   }
+
+   return (ssize_t)written;
+}
+
+static ALWAYS_INLINE struct tty *pts_get_tty(fs_handle h)
+{
+   struct devfs_handle *dh = h;
+   return ptys[dh->file->dev_minor]->slave;
+}
+
+static ssize_t pts_read(fs_handle h, char *buf, size_t size)
+{
+   return tty_read_int(pts_get_tty(h), h, buf, size);
+}
+
+static ssize_t pts_write(fs_handle h, char *buf, size_t size)
+{
+   return tty_write_int(pts_get_tty(h), h, buf, size);
+}
+
+static int pts_ioctl(fs_handle h, ulong request, void *argp)
+{
+   return tty_ioctl_int(pts_get_tty(h), h, request, argp);
+}
+
+static int pts_read_ready(fs_handle h)
+{
+   return tty_read_ready_int(pts_get_tty(h), h);
+}
+
+static struct kcond *pts_get_rready_cond(fs_handle h)
+{
+   return &pts_get_tty(h)->input_cond;
+}
+
+static int pts_write_ready(fs_handle h)
+{
+   struct tty *t = pts_get_tty(h);
+   bool ret;
+
+   disable_preemption();
+   {
+      ret = !ringbuf_is_full(&t->pty->out_rb) || t->hung_up;
+   }
+   enable_preemption();
+   return ret;
+}
+
+static struct kcond *pts_get_wready_cond(fs_handle h)
+{
+   return &pts_get_tty(h)->pty->out_wcond;
+}
+
+static int pts_create_extra(int minor, void *extra)
+{
+   struct pty *p;
+   int rc = 0;
+
+   kmutex_lock(&ptys_mutex);
+   {
+      p = ptys[minor];
+
+      if (!p || !p->in_use || !p->master_refs || p->locked) {
+         rc = -EIO;
+         goto out;
+      }
+
+      if (!(rc = tty_create_extra(minor, extra))) {
+         p->slave_refs++;
+         p->slave_opened = true;
+      }
+
+   out:;
+   }
+   kmutex_unlock(&ptys_mutex);
+   return rc;
+}
+
+static int pts_on_dup_extra(int minor, void *extra)
+{
+   int rc;
+
+   kmutex_lock(&ptys_mutex);
+   {
+      if (!(rc = tty_on_dup_extra(minor, extra)))
+         ptys[minor]->slave_refs++;
+   }
+   kmutex_unlock(&ptys_mutex);
+   return rc;
+}
+
+static void pts_destroy_extra(int minor, void *extra)
+{
+   struct pty *p;
+
+   tty_destroy_extra(minor, extra);
+
+   kmutex_lock(&ptys_mutex);
+   {
+      p = ptys[minor];
+      ASSERT(p->slave_refs > 0);
+
+      if (!--p->slave_refs) {
+
+         /* Wake up the master's readers: they'll get EIO */
+         disable_preemption();
+         {
+            kcond_signal_all(&p->out_rcond);
+         }
+         enable_preemption();
+         pty_put_if_unused(p);
+      }
+   }
+   kmutex_unlock(&ptys_mutex);
+}
+
+static int
+pts_create_device_file(int minor,
+                       enum vfs_entry_type *type,
+                       struct devfs_file_info *nfo)
+{
+   static const struct file_ops static_ops_pts = {
+
+      .read = pts_read,
+      .write = pts_write,
+      .ioctl = pts_ioctl,
+      .read_ready = pts_read_ready,
+      .write_ready = pts_write_ready,
+      .get_rready_cond = pts_get_rready_cond,
+      .get_wready_cond = pts_get_wready_cond,
+   };
+
+   *type = VFS_CHAR_DEV;
+   nfo->fops = &static_ops_pts;
+   nfo->create_extra = &pts_create_extra;
+   nfo->destroy_extra = &pts_destroy_extra;
+   nfo->on_dup_extra = &pts_on_dup_extra;
+   return 0;
+}
+
+/*
+ * Registers the driver for the slaves and creates the /dev/pts/N files.
+ * /dev/ptmx is created by init_ttyaux(), since it belongs to TTYAUX_MAJOR.
+ */
+void init_pty(void)
+{
+   static char names[MAX_PTYS][8];
+   struct driver_info *di = kzalloc_obj(struct driver_info);
+
+   if (!di)
+      panic("PTY: no enough memory for struct driver_info");
+
+   di->name = "pts";
+   di->create_dev_file = pts_create_device_file;
+   register_driver(di, UNIX98_PTY_SLAVE_MAJOR);
+
+   for (u16 i = 0; i < MAX_PTYS; i++) {
+      snprintk(names[i], sizeof(names[i]), "pts/%d", i);
+      tty_create_devfile_or_panic(names[i], UNIX98_PTY_SLAVE_MAJOR, i, NULL);
+   }
+}
@@ -153,7 +153,7 @@ static void init_tty_struct(struct tty *t, u16 minor, u16 serial_port_fwd)
    t->curr_color = make_color(DEFAULT_FG_COLOR, DEFAULT_BG_COLOR);
    tty_reset_termios(t);
 
-   if (MOD_console && !serial_port_fwd)
+   if (MOD_console && t->console_data)
       reset_console_data(t);
 }
 
@@ -162,6 +162,13 @@ int tty_get_num(struct tty *t)
    return t->minor;
 }
 
+/* The device number of `t`, encoded like `tty_nr` in /proc/PID/stat [Linux] */
+int tty_get_dev_nr(struct tty *t)
+{
+   const int major = t->pty ? UNIX98_PTY_SLAVE_MAJOR : TTY_MAJOR;
+   return (t->minor & 0xff) | (major << 8) | ((t->minor & ~0xff) << 12);
+}
+
 void
 tty_create_devfile_or_panic(const char *filename,
                             u16 major,
@@ -214,7 +221,7 @@ tty_allocate_and_init_new_serial_term(u16 serial_port_fwd)
    return new_term;
 }
 
-static void
+void
 tty_full_destroy(struct tty *t)
 {
    if (t->tstate) {
@@ -233,11 +240,9 @@ tty_full_destroy(struct tty *t)
 
 
 static struct tty *
-allocate_and_init_tty(u16 minor, u16 serial_port_fwd, int rows_buf)
+allocate_tty_struct(u16 minor, u16 serial_port_fwd, bool console)
 {
    struct tty *t;
-   term *new_term = get_curr_term();
-   const struct term_interface *new_term_intf;
 
    if (!(t = kzalloc_obj(struct tty)))
       return NULL;
@@ -252,7 +257,7 @@ allocate_and_init_tty(u16 minor, u16 serial_port_fwd, int rows_buf)
       return NULL;
    }
 
-   if (MOD_console && !serial_port_fwd) {
+   if (MOD_console && console) {
       if (!(t->console_data = alloc_console_data())) {
          tty_full_destroy(t);
          return NULL;
@@ -260,6 +265,19 @@ allocate_and_init_tty(u16 minor, u16 serial_port_fwd, int rows_buf)
    }
 
    init_tty_struct(t, minor, serial_port_fwd);
+   return t;
+}
+
+static struct tty *
+allocate_and_init_tty(u16 minor, u16 serial_port_fwd, int rows_buf)
+{
+   struct tty *t;
+   term *new_term = get_curr_term();
+   const struct term_interface *new_term_intf;
+
+   if (!(t = allocate_tty_struct(minor, serial_port_fwd, !serial_port_fwd)))
+      return NULL;
+
    new_term_intf = serial_port_fwd ? serial_term_intf : video_term_intf;
 
    if (minor != 1 && !kopt_serial_console) {
@@ -294,6 +312,25 @@ struct tty *create_tty_nodev(void)
    return t;
 }
 
+/*
+ * Creates a tty without a device file and without console data, using the
+ * already initialized term `tstate`. Used for the pty slaves (see pty.c).
+ */
+struct tty *
+create_tty_for_term(u16 minor, term *tstate, const struct term_interface *intf)
+{
+   struct tty *const t = allocate_tty_struct(minor, 0, false);
+
+   if (!t)
+      return NULL;
+
+   t->tstate = tstate;
+   t->tintf = intf;
+   t->tintf->get_params(t->tstate, &t->tparams);
+   tty_input_init(t);
+   return t;
+}
+
 static int internal_init_tty(u16 major, u16 minor, u16 serial_port_fwd)
 {
    ASSERT(minor < ARRAY_SIZE(ttys));
@@ -357,6 +394,9 @@ struct tty *get_serial_tty(int n)
 ssize_t
 tty_write_int(struct tty *t, struct devfs_handle *h, char *buf, size_t size)
 {
+   if (t->pty)
+      return pty_slave_write(t, h, buf, size);
+
    size = MIN(size, MAX_TERM_WRITE_LEN);
    t->tintf->write(t->tstate, buf, size, t->curr_color);
    return (ssize_t) size;
@@ -403,6 +443,7 @@ static void init_tty(void)
    enable_preemption();
 
    init_ttyaux();
+   init_pty();
    __curr_tty = ttys[kopt_serial_console ? TTYS0_MINOR : 1];
 
    process_set_tty(kernel_process_pi, get_curr_tty());
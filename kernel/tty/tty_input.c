@@ -78,6 +78,15 @@ static void tty_keypress_echo(struct tty *t, char c)
          */
 
 
+         if (c == c_term->c_cc[VERASE] && t->pty) {
+            /*
+             * The other end of a pty is a terminal emulator which doesn't
+             * know our VERASE char: erase the char on screen explicitly.
+             */
+            t->tintf->write(t->tstate, "\b \b", 3, t->curr_color);
+            return;
+         }
+
          if (c == c_term->c_cc[VWERASE] || c == c_term->c_cc[VERASE]) {
             t->tintf->write(t->tstate, &c, 1, t->curr_color);
             return;
@@ -144,19 +153,66 @@ static inline u8 tty_inbuf_read_elem(struct tty *t)
    return ret;
 }
 
-static inline bool tty_inbuf_drop_last_written_elem(struct tty *t)
+static inline bool tty_is_line_delim_char(struct tty *t, u8 c)
+{
+   return c == '\n' ||
+          c == t->c_term.c_cc[VEOF] ||
+          c == t->c_term.c_cc[VEOL] ||
+          c == t->c_term.c_cc[VEOL2];
+}
+
+static inline bool tty_is_blank_char(u8 c)
+{
+   return c == ' ' || c == '\t';
+}
+
+/*
+ * Drop the last char written in the input buffer and echo its erase, unless
+ * it's a line delimiter: the line it ends is complete and cannot be edited.
+ * When erasing a word, `in_word` tracks if we've already dropped some of its
+ * chars: in that case, we stop at the first blank char before it.
+ */
+static bool tty_inbuf_drop_last_written_elem(struct tty *t, bool *in_word)
 {
    bool ret;
-   tty_keypress_echo(t, (char)t->c_term.c_cc[VERASE]);
+   u8 c;
 
    disable_preemption();
    {
-      ret = ringbuf_unwrite_elem(&t->input_ringbuf, NULL);
+      ret = ringbuf_unwrite_elem(&t->input_ringbuf, &c);
+
+      if (ret) {
+
+         if (tty_is_line_delim_char(t, c) ||
+             (in_word && *in_word && tty_is_blank_char(c)))
+         {
+            /* Put the char back */
+            DEBUG_CHECKED_SUCCESS(ringbuf_write_elem1(&t->input_ringbuf, c));
+            ret = false;
+         }
+      }
    }
    enable_preemption();
+
+   if (ret) {
+
+      if (in_word && !tty_is_blank_char(c))
+         *in_word = true;
+
+      tty_keypress_echo(t, (char)t->c_term.c_cc[VERASE]);
+   }
+
    return ret;
 }
 
+static void tty_inbuf_drop_last_word(struct tty *t)
+{
+   bool in_word = false;
+   while (tty_inbuf_drop_last_written_elem(t, &in_word)) {
+      /* do nothing */
+   }
+}
+
 static void
 tty_inbuf_write_elem(struct tty *t, u8 c, bool block)
 {
@@ -218,20 +274,16 @@ tty_handle_non_printable_key(struct kb_dev *kb,
    return kb_handler_ok_and_continue;
 }
 
-static inline bool tty_is_line_delim_char(struct tty *t, u8 c)
-{
-   return c == '\n' ||
-          c == t->c_term.c_cc[VEOF] ||
-          c == t->c_term.c_cc[VEOL] ||
-          c == t->c_term.c_cc[VEOL2];
-}
-
 static void
 tty_keypress_handle_canon_mode(struct tty *t, u32 key, u8 c, bool block)
 {
    if (c == t->c_term.c_cc[VERASE]) {
 
-      tty_inbuf_drop_last_written_elem(t);
+      tty_inbuf_drop_last_written_elem(t, NULL);
+
+   } else if (c == t->c_term.c_cc[VWERASE] && (t->c_term.c_lflag & IEXTEN)) {
+
+      tty_inbuf_drop_last_word(t);
 
    } else {
 
@@ -277,6 +329,13 @@ void tty_send_keyevent(struct tty *t, struct key_event ke, bool block)
    return;
 }
 
+/* Send a batch of input bytes, as if they were typed one by one */
+void tty_send_input(struct tty *t, const char *buf, size_t len, bool block)
+{
+   for (size_t i = 0; i < len; i++)
+      tty_send_keyevent(t, make_key_event(0, buf[i], true), block);
+}
+
 static int
 tty_keypress_handler_int(struct tty *t,
                          struct kb_dev *kb,
@@ -461,6 +520,9 @@ bool tty_read_ready_int(struct tty *t, struct devfs_handle *h)
 {
    struct tty_handle_extra *eh = (void *)&h->extra;
 
+   if (t->hung_up)
+      return true; /* read() won't block: it will return EOF */
+
    if (t->c_term.c_lflag & ICANON) {
       return eh->read_allowed_to_return || t->end_line_delim_count > 0;
    }
@@ -479,7 +541,7 @@ tty_read_int(struct tty *t, struct devfs_handle *h, char *buf, size_t size)
 
    ASSERT(is_preemption_enabled());
 
-   if (!t->serial_port_fwd) {
+   if (!t->serial_port_fwd && !t->pty) {
 
       if (pi->proc_tty != t) {
 
@@ -538,11 +600,14 @@ tty_read_int(struct tty *t, struct devfs_handle *h, char *buf, size_t size)
 
    do {
 
-      if ((h->fl_flags & O_NONBLOCK) && tty_inbuf_is_empty(t))
+      if ((h->fl_flags & O_NONBLOCK) && tty_inbuf_is_empty(t) && !t->hung_up)
          return -EAGAIN;
 
       while (tty_inbuf_is_empty(t)) {
 
+         if (t->hung_up)
+            return (ssize_t) read_count; /* the pty master got closed: EOF */
+
          kcond_wait(&t->input_cond, NULL, KCOND_WAIT_FOREVER);
 
          if (pending_signals())
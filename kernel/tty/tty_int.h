@@ -12,6 +12,7 @@
 #include <tilck/kernel/fs/devfs.h>
 
 #define TTY_READ_BS   4096
+#define PTMX_MINOR       2   /* /dev/ptmx, TTYAUX_MAJOR */
 
 struct tty_handle_extra {
    offt read_pos;
@@ -23,6 +24,7 @@ struct tty_handle_extra {
 STATIC_ASSERT(sizeof(struct tty_handle_extra) <= DEVFS_EXTRA_SIZE);
 
 void tty_input_init(struct tty *t);
+void tty_inbuf_reset(struct tty *t);
 
 enum kb_handler_action
 tty_keypress_handler(struct kb_dev *, struct key_event ke);
@@ -52,6 +54,20 @@ int
 tty_on_dup_extra(int minor, void *extra);
 
 void init_ttyaux(void);
+void init_pty(void);
+void tty_full_destroy(struct tty *t);
+
+struct tty *
+create_tty_for_term(u16 minor, term *tstate, const struct term_interface *intf);
+
+ssize_t
+pty_slave_write(struct tty *t, struct devfs_handle *h, char *buf, size_t size);
+
+int
+ptmx_create_device_file(int minor,
+                        enum vfs_entry_type *type,
+                        struct devfs_file_info *nfo);
+
 void tty_create_devfile_or_panic(const char *filename,
                                  u16 major,
                                  u16 minor,
@@ -2,6 +2,7 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
+#include <tilck/common/tty_ioctl.h>
 #include <tilck/common/debug/termios_debug.c.h>
 
 #include <tilck/kernel/fs/vfs_base.h>
@@ -12,6 +13,7 @@
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/sys_types.h>
+#include <tilck/kernel/signal.h>
 
 #include "tty_int.h"
 
@@ -127,6 +129,33 @@ static int tty_ioctl_tiocgwinsz(struct tty *t, void *argp)
    return 0;
 }
 
+static int tty_ioctl_tiocswinsz(struct tty *t, void *argp)
+{
+   struct winsize sz;
+
+   /* Only the size of the pseudo-terminals can be changed */
+   if (!t->pty)
+      return -EINVAL;
+
+   if (copy_from_user(&sz, argp, sizeof(struct winsize)))
+      return -EFAULT;
+
+   if (sz.ws_row == t->tparams.rows && sz.ws_col == t->tparams.cols)
+      return 0;
+
+   disable_preemption();
+   {
+      t->tparams.rows = sz.ws_row;
+      t->tparams.cols = sz.ws_col;
+   }
+   enable_preemption();
+
+   if (t->fg_pgid)
+      send_signal_to_group(t->fg_pgid, SIGWINCH);
+
+   return 0;
+}
+
 void tty_setup_for_panic(struct tty *t)
 {
    if (t->kd_gfx_mode != KD_TEXT) {
@@ -264,6 +293,11 @@ static int tty_ioctl_TIOCSCTTY(struct tty *t, void *argp)
       return -EPERM; /* not a session leader */
 
    pi->proc_tty = t;
+
+   /* Like on Linux, the caller's group becomes the foreground group */
+   if (!t->fg_pgid)
+      t->fg_pgid = pi->pgid;
+
    return 0;
 }
 
@@ -311,6 +345,37 @@ static int tty_ioctl_TIOCSPGRP(struct tty *t, const int *user_pgrp)
    return 0;
 }
 
+static int tty_ioctl_get_scrollback(struct tty *t, int *user_rows)
+{
+   int rows;
+
+   if (!t->tintf->get_scrollback)
+      return -EINVAL;
+
+   rows = (int)t->tintf->get_scrollback(t->tstate);
+
+   if (copy_to_user(user_rows, &rows, sizeof(int)))
+      return -EFAULT;
+
+   return 0;
+}
+
+static int tty_ioctl_set_scrollback(struct tty *t, const int *user_rows)
+{
+   int rows;
+
+   if (!t->tintf->set_scrollback)
+      return -EINVAL;
+
+   if (copy_from_user(&rows, user_rows, sizeof(int)))
+      return -EFAULT;
+
+   if (rows < 0)
+      return -EINVAL;
+
+   return t->tintf->set_scrollback(t->tstate, (u32)rows);
+}
+
 int
 tty_ioctl_int(struct tty *t, struct devfs_handle *h, ulong request, void *argp)
 {
@@ -332,6 +397,9 @@ tty_ioctl_int(struct tty *t, struct devfs_handle *h, ulong request, void *argp)
       case TIOCGWINSZ:
          return tty_ioctl_tiocgwinsz(t, argp);
 
+      case TIOCSWINSZ:
+         return tty_ioctl_tiocswinsz(t, argp);
+
       case KDSETMODE:
          return tty_ioctl_kdsetmode(t, argp);
 
@@ -356,6 +424,12 @@ tty_ioctl_int(struct tty *t, struct devfs_handle *h, ulong request, void *argp)
       case TIOCSPGRP:
          return tty_ioctl_TIOCSPGRP(t, argp);
 
+      case TILCK_TIOCGSCROLLBACK:
+         return tty_ioctl_get_scrollback(t, argp);
+
+      case TILCK_TIOCSSCROLLBACK:
+         return tty_ioctl_set_scrollback(t, argp);
+
       default:
          printk("WARNING: unknown tty_ioctl() request: %p\n", TO_PTR(request));
          return -EINVAL;
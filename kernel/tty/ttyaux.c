@@ -53,6 +53,9 @@ ttyaux_create_device_file(int minor,
                           enum vfs_entry_type *type,
                           struct devfs_file_info *nfo)
 {
+   if (minor == PTMX_MINOR)
+      return ptmx_create_device_file(minor, type, nfo);
+
    static const struct file_ops static_ops_ttyaux = {
 
       .read = ttyaux_read,
@@ -87,4 +90,5 @@ void init_ttyaux(void)
 
    tty_create_devfile_or_panic("tty", TTYAUX_MAJOR, 0, NULL);
    tty_create_devfile_or_panic("console", TTYAUX_MAJOR, 1, NULL);
+   tty_create_devfile_or_panic("ptmx", TTYAUX_MAJOR, PTMX_MINOR, NULL);
 }
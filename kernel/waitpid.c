@@ -175,7 +175,8 @@ void wake_up_tasks_waiting_on(struct task *ti, enum wakeup_reason r)
  * ***************************************************************
  */
 
-int sys_waitpid(int tid, int *user_wstatus, int options)
+static int
+do_waitpid(int tid, int *user_wstatus, int options, struct k_rusage *ru)
 {
    struct task *curr = get_curr_task();
    struct task *chtask = NULL;
@@ -258,22 +259,34 @@ int sys_waitpid(int tid, int *user_wstatus, int options)
          chtask_tid = -EFAULT;
    }
 
-   if (chtask->state == TASK_STATE_ZOMBIE)
+   if (ru)
+      process_get_total_rusage(chtask, ru);
+
+   if (chtask->state == TASK_STATE_ZOMBIE) {
+      process_account_reaped_child(curr->pi, chtask);
       remove_task(chtask);
+   }
 
    enable_preemption();
    return chtask_tid;
 }
 
+int sys_waitpid(int tid, int *user_wstatus, int options)
+{
+   return do_waitpid(tid, user_wstatus, options, NULL);
+}
+
 int sys_wait4(int tid, int *user_wstatus, int options, void *user_rusage)
 {
-   struct k_rusage ru = {0};
+   struct k_rusage ru;
+   int rc;
+
+   rc = do_waitpid(tid, user_wstatus, options, user_rusage ? &ru : NULL);
 
-   if (user_rusage) {
-      // TODO: update when rusage is actually supported
+   if (rc > 0 && user_rusage) {
       if (copy_to_user(user_rusage, &ru, sizeof(ru)) < 0)
          return -EFAULT;
    }
 
-   return sys_waitpid(tid, user_wstatus, options);
+   return rc;
 }
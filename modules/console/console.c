@@ -847,8 +847,18 @@ tty_state_esc2_par1(u8 *c, u8 *color, struct term_action *a, void *ctx_arg)
 static void tty_set_state(struct twfilter_ctx *ctx, term_filter new_state)
 {
    struct tty *const t = ctx->t;
+   struct console_data *const cd = ctx->cd;
+
+   /*
+    * In the default state, the printable ASCII chars are written unchanged
+    * only when the current charset uses the default translation table.
+    */
+   const bool ascii_passthrough =
+      new_state == &tty_state_default &&
+      cd->c_sets_tables[cd->c_set] == tty_default_trans_table;
+
    ctx->non_default_state = new_state != &tty_state_default;
-   t->tintf->set_filter(t->tstate, new_state, ctx);
+   t->tintf->set_filter(t->tstate, new_state, ctx, ascii_passthrough);
 }
 
 static int tty_pre_filter(struct twfilter_ctx *ctx, u8 *c)
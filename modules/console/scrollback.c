@@ -0,0 +1,276 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/color_defs.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+
+#include "scrollback.h"
+
+#define SB_TOK_REPEAT                                    0x80
+#define SB_TOK_COLOR                                     0xff
+#define SB_MAX_LITERAL                                    128
+#define SB_MAX_REPEAT                                     127
+#define SB_BLANK                 make_vgaentry(' ', DEFAULT_COLOR16)
+
+static ALWAYS_INLINE bool
+sb_is_repeat(const u16 *row, u32 i, u32 n)
+{
+   return i + 2 < n && row[i] == row[i + 1] && row[i] == row[i + 2];
+}
+
+static u32
+sb_encode(const u16 *row, u16 cols, u8 *out)
+{
+   u8 color = DEFAULT_COLOR16;
+   u32 n = cols, i = 0, o = 0;
+
+   /* The trailing blank cells are implicit */
+   while (n > 0 && row[n - 1] == SB_BLANK)
+      n--;
+
+   while (i < n) {
+
+      const u8 c = vgaentry_get_color(row[i]);
+      u32 run = 1, lit_pos;
+
+      if (c != color) {
+         out[o++] = SB_TOK_COLOR;
+         out[o++] = c;
+         color = c;
+      }
+
+      while (i + run < n && run < SB_MAX_REPEAT && row[i + run] == row[i])
+         run++;
+
+      if (run >= 3) {
+         out[o++] = (u8)(SB_TOK_REPEAT + run - 1);
+         out[o++] = vgaentry_get_char(row[i]);
+         i += run;
+         continue;
+      }
+
+      /* Literal: the chars having the same color, up to the next repeat */
+      lit_pos = o++;
+      run = 0;
+
+      do {
+         out[o++] = vgaentry_get_char(row[i]);
+         i++;
+         run++;
+      } while (i < n &&
+               run < SB_MAX_LITERAL &&
+               vgaentry_get_color(row[i]) == color &&
+               !sb_is_repeat(row, i, n));
+
+      out[lit_pos] = (u8)(run - 1);
+   }
+
+   ASSERT(o <= SB_MAX_ROW_BYTES(cols) - 2);
+   return o;
+}
+
+static void
+sb_decode(const u8 *in, u32 len, u16 *out, u16 cols)
+{
+   u8 color = DEFAULT_COLOR16;
+   u32 i = 0, o = 0;
+
+   while (i < len) {
+
+      const u8 tok = in[i++];
+
+      if (tok == SB_TOK_COLOR) {
+
+         color = in[i++];
+
+      } else if (tok >= SB_TOK_REPEAT) {
+
+         const u32 n = tok - SB_TOK_REPEAT + 1u;
+         memset16(out + o, make_vgaentry(in[i++], color), n);
+         o += n;
+
+      } else {
+
+         for (u32 k = 0; k <= tok; k++)
+            out[o++] = make_vgaentry(in[i++], color);
+      }
+   }
+
+   ASSERT(o <= cols);
+   memset16(out + o, SB_BLANK, cols - o);
+}
+
+static ALWAYS_INLINE u32
+sb_slot(struct scrollback *sb, u32 n)
+{
+   return (sb->first + n) % sb->max_rows;
+}
+
+static ALWAYS_INLINE u16
+sb_rec_len(struct scrollback *sb, u32 off)
+{
+   u16 len;
+   memcpy(&len, sb->buf + off, sizeof(len));
+   return len;
+}
+
+static void
+sb_drop_oldest(struct scrollback *sb)
+{
+   ASSERT(sb->count > 0);
+   sb->first = (sb->first + 1) % sb->max_rows;
+   sb->count--;
+}
+
+/*
+ * Returns the offset in `buf` where a record of `need` bytes can be written
+ * without overwriting any other record or -1, when there's no room for it.
+ * Records never wrap around the end of `buf`: they're written at its start.
+ */
+static int
+sb_find_room(struct scrollback *sb, u32 need)
+{
+   u32 tail;
+
+   if (!sb->count) {
+      sb->head = 0;
+      return need <= sb->buf_size ? 0 : -1;
+   }
+
+   tail = sb->idx[sb->first];
+
+   if (sb->head > tail) {
+
+      if (sb->buf_size - sb->head >= need)
+         return (int)sb->head;
+
+      if (tail >= need)
+         return 0;
+
+      return -1;
+   }
+
+   /* The records wrapped around: head == tail means `buf` is full */
+   if (sb->head < tail && tail - sb->head >= need)
+      return (int)sb->head;
+
+   return -1;
+}
+
+static void
+sb_push_enc(struct scrollback *sb, const u8 *data, u16 len)
+{
+   const u32 need = sizeof(u16) + len;
+   int off;
+
+   if (sb->count == sb->max_rows)
+      sb_drop_oldest(sb);
+
+   while ((off = sb_find_room(sb, need)) < 0)
+      sb_drop_oldest(sb);
+
+   memcpy(sb->buf + off, &len, sizeof(len));
+   memcpy(sb->buf + off + sizeof(len), data, len);
+
+   sb->idx[sb_slot(sb, sb->count)] = (u32)off;
+   sb->count++;
+   sb->head = (u32)off + need;
+}
+
+void
+sb_push_row(struct scrollback *sb, const u16 *row)
+{
+   if (!sb->max_rows)
+      return;
+
+   sb_push_enc(sb, sb->tmp, (u16)sb_encode(row, sb->cols, sb->tmp));
+}
+
+void
+sb_get_row(struct scrollback *sb, u32 n, u16 *out)
+{
+   u32 off;
+   ASSERT(n < sb->count);
+
+   off = sb->idx[sb_slot(sb, n)];
+   sb_decode(sb->buf + off + sizeof(u16), sb_rec_len(sb, off), out, sb->cols);
+}
+
+void
+sb_move(struct scrollback *dst, struct scrollback *src)
+{
+   u32 start;
+   ASSERT(dst->cols == src->cols);
+
+   if (dst->max_rows) {
+
+      start = src->count > dst->max_rows ? src->count - dst->max_rows : 0;
+
+      for (u32 n = start; n < src->count; n++) {
+         const u32 off = src->idx[sb_slot(src, n)];
+         sb_push_enc(dst, src->buf + off + sizeof(u16), sb_rec_len(src, off));
+      }
+   }
+
+   sb_clear(src);
+}
+
+u32
+sb_get_used_bytes(struct scrollback *sb)
+{
+   u32 tot = 0;
+
+   for (u32 n = 0; n < sb->count; n++)
+      tot += sizeof(u16) + sb_rec_len(sb, sb->idx[sb_slot(sb, n)]);
+
+   return tot;
+}
+
+void
+sb_clear(struct scrollback *sb)
+{
+   sb->first = sb->count = sb->head = 0;
+}
+
+int
+sb_init(struct scrollback *sb, u16 cols, u32 max_rows)
+{
+   *sb = (struct scrollback) { .cols = cols };
+
+   if (!max_rows)
+      return 0;
+
+   max_rows = MIN(max_rows, (u32)SB_MAX_ROWS);
+   sb->buf_size = MAX(max_rows * SB_AVG_ROW_BYTES(cols),
+                      SB_MAX_ROW_BYTES(cols));
+
+   sb->buf = kmalloc(sb->buf_size);
+   sb->idx = kalloc_array_obj(u32, max_rows);
+   sb->tmp = kmalloc(SB_MAX_ROW_BYTES(cols));
+   sb->max_rows = max_rows;
+
+   if (!sb->buf || !sb->idx || !sb->tmp) {
+      sb_destroy(sb);
+      return -ENOMEM;
+   }
+
+   return 0;
+}
+
+void
+sb_destroy(struct scrollback *sb)
+{
+   if (sb->buf)
+      kfree2(sb->buf, sb->buf_size);
+
+   if (sb->idx)
+      kfree_array_obj(sb->idx, u32, sb->max_rows);
+
+   if (sb->tmp)
+      kfree2(sb->tmp, SB_MAX_ROW_BYTES(sb->cols));
+
+   *sb = (struct scrollback) { .cols = sb->cols };
+}
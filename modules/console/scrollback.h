@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Compressed scrollback history for the video terms.
+ *
+ * Every row leaving the top of the screen is encoded and appended to `buf`, a
+ * byte ring of variable-length records, while `idx` is a ring of `max_rows`
+ * offsets pointing to them. When either one is full, the oldest rows are
+ * dropped. Rows are encoded with a trivial RLE scheme, working on chars plus
+ * a "current color" state, in order to save the color byte of each cell:
+ *
+ *    0x00 - 0x7f    literal: the next (tok + 1) bytes are chars
+ *    0x80 - 0xfe    repeat: the next byte is a char repeated (tok - 0x7f) times
+ *    0xff           color: the next byte is the new current color
+ *
+ * The current color starts as DEFAULT_COLOR16 and the trailing blank cells
+ * (' ' with DEFAULT_COLOR16) are not stored at all. Therefore, empty rows cost
+ * just the 2 bytes of the record's header and rows of plain text less than
+ * the half of what they'd take in the screen buffer.
+ */
+
+#define SB_MAX_ROWS                                     65535
+
+/* Expected avg bytes per row, used to size `buf` for `max_rows` rows */
+#define SB_AVG_ROW_BYTES(cols)                  ((u32)(cols) / 2 + 2)
+
+/* The worst case: a color token, a literal token and a char, for each cell */
+#define SB_MAX_ROW_BYTES(cols)                  (4 * (u32)(cols) + 2)
+
+struct scrollback {
+
+   u8 *buf;                /* the records: u16 length + encoded row */
+   u32 *idx;               /* ring of `max_rows` offsets in `buf` */
+   u8 *tmp;                /* SB_MAX_ROW_BYTES(cols) bytes, used for encoding */
+
+   u32 buf_size;
+   u32 max_rows;
+   u32 first;              /* slot in `idx` of the oldest row */
+   u32 count;              /* number of rows currently stored */
+   u32 head;               /* offset in `buf` where to write the next record */
+   u16 cols;
+};
+
+/*
+ * Allocates a history of `max_rows` rows of `cols` cells each. With
+ * max_rows == 0, nothing is allocated and the rows pushed are just dropped.
+ */
+int sb_init(struct scrollback *sb, u16 cols, u32 max_rows);
+void sb_destroy(struct scrollback *sb);
+void sb_clear(struct scrollback *sb);
+
+/* Appends `row` (`cols` vga entries) as the newest row */
+void sb_push_row(struct scrollback *sb, const u16 *row);
+
+/* Decodes the n-th row (0 = the oldest one) into `out` */
+void sb_get_row(struct scrollback *sb, u32 n, u16 *out);
+
+/* Moves the newest rows of `src` fitting into `dst`, clearing `src` */
+void sb_move(struct scrollback *dst, struct scrollback *src);
+
+/* Bytes currently used by the records: for stats and tests */
+u32 sb_get_used_bytes(struct scrollback *sb);
@@ -30,6 +30,8 @@ static const struct actions_table_item actions_table[] = {
    [a_insert_blank_chars]   = ENTRY(term_action_ins_blank_chars, 1),
    [a_simple_del_chars]     = ENTRY(term_action_del_chars_in_line, 1),
    [a_simple_erase_chars]   = ENTRY(term_action_erase_chars_in_line, 1),
+   [a_flush]                = ENTRY(term_action_flush, 1),
+   [a_set_scrollback]       = ENTRY(term_action_set_scrollback, 3),
 };
 
 #undef ENTRY
@@ -55,13 +57,20 @@ static void term_execute_action(struct vterm *t, struct term_action *a)
    }
 }
 
+static void
+term_execute_top_action(struct vterm *t, struct term_action *a)
+{
+   term_execute_action(t, a);
+   term_end_of_action(t);
+}
+
 static void
 term_execute_or_enqueue_action(struct vterm *t, struct term_action *a)
 {
    term_execute_or_enqueue_action_template(t,
                                            &t->rb_data,
                                            a,
-                                           (void *)&term_execute_action);
+                                           (void *)&term_execute_top_action);
 }
 
 static void
@@ -72,6 +81,7 @@ vterm_write(term *t, const char *buf, size_t len, u8 color)
 
    if (in_panic()) {
       term_action_write(t, (char *)buf, (u32)len, color);
+      term_flush(t);
       return;
    }
 
@@ -120,6 +130,30 @@ vterm_restart_video_output(term *t)
    term_execute_or_enqueue_action(t, &a);
 }
 
+static int
+vterm_set_scrollback(term *_t, u32 rows)
+{
+   struct vterm *const t = _t;
+   struct scrollback *sb;
+   struct term_action a;
+   int rc;
+
+   if (rows > SB_MAX_ROWS)
+      return -EINVAL;
+
+   if (!(sb = kalloc_obj(struct scrollback)))
+      return -ENOMEM;
+
+   if ((rc = sb_init(sb, t->cols, rows)) < 0) {
+      kfree_obj(sb, struct scrollback);
+      return rc;
+   }
+
+   term_make_action_set_scrollback(&a, sb);
+   term_execute_or_enqueue_action(t, &a);
+   return 0;
+}
+
 /* ---------------- term non-action interface funcs --------------------- */
 
 u16 vterm_get_curr_row(struct vterm *t)
@@ -133,11 +167,22 @@ u16 vterm_get_curr_col(struct vterm *t)
 }
 
 static void
-vterm_set_filter(term *_t, term_filter func, void *ctx)
+vterm_set_filter(term *_t,
+                 term_filter func,
+                 void *ctx,
+                 bool ascii_passthrough)
 {
    struct vterm *const t = _t;
    t->filter = func;
    t->filter_ctx = ctx;
+   t->filter_ascii_passthrough = ascii_passthrough;
+}
+
+static u32
+vterm_get_scrollback(term *_t)
+{
+   struct vterm *const t = _t;
+   return t->sb.max_rows;
 }
 
 static bool
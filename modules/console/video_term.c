@@ -14,8 +14,35 @@
 #include <tilck/kernel/interrupts.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/errno.h>
+#include <tilck/kernel/timer.h>
 
 #include "video_term_int.h"
+#include "scrollback.h"
+
+/*
+ * Damage tracking
+ * -----------------
+ *
+ * When TERM_DAMAGE_TRACKING is enabled, the term actions do NOT draw anything
+ * on the screen: they just update the buffer and remember, for each row on the
+ * screen, the span of columns changed since the last flush. At the end of each
+ * top-level action (typically, a whole tty_write()), term_flush() draws only
+ * the changed spans and moves the cursor just once. That makes a huge
+ * difference for full-screen apps re-writing the same cells many times per
+ * frame, and for the scroll operations, since N scrolls in a single write cost
+ * at most a single redraw. If TERM_DAMAGE_FPS > 0, the flush is deferred at
+ * most to the next frame, which is flushed by a dedicated kernel thread.
+ *
+ * Terms failing to allocate the `dirty` array fall back to the direct mode.
+ */
+
+#define TERM_FLUSH_TICKS \
+   UNSAFE_MAX(1, TIMER_HZ / UNSAFE_MAX(TERM_DAMAGE_FPS, 1))
+
+struct dirty_span {
+   u16 s;                     /* first dirty col */
+   u16 e;                     /* last dirty col + 1. When s >= e: no damage */
+};
 
 struct vterm {
 
@@ -36,13 +63,16 @@ struct vterm {
    const struct video_interface *vi;
    const struct video_interface *saved_vi;
 
-   u16 *buffer;               /* the whole screen buffer */
+   u16 *buffer;               /* the screen buffer: a ring of `rows` rows */
    u16 *screen_buf_copy;      /* when != NULL, contains one screenshot */
+   u16 *view_buf;             /* the rows shown while scrolling the history */
    u32 scroll;                /* != max_scroll only while scrolling */
-   u32 max_scroll;            /* buffer rows used - rows. Its value is 0 until
-                                 the screen scrolls for the first time */
-   u32 total_buffer_rows;     /* >= term rows */
-   u32 extra_buffer_rows;     /* => total_buffer_rows - rows. Always >= 0 */
+   u32 max_scroll;            /* rows scrolled out of the screen so far. Its
+                                 value is 0 until the screen scrolls for the
+                                 first time */
+   u16 buf_top;               /* row in `buffer` of the first screen row */
+
+   struct scrollback sb;      /* the compressed history (see scrollback.h) */
 
    u16 saved_cur_row;         /* keeps primary buffer's cursor's row */
    u16 saved_cur_col;         /* keeps primary buffer's cursor's col */
@@ -64,10 +94,18 @@ struct vterm {
 
    term_filter filter;
    void *filter_ctx;
+   bool filter_ascii_passthrough;
+
+   struct dirty_span *dirty;  /* per-row damage. NULL -> direct drawing */
+   bool damaged;              /* at least one dirty span or pending scroll */
+   bool cursor_dirty;         /* the cursor has to be moved on flush */
+   u16 pending_scroll;        /* vi->scroll_one_line_up() calls to flush */
+   u64 last_flush_ticks;
 };
 
 static struct vterm first_instance;
 static u16 failsafe_buffer[80 * 25];
+static bool flush_thread_created;
 
 /* ------------ No-output video-interface ------------------ */
 
@@ -131,12 +169,38 @@ static const struct video_interface no_output_vi =
  *  301288    29388  250610   581286   8dea6   tilck
  */
 
-#define calc_buf_row(t, r) (((r) + (t)->scroll) % (t)->total_buffer_rows)
+#define calc_buf_row(t, r) (((r) + (t)->buf_top) % (t)->rows)
 #define get_buf_row(t, r) (&(t)->buffer[calc_buf_row((t), (r)) * (t)->cols])
+#define get_view_row(t, r)                                                \
+   ((t)->scroll == (t)->max_scroll                                        \
+      ? get_buf_row((t), (r))                                             \
+      : &(t)->view_buf[(r) * (t)->cols])
 #define buf_set_entry(t, r, c, e) (get_buf_row((t), (r))[(c)] = (e))
 #define buf_get_entry(t, r, c) (get_buf_row((t), (r))[(c)])
 #define buf_get_char_at(t, r, c) (vgaentry_get_char(buf_get_entry((t),(r),(c))))
 
+static ALWAYS_INLINE void
+ts_mark_dirty(struct vterm *t, u16 row, u16 s, u16 e)
+{
+   struct dirty_span *d = &t->dirty[row];
+
+   if (d->s >= d->e) {
+      d->s = s;
+      d->e = e;
+   } else {
+      d->s = MIN(d->s, s);
+      d->e = MAX(d->e, e);
+   }
+
+   t->damaged = true;
+}
+
+static void ts_mark_rows_dirty(struct vterm *t, u16 s, u16 e)
+{
+   for (u16 row = s; row < e; row++)
+      ts_mark_dirty(t, row, 0, t->cols);
+}
+
 static void
 buf_copy_row(term *_t, u32 dest, u32 src)
 {
@@ -146,6 +210,9 @@ buf_copy_row(term *_t, u32 dest, u32 src)
       return;
 
    memcpy(get_buf_row(t, dest), get_buf_row(t, src), t->cols * 2);
+
+   if (t->dirty && dest < t->rows)
+      ts_mark_dirty(t, (u16)dest, 0, t->cols);
 }
 
 static ALWAYS_INLINE bool ts_is_at_bottom(term *_t)
@@ -164,6 +231,154 @@ static ALWAYS_INLINE u8 get_curr_cell_color(term *_t)
    return vgaentry_get_color(buf_get_entry(t, t->r, t->c));
 }
 
+static void ts_set_char_at(struct vterm *t, u16 row, u16 col, u16 entry)
+{
+   buf_set_entry(t, row, col, entry);
+
+   if (t->dirty)
+      ts_mark_dirty(t, row, col, col + 1);
+   else if (ts_is_at_bottom(t))
+      t->vi->set_char_at(row, col, entry);
+}
+
+/* The cells [s, e) of `row` have been changed directly in the buffer */
+static void ts_row_span_changed(struct vterm *t, u16 row, u16 s, u16 e)
+{
+   u16 *data;
+
+   if (t->dirty) {
+
+      if (s < e)
+         ts_mark_dirty(t, row, s, e);
+
+      return;
+   }
+
+   if (!ts_is_at_bottom(t))
+      return; /* The screen will be redrawn when scrolling back to bottom */
+
+   data = get_buf_row(t, row);
+
+   for (u16 col = s; col < e; col++)
+      t->vi->set_char_at(row, col, data[col]);
+}
+
+static void ts_move_cursor(struct vterm *t)
+{
+   if (t->dirty)
+      t->cursor_dirty = true;
+   else
+      t->vi->move_cursor(t->r, t->c, get_curr_cell_color(t));
+}
+
+static void ts_draw_dirty_row(struct vterm *t, u16 row, bool fpu_allowed)
+{
+   struct dirty_span *d = &t->dirty[row];
+   u16 *data = get_view_row(t, row);
+
+   if (2 * (d->e - d->s) >= t->cols) {
+
+      t->vi->set_row(row, data, fpu_allowed);
+
+   } else {
+
+      for (u16 col = d->s; col < d->e; col++)
+         t->vi->set_char_at(row, col, data[col]);
+   }
+
+   d->s = d->e = 0;
+}
+
+/*
+ * Draw all the dirty spans and move the cursor, if needed. Must be called with
+ * the term's actions serialized, exactly like any other term action.
+ */
+static void term_flush(struct vterm *t)
+{
+   const bool fpu_allowed = !in_irq() && !in_panic();
+   const bool show_cursor = t->cursor_enabled && t->scroll == t->max_scroll;
+   u16 clean_rows = 0;
+
+   if (!t->dirty)
+      return;
+
+   if (TERM_DAMAGE_FPS > 0)
+      t->last_flush_ticks = get_ticks();
+
+   if (!t->damaged)
+      goto move_cursor;
+
+   /*
+    * Hide the cursor while drawing: that keeps the vi's under-cursor state
+    * consistent, no matter which cells we're going to redraw.
+    */
+   if (show_cursor)
+      t->vi->disable_cursor();
+
+   if (t->pending_scroll) {
+
+      for (u16 row = 0; row < t->rows; row++)
+         clean_rows += t->dirty[row].s >= t->dirty[row].e;
+
+      /* Don't bother scrolling the screen, if we have to redraw it anyway */
+      if (clean_rows) {
+         for (u16 i = 0; i < t->pending_scroll; i++)
+            t->vi->scroll_one_line_up();
+      }
+
+      t->pending_scroll = 0;
+   }
+
+   if (fpu_allowed)
+      fpu_context_begin();
+
+   for (u16 row = 0; row < t->rows; row++) {
+      if (t->dirty[row].s < t->dirty[row].e)
+         ts_draw_dirty_row(t, row, fpu_allowed);
+   }
+
+   if (fpu_allowed)
+      fpu_context_end();
+
+   t->damaged = false;
+
+   if (show_cursor) {
+      t->vi->enable_cursor();
+      t->cursor_dirty = true;
+   }
+
+move_cursor:
+
+   if (t->cursor_dirty) {
+
+      if (show_cursor)
+         t->vi->move_cursor(t->r, t->c, get_curr_cell_color(t));
+
+      t->cursor_dirty = false;
+   }
+}
+
+/* Called at the end of each top-level action */
+static void term_end_of_action(struct vterm *t)
+{
+   if (!t->dirty)
+      return;
+
+   if (TERM_DAMAGE_FPS > 0 && flush_thread_created && !in_panic()) {
+
+      if (get_ticks() - t->last_flush_ticks < TERM_FLUSH_TICKS)
+         return; /* vterm_flush_thread() will flush it, on the next frame */
+   }
+
+   term_flush(t);
+}
+
+static void term_action_flush(term *_t, ...)
+{
+   struct vterm *const t = _t;
+   term_flush(t);
+}
+
 static void term_action_enable_cursor(term *_t, u16 val, ...)
 {
    struct vterm *const t = _t;
@@ -190,11 +405,16 @@ static void term_redraw2(term *_t, u16 s, u16 e)
    if (!t->buffer)
       return;
 
+   if (t->dirty) {
+      ts_mark_rows_dirty(t, s, e);
+      return;
+   }
+
    if (fpu_allowed)
       fpu_context_begin();
 
    for (u16 row = s; row < e; row++)
-      t->vi->set_row(row, get_buf_row(t, row), fpu_allowed);
+      t->vi->set_row(row, get_view_row(t, row), fpu_allowed);
 
    if (fpu_allowed)
       fpu_context_end();
@@ -212,29 +432,77 @@ static inline void term_redraw_scroll_region(term *_t)
    term_redraw2(t, *t->start_scroll_region, *t->end_scroll_region + 1);
 }
 
+/*
+ * Fills `view_buf` with the rows to show for `new_scroll` < max_scroll. The
+ * rows already in the view (t->scroll != max_scroll) are just moved, so that
+ * only the ones scrolled into view get decoded from the history.
+ */
+static bool ts_update_view(struct vterm *t, u32 new_scroll)
+{
+   const u32 hist_start = t->max_scroll - t->sb.count;
+   const size_t row_size = sizeof(u16) * t->cols;
+   u16 *const view = t->view_buf;
+   u32 s = 0, e = t->rows, d;
+
+   if (!view) {
+
+      t->view_buf = kalloc_array_obj(u16, t->rows * t->cols);
+
+      if (!t->view_buf)
+         return false;
+
+   } else if (t->scroll != t->max_scroll) {
+
+      if (new_scroll < t->scroll && t->scroll - new_scroll < t->rows) {
+
+         d = t->scroll - new_scroll;
+         memmove(view + d * t->cols, view, row_size * (t->rows - d));
+         e = d;
+
+      } else if (new_scroll > t->scroll && new_scroll - t->scroll < t->rows) {
+
+         d = new_scroll - t->scroll;
+         memmove(view, view + d * t->cols, row_size * (t->rows - d));
+         s = t->rows - d;
+      }
+   }
+
+   for (u32 r = s; r < e; r++) {
+
+      const u32 v = new_scroll + r;   /* absolute row number */
+      u16 *const dest = &t->view_buf[r * t->cols];
+
+      if (v < t->max_scroll)
+         sb_get_row(&t->sb, v - hist_start, dest);
+      else
+         memcpy(dest, get_buf_row(t, v - t->max_scroll), row_size);
+   }
+
+   return true;
+}
+
 static void ts_set_scroll(term *_t, u32 requested_scroll)
 {
    struct vterm *const t = _t;
 
    /*
     * 1. scroll cannot be > max_scroll
-    * 2. scroll cannot be < max_scroll - extra_buffer_rows, where
-    *    extra_buffer_rows = total_buffer_rows - VIDEO_ROWS.
-    *    In other words, if for example total_buffer_rows is 26, and max_scroll
-    *    is 1000, scroll cannot be less than 1000 + 25 - 26 = 999, which means
-    *    exactly 1 scroll row (extra_buffer_rows == 1).
+    * 2. scroll cannot be < max_scroll - the number of rows in the history.
+    *    In other words, if for example the history contains 1 row, and
+    *    max_scroll is 1000, scroll cannot be less than 999.
     */
 
-   const u32 min_scroll =
-      t->max_scroll > t->extra_buffer_rows
-         ? t->max_scroll - t->extra_buffer_rows
-         : 0;
+   const u32 min_scroll = t->max_scroll - MIN(t->max_scroll, t->sb.count);
 
    requested_scroll = CLAMP(requested_scroll, min_scroll, t->max_scroll);
 
    if (requested_scroll == t->scroll)
       return; /* nothing to do */
 
+   if (requested_scroll != t->max_scroll)
+      if (!ts_update_view(t, requested_scroll))
+         return; /* no memory for the view: just don't scroll */
+
    t->scroll = requested_scroll;
    term_redraw(t);
 }
@@ -271,13 +539,39 @@ static void ts_buf_clear_row(term *_t, u16 row, u8 color)
       return;
 
    memset16(get_buf_row(t, row), make_vgaentry(' ', color), t->cols);
+
+   if (t->dirty && row < t->rows)
+      ts_mark_dirty(t, row, 0, t->cols);
 }
 
 static void ts_clear_row(term *_t, u16 row, u8 color)
 {
    struct vterm *const t = _t;
    ts_buf_clear_row(t, row, color);
-   t->vi->clear_row(row, color);
+
+   if (!t->dirty && ts_is_at_bottom(t))
+      t->vi->clear_row(row, color);
+}
+
+static void ts_scroll_one_line_up(struct vterm *t)
+{
+   if (!t->dirty) {
+      t->vi->scroll_one_line_up();
+      return;
+   }
+
+   /* The damage moves up together with the text */
+   memmove(&t->dirty[0], &t->dirty[1], sizeof(t->dirty[0]) * (t->rows - 1));
+   t->dirty[t->rows - 1] = (struct dirty_span) { 0, 0 };
+   t->damaged = true;
+
+   if (t->pending_scroll < t->rows) {
+      t->pending_scroll++;
+   } else {
+      /* Too many scrolls: it's cheaper to redraw everything */
+      t->pending_scroll = 0;
+      ts_mark_rows_dirty(t, 0, t->rows);
+   }
 }
 
 /* ---------------- term actions --------------------- */
@@ -299,7 +593,7 @@ static void term_int_scroll_up(term *_t, u32 lines)
       } else {
 
          t->vi->enable_cursor();
-         t->vi->move_cursor(t->r, t->c, get_curr_cell_color(t));
+         ts_move_cursor(t);
       }
    }
 }
@@ -313,7 +607,7 @@ static void term_int_scroll_down(term *_t, u32 lines)
    if (t->cursor_enabled) {
       if (ts_is_at_bottom(t)) {
          t->vi->enable_cursor();
-         t->vi->move_cursor(t->r, t->c, get_curr_cell_color(t));
+         ts_move_cursor(t);
       }
    }
 }
@@ -331,6 +625,21 @@ term_action_scroll(term *_t, u32 lines, enum term_scroll_type st, ...)
    }
 }
 
+static void
+term_action_set_scrollback(term *_t, struct scrollback *new_sb, ...)
+{
+   struct vterm *const t = _t;
+
+   /* The view depends on the history: get back to the bottom first */
+   if (!ts_is_at_bottom(t))
+      term_int_scroll_down(t, t->max_scroll - t->scroll);
+
+   sb_move(new_sb, &t->sb);
+   sb_destroy(&t->sb);
+   t->sb = *new_sb;
+   kfree_obj(new_sb, struct scrollback);
+}
+
 static void term_action_non_buf_scroll_up(term *_t, u16 n, ...)
 {
    struct vterm *const t = _t;
@@ -397,7 +706,7 @@ static void term_action_move_ch_and_cur(term *_t, int row, int col, ...)
    t->c = (u16) CLAMP(col, 0, t->cols - 1);
 
    if (t->cursor_enabled)
-      t->vi->move_cursor(t->r, t->c, get_curr_cell_color(t));
+      ts_move_cursor(t);
 }
 
 static void term_internal_incr_row(term *_t)
@@ -425,11 +734,14 @@ static void term_internal_incr_row(term *_t)
       return;
    }
 
+   /* The first row leaves the screen: save it and rotate the ring */
+   sb_push_row(&t->sb, get_buf_row(t, 0));
+   t->buf_top = (u16)((t->buf_top + 1) % t->rows);
    t->max_scroll++;
 
    if (t->vi->scroll_one_line_up) {
       t->scroll++;
-      t->vi->scroll_one_line_up();
+      ts_scroll_one_line_up(t);
    } else {
       ts_set_scroll(t, t->max_scroll);
    }
@@ -440,9 +752,7 @@ static void term_internal_incr_row(term *_t)
 static void term_internal_write_printable_char(term *_t, u8 c, u8 color)
 {
    struct vterm *const t = _t;
-   const u16 entry = make_vgaentry(c, color);
-   buf_set_entry(t, t->r, t->c, entry);
-   t->vi->set_char_at(t->r, t->c, entry);
+   ts_set_char_at(t, t->r, t->c, make_vgaentry(c, color));
    t->c++;
 }
 
@@ -475,8 +785,7 @@ static void term_internal_write_backspace(term *_t, u8 color)
    t->c--;
 
    if (!t->tabs_buf || !t->tabs_buf[t->r * t->cols + t->c]) {
-      buf_set_entry(t, t->r, t->c, space_entry);
-      t->vi->set_char_at(t->r, t->c, space_entry);
+      ts_set_char_at(t, t->r, t->c, space_entry);
       return;
    }
 
@@ -554,6 +863,80 @@ static void term_internal_write_char2(term *_t, char c, u8 color)
    }
 }
 
+#define WORD_ONES             (~0ul / 255)          /* 0x0101...01 */
+#define WORD_HIGHS            (WORD_ONES * 0x80)    /* 0x8080...80 */
+
+/* True if any byte in `w` is < 0x20 or > 0x7e */
+#define WORD_HAS_NON_PRINTABLE(w)                                      \
+   ((((w) - WORD_ONES * 0x20) & ~(w) & WORD_HIGHS) |                   \
+    ((((w) + WORD_ONES * (0x7f - 0x7e)) | (w)) & WORD_HIGHS))
+
+/*
+ * Returns the length of the run of printable ASCII chars [0x20, 0x7e] at the
+ * beginning of `buf`. After having aligned the pointer, it checks a whole
+ * machine word at a time and it falls back to the byte-by-byte scan only to
+ * find the exact position of the first non-printable char.
+ */
+static u32 term_printable_run_len(const char *buf, u32 len)
+{
+   const u8 *p = (const u8 *)buf;
+   const u8 *const end = p + len;
+
+   while (p < end && ((ulong)p & (sizeof(ulong) - 1))) {
+
+      if (!IN_RANGE_INC(*p, 0x20, 0x7e))
+         return (u32)(p - (const u8 *)buf);
+
+      p++;
+   }
+
+   while (p + sizeof(ulong) <= end) {
+
+      if (WORD_HAS_NON_PRINTABLE(*(const ulong *)p))
+         break;
+
+      p += sizeof(ulong);
+   }
+
+   while (p < end && IN_RANGE_INC(*p, 0x20, 0x7e))
+      p++;
+
+   return (u32)(p - (const u8 *)buf);
+}
+
+/*
+ * Writes a run of printable chars directly in the buffer, one row at a time,
+ * with the same wrap-around semantics of term_internal_write_char2().
+ */
+static void
+term_internal_write_printable_run(struct vterm *t,
+                                  const char *buf,
+                                  u32 len,
+                                  u8 color)
+{
+   while (len > 0) {
+
+      u16 *row;
+      u16 n;
+
+      if (t->c == t->cols) {
+         t->c = 0;
+         term_internal_incr_row(t);
+      }
+
+      n = (u16)MIN(len, (u32)(t->cols - t->c));
+      row = get_buf_row(t, t->r);
+
+      for (u16 i = 0; i < n; i++)
+         row[t->c + i] = make_vgaentry((u8)buf[i], color);
+
+      ts_row_span_changed(t, t->r, t->c, (u16)(t->c + n));
+      t->c = (u16)(t->c + n);
+      buf += n;
+      len -= n;
+   }
+}
+
 static void term_action_write(term *_t, char *buf, u32 len, u8 color)
 {
    struct vterm *const t = _t;
@@ -570,6 +953,22 @@ static void term_action_write(term *_t, char *buf, u32 len, u8 color)
          continue;
       }
 
+      /*
+       * Fast path: when the filter is in a state where it lets the printable
+       * ASCII chars pass unchanged, write the whole run of them in one go and
+       * call the filter only for the chars requiring some processing.
+       */
+      if (t->filter_ascii_passthrough) {
+
+         const u32 n = term_printable_run_len(buf + i, len - i);
+
+         if (n > 0) {
+            term_internal_write_printable_run(t, buf + i, n, color);
+            i += n - 1;
+            continue;
+         }
+      }
+
       /*
        * NOTE: We MUST store buf[i] in a local variable because the filter
        * function is absolutely allowed to modify its contents!!
@@ -588,7 +987,7 @@ static void term_action_write(term *_t, char *buf, u32 len, u8 color)
    }
 
    if (t->cursor_enabled)
-      vi->move_cursor(t->r, t->c, get_curr_cell_color(t));
+      ts_move_cursor(t);
 }
 
 /* Direct write without any filter nor move_cursor/flush */
@@ -618,7 +1017,7 @@ static void term_action_move_ch_and_cur_rel(term *_t, s8 dr, s8 dc, ...)
    t->c = (u16) CLAMP((int)t->c + dc, 0, t->cols - 1);
 
    if (t->cursor_enabled)
-      t->vi->move_cursor(t->r, t->c, get_curr_cell_color(t));
+      ts_move_cursor(t);
 }
 
 static void term_action_reset(term *_t, ...)
@@ -628,6 +1027,7 @@ static void term_action_reset(term *_t, ...)
    t->vi->enable_cursor();
    term_action_move_ch_and_cur(t, 0, 0);
    t->scroll = t->max_scroll = 0;
+   sb_clear(&t->sb);
 
    for (u16 i = 0; i < t->rows; i++)
       ts_clear_row(t, i, DEFAULT_COLOR16);
@@ -647,10 +1047,8 @@ static void term_action_erase_in_display(term *_t, int mode, ...)
 
          /* Clear the screen from the cursor position up to the end */
 
-         for (u16 col = t->c; col < t->cols; col++) {
-            buf_set_entry(t, t->r, col, entry);
-            t->vi->set_char_at(t->r, col, entry);
-         }
+         for (u16 col = t->c; col < t->cols; col++)
+            ts_set_char_at(t, t->r, col, entry);
 
          for (u16 i = t->r + 1; i < t->rows; i++)
             ts_clear_row(t, i, DEFAULT_COLOR16);
@@ -664,10 +1062,8 @@ static void term_action_erase_in_display(term *_t, int mode, ...)
          for (u16 i = 0; i < t->r; i++)
             ts_clear_row(t, i, DEFAULT_COLOR16);
 
-         for (u16 col = 0; col < t->c; col++) {
-            buf_set_entry(t, t->r, col, entry);
-            t->vi->set_char_at(t->r, col, entry);
-         }
+         for (u16 col = 0; col < t->c; col++)
+            ts_set_char_at(t, t->r, col, entry);
 
          break;
 
@@ -705,17 +1101,13 @@ static void term_action_erase_in_line(term *_t, int mode, ...)
    switch (mode) {
 
       case 0:
-         for (u16 col = t->c; col < t->cols; col++) {
-            buf_set_entry(t, t->r, col, entry);
-            t->vi->set_char_at(t->r, col, entry);
-         }
+         for (u16 col = t->c; col < t->cols; col++)
+            ts_set_char_at(t, t->r, col, entry);
          break;
 
       case 1:
-         for (u16 col = 0; col < t->c; col++) {
-            buf_set_entry(t, t->r, col, entry);
-            t->vi->set_char_at(t->r, col, entry);
-         }
+         for (u16 col = 0; col < t->c; col++)
+            ts_set_char_at(t, t->r, col, entry);
          break;
 
       case 2:
@@ -767,8 +1159,7 @@ static void term_action_ins_blank_chars(term *_t, u16 n, ...)
    for (u16 c = t->c; c < t->c + n; c++)
       buf_row[c] = make_vgaentry(' ', vgaentry_get_color(buf_row[c]));
 
-   for (u16 c = t->c; c < t->cols; c++)
-      t->vi->set_char_at(row, c, buf_row[c]);
+   ts_row_span_changed(t, row, t->c, t->cols);
 }
 
 static void term_action_del_chars_in_line(term *_t, u16 n, ...)
@@ -784,8 +1175,7 @@ static void term_action_del_chars_in_line(term *_t, u16 n, ...)
    for (u16 c = t->c + cN; c < MIN(t->c + cN + n - maxN, t->cols); c++)
       buf_row[c] = make_vgaentry(' ', vgaentry_get_color(buf_row[c]));
 
-   for (u16 c = t->c; c < t->cols; c++)
-      t->vi->set_char_at(row, c, buf_row[c]);
+   ts_row_span_changed(t, row, t->c, t->cols);
 }
 
 static void term_action_erase_chars_in_line(term *_t, u16 n, ...)
@@ -794,17 +1184,21 @@ static void term_action_erase_chars_in_line(term *_t, u16 n, ...)
    const u16 row = t->r;
    u16 *const buf_row = get_buf_row(t, row);
 
-   for (u16 c = t->c; c < MIN(t->cols, t->c + n); c++)
+   const u16 end = (u16)MIN(t->cols, t->c + n);
+
+   for (u16 c = t->c; c < end; c++)
       buf_row[c] = make_vgaentry(' ', vgaentry_get_color(buf_row[c]));
 
-   for (u16 c = t->c; c < t->cols; c++)
-      t->vi->set_char_at(row, c, buf_row[c]);
+   ts_row_span_changed(t, row, t->c, end);
 }
 
 static void term_action_pause_video_output(term *_t, ...)
 {
    struct vterm *const t = _t;
 
+   /* Draw the pending damage, before switching to no_output_vi */
+   term_flush(t);
+
    if (t->vi->disable_static_elems_refresh)
       t->vi->disable_static_elems_refresh();
 
@@ -859,7 +1253,7 @@ static void
 term_action_use_alt_buffer(term *_t, bool use_alt_buffer, ...)
 {
    struct vterm *const t = _t;
-   u16 *b = get_buf_row(t, 0);
+   const size_t row_size = sizeof(u16) * t->cols;
 
    if (t->using_alt_buffer == use_alt_buffer)
       return;
@@ -877,13 +1271,22 @@ term_action_use_alt_buffer(term *_t, bool use_alt_buffer, ...)
       t->tabs_buf = t->alt_tabs_buf;
       t->saved_cur_row = t->r;
       t->saved_cur_col = t->c;
-      memcpy(t->screen_buf_copy, b, sizeof(u16) * t->rows * t->cols);
+
+      for (u16 row = 0; row < t->rows; row++) {
+         memcpy(&t->screen_buf_copy[row * t->cols],
+                get_buf_row(t, row),
+                row_size);
+      }
 
    } else {
 
       ASSERT(t->screen_buf_copy != NULL);
 
-      memcpy(b, t->screen_buf_copy, sizeof(u16) * t->rows * t->cols);
+      for (u16 row = 0; row < t->rows; row++) {
+         memcpy(get_buf_row(t, row),
+                &t->screen_buf_copy[row * t->cols],
+                row_size);
+      }
       t->r = t->saved_cur_row;
       t->c = t->saved_cur_col;
       t->tabs_buf = t->main_tabs_buf;
@@ -935,7 +1338,7 @@ term_action_del_lines(term *_t, u32 n)
 
    n = MIN(n, (u32)(eR - t->r));
 
-   for (u32 row = t->r; row <= t->r + n; row++)
+   for (u32 row = t->r; row + n < eR; row++)
       buf_copy_row(t, row, row + n);
 
    for (u32 row = eR - n; row < eR; row++)
@@ -1007,6 +1410,7 @@ debug_term_dump_font_table(term *_t)
 
    term_internal_incr_row(t);
    t->c = 0;
+   term_flush(t);
 }
 
 #endif
@@ -1034,10 +1438,17 @@ dispose_term(term *_t)
    dispose_term_rb_data(&t->rb_data);
 
    if (t->buffer) {
-      kfree_array_obj(t->buffer, u16, t->total_buffer_rows * t->cols);
+      kfree_array_obj(t->buffer, u16, t->rows * t->cols);
       t->buffer = NULL;
    }
 
+   if (t->view_buf) {
+      kfree_array_obj(t->view_buf, u16, t->rows * t->cols);
+      t->view_buf = NULL;
+   }
+
+   sb_destroy(&t->sb);
+
    if (t->main_tabs_buf) {
       kfree2(t->main_tabs_buf, t->cols * t->rows);
       t->main_tabs_buf = NULL;
@@ -1052,6 +1463,11 @@ dispose_term(term *_t)
       kfree_array_obj(t->screen_buf_copy, u16, t->rows * t->cols);
       t->screen_buf_copy = NULL;
    }
+
+   if (t->dirty) {
+      kfree_array_obj(t->dirty, struct dirty_span, t->rows);
+      t->dirty = NULL;
+   }
 }
 
 static void
@@ -1067,12 +1483,48 @@ vterm_get_params(term *_t, struct term_params *out)
    };
 }
 
+static void vterm_flush_thread()
+{
+   struct term_action a;
+   struct vterm *t;
+
+   term_make_action_flush(&a);
+
+   while (true) {
+
+      kernel_sleep(TERM_FLUSH_TICKS);
+
+      if (get_curr_term_intf() != video_term_intf)
+         continue;
+
+      t = get_curr_term();
+
+      /* Unsafe check, like in vterm_is_initialized() */
+      if (t->damaged || t->cursor_dirty)
+         term_execute_or_enqueue_action(t, &a);
+   }
+}
+
+static void create_flush_thread_if_necessary(void)
+{
+   if (flush_thread_created)
+      return;
+
+   if (kthread_create(vterm_flush_thread, 0, NULL) < 0) {
+      printk("WARNING: unable to create vterm_flush_thread\n");
+      return;
+   }
+
+   flush_thread_created = true;
+}
+
 /*
- * Calculate an optimal number of extra buffer rows to use for a term of size
- * `rows` x `cols`, in order to minimize the memory waste (happening when the
- * buffer size is not a power of 2).
+ * Calculate the default number of history rows for a term with `cols` columns.
+ * The memory budget is the one of the old uncompressed scroll buffer, but the
+ * rows are compressed (see scrollback.h): typically that gives a few times
+ * more rows of history.
  */
-static u32 term_calc_extra_buf_rows(u16 rows, u16 cols)
+static u32 term_calc_scrollback_rows(u16 cols)
 {
    u32 buf_size = 0;
 
@@ -1088,7 +1540,7 @@ static u32 term_calc_extra_buf_rows(u16 rows, u16 cols)
    if (TERM_BIG_SCROLL_BUF)
       buf_size *= 4;
 
-   return (buf_size / 2) / cols - rows;
+   return buf_size / SB_AVG_ROW_BYTES(cols);
 }
 
 static int
@@ -1129,21 +1581,27 @@ init_vterm(term *_t,
                      sizeof(struct term_action),
                      t->actions_buf);
 
-   if (!in_panic() && intf) {
+   if (!in_panic() && intf && is_kmalloc_initialized()) {
 
-      t->extra_buffer_rows =
-         rows_buf >= 0
-            ? (u32)rows_buf
-            : term_calc_extra_buf_rows(rows, cols);
+      t->buffer = kalloc_array_obj(u16, t->rows * t->cols);
 
-      t->total_buffer_rows = t->rows + t->extra_buffer_rows;
+      if (t->buffer) {
 
-      if (is_kmalloc_initialized())
-         t->buffer = kmalloc(2 * t->total_buffer_rows * t->cols);
+         const u32 sb_rows =
+            rows_buf >= 0
+               ? (u32)rows_buf
+               : term_calc_scrollback_rows(cols);
+
+         if (sb_init(&t->sb, t->cols, sb_rows) < 0)
+            printk("WARNING: unable to allocate the term scrollback\n");
+      }
    }
 
    if (t->buffer) {
 
+      if (TERM_DAMAGE_TRACKING)
+         t->dirty = kzalloc_array_obj(struct dirty_span, t->rows);
+
       t->main_tabs_buf = kzmalloc(t->cols * t->rows);
 
       if (t->main_tabs_buf) {
@@ -1153,7 +1611,12 @@ init_vterm(term *_t,
       } else {
 
          if (t != &first_instance) {
-            kfree2(t->buffer, 2 * t->total_buffer_rows * t->cols);
+
+            if (t->dirty)
+               kfree_array_obj(t->dirty, struct dirty_span, t->rows);
+
+            sb_destroy(&t->sb);
+            kfree_array_obj(t->buffer, u16, t->rows * t->cols);
             return -ENOMEM;
          }
 
@@ -1170,8 +1633,6 @@ init_vterm(term *_t,
       t->cols = (u16) MIN((u16)80, t->cols);
       t->rows = (u16) MIN((u16)25, t->rows);
 
-      t->extra_buffer_rows = 0;
-      t->total_buffer_rows = t->rows;
       t->buffer = failsafe_buffer;
 
       if (!in_panic() && intf)
@@ -1185,6 +1646,11 @@ init_vterm(term *_t,
    for (u16 i = 0; i < t->rows; i++)
       ts_clear_row(t, i, DEFAULT_COLOR16);
 
+   term_flush(t);
+
+   if (TERM_DAMAGE_FPS > 0 && t->dirty && t != &first_instance)
+      create_flush_thread_if_necessary();
+
    t->initialized = true;
    return 0;
 }
@@ -1212,6 +1678,8 @@ static const struct term_interface intf = {
    .pause_video_output = vterm_pause_video_output,
    .restart_video_output = vterm_restart_video_output,
    .set_filter = vterm_set_filter,
+   .get_scrollback = vterm_get_scrollback,
+   .set_scrollback = vterm_set_scrollback,
 
    .get_first_term = vterm_get_first_inst,
    .video_term_init = init_vterm,
@@ -32,6 +32,8 @@ enum term_action_type {
    a_insert_blank_chars,
    a_simple_del_chars,
    a_simple_erase_chars,
+   a_flush,                      // [4]
+   a_set_scrollback,             // [5]
 };
 
 /*
@@ -50,6 +52,11 @@ enum term_action_type {
  *          REASON: because the `CSI n S` sequence is called SU (Scroll Up) and
  *             the `CSI n T` sequence is called SD (Scroll Down), despite what
  *             traditionally up and down mean when it's about scrolling.
+ *
+ *    [4] draw the damaged cells (see TERM_DAMAGE_TRACKING). Used internally.
+ *
+ *    [5] ptr: a new, empty, struct scrollback to move the history into. The
+ *          action takes the ownership of it. Used internally.
  */
 
 enum term_del_type {
@@ -312,3 +319,21 @@ term_make_action_simple_erase_chars(struct term_action *a, u16 num)
       .arg = num,
    };
 }
+
+static ALWAYS_INLINE void
+term_make_action_flush(struct term_action *a)
+{
+   *a = (struct term_action) {
+      .type1 = a_flush,
+      .arg = 0,
+   };
+}
+
+static ALWAYS_INLINE void
+term_make_action_set_scrollback(struct term_action *a, void *sb)
+{
+   *a = (struct term_action) {
+      .type3 = a_set_scrollback,
+      .ptr = (ulong)sb,
+   };
+}
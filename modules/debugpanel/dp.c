@@ -42,9 +42,13 @@ static ATOMIC(bool) dp_running;
 static struct list dp_screens_list = STATIC_LIST_INIT(dp_screens_list);
 
 static inline void
-dp_write_header(int i, const char *s, bool selected)
+dp_write_header(int i, const char *s, bool selected, bool compact)
 {
-   if (selected) {
+   if (compact && !selected) {
+
+      dp_write_raw("%d" RESET_ATTRS " ", i);
+
+   } else if (selected) {
 
       dp_write_raw(
          E_COLOR_BR_WHITE "%d" REVERSE_VIDEO "[%s]" RESET_ATTRS " ",
@@ -126,8 +130,25 @@ void dp_register_screen(struct dp_screen *screen)
    list_add_after(pred, &screen->node);
 }
 
+/*
+ * When the labels of all the screens don't fit in the header, show the label
+ * only for the current screen and just the number for the others.
+ */
+static bool dp_need_compact_header(void)
+{
+   struct dp_screen *pos;
+   int len = (int)strlen("q[Quit] ");
+
+   list_for_each_ro(pos, &dp_screens_list, node) {
+      len += (int)strlen(pos->label) + 4;   /* "N[label] " */
+   }
+
+   return len > DP_W - 4;
+}
+
 static void redraw_screen(void)
 {
+   const bool compact = dp_need_compact_header();
    struct dp_screen *pos;
    char buf[64];
    int rc;
@@ -136,7 +157,7 @@ static void redraw_screen(void)
    dp_move_cursor(dp_start_row + 1, dp_start_col + 2);
 
    list_for_each_ro(pos, &dp_screens_list, node) {
-      dp_write_header(pos->index+1, pos->label, pos == dp_ctx);
+      dp_write_header((pos->index+1) % 10, pos->label, pos == dp_ctx, compact);
    }
 
    dp_write_raw("q[Quit]" RESET_ATTRS " ");
@@ -168,6 +189,10 @@ dp_main_handle_keypress(struct key_event ke)
       struct dp_screen *pos;
       rc = ke.print_char - '0';
 
+      /* The 10th screen is selected by '0', like the last key of the row */
+      if (rc == 0)
+         rc = 10;
+
       list_for_each_ro(pos, &dp_screens_list, node) {
 
          if (pos->index == rc - 1 && pos != dp_ctx) {
@@ -0,0 +1,224 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/sort.h>
+#include <tilck/kernel/lock_stats.h>
+
+#include "termutil.h"
+#include "dp_int.h"
+
+/* All the classes, plus "<other>" */
+#define DP_LOCKS_MAX_ROWS                (LOCK_STATS_MAX_CLASSES + 1)
+
+static struct lock_class_stats *classes;
+static u32 classes_count;
+static char order_by = 'w';
+
+static long dp_locks_cmpf_acq(const void *a, const void *b)
+{
+   const struct lock_class_stats *x = a;
+   const struct lock_class_stats *y = b;
+
+   if (x->acquisitions == y->acquisitions)
+      return 0;
+
+   return y->acquisitions > x->acquisitions ? 1 : -1;
+}
+
+static long dp_locks_cmpf_contended(const void *a, const void *b)
+{
+   const struct lock_class_stats *x = a;
+   const struct lock_class_stats *y = b;
+
+   if (x->contended == y->contended)
+      return 0;
+
+   return y->contended > x->contended ? 1 : -1;
+}
+
+static long dp_locks_cmpf_wait(const void *a, const void *b)
+{
+   const struct lock_class_stats *x = a;
+   const struct lock_class_stats *y = b;
+
+   if (x->tot_wait == y->tot_wait)
+      return 0;
+
+   return y->tot_wait > x->tot_wait ? 1 : -1;
+}
+
+static long dp_locks_cmpf_hold(const void *a, const void *b)
+{
+   const struct lock_class_stats *x = a;
+   const struct lock_class_stats *y = b;
+
+   if (x->max_hold == y->max_hold)
+      return 0;
+
+   return y->max_hold > x->max_hold ? 1 : -1;
+}
+
+static void dp_locks_fmt_cycles(char *buf, size_t sz, u64 val)
+{
+   if (val < 100 * 1000)
+      snprintk(buf, sz, "%llu", val);
+   else if (val < 100 * 1000 * 1000)
+      snprintk(buf, sz, "%lluK", val / 1000);
+   else
+      snprintk(buf, sz, "%lluM", val / 1000 / 1000);
+}
+
+static void dp_locks_load_stats(void)
+{
+   cmpfun_ptr cmpf;
+
+   classes_count = lock_stats_get_all(classes, DP_LOCKS_MAX_ROWS);
+
+   switch (order_by) {
+      case 'a':
+         cmpf = dp_locks_cmpf_acq;
+         break;
+      case 'c':
+         cmpf = dp_locks_cmpf_contended;
+         break;
+      case 'h':
+         cmpf = dp_locks_cmpf_hold;
+         break;
+      default:
+         cmpf = dp_locks_cmpf_wait;
+   }
+
+   insertion_sort_generic(classes, sizeof(classes[0]), classes_count, cmpf);
+}
+
+static void dp_locks_enter(void)
+{
+   if (!KRN_LOCK_STATS)
+      return;
+
+   if (!classes) {
+
+      classes = kalloc_array_obj(struct lock_class_stats, DP_LOCKS_MAX_ROWS);
+
+      if (!classes)
+         panic("Unable to alloc memory for the lock stats");
+   }
+}
+
+static int dp_locks_keypress(struct key_event ke)
+{
+   const char c = ke.print_char;
+
+   if (!KRN_LOCK_STATS)
+      return kb_handler_nak;
+
+   switch (c) {
+
+      case 'a':
+      case 'c':
+      case 'w':
+      case 'h':
+         order_by = c;
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      case 'r':
+         lock_stats_reset();
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      default:
+         return kb_handler_nak;
+   }
+}
+
+static void dp_show_locks(void)
+{
+   int row = dp_screen_start_row;
+   const int max_rows = dp_screen_rows - 5;
+   char name[48], tot_wait[16], max_wait[16], max_hold[16];
+   char cl_name[32];
+
+   if (!KRN_LOCK_STATS) {
+      dp_writeln("Not available: recompile with KRN_LOCK_STATS=1");
+      return;
+   }
+
+   dp_locks_load_stats();
+
+   dp_writeln(
+      "Order by: "
+      E_COLOR_BR_WHITE "a" RESET_ATTRS "cquisitions, "
+      E_COLOR_BR_WHITE "c" RESET_ATTRS "ontended, "
+      E_COLOR_BR_WHITE "w" RESET_ATTRS "ait, "
+      E_COLOR_BR_WHITE "h" RESET_ATTRS "old  ["
+      E_COLOR_BR_WHITE "r" RESET_ATTRS "]eset  (TSC cycles)"
+   );
+
+   dp_writeln("");
+
+   dp_writeln(
+      " Lock class (type, init site) "
+      TERM_VLINE "%s" "   Acq   "             RESET_ATTRS
+      TERM_VLINE "%s" "  Cont  "              RESET_ATTRS
+      TERM_VLINE "%s" "  Wait  "              RESET_ATTRS
+      TERM_VLINE      " MaxWait"
+      TERM_VLINE "%s" " MaxHold"              RESET_ATTRS,
+      order_by == 'a' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'c' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'w' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'h' ? E_COLOR_BR_WHITE REVERSE_VIDEO : ""
+   );
+
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqqqqqqqqqqqqqqqqqqqqqq"
+      "nqqqqqqqqqnqqqqqqqqnqqqqqqqqnqqqqqqqqnqqqqqqqq"
+      GFX_OFF
+   );
+
+   for (u32 i = 0; i < classes_count && (int)i < max_rows; i++) {
+
+      struct lock_class_stats *cl = &classes[i];
+
+      lock_stats_get_class_name(cl, cl_name, sizeof(cl_name));
+      snprintk(name, sizeof(name), "%s %s",
+               lock_stats_get_type_str(cl), cl_name);
+
+      dp_locks_fmt_cycles(tot_wait, sizeof(tot_wait), cl->tot_wait);
+      dp_locks_fmt_cycles(max_wait, sizeof(max_wait), cl->max_wait);
+      dp_locks_fmt_cycles(max_hold, sizeof(max_hold), cl->max_hold);
+
+      dp_writeln(" %-28.28s "
+                 TERM_VLINE " %7llu "
+                 TERM_VLINE " %6llu "
+                 TERM_VLINE " %6s "
+                 TERM_VLINE " %6s "
+                 TERM_VLINE " %6s",
+                 name, cl->acquisitions, cl->contended,
+                 tot_wait, max_wait, max_hold);
+   }
+
+   dp_writeln("");
+}
+
+static struct dp_screen dp_locks_screen =
+{
+   .index = 8,
+   .label = "Locks",
+   .draw_func = dp_show_locks,
+   .on_dp_enter = dp_locks_enter,
+   .on_keypress_func = dp_locks_keypress,
+};
+
+__attribute__((constructor))
+static void dp_locks_init(void)
+{
+   dp_register_screen(&dp_locks_screen);
+}
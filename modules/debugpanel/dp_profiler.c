@@ -0,0 +1,203 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/mod_tracing.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/sort.h>
+
+#include <tilck/mods/profiler.h>
+
+#include "termutil.h"
+#include "dp_int.h"
+
+#if MOD_tracing
+
+/* Max number of distinct functions tracked while aggregating the samples */
+#define DP_PROF_MAX_FUNCS                                      128
+
+struct prof_func_row {
+
+   const char *name;
+   u32 samples;
+};
+
+struct prof_agg_ctx {
+
+   u32 tot;
+   u32 user;
+   u32 other;           /* kernel samples not fitting in `funcs` */
+   u32 funcs_count;
+};
+
+static struct prof_func_row *funcs;
+static struct prof_agg_ctx agg;
+
+static long dp_prof_cmpf(const void *a, const void *b)
+{
+   const struct prof_func_row *x = a;
+   const struct prof_func_row *y = b;
+   return (long)y->samples - (long)x->samples;
+}
+
+static void dp_prof_agg_cb(struct prof_sample *s, void *arg)
+{
+   struct prof_agg_ctx *ctx = arg;
+   const char *name;
+   u32 i;
+
+   ctx->tot++;
+
+   if (s->flags & PROF_SAMPLE_USER) {
+      ctx->user++;
+      return;
+   }
+
+   if (!(name = prof_get_kernel_sym(s, 0)))
+      name = "?";
+
+   /* Symbol names are pointers in the kernel's strtab: compare them directly */
+   for (i = 0; i < ctx->funcs_count; i++)
+      if (funcs[i].name == name)
+         break;
+
+   if (i == ctx->funcs_count) {
+
+      if (i == DP_PROF_MAX_FUNCS) {
+         ctx->other++;
+         return;
+      }
+
+      funcs[i] = (struct prof_func_row) { .name = name, .samples = 0 };
+      ctx->funcs_count++;
+   }
+
+   funcs[i].samples++;
+}
+
+static void dp_prof_load_samples(void)
+{
+   bzero(&agg, sizeof(agg));
+   prof_foreach_sample(dp_prof_agg_cb, &agg);
+
+   insertion_sort_generic(funcs,
+                          sizeof(funcs[0]),
+                          agg.funcs_count,
+                          dp_prof_cmpf);
+}
+
+static void dp_prof_enter(void)
+{
+   if (!funcs) {
+      if (!(funcs = kalloc_array_obj(struct prof_func_row, DP_PROF_MAX_FUNCS)))
+         panic("Unable to alloc memory for the profiler view");
+   }
+}
+
+static int dp_prof_keypress(struct key_event ke)
+{
+   const char c = ke.print_char;
+
+   switch (c) {
+
+      case 'e':
+         if (prof_set_enabled(!prof_is_enabled()))
+            modal_msg = "Out of memory";
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      case 'r':
+         prof_reset();
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      case '+':
+      case '-':
+         prof_set_interval(
+            c == '+' ? prof_get_interval() + 1 : prof_get_interval() - 1
+         );
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      default:
+         return kb_handler_nak;
+   }
+}
+
+static void dp_prof_writeln_row(int *row_ref, const char *name, u32 samples)
+{
+   int row = *row_ref;
+   const u32 pct10 = agg.tot ? (u32)((u64)samples * 1000 / agg.tot) : 0;
+
+   dp_writeln(" %-56.56s "
+              TERM_VLINE " %6u "
+              TERM_VLINE " %3u.%u",
+              name, samples, pct10 / 10, pct10 % 10);
+
+   *row_ref = row;
+}
+
+static void dp_show_profiler(void)
+{
+   int row = dp_screen_start_row;
+   const int max_rows = dp_screen_rows - 6;
+
+   dp_prof_load_samples();
+
+   dp_writeln(
+      "Profiler: %s  ["
+      E_COLOR_BR_WHITE "e" RESET_ATTRS "]nable/disable, "
+      E_COLOR_BR_WHITE "r" RESET_ATTRS "]eset, "
+      "interval: %u tick(s) ["
+      E_COLOR_BR_WHITE "+" RESET_ATTRS "/"
+      E_COLOR_BR_WHITE "-" RESET_ATTRS "]",
+      prof_is_enabled()
+         ? E_COLOR_GREEN "ON" RESET_ATTRS
+         : E_COLOR_RED "OFF" RESET_ATTRS,
+      prof_get_interval()
+   );
+
+   dp_writeln("Samples: %u (user mode: %u)", agg.tot, agg.user);
+   dp_writeln("");
+
+   dp_writeln(
+      " Function (where the kernel was interrupted)              "
+      TERM_VLINE " Samples "
+      TERM_VLINE "   %%  "
+   );
+
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqq"
+      "nqqqqqqqqnqqqqqqq"
+      GFX_OFF
+   );
+
+   for (u32 i = 0; i < agg.funcs_count && (int)i < max_rows; i++)
+      dp_prof_writeln_row(&row, funcs[i].name, funcs[i].samples);
+
+   if (agg.other)
+      dp_prof_writeln_row(&row, "<other>", agg.other);
+
+   dp_writeln("");
+}
+
+static struct dp_screen dp_profiler_screen =
+{
+   .index = 7,
+   .label = "Profiler",
+   .draw_func = dp_show_profiler,
+   .on_dp_enter = dp_prof_enter,
+   .on_keypress_func = dp_prof_keypress,
+};
+
+__attribute__((constructor))
+static void dp_profiler_init(void)
+{
+   dp_register_screen(&dp_profiler_screen);
+}
+
+#endif // #if MOD_tracing
@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sched_lat.h>
+#include <tilck/kernel/timer.h>
+
+#include "termutil.h"
+#include "dp_int.h"
+
+static struct sched_lat_stats stats;
+static int row;
+
+static void dp_sched_lat_fmt_ns(char *buf, size_t sz, u64 ns)
+{
+   if (ns < 10 * 1000)
+      snprintk(buf, sz, "%llu ns", ns);
+   else if (ns < 10 * 1000 * 1000)
+      snprintk(buf, sz, "%llu us", ns / 1000);
+   else
+      snprintk(buf, sz, "%llu ms", ns / 1000 / 1000);
+}
+
+static void dp_sched_lat_show_summary(const char *name,
+                                      struct sched_lat_hist *h)
+{
+   char avg[16], max[16];
+   const u64 avg_cycles = h->count ? h->tot / h->count : 0;
+
+   dp_sched_lat_fmt_ns(avg, sizeof(avg), tsc_to_ns(avg_cycles));
+   dp_sched_lat_fmt_ns(max, sizeof(max), tsc_to_ns(h->max));
+
+   dp_writeln(" %-10s "
+              TERM_VLINE " %10llu "
+              TERM_VLINE " %10s "
+              TERM_VLINE " %10s",
+              name, h->count, avg, max);
+}
+
+/*
+ * One row per log2 bucket, from the first to the last non-zero one. When they
+ * don't fit, the first row accumulates all the shorter latencies too.
+ */
+static void dp_sched_lat_show_hist(int max_rows)
+{
+   struct sched_lat_hist *w = &stats.wakeup;
+   struct sched_lat_hist *r = &stats.runq;
+   int first, last, lo;
+   u32 wc, rc;
+   char from[16];
+
+   for (first = 0; first < SCHED_LAT_HIST_SIZE; first++)
+      if (w->hist[first] || r->hist[first])
+         break;
+
+   if (first == SCHED_LAT_HIST_SIZE || max_rows < 1)
+      return;
+
+   for (last = SCHED_LAT_HIST_SIZE - 1; last > first; last--)
+      if (w->hist[last] || r->hist[last])
+         break;
+
+   lo = first;
+   first = MAX(first, last - max_rows + 1);
+
+   dp_writeln(" %-10s " TERM_VLINE "   Wakeup   " TERM_VLINE "    RunQ",
+              "Latency >=");
+
+   dp_writeln(GFX_ON "qqqqqqqqqqqqnqqqqqqqqqqqqnqqqqqqqqqqqq" GFX_OFF);
+
+   for (int b = first; b <= last; b++) {
+
+      wc = w->hist[b];
+      rc = r->hist[b];
+
+      if (b == first) {
+         for (int i = lo; i < first; i++) {
+            wc += w->hist[i];
+            rc += r->hist[i];
+         }
+      }
+
+      if (b == first && lo < first)
+         dp_sched_lat_fmt_ns(from, sizeof(from), 0);
+      else
+         dp_sched_lat_fmt_ns(from, sizeof(from), tsc_to_ns(1ull << b));
+
+      dp_writeln(" %-10s " TERM_VLINE " %10u " TERM_VLINE " %10u",
+                 from, wc, rc);
+   }
+}
+
+static void dp_sched_lat_show_worst(void)
+{
+   struct sched_lat_worst *wr = &stats.worst;
+   char lat[16];
+
+   if (!wr->latency)
+      return;
+
+   dp_sched_lat_fmt_ns(lat, sizeof(lat), tsc_to_ns(wr->latency));
+
+   dp_writeln(
+      "Worst wakeup: " E_COLOR_BR_WHITE "%s" RESET_ATTRS
+      ", tid %d (woken by: %d, ran after: %d)",
+      lat, wr->tid, wr->waker_tid, wr->prev_tid
+   );
+
+   dp_writeln(
+      "Reason: " E_COLOR_BR_WHITE "%s" RESET_ATTRS
+      " (preempt disable count: %d)",
+      sched_lat_get_reason_str(wr), wr->preempt_count
+   );
+}
+
+static int dp_sched_lat_keypress(struct key_event ke)
+{
+   if (!KRN_SCHED_LAT_STATS)
+      return kb_handler_nak;
+
+   if (ke.print_char == 'r') {
+      sched_lat_reset();
+      ui_need_update = true;
+      return kb_handler_ok_and_continue;
+   }
+
+   return kb_handler_nak;
+}
+
+static void dp_show_sched_lat(void)
+{
+   row = dp_screen_start_row;
+
+   if (!KRN_SCHED_LAT_STATS) {
+      dp_writeln("Not available: recompile with KRN_SCHED_LAT_STATS=1");
+      return;
+   }
+
+   sched_lat_get_stats(&stats);
+
+   dp_writeln(
+      "Time slice: %d ticks (%d ms)  ["
+      E_COLOR_BR_WHITE "r" RESET_ATTRS "]eset",
+      TIME_SLICE_TICKS, TIME_SLICE_TICKS * 1000 / TIMER_HZ
+   );
+
+   dp_writeln("");
+   dp_writeln(" %-10s " TERM_VLINE "   Count    "
+              TERM_VLINE "    Avg     " TERM_VLINE "    Max",
+              "Latency");
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqqqqnqqqqqqqqqqqqnqqqqqqqqqqqqnqqqqqqqqqqqq"
+      GFX_OFF
+   );
+
+   dp_sched_lat_show_summary("Wakeup", &stats.wakeup);
+   dp_sched_lat_show_summary("RunQ", &stats.runq);
+   dp_writeln("");
+
+   dp_sched_lat_show_worst();
+   dp_writeln("");
+
+   /* All the rows above, plus the header of the histogram */
+   dp_sched_lat_show_hist(dp_screen_rows - 13);
+   dp_writeln("");
+}
+
+static struct dp_screen dp_sched_lat_screen =
+{
+   .index = 9,
+   .label = "SchedLat",
+   .draw_func = dp_show_sched_lat,
+   .on_keypress_func = dp_sched_lat_keypress,
+};
+
+__attribute__((constructor))
+static void dp_sched_lat_init(void)
+{
+   dp_register_screen(&dp_sched_lat_screen);
+}
@@ -0,0 +1,265 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/mod_tracing.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/sort.h>
+
+#include <tilck/mods/tracing.h>
+
+#include "termutil.h"
+#include "dp_int.h"
+
+#if MOD_tracing
+
+struct sys_stat_row {
+
+   u32 sys_n;
+   u64 calls;
+   u64 tot;
+   u64 avg;
+   u64 max;
+   u64 p50;
+   u64 p99;
+};
+
+static struct sys_stat_row *rows;
+static u32 rows_count;
+static char order_by = 't';
+
+static long dp_sys_cmpf_calls(const void *a, const void *b)
+{
+   const struct sys_stat_row *x = a;
+   const struct sys_stat_row *y = b;
+   return x->calls == y->calls ? 0 : (y->calls > x->calls ? 1 : -1);
+}
+
+static long dp_sys_cmpf_tot(const void *a, const void *b)
+{
+   const struct sys_stat_row *x = a;
+   const struct sys_stat_row *y = b;
+   return x->tot == y->tot ? 0 : (y->tot > x->tot ? 1 : -1);
+}
+
+static long dp_sys_cmpf_avg(const void *a, const void *b)
+{
+   const struct sys_stat_row *x = a;
+   const struct sys_stat_row *y = b;
+   return x->avg == y->avg ? 0 : (y->avg > x->avg ? 1 : -1);
+}
+
+static long dp_sys_cmpf_max(const void *a, const void *b)
+{
+   const struct sys_stat_row *x = a;
+   const struct sys_stat_row *y = b;
+   return x->max == y->max ? 0 : (y->max > x->max ? 1 : -1);
+}
+
+/* Upper bound of the histogram bucket containing the p-th percentile */
+static u64 dp_sys_percentile(struct syscall_stats *st, u32 p)
+{
+   const u64 target = (st->calls * p + 99) / 100;
+   u64 sum = 0;
+   u32 i;
+
+   for (i = 0; i < SYS_STATS_HIST_SIZE - 1; i++) {
+
+      sum += st->hist[i];
+
+      if (sum >= target)
+         break;
+   }
+
+   return 2ull << i;
+}
+
+static void dp_sys_fmt_cycles(char *buf, size_t sz, u64 val)
+{
+   if (val < 100 * 1000)
+      snprintk(buf, sz, "%llu", val);
+   else if (val < 100 * 1000 * 1000)
+      snprintk(buf, sz, "%lluK", val / 1000);
+   else
+      snprintk(buf, sz, "%lluM", val / 1000 / 1000);
+}
+
+static void dp_sys_sort(void)
+{
+   cmpfun_ptr cmpf;
+
+   switch (order_by) {
+      case 'c':
+         cmpf = dp_sys_cmpf_calls;
+         break;
+      case 'a':
+         cmpf = dp_sys_cmpf_avg;
+         break;
+      case 'm':
+         cmpf = dp_sys_cmpf_max;
+         break;
+      default:
+         cmpf = dp_sys_cmpf_tot;
+   }
+
+   insertion_sort_generic(rows, sizeof(rows[0]), rows_count, cmpf);
+}
+
+static void dp_sys_load_stats(void)
+{
+   struct syscall_stats st;
+   rows_count = 0;
+
+   for (u32 i = 0; i < MAX_SYSCALLS; i++) {
+
+      if (!syscall_stats_get(i, &st))
+         continue;
+
+      rows[rows_count++] = (struct sys_stat_row) {
+         .sys_n = i,
+         .calls = st.calls,
+         .tot = st.tot_cycles,
+         .avg = st.tot_cycles / st.calls,
+         .max = st.max_cycles,
+         .p50 = dp_sys_percentile(&st, 50),
+         .p99 = dp_sys_percentile(&st, 99),
+      };
+   }
+
+   dp_sys_sort();
+}
+
+static void dp_sys_enter(void)
+{
+   if (!rows) {
+      if (!(rows = kalloc_array_obj(struct sys_stat_row, MAX_SYSCALLS)))
+         panic("Unable to alloc memory for the syscall stats");
+   }
+}
+
+static int dp_sys_keypress(struct key_event ke)
+{
+   const char c = ke.print_char;
+
+   switch (c) {
+
+      case 'c':
+      case 't':
+      case 'a':
+      case 'm':
+         order_by = c;
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      case 'e':
+         if (syscall_stats_set_enabled(!syscall_stats_is_enabled()))
+            modal_msg = "Out of memory";
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      case 'r':
+         syscall_stats_reset();
+         ui_need_update = true;
+         return kb_handler_ok_and_continue;
+
+      default:
+         return kb_handler_nak;
+   }
+}
+
+static void dp_show_sys_stats(void)
+{
+   int row = dp_screen_start_row;
+   char avg[16], max[16], p50[16], p99[16], tot[16];
+   const char *name;
+
+   dp_sys_load_stats();
+
+   dp_writeln(
+      "Stats collection: %s  ["
+      E_COLOR_BR_WHITE "e" RESET_ATTRS "]nable/disable, "
+      E_COLOR_BR_WHITE "r" RESET_ATTRS "]eset",
+      syscall_stats_is_enabled()
+         ? E_COLOR_GREEN "ON" RESET_ATTRS
+         : E_COLOR_RED "OFF" RESET_ATTRS
+   );
+
+   dp_writeln(
+      "Order by: "
+      E_COLOR_BR_WHITE "c" RESET_ATTRS "alls, "
+      E_COLOR_BR_WHITE "t" RESET_ATTRS "otal, "
+      E_COLOR_BR_WHITE "a" RESET_ATTRS "vg, "
+      E_COLOR_BR_WHITE "m" RESET_ATTRS "ax "
+      "(TSC cycles; p50, p99: upper bounds)"
+   );
+
+   dp_writeln("");
+
+   dp_writeln(
+      " Syscall        "
+      TERM_VLINE "%s" "   Calls  "             RESET_ATTRS
+      TERM_VLINE "%s" "  Avg   "               RESET_ATTRS
+      TERM_VLINE      "  p50   "
+      TERM_VLINE      "  p99   "
+      TERM_VLINE "%s" "  Max   "               RESET_ATTRS
+      TERM_VLINE "%s" " Total  "               RESET_ATTRS,
+      order_by == 'c' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'a' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'm' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 't' ? E_COLOR_BR_WHITE REVERSE_VIDEO : ""
+   );
+
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqqqqqqqqnqqqqqqqqqqnqqqqqqqqnqqqqqqqqnqqqqqqqqnqqqqqqqqnqqqqqqqq"
+      GFX_OFF
+   );
+
+   for (u32 i = 0; i < rows_count; i++) {
+
+      const struct sys_stat_row *r = &rows[i];
+
+      if (!(name = tracing_get_syscall_name(r->sys_n)))
+         name = "?";
+
+      if (!strncmp(name, "sys_", 4))
+         name += 4;
+
+      dp_sys_fmt_cycles(avg, sizeof(avg), r->avg);
+      dp_sys_fmt_cycles(p50, sizeof(p50), r->p50);
+      dp_sys_fmt_cycles(p99, sizeof(p99), r->p99);
+      dp_sys_fmt_cycles(max, sizeof(max), r->max);
+      dp_sys_fmt_cycles(tot, sizeof(tot), r->tot);
+
+      dp_writeln(" %-14.14s "
+                 TERM_VLINE " %8llu "
+                 TERM_VLINE " %6s "
+                 TERM_VLINE " %6s "
+                 TERM_VLINE " %6s "
+                 TERM_VLINE " %6s "
+                 TERM_VLINE " %6s",
+                 name, r->calls, avg, p50, p99, max, tot);
+   }
+
+   dp_writeln("");
+}
+
+static struct dp_screen dp_sys_stats_screen =
+{
+   .index = 6,
+   .label = "Syscalls",
+   .draw_func = dp_show_sys_stats,
+   .on_dp_enter = dp_sys_enter,
+   .on_keypress_func = dp_sys_keypress,
+};
+
+__attribute__((constructor))
+static void dp_sys_stats_init(void)
+{
+   dp_register_screen(&dp_sys_stats_screen);
+}
+
+#endif // #if MOD_tracing
@@ -131,6 +131,12 @@ tracing_ui_msg(void)
       " Trace expr: " E_COLOR_YELLOW "%s" RESET_ATTRS "\r\n", line_buf
    );
 
+   dp_write_raw(
+      TERM_VLINE
+      " Dropped events: " E_COLOR_BR_BLUE "%u" RESET_ATTRS "\r\n",
+      tracing_get_dropped_events_count()
+   );
+
    dp_write_raw("\r\n");
    dp_write_raw(E_COLOR_YELLOW "> " RESET_ATTRS);
 }
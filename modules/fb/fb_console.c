@@ -24,6 +24,7 @@ extern char _binary_font8x16_psf_start;
 extern char _binary_font16x32_psf_start;
 
 static bool use_optimized;
+static bool use_shadow_buf;
 static u32 fb_term_rows;
 static u32 fb_term_cols;
 static u32 fb_offset_y;
@@ -460,13 +461,8 @@ static void fb_scroll_one_line_up(void)
       fb_enable_cursor();
 }
 
-static void async_pre_render_scanlines()
+static void fb_switch_to_optimized_funcs(void)
 {
-   if (!fb_pre_render_char_scanlines()) {
-      printk("fb_console: WARNING: fb_pre_render_char_scanlines failed.\n");
-      return;
-   }
-
    disable_interrupts_forced();
    {
       use_optimized = true;
@@ -476,9 +472,40 @@ static void async_pre_render_scanlines()
    enable_interrupts_forced();
 }
 
+static void async_pre_render_scanlines()
+{
+   if (!fb_pre_render_char_scanlines()) {
+      printk("fb_console: WARNING: fb_pre_render_char_scanlines failed.\n");
+      return;
+   }
+
+   fb_switch_to_optimized_funcs();
+}
+
+/*
+ * Use the memory-lean glyph renderer, which doesn't need the pre-rendered
+ * scanlines (2 MB at 32 bpp) but it's a bit slower.
+ */
+static void fb_use_lean_funcs(void)
+{
+   if (fb_get_bpp() != 32) {
+      printk("fb_console: Not using fast funcs in order to save memory\n");
+      return;
+   }
+
+   fb_use_lean_glyph_renderer();
+   fb_switch_to_optimized_funcs();
+   printk("fb_console: using the memory-lean glyph renderer\n");
+}
+
 static void fb_use_optimized_funcs_if_possible(void)
 {
-   if (in_hypervisor())
+   /*
+    * Scrolling by moving the pixels is fast only when we don't have to read
+    * them from the VRAM or when we're in a VM, where reading VRAM is just
+    * reading regular memory (even if it's still slower than reading RAM).
+    */
+   if (in_hypervisor() || use_shadow_buf)
       framebuffer_vi.scroll_one_line_up = fb_scroll_one_line_up;
 
    if (in_panic())
@@ -491,15 +518,17 @@ static void fb_use_optimized_funcs_if_possible(void)
       return;
    }
 
-   if (fb_get_bpp() != 32) {
+   if (fb_get_bpp() != 32 && fb_get_bpp() != 24 && fb_get_bpp() != 16) {
       printk("fb_console: WARNING: using slower code for bpp = %d\n",
              fb_get_bpp());
-      printk("fb_console: switch to a resolution with bpp = 32 if possible\n");
+      printk("fb_console: switch to a resolution with bpp = 16, 24 or 32\n");
       return;
    }
 
-   if (kmalloc_get_max_tot_heap_free() < FBCON_OPT_FUNCS_MIN_FREE_HEAP) {
-      printk("fb_console: Not using fast funcs in order to save memory\n");
+   if (FB_CONSOLE_LEAN_GLYPHS ||
+       kmalloc_get_max_tot_heap_free() < FBCON_OPT_FUNCS_MIN_FREE_HEAP)
+   {
+      fb_use_lean_funcs();
       return;
    }
 
@@ -530,6 +559,21 @@ static void fb_create_cursor_blinking_thread(void)
    enable_preemption();
 }
 
+static void fb_try_alloc_shadow_buffer(void)
+{
+   if (kmalloc_get_max_tot_heap_free() < FBCON_OPT_FUNCS_MIN_FREE_HEAP+fb_size) {
+      printk("fb_console: Not using a shadow buffer in order to save memory\n");
+      return;
+   }
+
+   if (!fb_alloc_shadow_buffer()) {
+      printk("fb_console: WARNING: unable to allocate the shadow buffer\n");
+      return;
+   }
+
+   use_shadow_buf = true;
+}
+
 void init_fb_console(void)
 {
    ASSERT(use_framebuffer());
@@ -555,6 +599,9 @@ void init_fb_console(void)
 
       if (!under_cursor_buf)
          printk("WARNING: fb_console: unable to allocate under_cursor_buf!\n");
+
+      if (FB_CONSOLE_SHADOW_BUF)
+         fb_try_alloc_shadow_buffer();
    }
 
    init_first_video_term(&framebuffer_vi,
@@ -569,6 +616,9 @@ void init_fb_console(void)
    printk("fb_console: font size: %i x %i, term size: %i x %i\n",
           font_w, font_h, fb_term_cols, fb_term_rows);
 
+   if (use_shadow_buf)
+      printk("fb_console: using a shadow buffer in RAM\n");
+
    fb_use_optimized_funcs_if_possible();
 
    if (in_panic())
@@ -5,6 +5,7 @@
 extern u32 font_w;
 extern u32 font_h;
 extern u32 vga_rgb_colors[16];
+extern u32 fb_size;
 extern bool __use_framebuffer;
 
 u32 fb_get_width(void);
@@ -21,8 +22,11 @@ void fb_copy_from_screen(u32 ix, u32 iy, u32 w, u32 h, u32 *buf);
 void fb_copy_to_screen(u32 ix, u32 iy, u32 w, u32 h, u32 *buf);
 void fb_lines_shift_up(u32 src_y, u32 dst_y, u32 lines_count);
 bool fb_pre_render_char_scanlines(void);
+void fb_use_lean_glyph_renderer(void);
 bool fb_alloc_shadow_buffer(void);
 void fb_raw_perf_screen_redraw(u32 color, bool use_fpu);
+bool fb_raw_perf_use_shadow_buffer(bool enabled);
+bool fb_raw_perf_use_lean_glyphs(bool enabled);
 void fb_set_font(void *font);
 void fb_draw_banner(void);
 
@@ -10,6 +10,7 @@
 #endif
 
 #include <tilck_gen_headers/config_debug.h>
+#include <tilck_gen_headers/mod_fb.h>
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/utils.h>
@@ -21,6 +22,7 @@
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/system_mmap.h>
+#include <tilck/kernel/interrupts.h>
 
 #include "fb_int.h"
 
@@ -48,7 +50,19 @@ u32 fb_size;
 static u32 fb_bytes_per_pixel;
 static u32 fb_line_length;
 
+/*
+ * fb_real_vaddr is the kernel mapping of the actual VRAM, while fb_vaddr is
+ * where all the drawing functions read and write pixels from/to. By default,
+ * they are the same thing, but when the shadow buffer is used (see
+ * fb_alloc_shadow_buffer()), fb_vaddr points to a copy of the framebuffer in
+ * regular RAM, holding the authoritative pixels. In that case, VRAM is never
+ * read (reading from it is extremely slow both on real hardware and in VMs):
+ * each drawing function just copies the pixels it changed from the shadow
+ * buffer to the VRAM, by calling one of the fb_flush_* funcs below.
+ */
+ulong fb_real_vaddr;
 ulong fb_vaddr;
+static bool fb_shadow_nt_ok;     /* can use fpu_memcpy256_nt() for flushing */
 static u32 *fb_w8_char_scanlines;
 
 u32 font_w;
@@ -64,6 +78,11 @@ u32 vga_rgb_colors[16];
 
 static inline u32 fb_make_color(u32 r, u32 g, u32 b)
 {
+   /* Scale the 8-bit components down to the mask size (e.g. RGB565) */
+   r >>= 8 - MIN(fb_red_mask_size, (u8)8);
+   g >>= 8 - MIN(fb_green_mask_size, (u8)8);
+   b >>= 8 - MIN(fb_blue_mask_size, (u8)8);
+
    return ((r << fb_red_pos) & fb_red_mask) |
           ((g << fb_green_pos) & fb_green_mask) |
           ((b << fb_blue_pos) & fb_blue_mask);
@@ -185,11 +204,85 @@ void set_framebuffer_info_from_mbi(multiboot_info_t *mbi)
    });
 }
 
+static ALWAYS_INLINE bool fb_has_shadow_buffer(void)
+{
+   return fb_vaddr != fb_real_vaddr;
+}
+
+/*
+ * Copy the lines [iy, iy + h) from the shadow buffer to the VRAM. The caller
+ * must tell us if it's already in a FPU context (fpu == true): only in that
+ * case we can use non-temporal SIMD stores.
+ */
+static void fb_flush_lines_int(u32 iy, u32 h, bool fpu)
+{
+   void *dest = (void *)(fb_real_vaddr + fb_pitch * iy);
+   void *src = (void *)(fb_vaddr + fb_pitch * iy);
+
+   if (fpu && fb_shadow_nt_ok)
+      fpu_memcpy256_nt(dest, src, (fb_pitch * h) >> 5);
+   else
+      memcpy32(dest, src, (fb_pitch * h) >> 2);
+}
+
+/*
+ * Like fb_flush_lines_int(), but for callers NOT running in a FPU context.
+ * NOTE: never call this function while in a FPU context: they cannot nest.
+ */
+static void fb_flush_lines(u32 iy, u32 h)
+{
+   if (!fb_has_shadow_buffer())
+      return;
+
+   if (fb_shadow_nt_ok && !in_irq() && !in_panic()) {
+
+      fpu_context_begin();
+      {
+         fb_flush_lines_int(iy, h, true);
+      }
+      fpu_context_end();
+
+   } else {
+
+      fb_flush_lines_int(iy, h, false);
+   }
+}
+
+/* Copy a small rectangle from the shadow buffer to the VRAM, without FPU */
+static void fb_flush_rect(u32 ix, u32 iy, u32 w, u32 h)
+{
+   if (!fb_has_shadow_buffer())
+      return;
+
+   ulong off = (fb_pitch * iy) + (ix * fb_bytes_per_pixel);
+
+   if (LIKELY(fb_bpp == 32)) {
+
+      for (u32 y = 0; y < h; y++, off += fb_pitch)
+         memcpy32((void *)(fb_real_vaddr + off), (void *)(fb_vaddr + off), w);
+
+   } else {
+
+      for (u32 y = 0; y < h; y++, off += fb_pitch)
+         memcpy((void *)(fb_real_vaddr + off),
+                (void *)(fb_vaddr + off),
+                w * fb_bytes_per_pixel);
+   }
+}
+
 void fb_lines_shift_up(u32 src_y, u32 dst_y, u32 lines_count)
 {
+   /*
+    * With the shadow buffer, this is a memmove() in RAM followed by a
+    * streaming write of the whole area to the VRAM. Otherwise, it's a very
+    * slow VRAM to VRAM copy: that's why fb_console uses it only in VMs, when
+    * there's no shadow buffer.
+    */
    memcpy32((void *)(fb_vaddr + fb_pitch * dst_y),
             (void *)(fb_vaddr + fb_pitch * src_y),
             (fb_pitch * lines_count) >> 2);
+
+   fb_flush_lines(dst_y, lines_count);
 }
 
 u32 fb_get_width(void)
@@ -214,11 +307,34 @@ void fb_user_mmap(pdir_t *pdir, void *vaddr, size_t mmap_len)
 
 void fb_map_in_kernel_space(void)
 {
-   fb_vaddr = (ulong) map_framebuffer(get_kernel_pdir(),
-                                      fb_paddr,
-                                      0,
-                                      fb_size,
-                                      false);
+   fb_real_vaddr = (ulong) map_framebuffer(get_kernel_pdir(),
+                                           fb_paddr,
+                                           0,
+                                           fb_size,
+                                           false);
+   fb_vaddr = fb_real_vaddr;
+}
+
+bool fb_alloc_shadow_buffer(void)
+{
+   void *buf;
+
+   if (fb_has_shadow_buffer())
+      return true;
+
+   if (!(buf = kmalloc(fb_size)))
+      return false;
+
+   /*
+    * Read the VRAM just once, in order to preserve whatever is on the screen
+    * right now. From now on, the shadow buffer will be the only source of
+    * truth and we'll only write to the VRAM.
+    */
+   memcpy32(buf, (void *)fb_real_vaddr, fb_size >> 2);
+
+   fb_shadow_nt_ok = !(fb_pitch % 32) && !((ulong)buf % 32);
+   fb_vaddr = (ulong)buf;
+   return true;
 }
 
 /*
@@ -235,6 +351,11 @@ static inline void fb_draw_pixel(u32 x, u32 y, u32 color)
       *(volatile u32 *)
          (fb_vaddr + (fb_pitch * y) + (x << 2)) = color;
 
+   } else if (fb_bpp == 16) {
+
+      *(volatile u16 *)
+         (fb_vaddr + (fb_pitch * y) + (x << 1)) = (u16)color;
+
    } else {
 
       // Assumption: bpp is 24
@@ -269,17 +390,19 @@ void fb_raw_color_lines(u32 iy, u32 h, u32 color)
          for (u32 x = 0; x < fb_width; x++)
             fb_draw_pixel(x, y, color);
    }
+
+   fb_flush_lines(iy, h);
 }
 
 void fb_draw_cursor_raw(u32 ix, u32 iy, u32 color)
 {
    if (LIKELY(fb_bpp == 32)) {
 
-      ix <<= 2;
+      const u32 ix_bytes = ix << 2;
 
       for (u32 y = iy; y < (iy + font_h); y++) {
 
-         memset32((u32 *)(fb_vaddr + (fb_pitch * y) + ix),
+         memset32((u32 *)(fb_vaddr + (fb_pitch * y) + ix_bytes),
                   color,
                   font_w);
       }
@@ -295,6 +418,8 @@ void fb_draw_cursor_raw(u32 ix, u32 iy, u32 color)
          for (u32 x = ix; x < (ix + font_w); x++)
             fb_draw_pixel(x, y, color);
    }
+
+   fb_flush_rect(ix, iy, font_w, font_h);
 }
 
 void fb_copy_from_screen(u32 ix, u32 iy, u32 w, u32 h, u32 *buf)
@@ -341,6 +466,8 @@ void fb_copy_to_screen(u32 ix, u32 iy, u32 w, u32 h, u32 *buf)
                 (u8 *)buf + y * w * fb_bytes_per_pixel,
                 w * fb_bytes_per_pixel);
    }
+
+   fb_flush_rect(ix, iy, w, h);
 }
 
 #if DEBUG_CHECKS
@@ -426,6 +553,8 @@ void fb_draw_char_failsafe(u32 x, u32 y, u16 e)
             draw_char_partial(b);
          }
       }
+
+   fb_flush_rect(x, y, font_w, font_h);
 }
 
 
@@ -437,31 +566,72 @@ void fb_draw_char_failsafe(u32 x, u32 y, u16 e)
  * -------------------------------------------
  */
 
-#define PSZ         4     /* pixel size = 32 bpp / 8 = 4 bytes */
 #define SL_COUNT  256     /* all possible 8-pixel scanlines */
 #define SL_SIZE     8     /* scanline size: 8 pixels */
 #define FG_COLORS  16     /* #fg colors */
 #define BG_COLORS  16     /* #bg colors */
 
-#define TOT_CHAR_SCANLINES_SIZE (PSZ*SL_COUNT*FG_COLORS*BG_COLORS*SL_SIZE)
+/*
+ * Size in bytes of each pre-rendered scanline in fb_w8_char_scanlines:
+ *
+ *    32 bpp:  32 bytes (8 x 4 bytes)
+ *    24 bpp:  32 bytes (8 x 3 bytes + 8 bytes of padding, for alignment)
+ *    16 bpp:  16 bytes (8 x 2 bytes)
+ */
+static u32 fb_sl_stride;
+
+/*
+ * Non-temporal variants of the 16/24 bpp blitters, usable only if the CPU
+ * supports the required instructions and the VRAM lines are aligned enough.
+ * fb_nt_blit_ok is about single glyph scanlines, fb_nt_blit_wide_ok about the
+ * faster variants that combine two scanlines at once (font_w == 16).
+ */
+static bool fb_nt_blit_ok;
+static bool fb_nt_blit_wide_ok;
+
+static void fb_check_nt_blitters(void)
+{
+   const bool aligned16 = !(fb_real_vaddr % 16) && !(fb_pitch % 16);
+   const bool aligned32 = !(fb_real_vaddr % 32) && !(fb_pitch % 32);
+
+   if (fb_bpp == 16) {
+
+      fb_nt_blit_ok = x86_cpu_features.can_use_sse2 && aligned16;
+      fb_nt_blit_wide_ok = x86_cpu_features.can_use_avx2 && aligned32;
+
+   } else if (fb_bpp == 24) {
+
+      fb_nt_blit_ok = x86_cpu_features.can_use_sse;
+      fb_nt_blit_wide_ok = x86_cpu_features.can_use_sse2 && aligned16;
+   }
+}
 
 bool fb_pre_render_char_scanlines(void)
 {
-   fb_w8_char_scanlines = kmalloc(TOT_CHAR_SCANLINES_SIZE);
+   const u32 bpp_bytes = fb_bytes_per_pixel;
+   u8 *p;
+
+   ASSERT(fb_bpp == 16 || fb_bpp == 24 || fb_bpp == 32);
+   fb_sl_stride = fb_bpp == 16 ? 16 : 32;
+   fb_check_nt_blitters();
+
+   p = kmalloc(fb_sl_stride * SL_COUNT * FG_COLORS * BG_COLORS);
 
-   if (!fb_w8_char_scanlines)
+   if (!p)
       return false;
 
+   fb_w8_char_scanlines = (void *)p;
+
    for (u32 fg = 0; fg < FG_COLORS; fg++) {
       for (u32 bg = 0; bg < BG_COLORS; bg++) {
-         for (u32 sl = 0; sl < SL_COUNT; sl++) {
+         for (u32 sl = 0; sl < SL_COUNT; sl++, p += fb_sl_stride) {
             for (u32 pix = 0; pix < SL_SIZE; pix++) {
-               fb_w8_char_scanlines[
-                  fg * (BG_COLORS * SL_COUNT * SL_SIZE) +
-                  bg * (SL_COUNT * SL_SIZE) +
-                  sl * SL_SIZE +
-                  (SL_SIZE - pix - 1)
-               ] = (sl & (1 << pix)) ? vga_rgb_colors[fg] : vga_rgb_colors[bg];
+
+               const u32 color =
+                  (sl & (1 << pix)) ? vga_rgb_colors[fg] : vga_rgb_colors[bg];
+
+               /* NOTE: assuming little endian, like everywhere else here */
+               memcpy(p + (SL_SIZE - pix - 1) * bpp_bytes, &color, bpp_bytes);
             }
          }
       }
@@ -470,11 +640,192 @@ bool fb_pre_render_char_scanlines(void)
    return true;
 }
 
+/* Returns the 256 pre-rendered scanlines having the fg/bg colors of `e` */
+static ALWAYS_INLINE u8 *fb_get_char_scanlines(u16 e)
+{
+   const u32 colors = (vgaentry_get_fg(e) << 4) + vgaentry_get_bg(e);
+   return (u8 *)fb_w8_char_scanlines + colors * SL_COUNT * fb_sl_stride;
+}
+
+/* Generic version of fb_draw_char_optimized() for bpp = 16 or 24 */
+static void fb_draw_char_optimized_16_24(u32 x, u32 y, u16 e)
+{
+   const u32 sl_bytes = SL_SIZE * fb_bytes_per_pixel;        /* 16 or 24 */
+   const u8 *d = font_glyph_data + font_bytes_per_glyph * vgaentry_get_char(e);
+   const u8 *scanlines = fb_get_char_scanlines(e);
+   void *vaddr = (void *)fb_vaddr + (fb_pitch * y) + (x * fb_bytes_per_pixel);
+
+   for (u32 r = 0; r < font_h; r++, vaddr += fb_pitch)
+      for (u32 b = 0; b < font_width_bytes; b++, d++)
+         memcpy32(vaddr + b * sl_bytes,
+                  &scanlines[*d * fb_sl_stride],
+                  sl_bytes >> 2);
+
+   fb_flush_rect(x, y, font_w, font_h);
+}
+
+/*
+ * -------------------------------------------
+ *
+ * Memory-lean glyph renderer (32 bpp only)
+ *
+ * -------------------------------------------
+ *
+ * Instead of looking up the pre-rendered scanlines (2 MB), expand each glyph
+ * scanline on the fly. Each nibble of the 8-pixel scanline selects 4 pixel
+ * masks from fb_nibble_masks (256 bytes) and then:
+ *
+ *    pixel = bg ^ ((fg ^ bg) & mask)
+ *
+ * When we're in a FPU context, that's done with SSE2 for 4 pixels at once,
+ * otherwise with regular integer ops.
+ */
+
+#define M 0xffffffff
+
+static const u32 fb_nibble_masks[16][4] ALIGNED_AT(16) = {
+   {0, 0, 0, 0}, {0, 0, 0, M}, {0, 0, M, 0}, {0, 0, M, M},
+   {0, M, 0, 0}, {0, M, 0, M}, {0, M, M, 0}, {0, M, M, M},
+   {M, 0, 0, 0}, {M, 0, 0, M}, {M, 0, M, 0}, {M, 0, M, M},
+   {M, M, 0, 0}, {M, M, 0, M}, {M, M, M, 0}, {M, M, M, M},
+};
+
+#undef M
+
+static bool fb_lean_glyphs;
+
+static ALWAYS_INLINE void
+fb_expand_scanline(u32 *dest, u8 sl, u32 bg, u32 diff)
+{
+   const u32 *m0 = fb_nibble_masks[sl >> 4];
+   const u32 *m1 = fb_nibble_masks[sl & 15];
+
+   dest[0] = bg ^ (diff & m0[0]);
+   dest[1] = bg ^ (diff & m0[1]);
+   dest[2] = bg ^ (diff & m0[2]);
+   dest[3] = bg ^ (diff & m0[3]);
+   dest[4] = bg ^ (diff & m1[0]);
+   dest[5] = bg ^ (diff & m1[1]);
+   dest[6] = bg ^ (diff & m1[2]);
+   dest[7] = bg ^ (diff & m1[3]);
+}
+
+/*
+ * SSE2 version of fb_expand_scanline(): `cv` contains 4 times (fg ^ bg)
+ * followed by 4 times bg. The destination must be 16-byte aligned.
+ */
+static ALWAYS_INLINE void
+fb_expand_scanline_sse2(void *dest, u8 sl, const u32 *cv, bool nt)
+{
+   const u32 *m0 = fb_nibble_masks[sl >> 4];
+   const u32 *m1 = fb_nibble_masks[sl & 15];
+
+   if (nt)
+      asmVolatile("movdqa   (%0), %%xmm0\n\t"
+                  "movdqa   (%1), %%xmm1\n\t"
+                  "movdqa   (%2), %%xmm2\n\t"
+                  "movdqa 16(%2), %%xmm3\n\t"
+                  "pand   %%xmm2, %%xmm0\n\t"
+                  "pand   %%xmm2, %%xmm1\n\t"
+                  "pxor   %%xmm3, %%xmm0\n\t"
+                  "pxor   %%xmm3, %%xmm1\n\t"
+                  "movntdq %%xmm0,   (%3)\n\t"
+                  "movntdq %%xmm1, 16(%3)\n\t"
+                  : /* no output */
+                  : "r" (m0), "r" (m1), "r" (cv), "r" (dest)
+                  : "memory");
+   else
+      asmVolatile("movdqa   (%0), %%xmm0\n\t"
+                  "movdqa   (%1), %%xmm1\n\t"
+                  "movdqa   (%2), %%xmm2\n\t"
+                  "movdqa 16(%2), %%xmm3\n\t"
+                  "pand   %%xmm2, %%xmm0\n\t"
+                  "pand   %%xmm2, %%xmm1\n\t"
+                  "pxor   %%xmm3, %%xmm0\n\t"
+                  "pxor   %%xmm3, %%xmm1\n\t"
+                  "movdqa %%xmm0,   (%3)\n\t"
+                  "movdqa %%xmm1, 16(%3)\n\t"
+                  : /* no output */
+                  : "r" (m0), "r" (m1), "r" (cv), "r" (dest)
+                  : "memory");
+}
+
+static void fb_draw_char_lean(u32 x, u32 y, u16 e)
+{
+   const u32 bg = vga_rgb_colors[vgaentry_get_bg(e)];
+   const u32 diff = vga_rgb_colors[vgaentry_get_fg(e)] ^ bg;
+   const u8 *d = font_glyph_data + font_bytes_per_glyph * vgaentry_get_char(e);
+   void *vaddr = (void *)fb_vaddr + (fb_pitch * y) + (x << 2);
+
+   for (u32 r = 0; r < font_h; r++, vaddr += fb_pitch)
+      for (u32 b = 0; b < font_width_bytes; b++, d++)
+         fb_expand_scanline(vaddr + (b << 5), *d, bg, diff);
+
+   fb_flush_rect(x, y, font_w, font_h);
+}
+
+static void
+fb_draw_char_lean_row(ulong vaddr_base, u16 *entries, u32 count, bool fpu)
+{
+   const u32 bpg_shift = 4 + (font_bytes_per_glyph == 64) * 2; // 4 or 6
+   const u32 w4_shift  = 5 + (font_w == 16);                   // 5 or 6
+   const bool nt = !fb_has_shadow_buffer();
+   u32 cv[8] ALIGNED_AT(16);
+
+   ASSUME_WITHOUT_CHECK(font_w == 8 || font_w == 16);
+   ASSUME_WITHOUT_CHECK(font_h == 16 || font_h == 32);
+
+   /* The SSE2 expander requires 16-byte aligned destinations */
+   fpu = fpu && x86_cpu_features.can_use_sse2;
+   fpu = fpu && !(vaddr_base % 16) && !(fb_pitch % 16);
+
+   for (u32 ei = 0; ei < count; ei++) {
+
+      const u16 e = entries[ei];
+      const u32 bg = vga_rgb_colors[vgaentry_get_bg(e)];
+      const u32 diff = vga_rgb_colors[vgaentry_get_fg(e)] ^ bg;
+      const u8 *d = &font_glyph_data[vgaentry_get_char(e) << bpg_shift];
+      void *vaddr = (void *)vaddr_base + (ei << w4_shift);
+
+      if (!fpu) {
+
+         for (u32 r = 0; r < font_h; r++, vaddr += fb_pitch)
+            for (u32 b = 0; b < font_width_bytes; b++, d++)
+               fb_expand_scanline(vaddr + (b << 5), *d, bg, diff);
+
+         continue;
+      }
+
+      cv[0] = cv[1] = cv[2] = cv[3] = diff;
+      cv[4] = cv[5] = cv[6] = cv[7] = bg;
+
+      for (u32 r = 0; r < font_h; r++, vaddr += fb_pitch)
+         for (u32 b = 0; b < font_width_bytes; b++, d++)
+            fb_expand_scanline_sse2(vaddr + (b << 5), *d, cv, nt);
+   }
+}
+
+void fb_use_lean_glyph_renderer(void)
+{
+   ASSERT(fb_bpp == 32);
+   fb_lean_glyphs = true;
+}
+
 void fb_draw_char_optimized(u32 x, u32 y, u16 e)
 {
    /* Static variables, set once! */
    static void *op;
 
+   if (UNLIKELY(fb_lean_glyphs)) {
+      fb_draw_char_lean(x, y, e);
+      return;
+   }
+
+   if (UNLIKELY(fb_bpp != 32)) {
+      fb_draw_char_optimized_16_24(x, y, e);
+      return;
+   }
+
    if (UNLIKELY(!op)) {
 
       ASSERT(font_w == 8 || font_w == 16);
@@ -505,6 +856,7 @@ void fb_draw_char_optimized(u32 x, u32 y, u16 e)
       for (u32 r = 0; r < font_h; r++, d++, vaddr += fb_pitch)
          memcpy32(vaddr,      &scanlines[d[0] << 3], SL_SIZE);
 
+      fb_flush_rect(x, y, font_w, font_h);
       return;
 
    width2:
@@ -514,10 +866,15 @@ void fb_draw_char_optimized(u32 x, u32 y, u16 e)
          memcpy32(vaddr + 32, &scanlines[d[1] << 3], SL_SIZE);
       }
 
+      fb_flush_rect(x, y, font_w, font_h);
       return;
 }
 
-void fb_draw_char_optimized_row(u32 y, u16 *entries, u32 count, bool fpu)
+static void
+fb_draw_char_optimized_row_32(ulong vaddr_base,
+                              u16 *entries,
+                              u32 count,
+                              bool nt)
 {
    static const void *ops[] = {
       &&width_1_nofpu, &&width_1_fpu, &&width_2_nofpu, &&width_2_fpu
@@ -525,10 +882,7 @@ void fb_draw_char_optimized_row(u32 y, u16 *entries, u32 count, bool fpu)
 
    const u32 bpg_shift = 4 + (font_bytes_per_glyph == 64) * 2; // 4 or 6
    const u32 w4_shift  = 5 + (font_w == 16);                   // 5 or 6
-   const void *const op = ops[(font_w == 16) * 2 + fpu];       // ops[0..3]
-
-   /* -------------- Regular variables --------------- */
-   const ulong vaddr_base = fb_vaddr + (fb_pitch * y);
+   const void *const op = ops[(font_w == 16) * 2 + nt];        // ops[0..3]
 
    ASSUME_WITHOUT_CHECK(font_w == 8 || font_w == 16);
    ASSUME_WITHOUT_CHECK(font_h == 16 || font_h == 32);
@@ -579,6 +933,138 @@ void fb_draw_char_optimized_row(u32 y, u16 *entries, u32 count, bool fpu)
    }
 }
 
+static void
+fb_draw_char_optimized_row_16(ulong vaddr_base,
+                              u16 *entries,
+                              u32 count,
+                              bool nt)
+{
+   const u32 bpg_shift = 4 + (font_bytes_per_glyph == 64) * 2; // 4 or 6
+   const u32 w2_shift  = 4 + (font_w == 16);                   // 4 or 5
+   const bool wide = font_w == 16;
+
+   ASSUME_WITHOUT_CHECK(font_w == 8 || font_w == 16);
+   ASSUME_WITHOUT_CHECK(font_h == 16 || font_h == 32);
+
+   nt = nt && fb_nt_blit_ok;
+
+   for (u32 ei = 0; ei < count; ei++) {
+
+      const u16 e = entries[ei];
+      void *vaddr = (void *)vaddr_base + (ei << w2_shift);
+      const u8 *d = &font_glyph_data[vgaentry_get_char(e) << bpg_shift];
+      const u8 *sl = fb_get_char_scanlines(e);
+
+      if (!wide) {
+
+         if (nt) {
+            for (u32 r = 0; r < font_h; r++, d++, vaddr += fb_pitch)
+               fpu_cpy_single_128_nt_sse2(vaddr, &sl[d[0] << 4]);
+         } else {
+            for (u32 r = 0; r < font_h; r++, d++, vaddr += fb_pitch)
+               memcpy32(vaddr, &sl[d[0] << 4], 4);
+         }
+
+      } else if (nt && fb_nt_blit_wide_ok) {
+
+         for (u32 r = 0; r < font_h; r++, d+=2, vaddr += fb_pitch)
+            fpu_cpy_2x128_nt_avx2(vaddr, &sl[d[0] << 4], &sl[d[1] << 4]);
+
+      } else if (nt) {
+
+         for (u32 r = 0; r < font_h; r++, d+=2, vaddr += fb_pitch) {
+            fpu_cpy_single_128_nt_sse2(vaddr,      &sl[d[0] << 4]);
+            fpu_cpy_single_128_nt_sse2(vaddr + 16, &sl[d[1] << 4]);
+         }
+
+      } else {
+
+         for (u32 r = 0; r < font_h; r++, d+=2, vaddr += fb_pitch) {
+            memcpy32(vaddr,      &sl[d[0] << 4], 4);
+            memcpy32(vaddr + 16, &sl[d[1] << 4], 4);
+         }
+      }
+   }
+}
+
+static void
+fb_draw_char_optimized_row_24(ulong vaddr_base,
+                              u16 *entries,
+                              u32 count,
+                              bool nt)
+{
+   const u32 bpg_shift = 4 + (font_bytes_per_glyph == 64) * 2; // 4 or 6
+   const u32 glyph_row_bytes = font_w * 3;                     // 24 or 48
+   const bool wide = font_w == 16;
+
+   ASSUME_WITHOUT_CHECK(font_w == 8 || font_w == 16);
+   ASSUME_WITHOUT_CHECK(font_h == 16 || font_h == 32);
+
+   nt = nt && fb_nt_blit_ok;
+
+   for (u32 ei = 0; ei < count; ei++) {
+
+      const u16 e = entries[ei];
+      void *vaddr = (void *)vaddr_base + ei * glyph_row_bytes;
+      const u8 *d = &font_glyph_data[vgaentry_get_char(e) << bpg_shift];
+      const u8 *sl = fb_get_char_scanlines(e);
+
+      if (!wide) {
+
+         if (nt) {
+            for (u32 r = 0; r < font_h; r++, d++, vaddr += fb_pitch)
+               fpu_cpy_single_192_nt_sse(vaddr, &sl[d[0] << 5]);
+         } else {
+            for (u32 r = 0; r < font_h; r++, d++, vaddr += fb_pitch)
+               memcpy32(vaddr, &sl[d[0] << 5], 6);
+         }
+
+      } else if (nt && fb_nt_blit_wide_ok) {
+
+         for (u32 r = 0; r < font_h; r++, d+=2, vaddr += fb_pitch)
+            fpu_cpy_2x192_nt_sse2(vaddr, &sl[d[0] << 5], &sl[d[1] << 5]);
+
+      } else if (nt) {
+
+         for (u32 r = 0; r < font_h; r++, d+=2, vaddr += fb_pitch) {
+            fpu_cpy_single_192_nt_sse(vaddr,      &sl[d[0] << 5]);
+            fpu_cpy_single_192_nt_sse(vaddr + 24, &sl[d[1] << 5]);
+         }
+
+      } else {
+
+         for (u32 r = 0; r < font_h; r++, d+=2, vaddr += fb_pitch) {
+            memcpy32(vaddr,      &sl[d[0] << 5], 6);
+            memcpy32(vaddr + 24, &sl[d[1] << 5], 6);
+         }
+      }
+   }
+}
+
+void fb_draw_char_optimized_row(u32 y, u16 *entries, u32 count, bool fpu)
+{
+   const ulong vaddr_base = fb_vaddr + (fb_pitch * y);
+
+   /*
+    * With the shadow buffer, there's no point in using non-temporal stores
+    * for drawing the glyphs in RAM: we'll stream the whole row to the VRAM
+    * at the end, using the FPU (if allowed).
+    */
+   const bool nt = fpu && !fb_has_shadow_buffer();
+
+   if (UNLIKELY(fb_lean_glyphs))
+      fb_draw_char_lean_row(vaddr_base, entries, count, fpu);
+   else if (LIKELY(fb_bpp == 32))
+      fb_draw_char_optimized_row_32(vaddr_base, entries, count, nt);
+   else if (fb_bpp == 16)
+      fb_draw_char_optimized_row_16(vaddr_base, entries, count, nt);
+   else
+      fb_draw_char_optimized_row_24(vaddr_base, entries, count, nt);
+
+   if (fb_has_shadow_buffer())
+      fb_flush_lines_int(y, font_h, fpu);
+}
+
 
 #include <linux/fb.h>         // system header
 
@@ -615,14 +1101,100 @@ void fb_fill_var_info(void *var_info)
 }
 
 #if KERNEL_SELFTESTS
+
+/*
+ * Redraw the screen at 16 or 24 bpp: fill each line using a 96-byte pattern,
+ * which contains a whole number of pixels in both cases (48 or 32).
+ */
+static void fb_raw_perf_screen_redraw_16_24(u32 color, bool use_fpu)
+{
+   const u32 bpp_bytes = fb_bytes_per_pixel;
+   const u32 packets = fb_line_length >> 5;
+   const u32 rem = fb_line_length & 31;
+   u8 pattern[96] ALIGNED_AT(32);
+   ulong line = fb_vaddr;
+
+   VERIFY(!use_fpu || (!(fb_pitch % 32) && !(fb_vaddr % 32)));
+
+   for (u32 i = 0; i < sizeof(pattern); i += bpp_bytes)
+      memcpy(&pattern[i], &color, bpp_bytes);
+
+   for (u32 y = 0; y < fb_height; y++, line += fb_pitch) {
+
+      u32 p = 0;
+
+      if (use_fpu) {
+
+         for (; p < packets; p++)
+            fpu_cpy_single_256_nt((void *)(line + 32*p), &pattern[32*(p%3)]);
+
+      } else {
+
+         for (; p < packets; p++)
+            memcpy32((void *)(line + 32 * p), &pattern[32 * (p % 3)], 8);
+      }
+
+      if (rem)
+         memcpy((void *)(line + 32 * p), &pattern[32 * (p % 3)], rem);
+   }
+}
+
 void fb_raw_perf_screen_redraw(u32 color, bool use_fpu)
 {
-   VERIFY(fb_bpp == 32);
-   VERIFY(fb_pitch == fb_line_length);
+   if (fb_bpp == 16 || fb_bpp == 24) {
 
-   if (use_fpu)
-      fpu_memset256((void *)fb_vaddr, color, (fb_pitch * fb_height) >> 5);
-   else
-      memset32((void *)fb_vaddr, color, (fb_pitch * fb_height) >> 2);
+      fb_raw_perf_screen_redraw_16_24(color, use_fpu);
+
+   } else {
+
+      VERIFY(fb_bpp == 32);
+      VERIFY(fb_pitch == fb_line_length);
+
+      if (use_fpu)
+         fpu_memset256((void *)fb_vaddr, color, (fb_pitch * fb_height) >> 5);
+      else
+         memset32((void *)fb_vaddr, color, (fb_pitch * fb_height) >> 2);
+   }
+
+   if (fb_has_shadow_buffer())
+      fb_flush_lines_int(0, fb_height, use_fpu);
+}
+
+/*
+ * Temporarily bypass the shadow buffer (if any), in order to compare the
+ * performance of the two approaches. Returns false if there's no shadow
+ * buffer at all. The caller is responsible to redraw the whole screen
+ * after calling this function.
+ */
+bool fb_raw_perf_use_shadow_buffer(bool enabled)
+{
+   static ulong shadow_vaddr;
+
+   if (!shadow_vaddr) {
+
+      if (!fb_has_shadow_buffer())
+         return false;
+
+      shadow_vaddr = fb_vaddr;
+   }
+
+   fb_vaddr = enabled ? shadow_vaddr : fb_real_vaddr;
+   return true;
+}
+
+/*
+ * Switch between the table-based and the memory-lean glyph renderers, in order
+ * to compare them. Returns false if the requested renderer is not available.
+ */
+bool fb_raw_perf_use_lean_glyphs(bool enabled)
+{
+   if (fb_bpp != 32)
+      return false;
+
+   if (!enabled && !fb_w8_char_scanlines)
+      return false;
+
+   fb_lean_glyphs = enabled;
+   return true;
 }
 #endif
@@ -22,8 +22,11 @@
 
 #include "fb_int.h"
 
-extern ulong fb_vaddr;
-extern u32 fb_size;
+/*
+ * Always use the actual VRAM, ignoring the fb_console's shadow buffer: that's
+ * what the user space sees through mmap() as well.
+ */
+extern ulong fb_real_vaddr;
 
 static ssize_t total_fb_pages_mapped;
 static struct list mappings_list = STATIC_LIST_INIT(mappings_list);
@@ -32,7 +35,7 @@ static ssize_t fb_read(fs_handle h, char *user_buf, size_t size)
 {
    struct devfs_handle *dh = h;
    ssize_t actual_size = MIN((offt)fb_size - dh->pos, (offt)size);
-   void *src = (char *)fb_vaddr + dh->pos;
+   void *src = (char *)fb_real_vaddr + dh->pos;
 
    dh->pos += actual_size;
 
@@ -46,7 +49,7 @@ static ssize_t fb_write(fs_handle h, char *user_buf, size_t size)
 {
    struct devfs_handle *dh = h;
    ssize_t actual_size = MIN((offt)fb_size - dh->pos, (offt)size);
-   void *dest = (char *)fb_vaddr + dh->pos;
+   void *dest = (char *)fb_real_vaddr + dh->pos;
    dh->pos += (offt)actual_size;
 
    if (copy_from_user(dest, user_buf, (size_t)actual_size))
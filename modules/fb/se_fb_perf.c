@@ -11,16 +11,13 @@
 #include <tilck/mods/fb_console.h>
 #include <tilck/kernel/self_tests.h>
 #include <tilck/kernel/hal.h>
+#include <tilck/kernel/kmalloc.h>
 
 #include "fb_int.h"
 
-void internal_selftest_fb_perf(bool use_fpu)
+static u64 fb_perf_redraw(bool use_fpu, int iters)
 {
-   if (!use_framebuffer())
-      panic("Unable to test framebuffer's performance: we're in text-mode");
-
-   const int iters = 30;
-   u64 start, duration, cycles;
+   u64 start, duration;
 
    if (use_fpu)
       fpu_context_begin();
@@ -37,14 +34,56 @@ void internal_selftest_fb_perf(bool use_fpu)
    if (use_fpu)
       fpu_context_end();
 
-   cycles = duration / iters;
+   return duration / (u64)iters;
+}
+
+static u64 fb_perf_scroll(int iters)
+{
+   const u32 h = fb_get_height();
+   u64 start, duration;
+
+   /* NOTE: fb_lines_shift_up() decides by itself whether to use the FPU */
+   start = RDTSC();
 
-   u32 pixels = fb_get_width() * fb_get_height();
-   printk("fb size (pixels): %u\n", pixels);
-   printk("cycles per redraw: %llu\n", cycles);
-   printk("cycles per 32 pixels: %llu\n", 32 * cycles / pixels);
+   for (int i = 0; i < iters; i++)
+      fb_lines_shift_up(font_h, 0, h - font_h);
+
+   duration = RDTSC() - start;
+   return duration / (u64)iters;
+}
+
+static void fb_perf_run(const char *name, bool use_fpu)
+{
+   const int iters = 30;
+   const u32 pixels = fb_get_width() * fb_get_height();
+   const u64 redraw_cycles = fb_perf_redraw(use_fpu, iters);
+   const u64 scroll_cycles = fb_perf_scroll(iters);
+
+   printk("[%s] cycles per redraw: %llu\n", name, redraw_cycles);
+   printk("[%s] cycles per 32 pixels: %llu\n", name, 32*redraw_cycles/pixels);
+   printk("[%s] cycles per scroll: %llu\n", name, scroll_cycles);
+}
+
+void internal_selftest_fb_perf(bool use_fpu)
+{
+   if (!use_framebuffer())
+      panic("Unable to test framebuffer's performance: we're in text-mode");
+
+   printk("fb size (pixels): %u\n", fb_get_width() * fb_get_height());
    printk("use_fpu: %d\n", use_fpu);
 
+   if (fb_raw_perf_use_shadow_buffer(false)) {
+
+      /* Compare drawing directly on VRAM with using the shadow buffer */
+      fb_perf_run("vram", use_fpu);
+      fb_raw_perf_use_shadow_buffer(true);
+      fb_perf_run("shadow", use_fpu);
+
+   } else {
+
+      fb_perf_run("vram", use_fpu);
+   }
+
    fb_draw_banner();
 }
 
@@ -58,6 +97,63 @@ void selftest_fbperf_fpu_manual(void)
    internal_selftest_fb_perf(true);
 }
 
+/* Average cycles per char, drawing whole rows in a FPU context */
+static u64 fb_perf_glyph_rows(u16 *entries, u32 cols, u32 rows)
+{
+   const int iters = 10;
+   u64 start, duration;
+
+   fpu_context_begin();
+   {
+      start = RDTSC();
+
+      for (int i = 0; i < iters; i++)
+         for (u32 r = 0; r < rows; r++)
+            fb_draw_char_optimized_row(r * font_h, entries, cols, true);
+
+      duration = RDTSC() - start;
+   }
+   fpu_context_end();
+
+   return duration / (iters * rows * cols);
+}
+
+void selftest_fbperf_glyphs_manual(void)
+{
+   const u32 cols = fb_get_width() / font_w;
+   const u32 rows = fb_get_height() / font_h;
+   u16 *entries;
+
+   if (!use_framebuffer())
+      panic("Unable to test framebuffer's performance: we're in text-mode");
+
+   if (!fb_is_using_opt_funcs()) {
+      printk("fb_console is not using the optimized funcs: skip\n");
+      return;
+   }
+
+   if (!(entries = kalloc_array_obj(u16, cols)))
+      panic("Unable to allocate the entries");
+
+   for (u32 i = 0; i < cols; i++)
+      entries[i] = make_vgaentry(32 + i % 95, make_color(i % 16, i / 16 % 16));
+
+   /*
+    * Measure the lean renderer first: at the end, leave the table-based one
+    * active, if it's available (it means we were using it).
+    */
+   if (fb_raw_perf_use_lean_glyphs(true))
+      printk("[lean] cycles per char: %llu\n",
+             fb_perf_glyph_rows(entries, cols, rows));
+
+   if (fb_raw_perf_use_lean_glyphs(false))
+      printk("[table] cycles per char: %llu\n",
+             fb_perf_glyph_rows(entries, cols, rows));
+
+   kfree_array_obj(entries, u16, cols);
+   fb_draw_banner();
+}
+
 DECLARE_AND_REGISTER_SELF_TEST(fbperf_nofpu,
                                se_manual,
                                &selftest_fbperf_nofpu_manual);
@@ -67,4 +163,8 @@ DECLARE_AND_REGISTER_SELF_TEST(fbperf_fpu,
                                se_manual,
                                &selftest_fbperf_fpu_manual);
 
+DECLARE_AND_REGISTER_SELF_TEST(fbperf_glyphs,
+                               se_manual,
+                               &selftest_fbperf_glyphs_manual);
+
 #endif // #if KERNEL_SELFTESTS
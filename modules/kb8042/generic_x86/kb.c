@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
 #include <tilck_gen_headers/mod_kb8042.h>
+#include <tilck_gen_headers/mod_sysfs.h>
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
@@ -14,9 +15,11 @@
 #include <tilck/kernel/irq.h>
 #include <tilck/kernel/cmdline.h>
 #include <tilck/kernel/sched.h>
-#include <tilck/kernel/safe_ringbuf.h>
+#include <tilck/kernel/spsc_ringbuf.h>
 
 #include <tilck/mods/acpi.h>
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
 
 #include "i8042.h"
 #include "kb_layouts.c.h"
@@ -37,7 +40,8 @@ static bool numLock;
 static bool capsLock;
 static struct list keypress_handlers = STATIC_LIST_INIT(keypress_handlers);
 static struct kb_dev ps2_keyboard;
-static struct safe_ringbuf kb_input_rb;
+static struct spsc_ringbuf kb_input_rb;
+static ATOMIC(bool) kb_bh_pending;
 
 static bool kb_is_pressed(u32 key)
 {
@@ -225,11 +229,17 @@ static void kb_dump_regs(u8 ctr, u8 cto, u8 status)
 
 static void kb_irq_bottom_half(void *arg)
 {
-   u8 scancode;
+   u8 sc[16];
+   u32 n;
+
+   /* See the comments in ser_bh_handler() */
+   atomic_store(&kb_bh_pending, false);
+
    disable_preemption();
    {
-      while (safe_ringbuf_read_1(&kb_input_rb, &scancode)) {
-         kb_process_scancode(scancode);
+      while ((n = spsc_ringbuf_read(&kb_input_rb, sc, sizeof(sc))) > 0) {
+         for (u32 i = 0; i < n; i++)
+            kb_process_scancode(sc[i]);
       }
    }
    enable_preemption();
@@ -241,15 +251,8 @@ static int kb_irq_handler_read_scancodes(void)
 
    while (i8042_has_pending_data()) {
 
-      u8 scancode = i8042_read_data();
-      bool was_empty;
-
-      if (!safe_ringbuf_write_1(&kb_input_rb, &scancode, &was_empty)) {
-         /* We have no other choice than to just drain the data */
-         printk("KB: Warning: hit input limit. Drain the data!\n");
-         i8042_drain_any_data();
-      }
-
+      /* When the ring is full, the scancode is dropped (and counted) */
+      spsc_ringbuf_write_1(&kb_input_rb, i8042_read_data());
       count++;
    }
 
@@ -279,9 +282,17 @@ static enum irq_action keyboard_irq_handler(void *ctx)
    }
 
    /* Everything is fine: we read at least one scancode */
-   if (!wth_enqueue_on(kb_worker_thread, &kb_irq_bottom_half, NULL))
-      panic("KB: unable to enqueue job");
+   if (atomic_load_explicit(&kb_bh_pending, mo_relaxed))
+      return IRQ_HANDLED;
+
+   if (!wth_enqueue_on(kb_worker_thread, &kb_irq_bottom_half, NULL)) {
 
+      /* The scancodes stay in the ring: the next IRQ will retry */
+      printk("KB: Warning: hit job queue limit\n");
+      return IRQ_HANDLED;
+   }
+
+   atomic_store_explicit(&kb_bh_pending, true, mo_relaxed);
    return IRQ_HANDLED;
 }
 
@@ -302,7 +313,7 @@ static void create_kb_worker_thread(void)
    if (!kb_input_buf)
       panic("KB: unable to alloc kb_input_buf");
 
-   safe_ringbuf_init(&kb_input_rb, 512, 1, kb_input_buf);
+   spsc_ringbuf_init(&kb_input_rb, 512, kb_input_buf);
 
    kb_worker_thread =
       wth_create_thread("kb", 1 /* priority */, WTH_KB_QUEUE_SIZE);
@@ -438,9 +449,46 @@ init_kb_internal(void)
    register_keyboard_device(&ps2_keyboard);
 }
 
+DEF_STATIC_SYSOBJ_PROP(rx_bytes, &sysobj_ptype_ro_ulong);
+DEF_STATIC_SYSOBJ_PROP(rx_dropped, &sysobj_ptype_ro_ulong);
+DEF_STATIC_SYSOBJ_PROP(rx_batches, &sysobj_ptype_ro_ulong);
+
+DEF_STATIC_SYSOBJ_TYPE(kb_sysobj_type,
+                       &prop_rx_bytes,
+                       &prop_rx_dropped,
+                       &prop_rx_batches,
+                       NULL);
+
+/* Create /syst/kb8042, exposing the stats of the scancodes ring */
+static int kb_create_sysfs_view(void)
+{
+   struct sysobj *obj;
+
+   if (!MOD_sysfs)
+      return 0;
+
+   obj = sysfs_create_obj(&kb_sysobj_type,
+                          NULL,                    /* hooks */
+                          &kb_input_rb.written,
+                          &kb_input_rb.dropped,
+                          &kb_input_rb.batches);
+
+   if (!obj)
+      return -ENOMEM;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "kb8042", obj) < 0) {
+      sysfs_destroy_unregistered_obj(obj);
+      return -ENOMEM;
+   }
+
+   return 0;
+}
+
 /* This will be executed in a kernel thread */
 void init_kb(void)
 {
+   int rc;
+
    if (kopt_serial_console)
       return;
 
@@ -449,6 +497,12 @@ void init_kb(void)
       init_kb_internal();
    }
    enable_preemption();
+
+   if (!kb_worker_thread)
+      return; /* no PS/2 controller */
+
+   if ((rc = kb_create_sysfs_view()))
+      printk("KB: unable to create view in sysfs. Error: %d\n", -rc);
 }
 
 static struct module kb_ps2_module = {
@@ -0,0 +1,478 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/tty.h>
+#include <tilck/kernel/fs/vfs.h>
+
+#include <sys/mman.h>    // system header
+
+#include "procfs_int.h"
+
+/* Approx. max length of a line in /proc/<pid>/maps */
+#define PROCFS_MAPS_LINE_LEN                                    64
+
+/*
+ * A copy of the fields of a process and of its main task, taken with the
+ * preemption disabled. All the formatting happens later, on the copy.
+ */
+struct procfs_proc_snap {
+
+   int pid;
+   int ppid;
+   int pgid;
+   int sid;
+   int tty_nr;
+   enum task_state state;
+   bool stopped;
+   struct sched_rusage ru;
+   struct sched_rusage cru;      /* the usage of the waited children */
+   u32 rss;                      /* resident pages */
+   u32 maxrss;
+   ulong initial_brk;
+   ulong brk;
+   ulong mmap_tot;
+   int open_fds;
+   char cmdline[64];
+};
+
+struct procfs_map_snap {
+
+   ulong vaddr;
+   ulong len;
+   ulong off;
+   int prot;
+   bool shared_anon;
+   const char *fs_type;     /* NULL for private anonymous mappings */
+};
+
+static void
+procfs_snap_proc(struct process *pi, struct procfs_proc_snap *s)
+{
+   struct task *ti = get_process_task(pi);
+   struct user_mapping *um;
+   u32 cmaxrss;
+
+   ASSERT(!is_preemption_enabled());
+
+   *s = (struct procfs_proc_snap) {
+      .pid = pi->pid,
+      .ppid = pi->parent_pid,
+      .pgid = pi->pgid,
+      .sid = pi->sid,
+      .state = ti->state,
+      .stopped = ti->stopped,
+      .initial_brk = (ulong)pi->initial_brk,
+      .brk = (ulong)pi->brk,
+   };
+
+   if (ti == get_curr_task())
+      sched_account_cpu_time(ti);
+
+   s->rss = process_update_maxrss(pi);
+   s->maxrss = pi->maxrss;
+   s->ru = ti->ru;
+   process_get_children_rusage(pi, &s->cru, &cmaxrss);
+
+   if (pi->proc_tty)
+      s->tty_nr = tty_get_dev_nr(pi->proc_tty);
+
+   if (pi->debug_cmdline)
+      strncpy(s->cmdline, pi->debug_cmdline, sizeof(s->cmdline) - 1);
+
+   if (pi->mi) {
+      list_for_each_ro(um, &pi->mi->mappings, pi_node)
+         s->mmap_tot += um->len;
+   }
+
+   for (int i = 0; i < MAX_HANDLES; i++)
+      if (pi->handles[i])
+         s->open_fds++;
+}
+
+static int
+procfs_get_proc_snap(int pid, struct procfs_proc_snap *s)
+{
+   struct process *pi;
+   int rc = -ENOENT;
+
+   disable_preemption();
+   {
+      if ((pi = get_process(pid))) {
+         procfs_snap_proc(pi, s);
+         rc = 0;
+      }
+   }
+   enable_preemption();
+   return rc;
+}
+
+/* The name of the executable, like Linux's `comm` (max 15 chars) */
+static void
+procfs_get_comm(struct procfs_proc_snap *s, char *comm, size_t sz)
+{
+   const char *name = s->cmdline;
+   const char *p;
+   size_t len;
+
+   if (!*name) {
+      /* No cmdline (e.g. MOD_debugpanel=0) */
+      snprintk(comm, sz, "?");
+      return;
+   }
+
+   for (p = name; *p && *p != ' '; p++) {
+      if (*p == '/')
+         name = p + 1;
+   }
+
+   len = MIN((size_t)(p - name), sz - 1);
+   memcpy(comm, name, len);
+   comm[len] = 0;
+}
+
+static char
+procfs_get_state_char(struct procfs_proc_snap *s)
+{
+   if (s->stopped)
+      return 'T';
+
+   switch (s->state) {
+
+      case TASK_STATE_RUNNABLE:
+      case TASK_STATE_RUNNING:
+         return 'R';
+
+      case TASK_STATE_SLEEPING:
+         return 'S';
+
+      case TASK_STATE_ZOMBIE:
+         return 'Z';
+
+      default:
+         return '?';
+   }
+}
+
+/*
+ * Same fields as Linux's /proc/<pid>/stat, up to `rss`. The fields Tilck
+ * doesn't track (e.g. starttime) are always 0.
+ */
+int procfs_gen_pid_stat(int pid, char *buf, u32 buf_sz)
+{
+   struct procfs_proc_snap s;
+   u32 written = 0;
+   char comm[16];
+   int rc;
+
+   if ((rc = procfs_get_proc_snap(pid, &s)))
+      return rc;
+
+   procfs_get_comm(&s, comm, sizeof(comm));
+
+   BUF_PRINTF("%d (%s) %c %d %d %d %d -1 0 ",
+              s.pid, comm, procfs_get_state_char(&s),
+              s.ppid, s.pgid, s.sid, s.tty_nr);
+
+   /* minflt cminflt majflt cmajflt */
+   BUF_PRINTF("%u %u %u %u ",
+              s.ru.minflt, s.cru.minflt, s.ru.majflt, s.cru.majflt);
+
+   /* utime stime cutime cstime */
+   BUF_PRINTF("%llu %llu %llu %llu ",
+              ns_to_clock_t(tsc_to_ns(s.ru.utime)),
+              ns_to_clock_t(tsc_to_ns(s.ru.stime)),
+              ns_to_clock_t(tsc_to_ns(s.cru.utime)),
+              ns_to_clock_t(tsc_to_ns(s.cru.stime)));
+
+   /* priority nice num_threads itrealvalue starttime vsize rss */
+   BUF_PRINTF("20 0 1 0 0 %lu %u\n",
+              s.brk - s.initial_brk + s.mmap_tot, s.rss);
+   return (int)written;
+}
+
+int procfs_gen_pid_status(int pid, char *buf, u32 buf_sz)
+{
+   struct procfs_proc_snap s;
+   u32 written = 0;
+   char comm[16];
+   int rc;
+
+   if ((rc = procfs_get_proc_snap(pid, &s)))
+      return rc;
+
+   procfs_get_comm(&s, comm, sizeof(comm));
+
+   BUF_PRINTF("Name:\t%s\n", comm);
+   BUF_PRINTF("State:\t%c (%s)\n",
+              procfs_get_state_char(&s),
+              s.stopped ? "stopped" : task_state_str[s.state]);
+   BUF_PRINTF("Tgid:\t%d\n", s.pid);
+   BUF_PRINTF("Pid:\t%d\n", s.pid);
+   BUF_PRINTF("PPid:\t%d\n", s.ppid);
+   BUF_PRINTF("Pgid:\t%d\n", s.pgid);
+   BUF_PRINTF("Sid:\t%d\n", s.sid);
+   BUF_PRINTF("Uid:\t0\t0\t0\t0\n");
+   BUF_PRINTF("Gid:\t0\t0\t0\t0\n");
+   BUF_PRINTF("FDSize:\t%d\n", MAX_HANDLES);
+   BUF_PRINTF("FDUsed:\t%d\n", s.open_fds);
+   BUF_PRINTF("VmSize:\t%8lu kB\n",
+              (s.brk - s.initial_brk + s.mmap_tot) / KB);
+   BUF_PRINTF("VmData:\t%8lu kB\n", (s.brk - s.initial_brk) / KB);
+   BUF_PRINTF("VmMmap:\t%8lu kB\n", s.mmap_tot / KB);
+   BUF_PRINTF("VmHWM:\t%8lu kB\n", (ulong)s.maxrss * (PAGE_SIZE / KB));
+   BUF_PRINTF("VmRSS:\t%8lu kB\n", (ulong)s.rss * (PAGE_SIZE / KB));
+   BUF_PRINTF("Threads:\t1\n");
+   BUF_PRINTF("voluntary_ctxt_switches:\t%u\n", s.ru.nvcsw);
+   BUF_PRINTF("nonvoluntary_ctxt_switches:\t%u\n", s.ru.nivcsw);
+   BUF_PRINTF("Cmdline:\t%s\n", s.cmdline);
+   return (int)written;
+}
+
+/* Copies up to `max` user mappings in `arr` and returns their number */
+static int
+procfs_snap_maps(int pid,
+                 struct procfs_map_snap *arr,
+                 int max,
+                 ulong *initial_brk,
+                 ulong *brk)
+{
+   struct user_mapping *um;
+   struct process *pi;
+   int n = 0;
+
+   disable_preemption();
+   {
+      if (!(pi = get_process(pid))) {
+         enable_preemption();
+         return -ENOENT;
+      }
+
+      *initial_brk = (ulong)pi->initial_brk;
+      *brk = (ulong)pi->brk;
+
+      if (pi->mi) {
+
+         list_for_each_ro(um, &pi->mi->mappings, pi_node) {
+
+            struct fs_handle_base *h = um->h;
+
+            if (n == max)
+               break;
+
+            arr[n++] = (struct procfs_map_snap) {
+               .vaddr = um->vaddr,
+               .len = um->len,
+               .off = um->off,
+               .prot = um->prot,
+               .shared_anon = h && (h->spec_flags & VFS_SPFL_ANON_MAPPING),
+               .fs_type = h ? h->fs->fs_type_name : NULL,
+            };
+         }
+      }
+   }
+   enable_preemption();
+   return n;
+}
+
+int procfs_gen_pid_maps(int pid, char *buf, u32 buf_sz)
+{
+   const int max = (int)(buf_sz / PROCFS_MAPS_LINE_LEN) - 1;
+   struct procfs_map_snap *arr;
+   ulong initial_brk, brk;
+   u32 written = 0;
+   int n;
+
+   if (!(arr = kalloc_array_obj(struct procfs_map_snap, (size_t)max)))
+      return -ENOMEM;
+
+   if ((n = procfs_snap_maps(pid, arr, max, &initial_brk, &brk)) < 0) {
+      kfree_array_obj(arr, struct procfs_map_snap, (size_t)max);
+      return n;
+   }
+
+   if (brk > initial_brk)
+      BUF_PRINTF("%08lx-%08lx rw-p 00000000 00:00 0 [heap]\n",
+                 initial_brk, brk);
+
+   for (int i = 0; i < n; i++) {
+
+      struct procfs_map_snap *m = &arr[i];
+      const char *name = "";
+
+      if (m->shared_anon)
+         name = "[shmem]";
+      else if (m->fs_type)
+         name = m->fs_type;
+
+      /* All the mappings with a handle are MAP_SHARED in Tilck */
+      BUF_PRINTF("%08lx-%08lx %c%c%c%c %08lx 00:00 0 %s\n",
+                 m->vaddr, m->vaddr + m->len,
+                 m->prot & PROT_READ ? 'r' : '-',
+                 m->prot & PROT_WRITE ? 'w' : '-',
+                 m->prot & PROT_EXEC ? 'x' : '-',
+                 m->fs_type ? 's' : 'p',
+                 m->off, name);
+   }
+
+   kfree_array_obj(arr, struct procfs_map_snap, (size_t)max);
+   return (int)written;
+}
+
+struct procfs_pids_ctx {
+
+   int after;
+   int *buf;
+   int max;
+   int n;
+};
+
+static int
+procfs_get_pids_cb(void *obj, void *arg)
+{
+   struct task *ti = obj;
+   struct procfs_pids_ctx *ctx = arg;
+
+   if (is_kernel_thread(ti) || !is_main_thread(ti) || ti->tid <= ctx->after)
+      return 0;
+
+   ctx->buf[ctx->n++] = ti->tid;
+   return ctx->n == ctx->max; /* stop the walk when `buf` is full */
+}
+
+int procfs_get_pids(int after, int *buf, int max)
+{
+   struct procfs_pids_ctx ctx = {
+      .after = after,
+      .buf = buf,
+      .max = max,
+      .n = 0,
+   };
+
+   disable_preemption();
+   {
+      iterate_over_tasks(&procfs_get_pids_cb, &ctx);
+   }
+   enable_preemption();
+   return ctx.n;
+}
+
+bool procfs_pid_exists(int pid)
+{
+   bool ret;
+
+   disable_preemption();
+   {
+      ret = get_process(pid) != NULL;
+   }
+   enable_preemption();
+   return ret;
+}
+
+/* Max number of attempts to acquire the fslock of a process */
+#define PROCFS_FSLOCK_ATTEMPTS                                 100
+
+/*
+ * Acquire the fslock of the process `pid`, protecting its fd table, and return
+ * with the preemption disabled, so that the process cannot be reaped until
+ * procfs_unlock_fds() is called.
+ *
+ * NOTE: we cannot just sleep on the fslock of another process: it might be
+ * reaped in the meanwhile and our caller might be holding its own fslock (e.g.
+ * sys_open), so two processes doing that on each other would deadlock. That's
+ * why we try to acquire it, yielding the CPU on failure, and give up after a
+ * while.
+ */
+static int procfs_lock_fds(int pid, struct process **pi_ref)
+{
+   struct process *pi;
+
+   for (int i = 0; i < PROCFS_FSLOCK_ATTEMPTS; i++) {
+
+      disable_preemption();
+
+      if (!(pi = get_process(pid))) {
+         enable_preemption();
+         return -ENOENT;
+      }
+
+      if (kmutex_trylock(&pi->fslock)) {
+         *pi_ref = pi;
+         return 0;
+      }
+
+      enable_preemption();
+      kernel_yield();
+   }
+
+   return -EAGAIN;
+}
+
+static void procfs_unlock_fds(struct process *pi)
+{
+   kmutex_unlock(&pi->fslock);
+   enable_preemption();
+}
+
+int procfs_get_fds(int pid, int after, int *buf, int max)
+{
+   struct process *pi;
+   int n = 0, rc;
+
+   if ((rc = procfs_lock_fds(pid, &pi)))
+      return rc == -ENOENT ? 0 : rc;
+
+   for (int fd = after + 1; fd < MAX_HANDLES && n < max; fd++)
+      if (pi->handles[fd])
+         buf[n++] = fd;
+
+   procfs_unlock_fds(pi);
+   return n;
+}
+
+bool procfs_fd_exists(int pid, int fd)
+{
+   struct process *pi;
+   bool ret;
+
+   if (fd >= MAX_HANDLES || procfs_lock_fds(pid, &pi))
+      return false;
+
+   ret = pi->handles[fd] != NULL;
+   procfs_unlock_fds(pi);
+   return ret;
+}
+
+/*
+ * Handles don't keep the path they've been opened with: like Linux does for
+ * pipes and sockets, the target is "<fs type>:[<inode>]".
+ */
+int procfs_get_fd_link(int pid, int fd, char *buf)
+{
+   struct fs_handle_base *h;
+   const char *fs_type = NULL;
+   vfs_inode_ptr_t inode = NULL;
+   struct process *pi;
+   int rc;
+
+   if ((rc = procfs_lock_fds(pid, &pi)))
+      return rc;
+
+   if ((h = pi->handles[fd])) {
+      fs_type = h->fs->fs_type_name;
+      inode = h->fs->fsops->get_inode(h);
+   }
+
+   procfs_unlock_fds(pi);
+
+   if (!fs_type)
+      return -ENOENT;
+
+   return snprintk(buf, MAX_PATH, "%s:[%lu]", fs_type, (ulong)inode);
+}
@@ -0,0 +1,610 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/modules.h>
+
+#include "procfs_int.h"
+
+/* Max number of pids or fds collected at once by procfs_getdents() */
+#define PROCFS_DENTS_CHUNK                                32
+
+struct procfs_entry_info {
+
+   const char *name;
+   enum vfs_entry_type type;
+   u32 buf_sz;
+   procfs_gen_func gen;
+};
+
+static const struct procfs_entry_info procfs_entries[PROCFS_ENTRIES_COUNT] =
+{
+   [PROCFS_ROOT]        = { NULL, VFS_DIR },
+   [PROCFS_MEMINFO]     = { "meminfo", VFS_FILE, 1024, procfs_gen_meminfo },
+   [PROCFS_STAT]        = { "stat", VFS_FILE, 1024, procfs_gen_stat },
+   [PROCFS_UPTIME]      = { "uptime", VFS_FILE, 64, procfs_gen_uptime },
+   [PROCFS_LOADAVG]     = { "loadavg", VFS_FILE, 64, procfs_gen_loadavg },
+   [PROCFS_INTERRUPTS]  = {
+      "interrupts", VFS_FILE, 2 * KB, procfs_gen_interrupts
+   },
+   [PROCFS_SELF]        = { "self", VFS_SYMLINK },
+
+   [PROCFS_PID_DIR]     = { NULL, VFS_DIR },
+   [PROCFS_PID_STAT]    = { "stat", VFS_FILE, 512, procfs_gen_pid_stat },
+   [PROCFS_PID_STATUS]  = { "status", VFS_FILE, 1024, procfs_gen_pid_status },
+   [PROCFS_PID_MAPS]    = { "maps", VFS_FILE, 8 * KB, procfs_gen_pid_maps },
+   [PROCFS_PID_FD_DIR]  = { "fd", VFS_DIR },
+
+   [PROCFS_PID_FD]      = { NULL, VFS_SYMLINK },
+};
+
+static struct fs *procfs;
+static time_t procfs_mount_time;
+
+static ssize_t
+procfs_file_read(fs_handle h, char *buf, size_t len)
+{
+   struct procfs_handle *ph = h;
+   offt rem = (offt)ph->file.data_len - ph->pos;
+   ssize_t rc;
+
+   rc = (ssize_t)CLAMP(rem, 0, (offt)len);
+   memcpy(buf, ph->file.data + ph->pos, (size_t)rc);
+   ph->pos += rc;
+   return rc;
+}
+
+static ssize_t
+procfs_file_write(fs_handle h, char *buf, size_t len)
+{
+   return -EINVAL;
+}
+
+static offt
+procfs_file_seek(fs_handle h, offt target_off, int whence)
+{
+   struct procfs_handle *ph = h;
+   offt new_pos = ph->pos;
+
+   switch (whence) {
+
+      case SEEK_SET:
+         new_pos = target_off;
+         break;
+
+      case SEEK_CUR:
+         new_pos += target_off;
+         break;
+
+      case SEEK_END:
+         new_pos = (offt)ph->file.data_len + target_off;
+         break;
+
+      default:
+         return -EINVAL;
+   }
+
+   if (new_pos < 0)
+      return -EINVAL;
+
+   ph->pos = new_pos;
+   return new_pos;
+}
+
+static int
+procfs_ioctl(fs_handle h, ulong request, void *arg)
+{
+   return -EINVAL;
+}
+
+static ssize_t
+procfs_dir_read(fs_handle h, char *buf, size_t len)
+{
+   return -EINVAL;
+}
+
+static ssize_t
+procfs_dir_write(fs_handle h, char *buf, size_t len)
+{
+   return -EINVAL;
+}
+
+static offt
+procfs_dir_seek(fs_handle h, offt target_off, int whence)
+{
+   struct procfs_handle *ph = h;
+
+   /* The pids and the fds come and go: support just rewinddir() */
+   if (target_off != 0 || whence != SEEK_SET)
+      return -EINVAL;
+
+   ph->pos = 0;
+   ph->dir.last_id = -1;
+   return 0;
+}
+
+static const struct file_ops static_ops_file_procfs =
+{
+   .read = procfs_file_read,
+   .write = procfs_file_write,
+   .seek = procfs_file_seek,
+   .ioctl = procfs_ioctl,
+   .mmap = NULL,
+   .munmap = NULL,
+};
+
+static const struct file_ops static_ops_dir_procfs =
+{
+   .read = procfs_dir_read,
+   .write = procfs_dir_write,
+   .seek = procfs_dir_seek,
+   .ioctl = procfs_ioctl,
+   .mmap = NULL,
+   .munmap = NULL,
+};
+
+static int
+procfs_open_file(struct fs *fs, void *inode, fs_handle *out)
+{
+   const struct procfs_entry_info *e;
+   struct procfs_handle *h;
+   char *data;
+   int rc;
+
+   e = &procfs_entries[procfs_inode_entry(inode)];
+
+   if (!(data = kmalloc(e->buf_sz)))
+      return -ENOMEM;
+
+   /* Generate the whole content now: reads will work on this snapshot */
+   if ((rc = e->gen(procfs_inode_pid(inode), data, e->buf_sz)) < 0) {
+      kfree2(data, e->buf_sz);
+      return rc;
+   }
+
+   if (!(h = vfs_create_new_handle(fs, &static_ops_file_procfs))) {
+      kfree2(data, e->buf_sz);
+      return -ENOMEM;
+   }
+
+   h->inode = inode;
+   h->spec_flags = VFS_SPFL_NO_LF;
+   h->file.data = data;
+   h->file.data_len = (u32)rc;
+   h->file.data_buf_sz = e->buf_sz;
+   *out = h;
+   return 0;
+}
+
+static int
+procfs_open_dir(struct fs *fs, void *inode, fs_handle *out)
+{
+   struct procfs_handle *h;
+
+   if (!(h = vfs_create_new_handle(fs, &static_ops_dir_procfs)))
+      return -ENOMEM;
+
+   h->inode = inode;
+   h->spec_flags = VFS_SPFL_NO_LF;
+   h->dir.last_id = -1;
+   *out = h;
+   return 0;
+}
+
+static int
+procfs_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mod)
+{
+   void *inode = p->fs_path.inode;
+
+   if (!inode)
+      return (fl & O_CREAT) ? -EROFS : -ENOENT;
+
+   if ((fl & O_CREAT) && (fl & O_EXCL))
+      return -EEXIST;
+
+   if (p->fs_path.type == VFS_DIR)
+      return procfs_open_dir(p->fs, inode, out);
+
+   if (fl & (O_WRONLY | O_RDWR))
+      return -EACCES;
+
+   return procfs_open_file(p->fs, inode, out);
+}
+
+static void
+procfs_on_close(fs_handle h)
+{
+   struct procfs_handle *ph = h;
+
+   if (ph->fops == &static_ops_file_procfs)
+      kfree2(ph->file.data, ph->file.data_buf_sz);
+}
+
+static int
+procfs_on_dup(fs_handle new_h)
+{
+   struct procfs_handle *h2 = new_h;
+   char *data;
+
+   if (h2->fops != &static_ops_file_procfs)
+      return 0;
+
+   /* The new handle must have its own copy of the content */
+   if (!(data = kmalloc(h2->file.data_buf_sz)))
+      return -ENOMEM;
+
+   memcpy(data, h2->file.data, h2->file.data_len);
+   h2->file.data = data;
+   return 0;
+}
+
+static vfs_inode_ptr_t
+procfs_get_inode(fs_handle h)
+{
+   struct procfs_handle *ph = h;
+   return ph->inode;
+}
+
+static int
+procfs_emit_dent(get_dents_func_cb vfs_cb,
+                 void *arg,
+                 void *inode,
+                 const char *name)
+{
+   struct vfs_dent64 dent = {
+      .ino  = (tilck_ino_t)(ulong)inode,
+      .type = procfs_entries[procfs_inode_entry(inode)].type,
+      .name_len = (u8) strlen(name) + 1,
+      .name = name,
+   };
+
+   return vfs_cb(&dent, arg);
+}
+
+/*
+ * Emits first the static entries of the directory [first, last], then the
+ * pids (root dir) or the fds (fd dir). The dynamic part is collected in
+ * chunks, with the preemption disabled only while copying the ids.
+ */
+static int
+procfs_getdents(fs_handle h, get_dents_func_cb vfs_cb, void *arg)
+{
+   struct procfs_handle *ph = h;
+   const enum procfs_entry e = procfs_inode_entry(ph->inode);
+   const int pid = procfs_inode_pid(ph->inode);
+   enum procfs_entry first = PROCFS_INVALID, last = PROCFS_INVALID;
+   enum procfs_entry dyn_entry = PROCFS_INVALID;
+   int ids[PROCFS_DENTS_CHUNK];
+   char name[16];
+   int rc = 0, n;
+
+   switch (e) {
+
+      case PROCFS_ROOT:
+         first = PROCFS_ROOT_FIRST;
+         last = PROCFS_ROOT_LAST;
+         dyn_entry = PROCFS_PID_DIR;
+         break;
+
+      case PROCFS_PID_DIR:
+         first = PROCFS_PID_FIRST;
+         last = PROCFS_PID_LAST;
+         break;
+
+      case PROCFS_PID_FD_DIR:
+         dyn_entry = PROCFS_PID_FD;
+         break;
+
+      default:
+         return -ENOTDIR;
+   }
+
+   if (first != PROCFS_INVALID) {
+
+      /* `pos` is incremented by vfs_cb() for each entry returned */
+      while (ph->pos <= (offt)(last - first)) {
+
+         const enum procfs_entry c = first + (enum procfs_entry)ph->pos;
+         void *inode = procfs_inode(pid, 0, c);
+         const char *c_name = procfs_entries[c].name;
+
+         if ((rc = procfs_emit_dent(vfs_cb, arg, inode, c_name)))
+            return rc;
+      }
+   }
+
+   if (dyn_entry == PROCFS_INVALID)
+      return 0;
+
+   do {
+
+      if (dyn_entry == PROCFS_PID_DIR)
+         n = procfs_get_pids(ph->dir.last_id, ids, ARRAY_SIZE(ids));
+      else
+         n = procfs_get_fds(pid, ph->dir.last_id, ids, ARRAY_SIZE(ids));
+
+      if (n < 0)
+         return n;
+
+      for (int i = 0; i < n; i++) {
+
+         void *inode = dyn_entry == PROCFS_PID_DIR
+            ? procfs_inode(ids[i], 0, PROCFS_PID_DIR)
+            : procfs_inode(pid, ids[i], PROCFS_PID_FD);
+
+         snprintk(name, sizeof(name), "%d", ids[i]);
+
+         if ((rc = procfs_emit_dent(vfs_cb, arg, inode, name)))
+            return rc;
+
+         ph->dir.last_id = ids[i];
+      }
+
+   } while (n == ARRAY_SIZE(ids));
+
+   return 0;
+}
+
+static int
+procfs_stat(struct fs *fs, vfs_inode_ptr_t i, struct stat64 *statbuf)
+{
+   bzero(statbuf, sizeof(struct stat64));
+
+   switch (procfs_entries[procfs_inode_entry(i)].type) {
+
+      case VFS_FILE:
+         statbuf->st_mode = 0444 | S_IFREG;
+         break;
+
+      case VFS_DIR:
+         statbuf->st_mode = 0555 | S_IFDIR;
+         break;
+
+      case VFS_SYMLINK:
+         statbuf->st_mode = 0777 | S_IFLNK;
+         break;
+
+      default:
+         NOT_REACHED();
+   }
+
+   /* Like on Linux, the size of the files is 0: it's unknown before open */
+   statbuf->st_dev = fs->device_id;
+   statbuf->st_ino = (typeof(statbuf->st_ino))(ulong)i;
+   statbuf->st_nlink = 1;
+   statbuf->st_uid = 0; /* root */
+   statbuf->st_gid = 0; /* root */
+   statbuf->st_size = 0;
+   statbuf->st_blksize = PAGE_SIZE;
+   statbuf->st_blocks = 0;
+   statbuf->st_ctim.tv_sec = procfs_mount_time;
+   statbuf->st_mtim = statbuf->st_ctim;
+   statbuf->st_atim = statbuf->st_mtim;
+   return 0;
+}
+
+/* NOTE: `buf` is guaranteed to have room for at least MAX_PATH chars */
+static int
+procfs_readlink(struct vfs_path *p, char *buf)
+{
+   void *i = p->fs_path.inode;
+
+   switch (procfs_inode_entry(i)) {
+
+      case PROCFS_SELF:
+         return snprintk(buf, MAX_PATH, "%d", get_curr_pid());
+
+      case PROCFS_PID_FD:
+         return procfs_get_fd_link(procfs_inode_pid(i),
+                                   procfs_inode_fd(i),
+                                   buf);
+
+      default:
+         return -EINVAL;
+   }
+}
+
+static bool
+procfs_parse_id(const char *name, ssize_t nl, int *id)
+{
+   char buf[16];
+   const char *endp;
+   int err = 0;
+   long val;
+
+   if (nl <= 0 || nl >= (ssize_t)sizeof(buf))
+      return false;
+
+   memcpy(buf, name, (size_t)nl);
+   buf[nl] = 0;
+   val = tilck_strtol(buf, &endp, 10, &err);
+
+   if (err || *endp || val < 0 || val > MAX_PID)
+      return false;
+
+   *id = (int)val;
+   return true;
+}
+
+static void *
+procfs_lookup(void *dir, const char *name, ssize_t nl)
+{
+   const enum procfs_entry e = procfs_inode_entry(dir);
+   const int pid = procfs_inode_pid(dir);
+   enum procfs_entry first, last;
+   int id;
+
+   switch (e) {
+
+      case PROCFS_ROOT:
+         first = PROCFS_ROOT_FIRST;
+         last = PROCFS_ROOT_LAST;
+         break;
+
+      case PROCFS_PID_DIR:
+         first = PROCFS_PID_FIRST;
+         last = PROCFS_PID_LAST;
+         break;
+
+      case PROCFS_PID_FD_DIR:
+         if (procfs_parse_id(name, nl, &id) && procfs_fd_exists(pid, id))
+            return procfs_inode(pid, id, PROCFS_PID_FD);
+
+         return NULL;
+
+      default:
+         return NULL;
+   }
+
+   for (enum procfs_entry c = first; c <= last; c++) {
+
+      const char *c_name = procfs_entries[c].name;
+
+      if (!strncmp(c_name, name, (size_t)nl) && !c_name[nl])
+         return procfs_inode(pid, 0, c);
+   }
+
+   if (e == PROCFS_ROOT) {
+      if (procfs_parse_id(name, nl, &id) && procfs_pid_exists(id))
+         return procfs_inode(id, 0, PROCFS_PID_DIR);
+   }
+
+   return NULL;
+}
+
+static void *
+procfs_get_parent(void *dir)
+{
+   const int pid = procfs_inode_pid(dir);
+
+   if (procfs_inode_entry(dir) == PROCFS_PID_FD_DIR)
+      return procfs_inode(pid, 0, PROCFS_PID_DIR);
+
+   return procfs_inode(0, 0, PROCFS_ROOT);
+}
+
+static void
+procfs_get_entry(struct fs *fs,
+                 void *dir_inode,
+                 const char *name,
+                 ssize_t nl,
+                 struct fs_path *fs_path)
+{
+   void *dir = dir_inode ? dir_inode : procfs_inode(0, 0, PROCFS_ROOT);
+   void *inode;
+
+   if (!name || is_dot_or_dotdot(name, (int)nl)) {
+
+      if (name && nl == 2)
+         dir = procfs_get_parent(dir);
+
+      *fs_path = (struct fs_path) {
+         .inode      = dir,
+         .dir_inode  = procfs_get_parent(dir),
+         .dir_entry  = NULL,
+         .type       = VFS_DIR,
+      };
+
+      return;
+   }
+
+   bzero(fs_path, sizeof(*fs_path));
+
+   if ((inode = procfs_lookup(dir, name, nl))) {
+
+      *fs_path = (struct fs_path) {
+         .inode         = inode,
+         .dir_inode     = dir,
+         .dir_entry     = inode,
+         .type          = procfs_entries[procfs_inode_entry(inode)].type,
+      };
+   }
+}
+
+static int
+procfs_retain_inode(struct fs *fs, vfs_inode_ptr_t inode)
+{
+   /* procfs inodes are not objects: there's nothing to retain */
+   return 1;
+}
+
+static int
+procfs_release_inode(struct fs *fs, vfs_inode_ptr_t inode)
+{
+   /* procfs inodes are not objects: there's nothing to release */
+   return 1;
+}
+
+/*
+ * procfs has no state to protect: the data is read from the kernel's
+ * structures using their own locking rules (typically, disabling the
+ * preemption for a short time). Therefore, the fs-locks are no-ops.
+ */
+static void
+procfs_nop_lock(struct fs *fs)
+{
+   /* do nothing */
+}
+
+static const struct fs_ops static_fsops_procfs =
+{
+   .get_inode = procfs_get_inode,
+   .open = procfs_open,
+   .on_close = procfs_on_close,
+   .on_dup_cb = procfs_on_dup,
+   .getdents = procfs_getdents,
+   .unlink = NULL,
+   .mkdir = NULL,
+   .rmdir = NULL,
+   .truncate = NULL,
+   .stat = procfs_stat,
+   .symlink = NULL,
+   .readlink = procfs_readlink,
+   .chmod = NULL,
+   .get_entry = procfs_get_entry,
+   .rename = NULL,
+   .link = NULL,
+   .retain_inode = procfs_retain_inode,
+   .release_inode = procfs_release_inode,
+
+   .fs_exlock = procfs_nop_lock,
+   .fs_exunlock = procfs_nop_lock,
+   .fs_shlock = procfs_nop_lock,
+   .fs_shunlock = procfs_nop_lock,
+};
+
+static void
+init_procfs(void)
+{
+   int rc;
+
+   if ((rc = vfs_mkdir("/proc", 0777)))
+      panic("vfs_mkdir(\"/proc\") failed with error: %d", rc);
+
+   procfs = create_fs_obj("procfs", &static_fsops_procfs, NULL, 0);
+
+   if (!procfs)
+      panic("Unable to create procfs");
+
+   procfs_mount_time = (time_t)get_timestamp();
+
+   if ((rc = mp_add(procfs, "/proc/")))
+      panic("mp_add() failed with error: %d", rc);
+}
+
+static struct module procfs_module = {
+
+   .name = "procfs",
+   .priority = MOD_procfs_prio,
+   .init = &init_procfs,
+};
+
+REGISTER_MODULE(&procfs_module);
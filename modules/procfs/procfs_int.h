@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_userlim.h>
+#include <tilck_gen_headers/config_sched.h>
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/timer.h>
+
+/*
+ * procfs has no inode objects: an inode is just the tuple (pid, fd, entry)
+ * encoded in a pointer-size integer, which is never NULL because entry > 0.
+ * The content of the files is generated at open time in a per-handle buffer.
+ */
+
+enum procfs_entry {
+
+   PROCFS_INVALID,
+
+   /* /proc */
+   PROCFS_ROOT,
+   PROCFS_MEMINFO,
+   PROCFS_STAT,
+   PROCFS_UPTIME,
+   PROCFS_LOADAVG,
+   PROCFS_INTERRUPTS,
+   PROCFS_SELF,
+
+   /* /proc/<pid> */
+   PROCFS_PID_DIR,
+   PROCFS_PID_STAT,
+   PROCFS_PID_STATUS,
+   PROCFS_PID_MAPS,
+   PROCFS_PID_FD_DIR,
+
+   /* /proc/<pid>/fd/<fd> */
+   PROCFS_PID_FD,
+
+   PROCFS_ENTRIES_COUNT,
+};
+
+#define PROCFS_ROOT_FIRST                      PROCFS_MEMINFO
+#define PROCFS_ROOT_LAST                       PROCFS_SELF
+#define PROCFS_PID_FIRST                       PROCFS_PID_STAT
+#define PROCFS_PID_LAST                        PROCFS_PID_FD_DIR
+
+/* Note: the times in procfs are in USER_HZ units, like on Linux */
+#define BUF_PRINTF(...)                                                    \
+   written += (u32)snprintk(buf + written, buf_sz - written, __VA_ARGS__)
+
+STATIC_ASSERT(MAX_PID < (1 << 15));
+STATIC_ASSERT(MAX_HANDLES <= 256);
+
+static ALWAYS_INLINE void *
+procfs_inode(int pid, int fd, enum procfs_entry e)
+{
+   return (void *)((ulong)pid << 16 | (ulong)fd << 8 | (ulong)e);
+}
+
+static ALWAYS_INLINE int procfs_inode_pid(void *i)
+{
+   return (int)((ulong)i >> 16);
+}
+
+static ALWAYS_INLINE int procfs_inode_fd(void *i)
+{
+   return (int)(((ulong)i >> 8) & 0xff);
+}
+
+static ALWAYS_INLINE enum procfs_entry procfs_inode_entry(void *i)
+{
+   return (enum procfs_entry)((ulong)i & 0xff);
+}
+
+struct procfs_handle {
+
+   /* struct fs_handle_base */
+   FS_HANDLE_BASE_FIELDS
+
+   void *inode;
+
+   union {
+
+      struct {
+         char *data;          /* the content, generated at open */
+         u32 data_len;
+         u32 data_buf_sz;
+      } file;
+
+      struct {
+         int last_id;         /* the last pid or fd returned by getdents */
+      } dir;
+   };
+};
+
+STATIC_ASSERT(sizeof(struct procfs_handle) <= MAX_FS_HANDLE_SIZE);
+
+/*
+ * Generates the content of a file in `buf`, returning the number of bytes
+ * written or a negative errno value (e.g. -ESRCH when the process is gone).
+ */
+typedef int (*procfs_gen_func)(int pid, char *buf, u32 buf_sz);
+
+/* System-wide files */
+int procfs_gen_meminfo(int pid, char *buf, u32 buf_sz);
+int procfs_gen_stat(int pid, char *buf, u32 buf_sz);
+int procfs_gen_uptime(int pid, char *buf, u32 buf_sz);
+int procfs_gen_loadavg(int pid, char *buf, u32 buf_sz);
+int procfs_gen_interrupts(int pid, char *buf, u32 buf_sz);
+
+/* Per-process files */
+int procfs_gen_pid_stat(int pid, char *buf, u32 buf_sz);
+int procfs_gen_pid_status(int pid, char *buf, u32 buf_sz);
+int procfs_gen_pid_maps(int pid, char *buf, u32 buf_sz);
+
+bool procfs_pid_exists(int pid);
+bool procfs_fd_exists(int pid, int fd);
+
+/*
+ * Fill `buf` with up to `max` pids (or open fds) > `after`, in order.
+ * Return the number of ids or, only for the fds, a negative errno.
+ */
+int procfs_get_pids(int after, int *buf, int max);
+int procfs_get_fds(int pid, int after, int *buf, int max);
+
+/* Writes in `buf` (MAX_PATH) the target of /proc/<pid>/fd/<fd> */
+int procfs_get_fd_link(int pid, int fd, char *buf);
@@ -0,0 +1,195 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/irq.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/kmalloc_debug.h>
+#include <tilck/kernel/system_mmap.h>
+
+#include "procfs_int.h"
+
+int procfs_gen_meminfo(int pid, char *buf, u32 buf_sz)
+{
+   struct debug_kmalloc_heap_info hi;
+   size_t heaps_kb = 0, used_kb = 0;
+   u32 written = 0;
+
+   for (int i = 0; i < KMALLOC_HEAPS_COUNT; i++) {
+
+      if (!debug_kmalloc_get_heap_info(i, &hi))
+         break;
+
+      heaps_kb += hi.size / KB;
+      used_kb += hi.mem_allocated / KB;
+   }
+
+   /*
+    * Tilck has no page cache and no swap: all the free memory is in the
+    * kmalloc heaps. The fields with a fixed 0 are there because tools like
+    * busybox's free expect them.
+    */
+   BUF_PRINTF("MemTotal:     %8lu kB\n", get_phys_mem_size() / KB);
+   BUF_PRINTF("MemFree:      %8lu kB\n", (ulong)(heaps_kb - used_kb));
+   BUF_PRINTF("MemAvailable: %8lu kB\n", (ulong)(heaps_kb - used_kb));
+   BUF_PRINTF("Buffers:      %8lu kB\n", 0ul);
+   BUF_PRINTF("Cached:       %8lu kB\n", 0ul);
+   BUF_PRINTF("SwapCached:   %8lu kB\n", 0ul);
+   BUF_PRINTF("SwapTotal:    %8lu kB\n", 0ul);
+   BUF_PRINTF("SwapFree:     %8lu kB\n", 0ul);
+   BUF_PRINTF("Shmem:        %8lu kB\n", 0ul);
+   BUF_PRINTF("SReclaimable: %8lu kB\n", 0ul);
+   BUF_PRINTF("HeapsTotal:   %8lu kB\n", (ulong)heaps_kb);
+   BUF_PRINTF("HeapsUsed:    %8lu kB\n", (ulong)used_kb);
+   return (int)written;
+}
+
+struct procfs_tasks_count {
+
+   int total;
+   int running;
+   int max_pid;
+};
+
+static int
+procfs_count_tasks_cb(void *obj, void *arg)
+{
+   struct task *ti = obj;
+   struct procfs_tasks_count *c = arg;
+
+   if (ti->tid == KERNEL_TID_START)
+      return 0; /* skip the main kernel task */
+
+   c->total++;
+
+   if (ti->state == TASK_STATE_RUNNING || ti->state == TASK_STATE_RUNNABLE)
+      c->running++;
+
+   if (!is_kernel_thread(ti) && is_main_thread(ti))
+      c->max_pid = MAX(c->max_pid, ti->tid);
+
+   return 0;
+}
+
+/* Counts the tasks: the walk just increments a few counters */
+static void
+procfs_count_tasks(struct procfs_tasks_count *c)
+{
+   *c = (struct procfs_tasks_count) { 0 };
+
+   disable_preemption();
+   {
+      iterate_over_tasks(&procfs_count_tasks_cb, c);
+   }
+   enable_preemption();
+}
+
+int procfs_gen_stat(int pid, char *buf, u32 buf_sz)
+{
+   extern u32 irq_count[16];
+   struct procfs_tasks_count c;
+   struct sched_cpu_ticks t;
+   u64 tot_irqs = 0;
+   u32 written = 0;
+   s64 btime;
+
+   sched_get_cpu_ticks(&t);
+   procfs_count_tasks(&c);
+   btime = get_timestamp() - (s64)(get_sys_time() / TS_SCALE);
+
+   for (int i = 0; i < ARRAY_SIZE(irq_count); i++)
+      tot_irqs += irq_count[i];
+
+   /* cpu  user nice system idle iowait irq softirq */
+   BUF_PRINTF("cpu  %llu 0 %llu %llu 0 0 0\n",
+              ticks_to_clock_t(t.user),
+              ticks_to_clock_t(t.kernel),
+              ticks_to_clock_t(t.idle));
+
+   BUF_PRINTF("cpu0 %llu 0 %llu %llu 0 0 0\n",
+              ticks_to_clock_t(t.user),
+              ticks_to_clock_t(t.kernel),
+              ticks_to_clock_t(t.idle));
+
+   BUF_PRINTF("intr %llu", tot_irqs);
+
+   for (int i = 0; i < ARRAY_SIZE(irq_count); i++)
+      BUF_PRINTF(" %u", irq_count[i]);
+
+   BUF_PRINTF("\n");
+   BUF_PRINTF("btime %lld\n", btime);
+   BUF_PRINTF("procs_running %d\n", c.running);
+   BUF_PRINTF("tasks %d\n", c.total);
+   return (int)written;
+}
+
+int procfs_gen_uptime(int pid, char *buf, u32 buf_sz)
+{
+   const u64 ts = get_sys_time();
+   struct sched_cpu_ticks t;
+   u32 written = 0;
+   u64 idle_cs;
+
+   sched_get_cpu_ticks(&t);
+   idle_cs = ticks_to_clock_t(t.idle);
+
+   BUF_PRINTF("%llu.%02llu %llu.%02llu\n",
+              ts / TS_SCALE, ts % TS_SCALE / (TS_SCALE / 100),
+              idle_cs / 100, idle_cs % 100);
+
+   return (int)written;
+}
+
+/*
+ * Like on Linux: the 1, 5 and 15 min load averages, running/total tasks and
+ * the pid of the newest process, approximated here with the highest pid.
+ */
+int procfs_gen_loadavg(int pid, char *buf, u32 buf_sz)
+{
+   struct procfs_tasks_count c;
+   u32 written = 0;
+   ulong loads[3];
+
+   procfs_count_tasks(&c);
+   sched_get_loadavg(loads);
+
+   for (int i = 0; i < 3; i++) {
+
+      /* Round to 2 decimal digits, like Linux */
+      const ulong v = loads[i] + LOADAVG_FIXED_1 / 200;
+
+      BUF_PRINTF("%lu.%02lu ",
+                 v >> LOADAVG_FSHIFT,
+                 ((v & (LOADAVG_FIXED_1 - 1)) * 100) >> LOADAVG_FSHIFT);
+   }
+
+   BUF_PRINTF("%d/%d %d\n", c.running, c.total, c.max_pid);
+   return (int)written;
+}
+
+int procfs_gen_interrupts(int pid, char *buf, u32 buf_sz)
+{
+   extern u32 irq_count[16];
+   extern u32 unhandled_irq_count[256];
+   extern u32 spur_irq_count;
+   u32 written = 0;
+
+   BUF_PRINTF("            CPU0   Unhandled\n");
+
+   for (int i = 0; i < ARRAY_SIZE(irq_count); i++) {
+
+      if (!irq_count[i] && irq_is_masked(i))
+         continue;
+
+      BUF_PRINTF("%3d: %10u  %10u   %s\n",
+                 i, irq_count[i], unhandled_irq_count[i],
+                 irq_is_masked(i) ? "masked" : "");
+   }
+
+   BUF_PRINTF("SPU: %10u\n", spur_irq_count);
+   return (int)written;
+}
@@ -31,6 +31,11 @@
 #define IER_SLEEP_MODE_INTR        0b00010000
 #define IER_LOW_PWR_INTR           0b00100000
 
+/* Interrupt Identification Register (IIR) */
+#define IIR_NO_INTR_PENDING        0b00000001
+#define IIR_64_BYTE_FIFO           0b00100000
+#define IIR_FIFO_ENABLED           0b11000000
+
 /* Line Status Register (LSR) */
 #define LSR_DATA_READY             0b00000001
 #define LSR_OVERRUN_ERROR          0b00000010
@@ -120,10 +125,14 @@ void init_serial_port(u16 port)
 
    outb(port + UART_LCR, LCR_8_BITS | LCR_1_STOP_BIT | LCR_NO_PARITY);
 
+   /* NOTE: the 64-byte FIFO bit (16750 only) can be set only if DLAB = 1 */
+   uart_set_dlab(port, 1);
    outb(port + UART_FCR, FCR_ENABLE_FIFOs |
                          FCR_CLEAR_RECV_FIFO |
                          FCR_CLEAR_TR_FIFO |
+                         FCR_64_BYTE_FIFO |
                          FCR_INT_TRIG_LEVEL_3);
+   uart_set_dlab(port, 0);
 
    outb(port + UART_MCR, MCR_DTR | MCR_RTS | MCR_AUX_OUTPUT_2);
    outb(port + UART_IER, IER_RCV_AVAIL_INTR);
@@ -160,3 +169,38 @@ void serial_write(u16 port, char c)
    serial_wait_for_write(port);
    outb(port, (u8)c);
 }
+
+/* Write a byte without checking if the UART can accept it */
+void serial_write_nowait(u16 port, char c)
+{
+   outb(port, (u8)c);
+}
+
+/*
+ * Returns the number of bytes we can write, one after the other, each time
+ * serial_write_ready() returns true: that's the size of the TX FIFO.
+ *
+ * NOTE: reading the IIR clears a pending THR empty interrupt: call this only
+ * during the initialization.
+ */
+u32 serial_get_tx_fifo_size(u16 port)
+{
+   const u8 iir = inb(port + UART_IIR);
+
+   if ((iir & IIR_FIFO_ENABLED) != IIR_FIFO_ENABLED)
+      return 1;
+
+   return (iir & IIR_64_BYTE_FIFO) ? 64 : 16;
+}
+
+void serial_set_tx_intr(u16 port, bool enabled)
+{
+   u8 ier = inb(port + UART_IER);
+
+   if (enabled)
+      ier |= IER_TR_EMPTY_INTR;
+   else
+      ier &= (u8)~IER_TR_EMPTY_INTR;
+
+   outb(port + UART_IER, ier);
+}
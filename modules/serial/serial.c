@@ -1,5 +1,7 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <tilck_gen_headers/mod_sysfs.h>
+
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
 #include <tilck/common/atomics.h>
@@ -11,18 +13,50 @@
 #include <tilck/kernel/cmdline.h>
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/interrupts.h>
+#include <tilck/kernel/spsc_ringbuf.h>
+#include <tilck/kernel/errno.h>
 
 #include <tilck/mods/serial.h>
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
 
 /* NOTE: hw-specific stuff in generic code. TODO: fix that. */
 
+/* The TX/RX rings' free-running counters require a power of 2 size */
+STATIC_ASSERT((SERIAL_TX_BUF_SIZE & (SERIAL_TX_BUF_SIZE - 1)) == 0);
+STATIC_ASSERT((SERIAL_RX_BUF_SIZE & (SERIAL_RX_BUF_SIZE - 1)) == 0);
+
+/* Max bytes passed at once to the tty by the bottom half */
+#define SERIAL_RX_BATCH                                         64
+
 struct serial_device {
 
    const char *name;
    u16 ioport;
    struct tty *tty;
-   ATOMIC(int) jobs_cnt;
    struct worker_thread *wth;
+
+   /*
+    * RX ring buffer, filled directly by the IRQ handler, which reads all the
+    * bytes in the UART's FIFO, and drained in batches by the bottom half.
+    * At most one bottom half job is queued at a time (see `bh_pending`).
+    */
+   ATOMIC(bool) bh_pending;
+   struct spsc_ringbuf rx_rb;
+   u8 rx_buf[SERIAL_RX_BUF_SIZE];
+
+   /*
+    * TX ring buffer, drained by the THR empty interrupt. The read and write
+    * positions are free-running counters: the ring contains the bytes in the
+    * [tx_read, tx_write) range. Touched only with interrupts disabled.
+    */
+   bool tx_ring_on;
+   bool tx_intr_on;
+   u32 tx_fifo_size;
+   u32 tx_read;
+   u32 tx_write;
+   char tx_buf[SERIAL_TX_BUF_SIZE];
 };
 
 struct serial_device legacy_serial_ports[] =
@@ -45,41 +79,197 @@ struct serial_device legacy_serial_ports[] =
    },
 };
 
-static void ser_bh_handler(void *ctx)
+static struct serial_device *serial_get_dev(u16 port)
+{
+   for (int i = 0; i < ARRAY_SIZE(legacy_serial_ports); i++)
+      if (legacy_serial_ports[i].ioport == port)
+         return &legacy_serial_ports[i];
+
+   return NULL;
+}
+
+static ALWAYS_INLINE char serial_tx_pop(struct serial_device *dev)
+{
+   return dev->tx_buf[dev->tx_read++ % SERIAL_TX_BUF_SIZE];
+}
+
+/*
+ * Move bytes from the TX ring to the UART, filling its FIFO if it's empty.
+ * Keep the THR empty interrupt enabled as long as the ring is not empty.
+ * Must be called with interrupts disabled.
+ */
+static void serial_tx_fill_fifo(struct serial_device *dev)
 {
-   struct serial_device *const dev = ctx;
-   struct tty *const t = dev->tty;
    const u16 p = dev->ioport;
-   char c;
+   bool pending;
+
+   ASSERT(!are_interrupts_enabled());
+
+   if (serial_write_ready(p)) {
+
+      for (u32 n = dev->tx_fifo_size; n > 0; n--) {
 
-   while (serial_read_ready(p)) {
+         if (dev->tx_read == dev->tx_write)
+            break;
 
-      c = serial_read(p);
-      tty_send_keyevent(t, make_key_event(0, c, true), true);
+         serial_write_nowait(p, serial_tx_pop(dev));
+      }
    }
 
-   dev->jobs_cnt--;
+   pending = dev->tx_read != dev->tx_write;
+
+   if (pending != dev->tx_intr_on) {
+      serial_set_tx_intr(p, pending);
+      dev->tx_intr_on = pending;
+   }
+}
+
+/*
+ * Drain the TX ring by polling, in the contexts where we cannot wait for the
+ * THR empty interrupt. Must be called with interrupts disabled.
+ */
+static void serial_tx_drain_polling(struct serial_device *dev)
+{
+   ASSERT(!are_interrupts_enabled());
+
+   while (dev->tx_read != dev->tx_write)
+      serial_write(dev->ioport, serial_tx_pop(dev));
+}
+
+/*
+ * Write `len` bytes to the given serial port. After the module has been
+ * initialized, the bytes are just copied to the port's TX ring buffer, which
+ * is drained by the THR empty interrupt, a FIFO-full of bytes at a time. The
+ * caller blocks only while the ring is full. In panic, with interrupts
+ * disabled or in IRQ context, we cannot wait for the interrupt: fall back to
+ * polling, after draining the ring (if necessary) to preserve the ordering.
+ */
+void serial_write_buf(u16 port, const char *buf, size_t len)
+{
+   struct serial_device *const dev = serial_get_dev(port);
+   const bool can_wait = are_interrupts_enabled() && !in_irq() && !in_panic();
+   ulong var;
+
+   if (!dev || !dev->tx_ring_on || in_panic()) {
+
+      if (dev && dev->tx_read != dev->tx_write) {
+         disable_interrupts(&var);
+         serial_tx_drain_polling(dev);
+         enable_interrupts(&var);
+      }
+
+      for (size_t i = 0; i < len; i++)
+         serial_write(port, buf[i]);
+
+      return;
+   }
+
+   while (len > 0) {
+
+      disable_interrupts(&var);
+      {
+         const u32 used = dev->tx_write - dev->tx_read;
+         const u32 n = (u32)MIN(len, (size_t)(SERIAL_TX_BUF_SIZE - used));
+
+         for (u32 i = 0; i < n; i++)
+            dev->tx_buf[dev->tx_write++ % SERIAL_TX_BUF_SIZE] = buf[i];
+
+         buf += n;
+         len -= n;
+
+         serial_tx_fill_fifo(dev);
+
+         if (len > 0 && !can_wait)
+            serial_tx_drain_polling(dev);
+      }
+      enable_interrupts(&var);
+
+      if (len > 0 && can_wait) {
+
+         /*
+          * The ring is full: wait for the next interrupt. In the unlikely case
+          * the THR empty interrupt doesn't arrive, the timer will wake us up
+          * and serial_tx_fill_fifo() will move some bytes by itself.
+          */
+         halt();
+      }
+   }
+}
+
+static void ser_bh_handler(void *ctx)
+{
+   struct serial_device *const dev = ctx;
+   char buf[SERIAL_RX_BATCH];
+   u32 n;
+
+   /*
+    * Clear the flag *before* draining the ring: the bytes written by any IRQ
+    * after this point will be either read by the loop below or by the new job
+    * that such IRQ will enqueue.
+    */
+   atomic_store(&dev->bh_pending, false);
+
+   while ((n = spsc_ringbuf_read(&dev->rx_rb, buf, sizeof(buf))) > 0)
+      tty_send_input(dev->tty, buf, n, true);
 }
 
 static enum irq_action serial_con_irq_handler(void *ctx)
 {
    struct serial_device *const dev = ctx;
+   bool tx_handled = false;
+   ulong var;
+
+   if (dev->tx_intr_on && serial_write_ready(dev->ioport)) {
+
+      disable_interrupts(&var);
+      {
+         serial_tx_fill_fifo(dev);
+      }
+      enable_interrupts(&var);
+      tx_handled = true;
+   }
+
+   if (!serial_read_ready(dev->ioport)) {
+
+      if (tx_handled)
+         return IRQ_HANDLED;
 
-   if (!serial_read_ready(dev->ioport))
       return IRQ_NOT_HANDLED; /* Not an IRQ from this "device" [irq sharing] */
+   }
+
+   /* Read everything: when the ring is full, the bytes are just dropped */
+   while (serial_read_ready(dev->ioport))
+      spsc_ringbuf_write_1(&dev->rx_rb, (u8)serial_read(dev->ioport));
 
-   if (dev->jobs_cnt >= 2)
+   if (atomic_load_explicit(&dev->bh_pending, mo_relaxed))
       return IRQ_HANDLED;
 
    if (!wth_enqueue_on(dev->wth, &ser_bh_handler, dev)) {
+
+      /* The bytes stay in the ring: the next IRQ will retry */
       printk("Serial: WARNING: hit job queue limit\n");
       return IRQ_HANDLED;
    }
 
-   dev->jobs_cnt++;
+   atomic_store_explicit(&dev->bh_pending, true, mo_relaxed);
    return IRQ_HANDLED;
 }
 
+/*
+ * Synchronously write all the pending bytes in the TX rings. Useful before
+ * turning off or rebooting the machine.
+ */
+void serial_flush_tx_all(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      for (int i = 0; i < ARRAY_SIZE(legacy_serial_ports); i++)
+         serial_tx_drain_polling(&legacy_serial_ports[i]);
+   }
+   enable_interrupts(&var);
+}
+
 void early_init_serial_ports(void)
 {
    init_serial_port(COM1);
@@ -93,8 +283,58 @@ DEFINE_IRQ_HANDLER_NODE(com2, serial_con_irq_handler, &legacy_serial_ports[1]);
 DEFINE_IRQ_HANDLER_NODE(com3, serial_con_irq_handler, &legacy_serial_ports[2]);
 DEFINE_IRQ_HANDLER_NODE(com4, serial_con_irq_handler, &legacy_serial_ports[3]);
 
+DEF_STATIC_SYSOBJ_PROP(rx_bytes, &sysobj_ptype_ro_ulong);
+DEF_STATIC_SYSOBJ_PROP(rx_dropped, &sysobj_ptype_ro_ulong);
+DEF_STATIC_SYSOBJ_PROP(rx_batches, &sysobj_ptype_ro_ulong);
+
+DEF_STATIC_SYSOBJ_TYPE(serial_port_sysobj_type,
+                       &prop_rx_bytes,
+                       &prop_rx_dropped,
+                       &prop_rx_batches,
+                       NULL);
+
+/* Create /syst/serial/COMn, exposing the RX stats of each port */
+static int serial_create_sysfs_view(void)
+{
+   struct sysobj *dir, *obj;
+
+   if (!MOD_sysfs)
+      return 0;
+
+   if (!(dir = sysfs_create_empty_obj()))
+      return -ENOMEM;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "serial", dir) < 0) {
+      sysfs_destroy_unregistered_obj(dir);
+      return -ENOMEM;
+   }
+
+   for (int i = 0; i < ARRAY_SIZE(legacy_serial_ports); i++) {
+
+      struct serial_device *dev = &legacy_serial_ports[i];
+
+      obj = sysfs_create_obj(&serial_port_sysobj_type,
+                             NULL,                    /* hooks */
+                             &dev->rx_rb.written,
+                             &dev->rx_rb.dropped,
+                             &dev->rx_rb.batches);
+
+      if (!obj)
+         return -ENOMEM;
+
+      if (sysfs_register_obj(NULL, dir, dev->name, obj) < 0) {
+         sysfs_destroy_unregistered_obj(obj);
+         return -ENOMEM;
+      }
+   }
+
+   return 0;
+}
+
 static void init_serial_comm(void)
 {
+   int rc;
+
    struct worker_thread *wth;
 
    disable_preemption();
@@ -112,12 +352,24 @@ static void init_serial_comm(void)
 
       dev->tty = get_serial_tty((int)i);
       dev->wth = wth;
+      spsc_ringbuf_init(&dev->rx_rb, SERIAL_RX_BUF_SIZE, dev->rx_buf);
    }
 
    irq_install_handler(X86_PC_COM1_COM3_IRQ, &com1);
    irq_install_handler(X86_PC_COM1_COM3_IRQ, &com3);
    irq_install_handler(X86_PC_COM2_COM4_IRQ, &com2);
    irq_install_handler(X86_PC_COM2_COM4_IRQ, &com4);
+
+   for (int i = 0; i < ARRAY_SIZE(legacy_serial_ports); i++) {
+
+      struct serial_device *dev = &legacy_serial_ports[i];
+
+      dev->tx_fifo_size = serial_get_tx_fifo_size(dev->ioport);
+      dev->tx_ring_on = true;
+   }
+
+   if ((rc = serial_create_sysfs_view()))
+      printk("Serial: unable to create view in sysfs. Error: %d\n", -rc);
 }
 
 static struct module serial_module = {
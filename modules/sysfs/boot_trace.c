@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/boot_trace.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+#define BOOT_TRACE_LINE_LEN             96
+
+/*
+ * Three lines: the TSC frequency in kHz, then the TSC cycles and the ns
+ * spent before kmain() and in the kernel init, until the first user process.
+ */
+static offt
+boot_trace_summary_load(struct sysobj *obj,
+                        void *data, void *buf, offt buf_sz, offt off)
+{
+   struct boot_trace_step dummy;
+   u64 start, end;
+
+   ASSERT(off == 0);
+   boot_trace_get_steps(&dummy, 0, &start, &end);
+
+   if (!end)
+      end = start;
+
+   return snprintk(buf, (size_t)buf_sz,
+                   "tsc_khz %u\n"
+                   "before_kmain %llu %llu\n"
+                   "kernel_init %llu %llu\n",
+                   get_tsc_khz(),
+                   start, tsc_to_ns(start),
+                   end - start, tsc_to_ns(end - start));
+}
+
+static offt
+boot_trace_table_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return (BOOT_TRACE_MAX_STEPS + 1) * BOOT_TRACE_LINE_LEN;
+}
+
+/*
+ * One line per init step, in execution order:
+ *    <depth> <name> <start cycles> <cycles> <ns>
+ * where <start cycles> is relative to the entry of kmain().
+ */
+static offt
+boot_trace_table_load(struct sysobj *obj,
+                      void *data, void *buf, offt buf_sz, offt off)
+{
+   struct boot_trace_step *steps;
+   offt written = 0;
+   u64 start, end;
+   u32 n;
+
+   ASSERT(off == 0);
+
+   steps = kalloc_array_obj(struct boot_trace_step, BOOT_TRACE_MAX_STEPS);
+
+   if (!steps)
+      return -ENOMEM;
+
+   n = boot_trace_get_steps(steps, BOOT_TRACE_MAX_STEPS, &start, &end);
+
+   for (u32 i = 0; i < n; i++) {
+
+      struct boot_trace_step *s = &steps[i];
+      const u64 cycles = s->end ? s->end - s->start : 0;
+
+      if (buf_sz - written < BOOT_TRACE_LINE_LEN)
+         break;
+
+      written += snprintk(buf + written, (size_t)(buf_sz - written),
+                          "%u %s %llu %llu %llu\n",
+                          s->depth, s->name, s->start - start,
+                          cycles, tsc_to_ns(cycles));
+   }
+
+   kfree_array_obj(steps, struct boot_trace_step, BOOT_TRACE_MAX_STEPS);
+   return written;
+}
+
+static const struct sysobj_prop_type boot_trace_ptype_summary = {
+   .load = &boot_trace_summary_load,
+};
+
+static const struct sysobj_prop_type boot_trace_ptype_table = {
+   .get_buf_sz = &boot_trace_table_get_buf_sz,
+   .load = &boot_trace_table_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(summary, &boot_trace_ptype_summary);
+DEF_STATIC_SYSOBJ_PROP(table, &boot_trace_ptype_table);
+
+DEF_STATIC_SYSOBJ_TYPE(boot_trace_sysobj_type,
+                       &prop_summary,
+                       &prop_table,
+                       NULL);
+
+/* Create /syst/boot_trace/{summary,table} */
+void sysfs_create_boot_trace_obj(void)
+{
+   struct sysobj *obj;
+
+   obj = sysfs_create_obj(&boot_trace_sysobj_type,
+                          NULL,                    /* hooks */
+                          NULL,                    /* summary */
+                          NULL);                   /* table */
+
+   if (!obj)
+      panic("sysfs: unable to create /syst/boot_trace");
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "boot_trace", obj) < 0)
+      panic("sysfs: unable to register /syst/boot_trace");
+}
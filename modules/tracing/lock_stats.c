@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/mod_sysfs.h>
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/lock_stats.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+#include "tracing_int.h"
+
+/* Max length of a line in /syst/lock_stats/table */
+#define LOCK_STATS_LINE_LEN                                    192
+
+/* All the classes, plus "<other>" */
+#define LOCK_STATS_BUF_ELEMS               (LOCK_STATS_MAX_CLASSES + 1)
+
+/* Max length of a class name */
+#define LOCK_STATS_NAME_LEN                                     64
+
+static offt
+lock_stats_reset_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   lock_stats_reset();
+   return buf_sz;
+}
+
+static offt
+lock_stats_table_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return LOCK_STATS_BUF_ELEMS * LOCK_STATS_LINE_LEN;
+}
+
+/*
+ * One line per lock class acquired at least once:
+ *    <type> <name> <acquisitions> <contended> <tot wait> <max wait> <max hold>
+ * where all the times are in TSC cycles.
+ */
+static offt
+lock_stats_table_load(struct sysobj *obj,
+                      void *data, void *buf, offt buf_sz, offt off)
+{
+   char name[LOCK_STATS_NAME_LEN];
+   struct lock_class_stats *arr;
+   offt written = 0;
+   u32 count;
+
+   ASSERT(off == 0);
+
+   if (!(arr = kalloc_array_obj(struct lock_class_stats, LOCK_STATS_BUF_ELEMS)))
+      return -ENOMEM;
+
+   count = lock_stats_get_all(arr, LOCK_STATS_BUF_ELEMS);
+
+   for (u32 i = 0; i < count; i++) {
+
+      struct lock_class_stats *cl = &arr[i];
+
+      if (buf_sz - written < LOCK_STATS_LINE_LEN)
+         break;
+
+      lock_stats_get_class_name(cl, name, sizeof(name));
+
+      written += snprintk(buf + written, (size_t)(buf_sz - written),
+                          "%s %s %llu %llu %llu %llu %llu\n",
+                          lock_stats_get_type_str(cl), name,
+                          cl->acquisitions, cl->contended,
+                          cl->tot_wait, cl->max_wait, cl->max_hold);
+   }
+
+   kfree_array_obj(arr, struct lock_class_stats, LOCK_STATS_BUF_ELEMS);
+   return written;
+}
+
+static const struct sysobj_prop_type lock_stats_ptype_reset = {
+   .store = &lock_stats_reset_store,
+};
+
+static const struct sysobj_prop_type lock_stats_ptype_table = {
+   .get_buf_sz = &lock_stats_table_get_buf_sz,
+   .load = &lock_stats_table_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(reset, &lock_stats_ptype_reset);
+DEF_STATIC_SYSOBJ_PROP(table, &lock_stats_ptype_table);
+
+DEF_STATIC_SYSOBJ_TYPE(lock_stats_sysobj_type,
+                       &prop_reset,
+                       &prop_table,
+                       NULL);
+
+/* Create /syst/lock_stats/{reset,table}, when KRN_LOCK_STATS=1 */
+void
+init_lock_stats(void)
+{
+   struct sysobj *obj;
+
+   if (!MOD_sysfs || !KRN_LOCK_STATS)
+      return;
+
+   obj = sysfs_create_obj(&lock_stats_sysobj_type,
+                          NULL,                    /* hooks */
+                          NULL,                    /* reset */
+                          NULL);                   /* table */
+
+   if (!obj)
+      panic("tracing: unable to create /syst/lock_stats");
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "lock_stats", obj) < 0)
+      panic("tracing: unable to register /syst/lock_stats");
+}
@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/mod_sysfs.h>
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/preemptoff_trace.h>
+#include <tilck/kernel/timer.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+#include "tracing_int.h"
+
+/* Max length of a line in /syst/preemptoff/{preempt,irqs} */
+#define POFF_LINE_LEN                                          192
+
+/* Max length of a call site name */
+#define POFF_SITE_NAME_LEN                                      64
+
+static offt
+poff_reset_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   poff_trace_reset();
+   return buf_sz;
+}
+
+static offt
+poff_table_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return POFF_TRACE_TOP_N * POFF_LINE_LEN;
+}
+
+/*
+ * One line per section, from the longest to the shortest:
+ *    <cycles> <ns> <start site> <end site> <tid>
+ * where <tid> is the task that ended the section.
+ */
+static offt
+poff_table_load(enum poff_type t, void *buf, offt buf_sz)
+{
+   char start[POFF_SITE_NAME_LEN], end[POFF_SITE_NAME_LEN];
+   struct poff_entry arr[POFF_TRACE_TOP_N];
+   offt written = 0;
+   u32 count;
+
+   count = poff_trace_get(t, arr, ARRAY_SIZE(arr));
+
+   for (u32 i = 0; i < count; i++) {
+
+      struct poff_entry *e = &arr[i];
+
+      if (buf_sz - written < POFF_LINE_LEN)
+         break;
+
+      poff_trace_get_site_name(e->start_site, start, sizeof(start));
+      poff_trace_get_site_name(e->end_site, end, sizeof(end));
+
+      written += snprintk(buf + written, (size_t)(buf_sz - written),
+                          "%llu %llu %s %s %d\n",
+                          e->cycles, tsc_to_ns(e->cycles),
+                          start, end, e->tid);
+   }
+
+   return written;
+}
+
+static offt
+poff_preempt_load(struct sysobj *obj,
+                  void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return poff_table_load(POFF_PREEMPT, buf, buf_sz);
+}
+
+static offt
+poff_irqs_load(struct sysobj *obj,
+               void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return poff_table_load(POFF_IRQS, buf, buf_sz);
+}
+
+static const struct sysobj_prop_type poff_ptype_reset = {
+   .store = &poff_reset_store,
+};
+
+static const struct sysobj_prop_type poff_ptype_preempt = {
+   .get_buf_sz = &poff_table_get_buf_sz,
+   .load = &poff_preempt_load,
+};
+
+static const struct sysobj_prop_type poff_ptype_irqs = {
+   .get_buf_sz = &poff_table_get_buf_sz,
+   .load = &poff_irqs_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(reset, &poff_ptype_reset);
+DEF_STATIC_SYSOBJ_PROP(preempt, &poff_ptype_preempt);
+DEF_STATIC_SYSOBJ_PROP(irqs, &poff_ptype_irqs);
+
+DEF_STATIC_SYSOBJ_TYPE(poff_sysobj_type,
+                       &prop_reset,
+                       &prop_preempt,
+                       &prop_irqs,
+                       NULL);
+
+/* Create /syst/preemptoff/{reset,preempt,irqs}, when KRN_PREEMPTOFF_TRACE=1 */
+void
+init_preemptoff_trace(void)
+{
+   struct sysobj *obj;
+
+   if (!MOD_sysfs || !KRN_PREEMPTOFF_TRACE)
+      return;
+
+   obj = sysfs_create_obj(&poff_sysobj_type,
+                          NULL,                    /* hooks */
+                          NULL,                    /* reset */
+                          NULL,                    /* preempt */
+                          NULL);                   /* irqs */
+
+   if (!obj)
+      panic("tracing: unable to create /syst/preemptoff");
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "preemptoff", obj) < 0)
+      panic("tracing: unable to register /syst/preemptoff");
+}
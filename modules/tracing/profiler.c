@@ -0,0 +1,561 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_mm.h>
+#include <tilck_gen_headers/mod_sysfs.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/interrupts.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/paging_hw.h>
+#include <tilck/kernel/elf_utils.h>
+#include <tilck/kernel/sort.h>
+
+#include <tilck/mods/profiler.h>
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+#include "tracing_int.h"
+
+/* Max length of a line in /syst/profiler/folded */
+#define PROF_FOLDED_LINE_LEN                                   256
+
+/* Allocated on the first enable: nobody pays for it, unless used */
+static struct prof_sample *samples;
+static u32 samples_w;            /* index of the next sample to write */
+static u32 samples_count;        /* valid samples, at most PROF_MAX_SAMPLES */
+
+static u32 prof_pause_count;     /* readers iterating over the samples */
+static bool prof_reset_pending;
+static u32 prof_interval = 1;    /* in timer ticks */
+static u32 prof_ticks;
+bool __prof_on;
+
+static u16
+prof_walk_kernel_stack(struct task *ti, ulong fp, ulong *pcs, u16 depth)
+{
+   const ulong stack_lo = (ulong)ti->kernel_stack;
+   const ulong stack_hi = stack_lo + KERNEL_STACK_SIZE;
+   ulong *frame;
+
+   while (depth < PROF_MAX_DEPTH) {
+
+      if (fp & (sizeof(ulong) - 1))
+         break;
+
+      if (fp < stack_lo || fp + 2 * sizeof(ulong) > stack_hi)
+         break;
+
+      frame = (ulong *)fp;
+
+      if (!frame[1])
+         break;
+
+      pcs[depth++] = frame[1];
+
+      if (frame[0] <= fp)
+         break;                  /* frames must go towards the stack's base */
+
+      fp = frame[0];
+   }
+
+   return depth;
+}
+
+static u16
+prof_walk_user_stack(ulong fp, ulong *pcs, u16 depth)
+{
+   pdir_t *pdir = get_curr_pdir();
+   ulong frame[2];
+
+   while (depth < PROF_MAX_DEPTH) {
+
+      if (!fp || (fp & (sizeof(ulong) - 1)))
+         break;
+
+      if (fp + sizeof(frame) > USERMODE_VADDR_END)
+         break;
+
+      if (virtual_read(pdir, (void *)fp, frame, sizeof(frame)) < 0)
+         break;
+
+      if (!frame[1])
+         break;
+
+      pcs[depth++] = frame[1];
+
+      if (frame[0] <= fp)
+         break;
+
+      fp = frame[0];
+   }
+
+   return depth;
+}
+
+void
+prof_timer_tick(void)
+{
+   struct task *curr = get_curr_task();
+   regs_t *r = get_irq_regs();
+   struct prof_sample *s;
+   ulong var;
+
+   if (prof_pause_count || !samples)
+      return;
+
+   if (++prof_ticks < prof_interval)
+      return;
+
+   prof_ticks = 0;
+
+   /*
+    * Keep the interrupts disabled while writing the sample: it's just a few
+    * words per frame and nested timer IRQs must not get the same slot.
+    */
+   disable_interrupts(&var);
+   {
+      s = &samples[samples_w];
+      s->tid = curr->tid;
+      s->flags = 0;
+      s->pcs[0] = regs_get_ip(r);
+
+      if (regs_in_user_mode(r)) {
+         s->flags |= PROF_SAMPLE_USER;
+         s->depth = prof_walk_user_stack(regs_get_frame_ptr(r), s->pcs, 1);
+      } else {
+         s->depth =
+            prof_walk_kernel_stack(curr, regs_get_frame_ptr(r), s->pcs, 1);
+      }
+
+      samples_w = (samples_w + 1) % PROF_MAX_SAMPLES;
+      samples_count = MIN(samples_count + 1, (u32)PROF_MAX_SAMPLES);
+   }
+   enable_interrupts(&var);
+}
+
+int
+prof_set_enabled(bool enabled)
+{
+   struct prof_sample *buf;
+
+   if (enabled && !samples) {
+
+      if (!(buf = kzalloc_array_obj(struct prof_sample, PROF_MAX_SAMPLES)))
+         return -ENOMEM;
+
+      disable_preemption();
+      {
+         if (!samples) {
+            samples = buf;
+            buf = NULL;
+         }
+      }
+      enable_preemption();
+
+      if (buf)
+         kfree_array_obj(buf, struct prof_sample, PROF_MAX_SAMPLES);
+   }
+
+   __prof_on = enabled;
+   return 0;
+}
+
+void
+prof_set_interval(u32 ticks)
+{
+   prof_interval = MAX(ticks, 1u);
+}
+
+u32
+prof_get_interval(void)
+{
+   return prof_interval;
+}
+
+static void
+prof_reset_nolock(void)
+{
+   ASSERT(!are_interrupts_enabled());
+   samples_w = 0;
+   samples_count = 0;
+   prof_ticks = 0;
+}
+
+/*
+ * If somebody is iterating over the samples, the reset is deferred to the
+ * moment the last reader is done.
+ */
+void
+prof_reset(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      if (prof_pause_count)
+         prof_reset_pending = true;
+      else
+         prof_reset_nolock();
+   }
+   enable_interrupts(&var);
+}
+
+static u32
+prof_get_samples_count(void)
+{
+   ulong var;
+   u32 count;
+
+   disable_interrupts(&var);
+   {
+      count = samples_count;
+   }
+   enable_interrupts(&var);
+   return count;
+}
+
+/*
+ * Pausing the profiler is enough to read the ring without disabling the
+ * interrupts: prof_timer_tick() runs in IRQ context, so it never stops in the
+ * middle of a sample to let a task run. Readers can overlap (e.g. the debug
+ * panel and /syst/profiler/folded), so pausing is ref-counted.
+ */
+static void
+prof_pause(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      prof_pause_count++;
+   }
+   enable_interrupts(&var);
+}
+
+static void
+prof_resume(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      ASSERT(prof_pause_count > 0);
+
+      if (!--prof_pause_count && prof_reset_pending) {
+         prof_reset_nolock();
+         prof_reset_pending = false;
+      }
+   }
+   enable_interrupts(&var);
+}
+
+static ALWAYS_INLINE struct prof_sample *
+prof_get_nth_sample(u32 n)
+{
+   ASSERT(n < samples_count);
+   return &samples[(samples_w + PROF_MAX_SAMPLES - samples_count + n)
+                   % PROF_MAX_SAMPLES];
+}
+
+void
+prof_foreach_sample(void (*cb)(struct prof_sample *, void *), void *arg)
+{
+   prof_pause();
+   {
+      for (u32 i = 0; i < samples_count; i++)
+         cb(prof_get_nth_sample(i), arg);
+   }
+   prof_resume();
+}
+
+const char *
+prof_get_kernel_sym(struct prof_sample *s, u32 n)
+{
+   ulong va;
+
+   ASSERT(n < s->depth);
+   ASSERT(!(s->flags & PROF_SAMPLE_USER));
+
+   /*
+    * pcs[0] is the interrupted instruction, while the others are return
+    * addresses: the call instruction is just before them and it might be the
+    * last one of its function (e.g. calls to NORETURN funcs).
+    */
+   va = n ? s->pcs[n] - 1 : s->pcs[0];
+   return find_sym_at_addr(va, NULL, NULL);
+}
+
+static void
+prof_get_comm(int tid, char *buf, size_t buf_sz)
+{
+   struct task *ti;
+   const char *name = NULL;
+   size_t len = 0;
+
+   disable_preemption();
+   {
+      if ((ti = get_task(tid))) {
+
+         if (is_kernel_thread(ti)) {
+            name = ti->kthread_name;
+            len = name ? strlen(name) : 0;
+         } else if ((name = ti->pi->debug_cmdline)) {
+            for (len = 0; name[len] && name[len] != ' '; len++) { }
+         }
+      }
+
+      if (len)
+         snprintk(buf, MIN(buf_sz, len + 1), "%s", name);
+      else
+         snprintk(buf, buf_sz, "tid-%d", tid);
+   }
+   enable_preemption();
+}
+
+static long
+prof_cmp_samples(const void *a, const void *b)
+{
+   const struct prof_sample *x = prof_get_nth_sample(*(const u16 *)a);
+   const struct prof_sample *y = prof_get_nth_sample(*(const u16 *)b);
+
+   if (x->tid != y->tid)
+      return x->tid - y->tid;
+
+   if (x->flags != y->flags)
+      return x->flags - y->flags;
+
+   if (x->depth != y->depth)
+      return x->depth - y->depth;
+
+   for (u32 i = 0; i < x->depth; i++)
+      if (x->pcs[i] != y->pcs[i])
+         return x->pcs[i] < y->pcs[i] ? -1 : 1;
+
+   return 0;
+}
+
+static int
+prof_fmt_folded_line(char *buf, int buf_sz, struct prof_sample *s, u32 count)
+{
+   char comm[32];
+   const char *sym;
+   int rc;
+
+   prof_get_comm(s->tid, comm, sizeof(comm));
+   rc = snprintk(buf, (size_t)buf_sz, "%s", comm);
+
+   /* The folded format wants the outermost frame first */
+   for (int i = s->depth - 1; i >= 0 && rc < buf_sz; i--) {
+
+      if (s->flags & PROF_SAMPLE_USER) {
+         rc += snprintk(buf + rc, (size_t)(buf_sz - rc), ";%p",
+                        (void *)s->pcs[i]);
+         continue;
+      }
+
+      if (!(sym = prof_get_kernel_sym(s, (u32)i)))
+         sym = "?";
+
+      rc += snprintk(buf + rc, (size_t)(buf_sz - rc), ";%s", sym);
+   }
+
+   if (rc < buf_sz)
+      rc += snprintk(buf + rc, (size_t)(buf_sz - rc), " %u\n", count);
+
+   return rc;
+}
+
+static offt
+prof_enabled_load(struct sysobj *obj,
+                  void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return snprintk(buf, (size_t)buf_sz, "%u\n", prof_is_enabled());
+}
+
+static offt
+prof_enabled_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   const char *s = buf;
+   int rc;
+
+   if (buf_sz < 1 || (s[0] != '0' && s[0] != '1'))
+      return -EINVAL;
+
+   if ((rc = prof_set_enabled(s[0] == '1')))
+      return rc;
+
+   return buf_sz;
+}
+
+static offt
+prof_interval_load(struct sysobj *obj,
+                   void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return snprintk(buf, (size_t)buf_sz, "%u\n", prof_get_interval());
+}
+
+static offt
+prof_interval_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   char tmp[16];
+   const char *endp;
+   int err = 0;
+   long val;
+
+   if (buf_sz < 1 || buf_sz >= (offt)sizeof(tmp))
+      return -EINVAL;
+
+   memcpy(tmp, buf, (size_t)buf_sz);
+   tmp[buf_sz] = 0;
+
+   val = tilck_strtol(tmp, &endp, 10, &err);
+
+   if (err || val < 1 || val > 1000 || (*endp && *endp != '\n'))
+      return -EINVAL;
+
+   prof_set_interval((u32)val);
+   return buf_sz;
+}
+
+static offt
+prof_reset_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   prof_reset();
+   return buf_sz;
+}
+
+static offt
+prof_samples_load(struct sysobj *obj,
+                  void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return snprintk(buf, (size_t)buf_sz, "%u\n", prof_get_samples_count());
+}
+
+static offt
+prof_folded_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return (prof_get_samples_count() + 1) * PROF_FOLDED_LINE_LEN;
+}
+
+/*
+ * One line per distinct stack, in the folded format:
+ *    <comm>;<outermost func>;...;<innermost func> <count>
+ * User frames are not symbolized: they're shown as raw addresses.
+ */
+static offt
+prof_folded_load(struct sysobj *obj,
+                 void *data, void *buf, offt buf_sz, offt off)
+{
+   char line[PROF_FOLDED_LINE_LEN];
+   struct prof_sample *s;
+   offt written = 0;
+   u16 *idx;
+   u32 count, n;
+   int rc;
+
+   ASSERT(off == 0);
+   STATIC_ASSERT(PROF_MAX_SAMPLES <= 65536);
+
+   if (!(idx = kalloc_array_obj(u16, PROF_MAX_SAMPLES)))
+      return -ENOMEM;
+
+   prof_pause();
+   {
+      for (n = 0; n < samples_count; n++)
+         idx[n] = (u16)n;
+
+      heap_sort_generic(idx, sizeof(idx[0]), n, prof_cmp_samples);
+
+      for (u32 i = 0; i < n; i += count) {
+
+         s = prof_get_nth_sample(idx[i]);
+
+         for (count = 1; i + count < n; count++)
+            if (prof_cmp_samples(&idx[i], &idx[i + count]))
+               break;
+
+         rc = prof_fmt_folded_line(line, sizeof(line), s, count);
+
+         if (rc >= (int)sizeof(line))
+            continue;            /* too deep stack: skip it */
+
+         if (buf_sz - written < rc)
+            break;
+
+         memcpy(buf + written, line, (size_t)rc);
+         written += rc;
+      }
+   }
+   prof_resume();
+
+   kfree_array_obj(idx, u16, PROF_MAX_SAMPLES);
+   return written;
+}
+
+static const struct sysobj_prop_type prof_ptype_enabled = {
+   .load = &prof_enabled_load,
+   .store = &prof_enabled_store,
+};
+
+static const struct sysobj_prop_type prof_ptype_interval = {
+   .load = &prof_interval_load,
+   .store = &prof_interval_store,
+};
+
+static const struct sysobj_prop_type prof_ptype_reset = {
+   .store = &prof_reset_store,
+};
+
+static const struct sysobj_prop_type prof_ptype_samples = {
+   .load = &prof_samples_load,
+};
+
+static const struct sysobj_prop_type prof_ptype_folded = {
+   .get_buf_sz = &prof_folded_get_buf_sz,
+   .load = &prof_folded_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(enabled, &prof_ptype_enabled);
+DEF_STATIC_SYSOBJ_PROP(interval, &prof_ptype_interval);
+DEF_STATIC_SYSOBJ_PROP(reset, &prof_ptype_reset);
+DEF_STATIC_SYSOBJ_PROP(samples, &prof_ptype_samples);
+DEF_STATIC_SYSOBJ_PROP(folded, &prof_ptype_folded);
+
+DEF_STATIC_SYSOBJ_TYPE(prof_sysobj_type,
+                       &prop_enabled,
+                       &prop_interval,
+                       &prop_reset,
+                       &prop_samples,
+                       &prop_folded,
+                       NULL);
+
+/* Create /syst/profiler/{enabled,interval,reset,samples,folded} */
+void
+init_profiler(void)
+{
+   struct sysobj *obj;
+
+   if (!MOD_sysfs)
+      return;
+
+   obj = sysfs_create_obj(&prof_sysobj_type,
+                          NULL,                    /* hooks */
+                          NULL,                    /* enabled */
+                          NULL,                    /* interval */
+                          NULL,                    /* reset */
+                          NULL,                    /* samples */
+                          NULL);                   /* folded */
+
+   if (!obj)
+      panic("tracing: unable to create /syst/profiler");
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "profiler", obj) < 0)
+      panic("tracing: unable to register /syst/profiler");
+}
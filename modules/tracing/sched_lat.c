@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/mod_sysfs.h>
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sched_lat.h>
+#include <tilck/kernel/timer.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+#include "tracing_int.h"
+
+/* Max length of the content of /syst/sched_lat/{wakeup,runq} */
+#define SCHED_LAT_HIST_BUF_SZ      (64 + SCHED_LAT_HIST_SIZE * 12)
+
+static offt
+sched_lat_reset_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   sched_lat_reset();
+   return buf_sz;
+}
+
+static offt
+sched_lat_hist_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return SCHED_LAT_HIST_BUF_SZ;
+}
+
+/*
+ * A single line:
+ *    <count> <tot cycles> <max cycles> <first bucket> <hist>
+ * where <hist> are the counters of the histogram, from the first to the last
+ * non-zero bucket. Same format as /syst/syscall_stats/table.
+ */
+static offt
+sched_lat_hist_load(struct sched_lat_hist *h, void *buf, offt buf_sz)
+{
+   offt written;
+   int first, last;
+
+   if (!h->count)
+      return snprintk(buf, (size_t)buf_sz, "0 0 0 0\n");
+
+   for (first = 0; !h->hist[first]; first++) { }
+   for (last = SCHED_LAT_HIST_SIZE - 1; !h->hist[last]; last--) { }
+
+   written = snprintk(buf, (size_t)buf_sz, "%llu %llu %llu %d",
+                      h->count, h->tot, h->max, first);
+
+   for (int b = first; b <= last; b++)
+      written += snprintk(buf + written, (size_t)(buf_sz - written),
+                          " %u", h->hist[b]);
+
+   written += snprintk(buf + written, (size_t)(buf_sz - written), "\n");
+   return written;
+}
+
+static offt
+sched_lat_wakeup_load(struct sysobj *obj,
+                      void *data, void *buf, offt buf_sz, offt off)
+{
+   struct sched_lat_stats s;
+
+   ASSERT(off == 0);
+   sched_lat_get_stats(&s);
+   return sched_lat_hist_load(&s.wakeup, buf, buf_sz);
+}
+
+static offt
+sched_lat_runq_load(struct sysobj *obj,
+                    void *data, void *buf, offt buf_sz, offt off)
+{
+   struct sched_lat_stats s;
+
+   ASSERT(off == 0);
+   sched_lat_get_stats(&s);
+   return sched_lat_hist_load(&s.runq, buf, buf_sz);
+}
+
+/*
+ * A single line:
+ *    <cycles> <ns> <tid> <waker tid> <prev tid> <preempt count> <reason>
+ * See struct sched_lat_worst.
+ */
+static offt
+sched_lat_worst_load(struct sysobj *obj,
+                     void *data, void *buf, offt buf_sz, offt off)
+{
+   struct sched_lat_stats s;
+   struct sched_lat_worst *w = &s.worst;
+
+   ASSERT(off == 0);
+   sched_lat_get_stats(&s);
+
+   return snprintk(buf, (size_t)buf_sz, "%llu %llu %d %d %d %d %s\n",
+                   w->latency, tsc_to_ns(w->latency),
+                   w->tid, w->waker_tid, w->prev_tid, w->preempt_count,
+                   sched_lat_get_reason_str(w));
+}
+
+static const struct sysobj_prop_type sched_lat_ptype_reset = {
+   .store = &sched_lat_reset_store,
+};
+
+static const struct sysobj_prop_type sched_lat_ptype_wakeup = {
+   .get_buf_sz = &sched_lat_hist_get_buf_sz,
+   .load = &sched_lat_wakeup_load,
+};
+
+static const struct sysobj_prop_type sched_lat_ptype_runq = {
+   .get_buf_sz = &sched_lat_hist_get_buf_sz,
+   .load = &sched_lat_runq_load,
+};
+
+static const struct sysobj_prop_type sched_lat_ptype_worst = {
+   .load = &sched_lat_worst_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(reset, &sched_lat_ptype_reset);
+DEF_STATIC_SYSOBJ_PROP(wakeup, &sched_lat_ptype_wakeup);
+DEF_STATIC_SYSOBJ_PROP(runq, &sched_lat_ptype_runq);
+DEF_STATIC_SYSOBJ_PROP(worst, &sched_lat_ptype_worst);
+
+DEF_STATIC_SYSOBJ_TYPE(sched_lat_sysobj_type,
+                       &prop_reset,
+                       &prop_wakeup,
+                       &prop_runq,
+                       &prop_worst,
+                       NULL);
+
+/*
+ * Create /syst/sched_lat/{reset,wakeup,runq,worst}, when
+ * KRN_SCHED_LAT_STATS=1
+ */
+void
+init_sched_lat(void)
+{
+   struct sysobj *obj;
+
+   if (!MOD_sysfs || !KRN_SCHED_LAT_STATS)
+      return;
+
+   obj = sysfs_create_obj(&sched_lat_sysobj_type,
+                          NULL,                    /* hooks */
+                          NULL,                    /* reset */
+                          NULL,                    /* wakeup */
+                          NULL,                    /* runq */
+                          NULL);                   /* worst */
+
+   if (!obj)
+      panic("tracing: unable to create /syst/sched_lat");
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "sched_lat", obj) < 0)
+      panic("tracing: unable to register /syst/sched_lat");
+}
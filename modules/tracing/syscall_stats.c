@@ -0,0 +1,247 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/mod_sysfs.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+
+#include <tilck/mods/tracing.h>
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+#include "tracing_int.h"
+
+/* Max length of a line in /syst/syscall_stats/table */
+#define SYS_STATS_LINE_LEN                                     512
+
+/* Allocated on the first enable: nobody pays for it, unless used */
+static struct syscall_stats *sys_stats;
+bool __syscall_stats_on;
+
+static ALWAYS_INLINE u32
+sys_stats_hist_bucket(u64 cycles)
+{
+   if (!cycles)
+      return 0;
+
+   return MIN((u32)(63 - __builtin_clzll(cycles)), SYS_STATS_HIST_SIZE - 1u);
+}
+
+void
+syscall_stats_account(u32 sys_n, u64 cycles)
+{
+   struct syscall_stats *s = &sys_stats[sys_n];
+   const u32 bucket = sys_stats_hist_bucket(cycles);
+
+   ASSERT(sys_n < MAX_SYSCALLS);
+
+   disable_preemption();
+   {
+      s->calls++;
+      s->tot_cycles += cycles;
+      s->max_cycles = MAX(s->max_cycles, cycles);
+      s->hist[bucket]++;
+   }
+   enable_preemption();
+}
+
+int
+syscall_stats_set_enabled(bool enabled)
+{
+   struct syscall_stats *buf;
+
+   if (enabled && !sys_stats) {
+
+      if (!(buf = kzalloc_array_obj(struct syscall_stats, MAX_SYSCALLS)))
+         return -ENOMEM;
+
+      disable_preemption();
+      {
+         if (!sys_stats) {
+            sys_stats = buf;
+            buf = NULL;
+         }
+      }
+      enable_preemption();
+
+      if (buf)
+         kfree_array_obj(buf, struct syscall_stats, MAX_SYSCALLS);
+   }
+
+   /*
+    * Never free `sys_stats` on disable: syscalls already running will account
+    * their latency on exit anyway.
+    */
+   __syscall_stats_on = enabled;
+   return 0;
+}
+
+void
+syscall_stats_reset(void)
+{
+   disable_preemption();
+   {
+      if (sys_stats)
+         bzero(sys_stats, sizeof(struct syscall_stats) * MAX_SYSCALLS);
+   }
+   enable_preemption();
+}
+
+bool
+syscall_stats_get(u32 sys_n, struct syscall_stats *out)
+{
+   bool ret = false;
+
+   if (sys_n >= MAX_SYSCALLS)
+      return false;
+
+   disable_preemption();
+   {
+      if (sys_stats && sys_stats[sys_n].calls) {
+         *out = sys_stats[sys_n];
+         ret = true;
+      }
+   }
+   enable_preemption();
+   return ret;
+}
+
+static offt
+sys_stats_enabled_load(struct sysobj *obj,
+                       void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return snprintk(buf, (size_t)buf_sz, "%u\n", syscall_stats_is_enabled());
+}
+
+static offt
+sys_stats_enabled_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   const char *s = buf;
+   int rc;
+
+   if (buf_sz < 1 || (s[0] != '0' && s[0] != '1'))
+      return -EINVAL;
+
+   if ((rc = syscall_stats_set_enabled(s[0] == '1')))
+      return rc;
+
+   return buf_sz;
+}
+
+static offt
+sys_stats_reset_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   syscall_stats_reset();
+   return buf_sz;
+}
+
+static offt
+sys_stats_table_get_buf_sz(struct sysobj *obj, void *data)
+{
+   struct syscall_stats st;
+   offt lines = 1;
+
+   for (u32 i = 0; i < MAX_SYSCALLS; i++)
+      if (syscall_stats_get(i, &st))
+         lines++;
+
+   return lines * SYS_STATS_LINE_LEN;
+}
+
+/*
+ * One line per syscall called at least once:
+ *    <sys_n> <name> <calls> <tot cycles> <max cycles> <first bucket> <hist>
+ * where <hist> are the counters of the histogram, from the first to the last
+ * non-zero bucket.
+ */
+static offt
+sys_stats_table_load(struct sysobj *obj,
+                     void *data, void *buf, offt buf_sz, offt off)
+{
+   struct syscall_stats st;
+   const char *name;
+   offt written = 0;
+   int first, last;
+
+   ASSERT(off == 0);
+
+   for (u32 i = 0; i < MAX_SYSCALLS; i++) {
+
+      if (buf_sz - written < SYS_STATS_LINE_LEN)
+         break;
+
+      if (!syscall_stats_get(i, &st))
+         continue;
+
+      if (!(name = tracing_get_syscall_name(i)))
+         name = "?";
+
+      for (first = 0; !st.hist[first]; first++) { }
+      for (last = SYS_STATS_HIST_SIZE - 1; !st.hist[last]; last--) { }
+
+      written += snprintk(buf + written, (size_t)(buf_sz - written),
+                          "%u %s %llu %llu %llu %d",
+                          i, name, st.calls, st.tot_cycles,
+                          st.max_cycles, first);
+
+      for (int b = first; b <= last; b++)
+         written += snprintk(buf + written, (size_t)(buf_sz - written),
+                             " %u", st.hist[b]);
+
+      written += snprintk(buf + written, (size_t)(buf_sz - written), "\n");
+   }
+
+   return written;
+}
+
+static const struct sysobj_prop_type sys_stats_ptype_enabled = {
+   .load = &sys_stats_enabled_load,
+   .store = &sys_stats_enabled_store,
+};
+
+static const struct sysobj_prop_type sys_stats_ptype_reset = {
+   .store = &sys_stats_reset_store,
+};
+
+static const struct sysobj_prop_type sys_stats_ptype_table = {
+   .get_buf_sz = &sys_stats_table_get_buf_sz,
+   .load = &sys_stats_table_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(enabled, &sys_stats_ptype_enabled);
+DEF_STATIC_SYSOBJ_PROP(reset, &sys_stats_ptype_reset);
+DEF_STATIC_SYSOBJ_PROP(table, &sys_stats_ptype_table);
+
+DEF_STATIC_SYSOBJ_TYPE(sys_stats_sysobj_type,
+                       &prop_enabled,
+                       &prop_reset,
+                       &prop_table,
+                       NULL);
+
+/* Create /syst/syscall_stats/{enabled,reset,table} */
+void
+init_syscall_stats(void)
+{
+   struct sysobj *obj;
+
+   if (!MOD_sysfs)
+      return;
+
+   obj = sysfs_create_obj(&sys_stats_sysobj_type,
+                          NULL,                    /* hooks */
+                          NULL,                    /* enabled */
+                          NULL,                    /* reset */
+                          NULL);                   /* table */
+
+   if (!obj)
+      panic("tracing: unable to create /syst/syscall_stats");
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "syscall_stats", obj) < 0)
+      panic("tracing: unable to register /syst/syscall_stats");
+}
@@ -2,12 +2,13 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
+#include <tilck/common/utils.h>
 
 #include <tilck/kernel/modules.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/sync.h>
-#include <tilck/kernel/ringbuf.h>
+#include <tilck/kernel/paging.h>
 #include <tilck/kernel/datetime.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/bintree.h>
@@ -16,7 +17,10 @@
 
 #include <tilck/mods/tracing.h>
 
-#define TRACE_BUF_SIZE                       (128 * KB)
+#include "tracing_int.h"
+
+#define TRACE_REC_HDR_SIZE           (offsetof(struct trace_rec, e))
+#define TRACE_EV_BASE_SIZE           (offsetof(struct trace_event, fmt0))
 
 struct symbol_node {
 
@@ -27,10 +31,14 @@ struct symbol_node {
    const char *name;
 };
 
-static struct kmutex tracing_lock;
-static struct kcond tracing_cond;
-static struct ringbuf tracing_rb;
-static void *tracing_buf;
+struct kcond tracing_cond;
+struct trace_buf_hdr *tracing_hdr;
+bool tracing_ext_consumer;
+
+static u8 *tracing_data;
+static u32 tracing_data_size;
+static u32 tracing_head;      /* copy of tracing_hdr->head, not user-writable */
+static u16 *syscalls_ev_sizes;
 
 static u32 syms_count;
 static struct symbol_node *syms_buf;
@@ -188,6 +196,84 @@ trace_syscall_exit_save_params(const struct syscall_info *si,
    }
 }
 
+/*
+ * Returns true and sets `off` if there's room for a record of `size` bytes,
+ * writing a padding record at the end of the data area if necessary.
+ * The user space can write `tail`: validate it. Called with preemption
+ * disabled.
+ */
+static bool
+tracing_find_room(u32 size, u32 *off)
+{
+   const u32 tail = atomic_load_explicit(&tracing_hdr->tail, mo_acquire);
+   const u32 end_space = tracing_data_size - tracing_head;
+   struct trace_rec *pad;
+
+   if (tail >= tracing_data_size || tail % TRACE_REC_ALIGN)
+      return false;
+
+   if (tracing_head < tail) {
+
+      /* The head must never reach the tail: that would mean "empty" */
+      *off = tracing_head;
+      return size < tail - tracing_head;
+   }
+
+   if (size < end_space || (size == end_space && tail > 0)) {
+      *off = tracing_head;
+      return true;
+   }
+
+   if (size >= tail)
+      return false;
+
+   pad = (void *)(tracing_data + tracing_head);
+   pad->size = end_space;
+   pad->flags = TRACE_REC_PAD;
+   *off = 0;
+   return true;
+}
+
+/*
+ * Write the event in the buffer without taking any lock: on Tilck disabling
+ * the preemption is enough to make the short copy below atomic, because
+ * syscalls are not traced in IRQ context.
+ */
+static void
+tracing_write_event(struct trace_event *e)
+{
+   const u32 len = e->sys < MAX_SYSCALLS
+      ? syscalls_ev_sizes[e->sys]
+      : TRACE_EV_BASE_SIZE;
+
+   const u32 size =
+      (u32)pow2_round_up_at(TRACE_REC_HDR_SIZE + len, TRACE_REC_ALIGN);
+   struct trace_rec *r;
+   u32 off;
+
+   disable_preemption();
+   {
+      if (tracing_find_room(size, &off)) {
+
+         r = (void *)(tracing_data + off);
+         r->size = size;
+         r->flags = 0;
+         memcpy(&r->e, e, len);
+         bzero((char *)&r->e + len, size - TRACE_REC_HDR_SIZE - len);
+
+         tracing_head = (off + size) % tracing_data_size;
+         atomic_store_explicit(&tracing_hdr->head, tracing_head, mo_release);
+         atomic_fetch_add_explicit(&tracing_hdr->written, 1, mo_relaxed);
+
+      } else {
+
+         atomic_fetch_add_explicit(&tracing_hdr->dropped, 1, mo_relaxed);
+      }
+   }
+   enable_preemption();
+   kcond_signal_all(&tracing_cond);
+}
+
 void
 trace_syscall_enter_int(u32 sys,
                         ulong a1,
@@ -211,13 +297,7 @@ trace_syscall_enter_int(u32 sys,
    };
 
    trace_syscall_enter_save_params(si, &e);
-
-   kmutex_lock(&tracing_lock);
-   {
-      ringbuf_write_elem(&tracing_rb, &e);
-      kcond_signal_one(&tracing_cond);
-   }
-   kmutex_unlock(&tracing_lock);
+   tracing_write_event(&e);
 }
 
 void
@@ -242,38 +322,100 @@ trace_syscall_exit_int(u32 sys,
    };
 
    trace_syscall_exit_save_params(si, &e);
+   tracing_write_event(&e);
+}
+
+/*
+ * Returns true if the next record of the consumer (tail) is valid and is not
+ * a padding record, skipping the padding records. In case the tail or the
+ * records have been corrupted by the user space, the buffer is emptied.
+ * Must be called with preemption disabled.
+ */
+static bool
+tracing_next_rec(u32 *tail_ref)
+{
+   u32 tail = *tail_ref;
+   struct trace_rec *r;
+
+   ASSERT(!is_preemption_enabled());
+
+   while (tail != tracing_head) {
+
+      if (tail >= tracing_data_size || tail % TRACE_REC_ALIGN)
+         break;
+
+      r = (void *)(tracing_data + tail);
+
+      if (r->size < TRACE_REC_HDR_SIZE ||
+          r->size % TRACE_REC_ALIGN ||
+          r->size > tracing_data_size - tail)
+      {
+         break;
+      }
 
-   kmutex_lock(&tracing_lock);
+      if (!(r->flags & TRACE_REC_PAD)) {
+         *tail_ref = tail;
+         return true;
+      }
+
+      tail = (tail + r->size) % tracing_data_size;
+   }
+
+   /* Empty or corrupted buffer: in the 2nd case, discard everything */
+   *tail_ref = tracing_head;
+   atomic_store_explicit(&tracing_hdr->tail, tracing_head, mo_release);
+   return false;
+}
+
+void
+tracing_reset_tail(void)
+{
+   disable_preemption();
    {
-      ringbuf_write_elem(&tracing_rb, &e);
-      kcond_signal_one(&tracing_cond);
+      atomic_store_explicit(&tracing_hdr->tail, tracing_head, mo_release);
    }
-   kmutex_unlock(&tracing_lock);
+   enable_preemption();
+}
+
+bool
+tracing_is_buf_empty(void)
+{
+   const u32 tail = atomic_load_explicit(&tracing_hdr->tail, mo_relaxed);
+   return tail == atomic_load_explicit(&tracing_hdr->head, mo_relaxed);
 }
 
 bool read_trace_event_noblock(struct trace_event *e)
 {
-   bool ret;
-   kmutex_lock(&tracing_lock);
+   struct trace_rec *r;
+   bool ret = false;
+   u32 tail;
+
+   disable_preemption();
    {
-      ret = ringbuf_read_elem(&tracing_rb, e);
+      tail = atomic_load_explicit(&tracing_hdr->tail, mo_relaxed);
+
+      if (!tracing_ext_consumer && tracing_next_rec(&tail)) {
+
+         r = (void *)(tracing_data + tail);
+         bzero(e, sizeof(*e));
+         memcpy(e, &r->e, MIN(r->size - TRACE_REC_HDR_SIZE, sizeof(*e)));
+
+         tail = (tail + r->size) % tracing_data_size;
+         atomic_store_explicit(&tracing_hdr->tail, tail, mo_release);
+         ret = true;
+      }
    }
-   kmutex_unlock(&tracing_lock);
+   enable_preemption();
    return ret;
 }
 
 bool read_trace_event(struct trace_event *e, u32 timeout_ticks)
 {
-   bool ret;
-   kmutex_lock(&tracing_lock);
-   {
-      if (ringbuf_is_empty(&tracing_rb))
-         kcond_wait(&tracing_cond, &tracing_lock, timeout_ticks);
+   if (read_trace_event_noblock(e))
+      return true;
 
-      ret = ringbuf_read_elem(&tracing_rb, e);
-   }
-   kmutex_unlock(&tracing_lock);
-   return ret;
+   kcond_wait(&tracing_cond, NULL, timeout_ticks);
+   return read_trace_event_noblock(e);
 }
 
 const struct syscall_info *
@@ -431,6 +573,25 @@ tracing_reset_slot_info(u32 sys)
       (*params_slots)[sys][j] = NO_SLOT;
 }
 
+/* The size of the events of the given syscall: up to the end of its slots */
+static void
+tracing_calc_ev_size(const struct syscall_info *si)
+{
+   const s8 fmt = syscalls_fmts[si->sys_n];
+   size_t size = TRACE_EV_BASE_SIZE;
+   s8 slot;
+
+   for (int i = 0; i < si->n_params; i++) {
+
+      if ((slot = (*params_slots)[si->sys_n][i]) == NO_SLOT)
+         continue;
+
+      size = MAX(size, fmt_offsets[fmt][slot] + fmt_sizes[fmt][slot]);
+   }
+
+   syscalls_ev_sizes[si->sys_n] = (u16)size;
+}
+
 static void
 tracing_allocate_slots_for_params(void)
 {
@@ -468,6 +629,9 @@ tracing_allocate_slots_for_params(void)
 
       panic("Unable to alloc param slots for syscall #%u", sys_n);
    }
+
+   for (si = tracing_metadata; si->sys_n != INVALID_SYSCALL; si++)
+      tracing_calc_ev_size(si);
 }
 
 static void
@@ -640,13 +804,28 @@ set_traced_syscalls(const char *s)
 int
 tracing_get_in_buffer_events_count(void)
 {
-   int rc;
-   kmutex_lock(&tracing_lock);
+   struct trace_rec *r;
+   int count = 0;
+   u32 tail;
+
+   disable_preemption();
    {
-      rc = (int)ringbuf_get_elems(&tracing_rb); // integer narrowing
+      tail = atomic_load_explicit(&tracing_hdr->tail, mo_relaxed);
+
+      while (tracing_next_rec(&tail)) {
+         r = (void *)(tracing_data + tail);
+         tail = (tail + r->size) % tracing_data_size;
+         count++;
+      }
    }
-   kmutex_unlock(&tracing_lock);
-   return rc;
+   enable_preemption();
+   return count;
+}
+
+u32
+tracing_get_dropped_events_count(void)
+{
+   return atomic_load_explicit(&tracing_hdr->dropped, mo_relaxed);
 }
 
 static void
@@ -658,9 +837,12 @@ tracing_init_oom_panic(const char *buf_name)
 void
 init_tracing(void)
 {
-   if (!(tracing_buf = kzmalloc(TRACE_BUF_SIZE)))
+   if (!(tracing_hdr = kzmalloc(TRACE_BUF_SIZE)))
       tracing_init_oom_panic("tracing_buf");
 
+   if (!(syscalls_ev_sizes = kalloc_array_obj(u16, MAX_SYSCALLS)))
+      tracing_init_oom_panic("syscalls_ev_sizes");
+
    if (!(syms_buf = kalloc_array_obj(struct symbol_node, MAX_SYSCALLS)))
       tracing_init_oom_panic("syms_buf");
 
@@ -679,12 +861,20 @@ init_tracing(void)
    if (!(traced_syscalls_str = kmalloc(TRACED_SYSCALLS_STR_LEN)))
       tracing_init_oom_panic("traced_syscalls_str");
 
-   ringbuf_init(&tracing_rb,
-                TRACE_BUF_SIZE / sizeof(struct trace_event),
-                sizeof(struct trace_event),
-                tracing_buf);
+   /* The buffer gets mapped in the user space: see tracing_dev.c */
+   ASSERT(IS_PAGE_ALIGNED(tracing_hdr));
+   retain_pageframes_mapped_at(get_kernel_pdir(), tracing_hdr, TRACE_BUF_SIZE);
+
+   tracing_data = (u8 *)tracing_hdr + PAGE_SIZE;
+   tracing_data_size = TRACE_BUF_SIZE - PAGE_SIZE;
+
+   tracing_hdr->magic = TRACE_BUF_MAGIC;
+   tracing_hdr->data_off = PAGE_SIZE;
+   tracing_hdr->data_size = tracing_data_size;
+
+   for (u32 i = 0; i < MAX_SYSCALLS; i++)
+      syscalls_ev_sizes[i] = TRACE_EV_BASE_SIZE;
 
-   kmutex_init(&tracing_lock, 0);
    kcond_init(&tracing_cond);
 
    foreach_symbol(elf_symbol_cb, NULL);
@@ -693,6 +883,12 @@ init_tracing(void)
    tracing_allocate_slots_for_params();
 
    set_traced_syscalls("*");
+   init_tracing_dev();
+   init_syscall_stats();
+   init_profiler();
+   init_lock_stats();
+   init_sched_lat();
+   init_preemptoff_trace();
 }
 
 static struct module dp_module = {
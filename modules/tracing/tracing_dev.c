@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/user.h>
+
+#include <linux/major.h>  // system header
+
+#include "tracing_int.h"
+
+/*
+ * /dev/tracing: the user space interface of the syscall tracing buffer.
+ * See the comment in <tilck/common/tracing_buf.h> for the protocol.
+ */
+
+#define TRACING_MINOR                           0
+
+static u32 tracing_dev_refs;
+
+static int tracing_dev_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
+{
+   const size_t pg_count = um->len >> PAGE_SHIFT;
+   size_t mapped_cnt;
+
+   if (um->off + um->len > TRACE_BUF_SIZE)
+      return -EINVAL;
+
+   if (flags & VFS_MM_DONT_MMAP)
+      return 0;
+
+   mapped_cnt = map_pages(pdir,
+                          um->vaddrp,
+                          KERNEL_VA_TO_PA(tracing_hdr) + um->off,
+                          pg_count,
+                          PAGING_FL_RWUS | PAGING_FL_SHARED);
+
+   if (mapped_cnt != pg_count) {
+      unmap_pages_permissive(pdir, um->vaddrp, mapped_cnt, false);
+      return -ENOMEM;
+   }
+
+   return 0;
+}
+
+static int tracing_dev_trace_tid(int tid)
+{
+   struct task *ti;
+   int rc = 0;
+
+   disable_preemption();
+   {
+      if ((ti = get_task(tid >= 0 ? tid : -tid)))
+         ti->traced = tid >= 0;
+      else
+         rc = -ESRCH;
+   }
+   enable_preemption();
+   return rc;
+}
+
+static int tracing_dev_set_filter(const char *user_expr)
+{
+   char expr[TRACED_SYSCALLS_STR_LEN];
+
+   if (copy_str_from_user(expr, user_expr, sizeof(expr), NULL))
+      return -EFAULT;
+
+   return set_traced_syscalls(expr);
+}
+
+static int tracing_dev_get_sys_name(struct trace_sys *user_ts)
+{
+   struct trace_sys ts;
+   const char *name;
+
+   if (copy_from_user(&ts, user_ts, sizeof(ts)))
+      return -EFAULT;
+
+   if (ts.sys >= MAX_SYSCALLS || !(name = tracing_get_syscall_name(ts.sys)))
+      return -EINVAL;
+
+   if (!strncmp(name, "sys_", 4))
+      name += 4;
+
+   snprintk(ts.name, sizeof(ts.name), "%s", name);
+
+   if (copy_to_user(user_ts, &ts, sizeof(ts)))
+      return -EFAULT;
+
+   return 0;
+}
+
+static int tracing_dev_ioctl(fs_handle h, ulong request, void *argp)
+{
+   switch (request) {
+
+      case TILCK_TRACE_IOC_ENABLE:
+         tracing_set_enabled(!!argp);
+         return 0;
+
+      case TILCK_TRACE_IOC_TRACE_TID:
+         return tracing_dev_trace_tid((int)(long)argp);
+
+      case TILCK_TRACE_IOC_SET_FILTER:
+         return tracing_dev_set_filter(argp);
+
+      case TILCK_TRACE_IOC_GET_SYS_NAME:
+         return tracing_dev_get_sys_name(argp);
+
+      default:
+         return -EINVAL;
+   }
+}
+
+static int tracing_dev_read_ready(fs_handle h)
+{
+   return !tracing_is_buf_empty();
+}
+
+static struct kcond *tracing_dev_get_rready_cond(fs_handle h)
+{
+   return &tracing_cond;
+}
+
+static int tracing_dev_create_extra(int minor, void *extra)
+{
+   int rc = 0;
+
+   disable_preemption();
+   {
+      if (tracing_ext_consumer) {
+         rc = -EBUSY;
+      } else {
+         tracing_ext_consumer = true;
+         tracing_dev_refs = 1;
+      }
+   }
+   enable_preemption();
+   return rc;
+}
+
+static int tracing_dev_on_dup_extra(int minor, void *extra)
+{
+   disable_preemption();
+   {
+      tracing_dev_refs++;
+   }
+   enable_preemption();
+   return 0;
+}
+
+static void tracing_dev_destroy_extra(int minor, void *extra)
+{
+   disable_preemption();
+   {
+      ASSERT(tracing_dev_refs > 0);
+
+      if (!--tracing_dev_refs) {
+
+         /* Don't leave stale (or corrupted) events to the kernel's reader */
+         tracing_reset_tail();
+         tracing_ext_consumer = false;
+      }
+   }
+   enable_preemption();
+}
+
+static int
+tracing_dev_create_device_file(int minor,
+                               enum vfs_entry_type *type,
+                               struct devfs_file_info *nfo)
+{
+   static const struct file_ops static_ops_tracing = {
+
+      .ioctl = tracing_dev_ioctl,
+      .mmap = tracing_dev_mmap,
+      .munmap = generic_fs_munmap,
+      .read_ready = tracing_dev_read_ready,
+      .get_rready_cond = tracing_dev_get_rready_cond,
+   };
+
+   *type = VFS_CHAR_DEV;
+   nfo->fops = &static_ops_tracing;
+   nfo->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
+   nfo->create_extra = &tracing_dev_create_extra;
+   nfo->on_dup_extra = &tracing_dev_on_dup_extra;
+   nfo->destroy_extra = &tracing_dev_destroy_extra;
+   return 0;
+}
+
+void init_tracing_dev(void)
+{
+   struct driver_info *di = kzalloc_obj(struct driver_info);
+
+   if (!di)
+      panic("tracing: no enough memory for struct driver_info");
+
+   di->name = "tracing";
+   di->create_dev_file = tracing_dev_create_device_file;
+   register_driver(di, MISC_MAJOR);
+
+   if (create_dev_file("tracing", MISC_MAJOR, TRACING_MINOR, NULL) < 0)
+      panic("tracing: unable to create /dev/tracing");
+}
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/mods/tracing.h>
+#include <tilck/kernel/sync.h>
+
+/* The header page plus the data area, mapped in the user space as well */
+#define TRACE_BUF_SIZE                       (128 * KB)
+
+extern struct kcond tracing_cond;
+extern struct trace_buf_hdr *tracing_hdr;
+
+/* True while /dev/tracing is open: the kernel does not consume events */
+extern bool tracing_ext_consumer;
+
+void init_tracing_dev(void);
+void init_syscall_stats(void);
+void init_profiler(void);
+void init_lock_stats(void);
+void init_sched_lat(void);
+void init_preemptoff_trace(void);
+void tracing_reset_tail(void);
+bool tracing_is_buf_empty(void);
@@ -23,6 +23,8 @@ DECL_CMD(fpu_loop);
 DECL_CMD(brk);
 DECL_CMD(mmap);
 DECL_CMD(mmap2);
+DECL_CMD(mmap3);
+DECL_CMD(memfd1);
 DECL_CMD(kcow);
 DECL_CMD(wpid1);
 DECL_CMD(wpid2);
@@ -30,6 +32,7 @@ DECL_CMD(wpid3);
 DECL_CMD(wpid4);
 DECL_CMD(wpid5);
 DECL_CMD(wpid6);
+DECL_CMD(wpid7);
 DECL_CMD(sigsegv1);
 DECL_CMD(sigsegv2);
 DECL_CMD(sigill);
@@ -52,6 +55,13 @@ DECL_CMD(fs4);
 DECL_CMD(fs5);
 DECL_CMD(fs6);
 DECL_CMD(fs7);
+DECL_CMD(fs8);
+DECL_CMD(fs9);
+DECL_CMD(aio1);
+DECL_CMD(aio2);
+DECL_CMD(kmsg);
+DECL_CMD(pty);
+DECL_CMD(procfs1);
 DECL_CMD(fmmap1);
 DECL_CMD(fmmap2);
 DECL_CMD(fmmap3);
@@ -61,6 +71,7 @@ DECL_CMD(fmmap6);
 DECL_CMD(fmmap7);
 DECL_CMD(fs_perf1);
 DECL_CMD(fs_perf2);
+DECL_CMD(perf1);
 DECL_CMD(pipe1);
 DECL_CMD(pipe2);
 DECL_CMD(pipe3);
@@ -93,6 +104,8 @@ static struct test_cmd_entry _cmds_table[] =
    CMD_ENTRY(brk,          TT_SHORT,  true),
    CMD_ENTRY(mmap,         TT_MED,    true),
    CMD_ENTRY(mmap2,        TT_SHORT,  true),
+   CMD_ENTRY(mmap3,        TT_SHORT,  true),
+   CMD_ENTRY(memfd1,       TT_SHORT,  true),
    CMD_ENTRY(kcow,         TT_SHORT,  true),
    CMD_ENTRY(wpid1,        TT_SHORT,  true),
    CMD_ENTRY(wpid2,        TT_SHORT,  true),
@@ -100,6 +113,7 @@ static struct test_cmd_entry _cmds_table[] =
    CMD_ENTRY(wpid4,        TT_SHORT,  true),
    CMD_ENTRY(wpid5,        TT_SHORT,  true),
    CMD_ENTRY(wpid6,        TT_SHORT,  true),
+   CMD_ENTRY(wpid7,        TT_SHORT,  true),
    CMD_ENTRY(sigsegv1,     TT_SHORT,  true),
    CMD_ENTRY(sigsegv2,     TT_SHORT,  true),
    CMD_ENTRY(sigill,       TT_SHORT,  true),
@@ -115,8 +129,16 @@ static struct test_cmd_entry _cmds_table[] =
    CMD_ENTRY(fs5,          TT_SHORT,  true),
    CMD_ENTRY(fs6,          TT_SHORT,  true),
    CMD_ENTRY(fs7,          TT_SHORT,  true),
+   CMD_ENTRY(fs8,          TT_SHORT,  true),
+   CMD_ENTRY(fs9,          TT_SHORT,  true),
+   CMD_ENTRY(aio1,         TT_SHORT,  true),
+   CMD_ENTRY(aio2,         TT_SHORT,  true),
+   CMD_ENTRY(kmsg,         TT_SHORT,  true),
+   CMD_ENTRY(pty,          TT_SHORT,  true),
+   CMD_ENTRY(procfs1,      TT_SHORT,  true),
    CMD_ENTRY(fs_perf1,     TT_SHORT,  true),
    CMD_ENTRY(fs_perf2,     TT_SHORT,  true),
+   CMD_ENTRY(perf1,        TT_SHORT,  true),
    CMD_ENTRY(fmmap1,       TT_SHORT,  true),
    CMD_ENTRY(fmmap2,       TT_SHORT,  true),
    CMD_ENTRY(fmmap3,       TT_SHORT,  true),
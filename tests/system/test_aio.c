@@ -0,0 +1,269 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/aio_abi.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static const char test_file[] = "/tmp/test_aio";
+
+/* The layout of the completion ring mapped in the user space [Linux] */
+struct aio_ring {
+   unsigned id, nr;
+   volatile unsigned head, tail;
+   unsigned magic, compat_features, incompat_features, header_length;
+   struct io_event io_events[];
+};
+
+static int io_setup(unsigned nr, aio_context_t *ctx)
+{
+   return syscall(SYS_io_setup, nr, ctx);
+}
+
+static int io_destroy(aio_context_t ctx)
+{
+   return syscall(SYS_io_destroy, ctx);
+}
+
+static int io_submit(aio_context_t ctx, long nr, struct iocb **iocbpp)
+{
+   return syscall(SYS_io_submit, ctx, nr, iocbpp);
+}
+
+static int
+io_getevents(aio_context_t ctx, long min_nr, long nr,
+             struct io_event *events, struct timespec *timeout)
+{
+   return syscall(SYS_io_getevents, ctx, min_nr, nr, events, timeout);
+}
+
+static void
+prep_iocb(struct iocb *cb, int op, int fd, void *buf, size_t n, off_t off)
+{
+   memset(cb, 0, sizeof(*cb));
+   cb->aio_lio_opcode = op;
+   cb->aio_fildes = fd;
+   cb->aio_buf = (unsigned long)buf;
+   cb->aio_nbytes = n;
+   cb->aio_offset = off;
+   cb->aio_data = (unsigned long)cb;
+}
+
+/* Test eventfd(), in counter and semaphore mode */
+int cmd_aio1(int argc, char **argv)
+{
+   struct pollfd pfd;
+   uint64_t val;
+   int fd, rc;
+
+   fd = eventfd(3, EFD_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 3);
+
+   /* The counter is 0: a non-blocking read fails */
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   /* Reads and writes of less than 8 bytes fail */
+   rc = read(fd, &val, 4);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   pfd = (struct pollfd) { .fd = fd, .events = POLLIN };
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   val = 5;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+
+   val = 2;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1 && (pfd.revents & POLLIN));
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 7);
+
+   /* The counter cannot exceed 2^64 - 2 */
+   val = UINT64_MAX;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   val = UINT64_MAX - 1;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+
+   val = 1;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   close(fd);
+
+   /* Semaphore mode: each read returns 1 */
+   fd = eventfd(2, EFD_SEMAPHORE | EFD_NONBLOCK | EFD_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   for (int i = 0; i < 2; i++) {
+      rc = read(fd, &val, sizeof(val));
+      DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+      DEVSHELL_CMD_ASSERT(val == 1);
+   }
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   close(fd);
+   return 0;
+}
+
+/* Test AIO: io_submit() of all the supported requests and the ring */
+int cmd_aio2(int argc, char **argv)
+{
+   static char wbuf[3 * 4096], rbuf[3 * 4096], rbuf2[100];
+   struct iocb cbs[4], *cbp[4];
+   struct io_event events[4];
+   struct timespec ts = { .tv_sec = 5 };
+   struct aio_ring *ring;
+   aio_context_t ctx = 0;
+   struct iovec iov[2];
+   uint64_t val;
+   int fd, efd, rc;
+
+   for (size_t i = 0; i < sizeof(wbuf); i++)
+      wbuf[i] = 'a' + (char)(i % 26);
+
+   fd = open(test_file, O_CREAT | O_RDWR | O_TRUNC, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   efd = eventfd(0, 0);
+   DEVSHELL_CMD_ASSERT(efd >= 0);
+
+   rc = io_setup(8, &ctx);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(ctx != 0);
+
+   /* The context ID is the address of the ring */
+   ring = (void *)ctx;
+   DEVSHELL_CMD_ASSERT(ring->magic == 0xa10a10a1);
+   DEVSHELL_CMD_ASSERT(ring->nr >= 8);
+   DEVSHELL_CMD_ASSERT(ring->head == ring->tail);
+
+   /* Write the file with two requests, one of them vectored */
+   prep_iocb(&cbs[0], IOCB_CMD_PWRITE, fd, wbuf, 4096, 0);
+
+   iov[0] = (struct iovec) { wbuf + 4096, 1000 };
+   iov[1] = (struct iovec) { wbuf + 5096, 2 * 4096 - 1000 };
+   prep_iocb(&cbs[1], IOCB_CMD_PWRITEV, fd, iov, 2, 4096);
+   cbs[1].aio_flags = IOCB_FLAG_RESFD;
+   cbs[1].aio_resfd = efd;
+
+   cbp[0] = &cbs[0];
+   cbp[1] = &cbs[1];
+
+   rc = io_submit(ctx, 2, cbp);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   rc = io_getevents(ctx, 2, 4, events, &ts);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   for (int i = 0; i < 2; i++) {
+      struct iocb *cb = (void *)(unsigned long)events[i].obj;
+      const int64_t exp_res = cb == &cbs[0] ? 4096 : 2 * 4096;
+      DEVSHELL_CMD_ASSERT(events[i].data == (unsigned long)cb);
+      DEVSHELL_CMD_ASSERT(events[i].res == exp_res);
+   }
+
+   /* The completion of the 2nd request has been notified through eventfd */
+   rc = read(efd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 1);
+
+   /* Read the data back, reaping the events directly from the ring */
+   prep_iocb(&cbs[2], IOCB_CMD_PREAD, fd, rbuf, sizeof(rbuf), 0);
+   prep_iocb(&cbs[3], IOCB_CMD_FSYNC, fd, NULL, 0, 0);
+   cbp[0] = &cbs[2];
+   cbp[1] = &cbs[3];
+
+   rc = io_submit(ctx, 2, cbp);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   for (int i = 0; i < 2; i++) {
+
+      struct io_event *ev;
+
+      while (ring->head == ring->tail)
+         usleep(1000);
+
+      ev = &ring->io_events[ring->head];
+      DEVSHELL_CMD_ASSERT(ev->res == (ev->data == (unsigned long)&cbs[2]
+                                      ? (int64_t)sizeof(rbuf) : 0));
+
+      ring->head = (ring->head + 1) % ring->nr;
+   }
+
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf, wbuf, sizeof(wbuf)));
+
+   /* Read past EOF: short read */
+   prep_iocb(&cbs[0], IOCB_CMD_PREAD, fd, rbuf2, sizeof(rbuf2), 12238);
+   cbp[0] = &cbs[0];
+
+   rc = io_submit(ctx, 1, cbp);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = io_getevents(ctx, 1, 1, events, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(events[0].res == 50);
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf2, wbuf + 12238, 50));
+
+   /* No more events: the timeout expires */
+   ts = (struct timespec) { .tv_nsec = 10 * 1000 * 1000 };
+   rc = io_getevents(ctx, 1, 1, events, &ts);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Invalid requests */
+   prep_iocb(&cbs[0], IOCB_CMD_PREAD, 1234, rbuf, 10, 0);
+   rc = io_submit(ctx, 1, cbp);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EBADF);
+
+   prep_iocb(&cbs[0], IOCB_CMD_PREAD, fd, rbuf, 10, -1);
+   rc = io_submit(ctx, 1, cbp);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   prep_iocb(&cbs[0], IOCB_CMD_NOOP, fd, NULL, 0, 0);
+   rc = io_submit(ctx, 1, cbp);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = io_destroy(ctx);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = io_destroy(ctx);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   close(efd);
+   close(fd);
+   rc = unlink(test_file);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
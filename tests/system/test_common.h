@@ -9,3 +9,23 @@ void remove_test_file_expecting_success(const char *path, int n);
 int test_sig(void (*child_func)(void *), void *arg, int ex_sig, int ex_code);
 bool running_on_tilck(void);
 void not_on_tilck_message(void);
+
+enum perf_cnt_ev {
+
+   PERF_CNT_CYCLES,
+   PERF_CNT_INSTRUCTIONS,
+   PERF_CNT_LLC_MISSES,
+   PERF_CNT_BRANCH_MISSES,
+   PERF_CNT_DTLB_MISSES,
+
+   PERF_CNT_COUNT,
+};
+
+struct perf_counters {
+   int fds[PERF_CNT_COUNT];
+   u64 vals[PERF_CNT_COUNT];
+};
+
+void perf_counters_start(struct perf_counters *pc);
+void perf_counters_stop(struct perf_counters *pc);
+void perf_counters_dump(struct perf_counters *pc, u64 ops);
@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static const char test_file[] = "/tmp/test_sparse";
+static const char test_clone_src[] = "/tmp/test_clone_src";
+static const char test_clone_dst[] = "/tmp/test_clone_dst";
+
+/* Test fallocate(), including hole punching, and SEEK_DATA/SEEK_HOLE */
+int cmd_fs8(int argc, char **argv)
+{
+   const int punch = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+   const size_t page_size = getpagesize();
+   struct stat statbuf;
+   off_t off;
+   char *vaddr;
+   int fd, rc;
+
+   fd = open(test_file, O_CREAT | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   /* A sparse file uses no blocks */
+   rc = ftruncate(fd, 16 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fstat(fd, &statbuf);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(statbuf.st_blocks == 0);
+
+   /* Preallocate 4 pages, without changing the file size */
+   rc = fallocate(fd, FALLOC_FL_KEEP_SIZE, 16 * page_size, 4 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fstat(fd, &statbuf);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(statbuf.st_size == (off_t)(16 * page_size));
+   DEVSHELL_CMD_ASSERT(statbuf.st_blocks == (blkcnt_t)(4 * page_size / 512));
+
+   /* Preallocate 4 more pages, extending the file */
+   rc = fallocate(fd, 0, 20 * page_size, 4 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fstat(fd, &statbuf);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(statbuf.st_size == (off_t)(24 * page_size));
+
+   /* Write data in [2, 6) pages through a shared mapping */
+   vaddr = mmap(NULL,
+                8 * page_size,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED,
+                fd,
+                0);
+
+   DEVSHELL_CMD_ASSERT(vaddr != (void *)-1);
+   memset(vaddr + 2 * page_size, 'a', 4 * page_size);
+
+   /* Punch a hole in [3, 5) pages: the mapping must see zeros there */
+   rc = fallocate(fd, punch, 3 * page_size, 2 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   DEVSHELL_CMD_ASSERT(vaddr[3 * page_size] == 0);
+   DEVSHELL_CMD_ASSERT(vaddr[5 * page_size - 1] == 0);
+   DEVSHELL_CMD_ASSERT(vaddr[5 * page_size] == 'a');
+
+   /* Write again in the hole, through the mapping */
+   vaddr[4 * page_size] = 'b';
+
+   rc = munmap(vaddr, 8 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Data: [2, 3), [4, 6) pages and [16, 24) pages */
+   off = lseek(fd, 0, SEEK_DATA);
+   DEVSHELL_CMD_ASSERT(off == (off_t)(2 * page_size));
+
+   off = lseek(fd, off, SEEK_HOLE);
+   DEVSHELL_CMD_ASSERT(off == (off_t)(3 * page_size));
+
+   off = lseek(fd, off, SEEK_DATA);
+   DEVSHELL_CMD_ASSERT(off == (off_t)(4 * page_size));
+
+   off = lseek(fd, 24 * page_size, SEEK_DATA);
+   DEVSHELL_CMD_ASSERT(off < 0 && errno == ENXIO);
+
+   /* Punching a hole requires FALLOC_FL_KEEP_SIZE */
+   rc = fallocate(fd, FALLOC_FL_PUNCH_HOLE, 0, page_size);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EOPNOTSUPP);
+
+   close(fd);
+   rc = unlink(test_file);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+static ssize_t
+sys_copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+                    size_t len, unsigned flags)
+{
+   loff_t in = off_in ? *off_in : 0;
+   loff_t out = off_out ? *off_out : 0;
+   ssize_t rc;
+
+   rc = syscall(SYS_copy_file_range,
+                fd_in, off_in ? &in : NULL,
+                fd_out, off_out ? &out : NULL,
+                len, flags);
+
+   if (off_in)
+      *off_in = (off_t)in;
+
+   if (off_out)
+      *off_out = (off_t)out;
+
+   return rc;
+}
+
+static bool check_file(int fd, const char *exp, size_t len)
+{
+   char *buf = malloc(len + 1);
+   bool ok;
+
+   if (!buf)
+      return false;
+
+   ok = lseek(fd, 0, SEEK_SET) == 0 &&
+        read(fd, buf, len + 1) == (ssize_t)len &&
+        !memcmp(buf, exp, len);
+
+   free(buf);
+   return ok;
+}
+
+/* Test FICLONE, copy_file_range() and copy-on-write with shared mappings */
+int cmd_fs9(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   const size_t file_size = 32 * page_size + 100;
+   off_t off_in, off_out;
+   char *vaddr, *sbuf, *dbuf;
+   int src, dst, rc;
+   ssize_t n;
+
+   sbuf = malloc(file_size);
+   dbuf = malloc(file_size);
+   DEVSHELL_CMD_ASSERT(sbuf != NULL && dbuf != NULL);
+
+   for (size_t i = 0; i < file_size; i++)
+      sbuf[i] = (char)('a' + i % 26);
+
+   src = open(test_clone_src, O_CREAT | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(src > 0);
+
+   dst = open(test_clone_dst, O_CREAT | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(dst > 0);
+
+   n = write(src, sbuf, file_size);
+   DEVSHELL_CMD_ASSERT(n == (ssize_t)file_size);
+
+   /* Map the source in R/W mode and write to it, before cloning it */
+   vaddr = mmap(NULL,
+                4 * page_size,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED,
+                src,
+                0);
+
+   DEVSHELL_CMD_ASSERT(vaddr != (void *)-1);
+   vaddr[0] = sbuf[0] = 'X';
+
+   /* Clone the whole file */
+   rc = ioctl(dst, FICLONE, src);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   memcpy(dbuf, sbuf, file_size);
+   DEVSHELL_CMD_ASSERT(check_file(dst, dbuf, file_size));
+
+   /* Writing through the mapping must not affect the clone */
+   vaddr[1] = sbuf[1] = 'Y';
+   vaddr[page_size] = sbuf[page_size] = 'Z';
+
+   rc = munmap(vaddr, 4 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   DEVSHELL_CMD_ASSERT(check_file(src, sbuf, file_size));
+   DEVSHELL_CMD_ASSERT(check_file(dst, dbuf, file_size));
+
+   /* copy_file_range() with explicit offsets, not aligned */
+   off_in = 10;
+   off_out = 3 * page_size + 10;
+   n = sys_copy_file_range(src, &off_in, dst, &off_out, 5 * page_size, 0);
+   DEVSHELL_CMD_ASSERT(n == (ssize_t)(5 * page_size));
+   DEVSHELL_CMD_ASSERT(off_in == (off_t)(5 * page_size + 10));
+   DEVSHELL_CMD_ASSERT(off_out == (off_t)(8 * page_size + 10));
+   memcpy(dbuf + 3 * page_size + 10, sbuf + 10, 5 * page_size);
+
+   /* copy_file_range() using the file positions, up to the source's EOF */
+   off_in = lseek(src, 30 * page_size, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(off_in == (off_t)(30 * page_size));
+   off_out = lseek(dst, 0, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(off_out == 0);
+
+   n = sys_copy_file_range(src, NULL, dst, NULL, 4 * page_size, 0);
+   DEVSHELL_CMD_ASSERT(n == (ssize_t)(2 * page_size + 100));
+   DEVSHELL_CMD_ASSERT(lseek(src, 0, SEEK_CUR) == (off_t)file_size);
+   DEVSHELL_CMD_ASSERT(lseek(dst, 0, SEEK_CUR) == n);
+   memcpy(dbuf, sbuf + 30 * page_size, 2 * page_size + 100);
+
+   DEVSHELL_CMD_ASSERT(check_file(src, sbuf, file_size));
+   DEVSHELL_CMD_ASSERT(check_file(dst, dbuf, file_size));
+
+   /* Flags are not supported */
+   n = sys_copy_file_range(src, NULL, dst, NULL, page_size, 1);
+   DEVSHELL_CMD_ASSERT(n < 0 && errno == EINVAL);
+
+   free(dbuf);
+   free(sbuf);
+   close(dst);
+   close(src);
+
+   rc = unlink(test_clone_dst);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = unlink(test_clone_src);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
@@ -17,6 +17,7 @@
 
 #include "devshell.h"
 #include "sysenter.h"
+#include "test_common.h"
 
 void create_test_file(const char *path, int n)
 {
@@ -47,27 +48,35 @@ void remove_test_file_expecting_success(const char *path, int n)
 int cmd_fs_perf1(int argc, char **argv)
 {
    const int n = 1000;
+   struct perf_counters pc;
    u64 start, end, elapsed;
    const char *dest_dir = argc > 0 ? argv[0] : "/tmp";
    printf("Using '%s' as test dir\n", dest_dir);
 
+   perf_counters_start(&pc);
    start = RDTSC();
 
    for (int i = 0; i < n; i++)
       create_test_file(dest_dir, i);
 
    end = RDTSC();
+   perf_counters_stop(&pc);
    elapsed = (end - start) / n;
-   start = RDTSC();
 
    printf("Avg. creat() cost:  %4llu cycles\n", elapsed);
+   perf_counters_dump(&pc, n);
+
+   perf_counters_start(&pc);
+   start = RDTSC();
 
    for (int i = 0; i < n; i++)
      remove_test_file_expecting_success(dest_dir, i);
 
    end = RDTSC();
+   perf_counters_stop(&pc);
    elapsed = (end - start) / n;
    printf("Avg. unlink() cost: %4llu cycles\n", elapsed);
+   perf_counters_dump(&pc, n);
    return 0;
 }
 
@@ -77,6 +86,7 @@ int cmd_fs_perf2(int argc, char **argv)
    char path[256];
    char buf[1024];
    int fd, rc;
+   struct perf_counters pc;
    u64 start, end, elapsed;
    const char *dest_dir = argc > 0 ? argv[0] : "/tmp";
 
@@ -91,6 +101,7 @@ int cmd_fs_perf2(int argc, char **argv)
    memset(buf + 512, 'c', 256);
    memset(buf + 768, 'd', 256);
 
+   perf_counters_start(&pc);
    start = RDTSC();
 
    for (int i = 0; i < n; i++) {
@@ -99,11 +110,13 @@ int cmd_fs_perf2(int argc, char **argv)
    }
 
    end = RDTSC();
+   perf_counters_stop(&pc);
    elapsed = (end - start);
    close(fd);
 
    printf("Tot written: %d KB\n", n);
    printf("Avg. cost per KB: %4llu cycles\n", elapsed / KB);
+   perf_counters_dump(&pc, n);
 
    rc = unlink(path);
    DEVSHELL_CMD_ASSERT(rc == 0);
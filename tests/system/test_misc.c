@@ -260,6 +260,55 @@ int cmd_cloexec(int argc, char **argv)
    return WEXITSTATUS(wstatus);
 }
 
+/* Test /dev/kmsg: messages written there can be read back as log records */
+int cmd_kmsg(int argc, char **argv)
+{
+   static const char msg[] = "devshell: kmsg test message";
+   char buf[512];
+   bool found = false;
+   int fd, rc;
+
+   if (!running_on_tilck()) {
+      not_on_tilck_message();
+      return 0;
+   }
+
+   fd = open("/dev/kmsg", O_RDWR | O_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   /* Skip all the records already in the log */
+   rc = lseek(fd, 0, SEEK_END);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = read(fd, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   sprintf(buf, "<4>%s\n", msg);
+   rc = write(fd, buf, strlen(buf));
+   DEVSHELL_CMD_ASSERT(rc == (int)strlen(buf));
+
+   /* The buffer is too small for the record: it does NOT get consumed */
+   rc = read(fd, buf, 8);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   /* Other kernel messages might have been logged in the meanwhile */
+   while ((rc = read(fd, buf, sizeof(buf) - 1)) > 0) {
+
+      buf[rc] = 0;
+      DEVSHELL_CMD_ASSERT(buf[rc - 1] == '\n');
+
+      if (strstr(buf, msg)) {
+         DEVSHELL_CMD_ASSERT(!strncmp(buf, "4,", 2));
+         found = true;
+      }
+   }
+
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+   DEVSHELL_CMD_ASSERT(found);
+   close(fd);
+   return 0;
+}
+
 /* Test scripts testing EXTRA components running on Tilck */
 
 static const char *extra_test_scripts[] = {
@@ -155,3 +155,111 @@ int cmd_mmap2(int argc, char **argv)
    waitpid(child, &wstatus, 0);
    return 0;
 }
+
+/* Shared anonymous memory must be shared between parent and child */
+int cmd_mmap3(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   volatile int *shared;
+   int child, wstatus, rc;
+
+   shared = mmap(NULL,
+                 4 * page_size,
+                 PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS,
+                 -1,
+                 0);
+
+   DEVSHELL_CMD_ASSERT(shared != (void *)-1);
+
+   /* The memory must be zero-initialized */
+   DEVSHELL_CMD_ASSERT(shared[0] == 0);
+   DEVSHELL_CMD_ASSERT(shared[page_size / sizeof(int)] == 0);
+
+   /* Touch only the first page before fork(): the others are still holes */
+   shared[0] = 1;
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      if (shared[0] != 1)
+         exit(1);
+
+      shared[0] = 2;
+      shared[2 * page_size / sizeof(int)] = 3;
+
+      /* The parent read this page before fork(): it mapped the zero page */
+      shared[page_size / sizeof(int)] = 4;
+      exit(0);
+   }
+
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+   DEVSHELL_CMD_ASSERT(shared[0] == 2);
+   DEVSHELL_CMD_ASSERT(shared[page_size / sizeof(int)] == 4);
+   DEVSHELL_CMD_ASSERT(shared[2 * page_size / sizeof(int)] == 3);
+   DEVSHELL_CMD_ASSERT(shared[3 * page_size / sizeof(int)] == 0);
+
+   /* Partial munmap(), then munmap() of the whole range */
+   rc = munmap((void *)shared, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   DEVSHELL_CMD_ASSERT(shared[page_size / sizeof(int)] == 4);
+
+   /* Start before what's left of the mapping: it must be un-mapped anyway */
+   rc = munmap((void *)shared, 4 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+int cmd_memfd1(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   char buf[32];
+   char *vaddr;
+   int fd, rc;
+
+   fd = syscall(SYS_memfd_create, "test", 1 /* MFD_CLOEXEC */);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+   DEVSHELL_CMD_ASSERT(fcntl(fd, F_GETFD) == FD_CLOEXEC);
+
+   rc = ftruncate(fd, 2 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Write in the middle of a hole */
+   rc = pwrite(fd, "hello", 5, page_size + 100);
+   DEVSHELL_CMD_ASSERT(rc == 5);
+
+   vaddr = mmap(NULL,
+                2 * page_size,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED,
+                fd,
+                0);
+   DEVSHELL_CMD_ASSERT(vaddr != (void *)-1);
+
+   DEVSHELL_CMD_ASSERT(vaddr[0] == 0);
+   DEVSHELL_CMD_ASSERT(!memcmp(vaddr + page_size + 100, "hello", 5));
+
+   /* Writes through the mapping must be visible with read() */
+   memcpy(vaddr + 10, "world", 5);
+   rc = pread(fd, buf, 5, 10);
+   DEVSHELL_CMD_ASSERT(rc == 5);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "world", 5));
+
+   rc = munmap(vaddr, 2 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   close(fd);
+
+   /* Unsupported flags and too long names must be rejected */
+   rc = syscall(SYS_memfd_create, "test", 4 /* MFD_HUGETLB */);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = syscall(SYS_memfd_create, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EFAULT);
+   return 0;
+}
@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static const struct {
+   const char *name;
+   u32 type;
+   u64 config;
+} perf_cnt_events[PERF_CNT_COUNT] = {
+
+   { "cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+   { "instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+   { "llc-misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+   { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+   {
+      "dtlb-misses",
+      PERF_TYPE_HW_CACHE,
+      PERF_COUNT_HW_CACHE_DTLB |
+      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+   },
+};
+
+static int perf_open_counter(u32 type, u64 config, bool disabled)
+{
+   struct perf_event_attr attr;
+
+   memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.type = type;
+   attr.config = config;
+   attr.disabled = disabled;
+
+   return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static u64 perf_read_counter(int fd)
+{
+   u64 val = 0;
+   int rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   return val;
+}
+
+/*
+ * Opens (and starts) a counter for each one of the events in perf_cnt_events.
+ * The ones not supported by the CPU (or by the hypervisor) just have fd = -1.
+ */
+void perf_counters_start(struct perf_counters *pc)
+{
+   for (int i = 0; i < PERF_CNT_COUNT; i++)
+      pc->fds[i] = perf_open_counter(perf_cnt_events[i].type,
+                                     perf_cnt_events[i].config,
+                                     false);
+}
+
+void perf_counters_stop(struct perf_counters *pc)
+{
+   for (int i = 0; i < PERF_CNT_COUNT; i++) {
+
+      if (pc->fds[i] < 0)
+         continue;
+
+      ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+      pc->vals[i] = perf_read_counter(pc->fds[i]);
+      close(pc->fds[i]);
+   }
+}
+
+/* Prints the values per operation, plus the IPC, when available */
+void perf_counters_dump(struct perf_counters *pc, u64 ops)
+{
+   const int cyc = PERF_CNT_CYCLES;
+   const int ins = PERF_CNT_INSTRUCTIONS;
+
+   if (pc->fds[cyc] < 0) {
+      printf("[perf counters not available]\n");
+      return;
+   }
+
+   for (int i = 0; i < PERF_CNT_COUNT; i++) {
+      if (pc->fds[i] >= 0)
+         printf("    %-14s %8llu per op\n",
+                perf_cnt_events[i].name, pc->vals[i] / ops);
+   }
+
+   if (pc->fds[ins] >= 0 && pc->vals[cyc] > 0)
+      printf("    IPC:           %llu.%02llu\n",
+             pc->vals[ins] / pc->vals[cyc],
+             pc->vals[ins] * 100 / pc->vals[cyc] % 100);
+}
+
+int cmd_perf1(int argc, char **argv)
+{
+   volatile u32 sink = 0;
+   u64 v1, v2;
+   int fd, rc;
+
+   fd = perf_open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true);
+
+   if (fd < 0) {
+
+      /* On Linux, perf_event_paranoid might forbid it as well */
+      if (running_on_tilck())
+         DEVSHELL_CMD_ASSERT(errno == ENOENT);
+
+      printf("perf_event_open() failed: %s. Skip\n", strerror(errno));
+      return 0;
+   }
+
+   /* The counter was created disabled */
+   for (u32 i = 0; i < 10 * 1000; i++)
+      sink += i;
+
+   DEVSHELL_CMD_ASSERT(perf_read_counter(fd) == 0);
+
+   rc = ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (u32 i = 0; i < 10 * 1000; i++)
+      sink += i;
+
+   rc = ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   v1 = perf_read_counter(fd);
+   printf("Instructions for 10k iterations: %llu\n", v1);
+   DEVSHELL_CMD_ASSERT(v1 >= 10 * 1000);
+
+   /* Context switches must not make the counter move, while disabled */
+   usleep(10 * 1000);
+   v2 = perf_read_counter(fd);
+   DEVSHELL_CMD_ASSERT(v1 == v2);
+
+   rc = ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(perf_read_counter(fd) == 0);
+
+   close(fd);
+   return 0;
+}
@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static int read_proc_file(const char *path, char *buf, size_t size)
+{
+   int fd, rc;
+
+   fd = open(path, O_RDONLY);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   rc = read(fd, buf, size - 1);
+   DEVSHELL_CMD_ASSERT(rc > 0);
+   buf[rc] = 0;
+
+   close(fd);
+   return rc;
+}
+
+static bool dir_has_entry(const char *path, const char *name)
+{
+   struct dirent *de;
+   bool found = false;
+   DIR *d;
+
+   d = opendir(path);
+   DEVSHELL_CMD_ASSERT(d != NULL);
+
+   while ((de = readdir(d))) {
+      if (!strcmp(de->d_name, name)) {
+         found = true;
+         break;
+      }
+   }
+
+   closedir(d);
+   return found;
+}
+
+/* Test the basic files in /proc and /proc/<pid> */
+int cmd_procfs1(int argc, char **argv)
+{
+   char buf[1024], path[64], name[32];
+   unsigned long up, up_cs;
+   struct stat st;
+   int rc, pid, fd;
+   char state;
+
+   if (stat("/proc/self", &st) < 0) {
+      printf("[procfs] /proc not available, skipping the test\n");
+      return 0;
+   }
+
+   snprintf(name, sizeof(name), "%d", getpid());
+
+   rc = readlink("/proc/self", buf, sizeof(buf) - 1);
+   DEVSHELL_CMD_ASSERT(rc > 0);
+   buf[rc] = 0;
+   DEVSHELL_CMD_ASSERT(!strcmp(buf, name));
+   DEVSHELL_CMD_ASSERT(dir_has_entry("/proc", name));
+   DEVSHELL_CMD_ASSERT(dir_has_entry("/proc", "meminfo"));
+
+   /* /proc/self/stat: "pid (comm) state ..." */
+   read_proc_file("/proc/self/stat", buf, sizeof(buf));
+   rc = sscanf(buf, "%d", &pid);
+   DEVSHELL_CMD_ASSERT(rc == 1 && pid == getpid());
+   DEVSHELL_CMD_ASSERT(strchr(buf, ')') != NULL);
+   rc = sscanf(strrchr(buf, ')') + 1, " %c", &state);
+   DEVSHELL_CMD_ASSERT(rc == 1 && state == 'R');
+
+   read_proc_file("/proc/self/status", buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(strstr(buf, "Pid:") != NULL);
+
+   read_proc_file("/proc/meminfo", buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(!strncmp(buf, "MemTotal:", 9));
+
+   read_proc_file("/proc/uptime", buf, sizeof(buf));
+   rc = sscanf(buf, "%lu.%lu", &up, &up_cs);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   read_proc_file("/proc/stat", buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(!strncmp(buf, "cpu ", 4));
+
+   /* A newly opened fd must appear in /proc/self/fd */
+   fd = open("/proc/self/maps", O_RDONLY);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+   snprintf(name, sizeof(name), "%d", fd);
+   DEVSHELL_CMD_ASSERT(dir_has_entry("/proc/self/fd", name));
+
+   snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+   rc = readlink(path, buf, sizeof(buf) - 1);
+   DEVSHELL_CMD_ASSERT(rc > 0);
+   close(fd);
+
+   DEVSHELL_CMD_ASSERT(!dir_has_entry("/proc/self/fd", name));
+
+   /* procfs is read-only */
+   rc = open("/proc/meminfo", O_WRONLY);
+   DEVSHELL_CMD_ASSERT(rc < 0);
+
+   rc = open("/proc/new_file", O_CREAT | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(rc < 0);
+   return 0;
+}
@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static ssize_t read_all_nonblock(int fd, char *buf, size_t size)
+{
+   ssize_t rc, tot = 0;
+
+   while ((size_t)tot < size) {
+
+      rc = read(fd, buf + tot, size - (size_t)tot);
+
+      if (rc <= 0)
+         break;
+
+      tot += rc;
+   }
+
+   return tot;
+}
+
+/* Test the pseudo-terminals: /dev/ptmx and /dev/pts/N */
+int cmd_pty(int argc, char **argv)
+{
+   struct winsize ws = { .ws_row = 40, .ws_col = 120 };
+   struct winsize ws2 = {0};
+   struct pollfd pfd;
+   char name[32], buf[64];
+   int master, slave, rc, lck;
+
+   master = posix_openpt(O_RDWR | O_NOCTTY);
+   DEVSHELL_CMD_ASSERT(master >= 0);
+
+   rc = ptsname_r(master, name, sizeof(name));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(!strncmp(name, "/dev/pts/", 9));
+
+   /* New ptys are locked: the slave cannot be opened before unlockpt() */
+   rc = ioctl(master, TIOCGPTLCK, &lck);
+   DEVSHELL_CMD_ASSERT(rc == 0 && lck == 1);
+
+   rc = open(name, O_RDWR | O_NOCTTY);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EIO);
+
+   DEVSHELL_CMD_ASSERT(grantpt(master) == 0);
+   DEVSHELL_CMD_ASSERT(unlockpt(master) == 0);
+
+   slave = open(name, O_RDWR | O_NOCTTY);
+   DEVSHELL_CMD_ASSERT(slave >= 0);
+   DEVSHELL_CMD_ASSERT(isatty(slave));
+
+   fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+   /* Nothing to read yet */
+   rc = read(master, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   pfd = (struct pollfd) { .fd = master, .events = POLLIN };
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Master -> slave: the line discipline works in canonical mode */
+   rc = write(master, "hellx\x7fo\n", 8);
+   DEVSHELL_CMD_ASSERT(rc == 8);
+
+   rc = read(slave, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 6);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "hello\n", 6));
+
+   /* The echo of the input got to the master, with ONLCR applied */
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1 && (pfd.revents & POLLIN));
+
+   rc = read_all_nonblock(master, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 11);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "hellx\b \bo\r\n", 11));
+
+   /* Word erase (Ctrl+W) erases the last word and the blanks after it */
+   rc = write(master, "one two  \x17three\n", 16);
+   DEVSHELL_CMD_ASSERT(rc == 16);
+
+   rc = read(slave, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 10);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "one three\n", 10));
+
+   rc = read_all_nonblock(master, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 9 + 5 * 3 + 5 + 2);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "one two  \b \b\b \b\b \b\b \b\b \b"
+                                    "three\r\n", 31));
+
+   /* Slave -> master */
+   rc = write(slave, "abc\n", 4);
+   DEVSHELL_CMD_ASSERT(rc == 4);
+
+   rc = read_all_nonblock(master, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 5);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "abc\r\n", 5));
+
+   /* The window size set on the master is seen by the slave */
+   rc = ioctl(master, TIOCSWINSZ, &ws);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = ioctl(slave, TIOCGWINSZ, &ws2);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(ws2.ws_row == 40 && ws2.ws_col == 120);
+
+   /* Closing all the slave handles makes the master's read() fail with EIO */
+   close(slave);
+   rc = read(master, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EIO);
+
+   /* Closing the master hangs up the slave */
+   slave = open(name, O_RDWR | O_NOCTTY);
+   DEVSHELL_CMD_ASSERT(slave >= 0);
+   close(master);
+
+   rc = read(slave, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = write(slave, "x", 1);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EIO);
+
+   /* The pty is free again only after its slave got closed too */
+   close(slave);
+   return 0;
+}
@@ -12,6 +12,8 @@
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/times.h>
 
 #include "devshell.h"
 #include "sysenter.h"
@@ -470,3 +472,59 @@ int cmd_wpid6(int argc, char **argv)
    DEVSHELL_CMD_ASSERT(pid == cld[6]);
    return 0;
 }
+
+static void wpid7_busy_child(void)
+{
+   struct rusage ru;
+   volatile unsigned long n = 0;
+
+   /* Spin until we consumed at least 50 ms of CPU time (or give up) */
+   for (int r = 0; r < 1000; r++) {
+
+      for (int i = 0; i < 1000 * 1000; i++)
+         n++;
+
+      getrusage(RUSAGE_SELF, &ru);
+
+      if (ru.ru_utime.tv_sec > 0 || ru.ru_utime.tv_usec >= 50 * 1000)
+         break;
+   }
+
+   exit(0);
+}
+
+/*
+ * Check the resource usage returned by wait4() and getrusage()
+ */
+int cmd_wpid7(int argc, char **argv)
+{
+   struct rusage ru, cru;
+   struct tms tms;
+   int pid, wstatus;
+   long us;
+
+   pid = fork();
+   DEVSHELL_CMD_ASSERT(pid >= 0);
+
+   if (!pid)
+      wpid7_busy_child();
+
+   DEVSHELL_CMD_ASSERT(wait4(pid, &wstatus, 0, &ru) == pid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+
+   us = ru.ru_utime.tv_sec * 1000000 + ru.ru_utime.tv_usec;
+   printf(STR_PARENT "child's utime: %ld us, minflt: %ld, nivcsw: %ld\n",
+          us, ru.ru_minflt, ru.ru_nivcsw);
+
+   DEVSHELL_CMD_ASSERT(us >= 50 * 1000);
+   DEVSHELL_CMD_ASSERT(ru.ru_maxrss > 0);
+
+   /* The child has been waited: its usage must be in RUSAGE_CHILDREN */
+   DEVSHELL_CMD_ASSERT(getrusage(RUSAGE_CHILDREN, &cru) == 0);
+   DEVSHELL_CMD_ASSERT(cru.ru_utime.tv_sec * 1000000 +
+                       cru.ru_utime.tv_usec >= us);
+
+   DEVSHELL_CMD_ASSERT(times(&tms) != (clock_t)-1);
+   DEVSHELL_CMD_ASSERT(tms.tms_cutime >= 5);   /* 50 ms, USER_HZ = 100 */
+   return 0;
+}
@@ -111,15 +111,24 @@ void switch_to_task() { }
 void pdir_clone() { }
 void pdir_deep_clone() { }
 void pdir_destroy() { }
+size_t pdir_count_user_pages() { return 0; }
 void set_curr_pdir() { }
 void set_current_task_in_user_mode() { }
 void arch_specific_new_task_setup() { NOT_REACHED(); }
 void arch_specific_free_task() { NOT_REACHED(); }
 void arch_specific_new_proc_setup() { NOT_REACHED(); }
 void arch_specific_free_proc() { NOT_REACHED(); }
+void pmu_free_task_ctx() { }
+int pmu_counter_attach() { return -2; /* ENOENT */ }
+void pmu_counter_detach() { }
+void pmu_counter_enable() { }
+void pmu_counter_reset() { }
+u64 pmu_counter_read() { return 0; }
 void fpu_context_begin() { }
 void fpu_context_end() { }
 void map_zero_pages() { NOT_REACHED(); }
+void map_zero_page() { NOT_REACHED(); }
+void get_mapping2() { NOT_REACHED(); }
 void dump_var_mtrrs() { }
 void set_page_rw() { }
 void poweroff() { NOT_REACHED(); }
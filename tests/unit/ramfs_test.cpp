@@ -0,0 +1,371 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <vector>
+
+#include "vfs_test.h"
+
+using namespace std;
+
+class ramfs_test : public vfs_test_base {
+
+protected:
+   struct fs *fs;
+
+   void SetUp() override {
+
+      vfs_test_base::SetUp();
+
+      fs = ramfs_create();
+      ASSERT_TRUE(fs != NULL);
+      mp_init(fs);
+   }
+
+   void TearDown() override {
+
+      // TODO: destroy ramfs
+      vfs_test_base::TearDown();
+   }
+};
+
+static void check_file_content(fs_handle h, const vector<char> &expected)
+{
+   vector<char> buf(expected.size() + 1);
+   ssize_t rc;
+
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_SET), 0);
+
+   rc = vfs_read(h, buf.data(), buf.size());
+   ASSERT_EQ(rc, (ssize_t)expected.size());
+   ASSERT_EQ(memcmp(buf.data(), expected.data(), expected.size()), 0);
+}
+
+TEST_F(ramfs_test, small_sequential_writes)
+{
+   const size_t chunk = 100;
+   const size_t tot = 1 * MB;
+   vector<char> data(tot);
+   struct stat64 st;
+   fs_handle h;
+   int rc;
+
+   for (size_t i = 0; i < tot; i++)
+      data[i] = (char)(i * 7 + i / 4096);
+
+   rc = vfs_open("/test1", &h, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+
+   for (size_t off = 0; off < tot; off += chunk) {
+
+      const size_t len = MIN(chunk, tot - off);
+      ASSERT_EQ(vfs_write(h, &data[off], len), (ssize_t)len);
+   }
+
+   check_file_content(h, data);
+
+   rc = vfs_fstat64(h, &st);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(st.st_size, (off_t)tot);
+   ASSERT_GE((size_t)st.st_blocks, tot / 512);
+
+   vfs_close(h);
+   ASSERT_EQ(vfs_unlink("/test1"), 0);
+}
+
+TEST_F(ramfs_test, truncate_in_the_middle_of_a_block)
+{
+   const size_t tot = 10 * PAGE_SIZE;
+   const size_t new_len = 5 * PAGE_SIZE + 100;
+   vector<char> data(tot, 'a');
+   fs_handle h;
+   int rc;
+
+   rc = vfs_open("/test2", &h, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+
+   ASSERT_EQ(vfs_write(h, data.data(), tot), (ssize_t)tot);
+
+   rc = vfs_ftruncate(h, (offt)new_len);
+   ASSERT_EQ(rc, 0);
+
+   rc = vfs_ftruncate(h, (offt)tot);
+   ASSERT_EQ(rc, 0);
+
+   /* The data past the truncation point must be zero */
+   for (size_t i = new_len; i < tot; i++)
+      data[i] = 0;
+
+   check_file_content(h, data);
+
+   vfs_close(h);
+   ASSERT_EQ(vfs_unlink("/test2"), 0);
+}
+
+TEST_F(ramfs_test, write_in_holes)
+{
+   vector<char> data(4 * PAGE_SIZE, 0);
+   fs_handle h;
+   int rc;
+
+   rc = vfs_open("/test3", &h, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+
+   ASSERT_EQ(vfs_seek(h, 3 * PAGE_SIZE + 10, SEEK_SET), 3 * PAGE_SIZE + 10);
+   ASSERT_EQ(vfs_write(h, (void *)"abc", 3), 3);
+   memcpy(&data[3 * PAGE_SIZE + 10], "abc", 3);
+
+   ASSERT_EQ(vfs_seek(h, PAGE_SIZE - 1, SEEK_SET), PAGE_SIZE - 1);
+   ASSERT_EQ(vfs_write(h, (void *)"xyz", 3), 3);
+   memcpy(&data[PAGE_SIZE - 1], "xyz", 3);
+
+   data.resize(3 * PAGE_SIZE + 13);
+   check_file_content(h, data);
+
+   vfs_close(h);
+   ASSERT_EQ(vfs_unlink("/test3"), 0);
+}
+
+TEST_F(ramfs_test, fallocate_and_st_blocks)
+{
+   struct stat64 st;
+   fs_handle h;
+   int rc;
+
+   rc = vfs_open("/test4", &h, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+
+   /* A sparse file has no blocks */
+   ASSERT_EQ(vfs_ftruncate(h, 64 * PAGE_SIZE), 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   ASSERT_EQ(st.st_size, 64 * PAGE_SIZE);
+   ASSERT_EQ(st.st_blocks, 0);
+
+   /* Default mode: allocate the blocks */
+   rc = vfs_fallocate(h, 0, 10 * PAGE_SIZE + 1, 4 * PAGE_SIZE);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   ASSERT_EQ(st.st_size, 64 * PAGE_SIZE);
+   ASSERT_EQ(st.st_blocks, 5 * PAGE_SIZE / 512);
+
+   /* Default mode, past EOF: the file gets extended */
+   rc = vfs_fallocate(h, 0, 64 * PAGE_SIZE, 100);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   ASSERT_EQ(st.st_size, 64 * PAGE_SIZE + 100);
+
+   /* KEEP_SIZE: the blocks get allocated, but the size does not change */
+   rc = vfs_fallocate(h, FALLOC_FL_KEEP_SIZE, 80 * PAGE_SIZE, PAGE_SIZE);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   ASSERT_EQ(st.st_size, 64 * PAGE_SIZE + 100);
+   ASSERT_GE(st.st_blocks, 7 * PAGE_SIZE / 512);
+
+   /* Invalid arguments */
+   ASSERT_EQ(vfs_fallocate(h, 0, -1, 10), -EINVAL);
+   ASSERT_EQ(vfs_fallocate(h, 0, 0, 0), -EINVAL);
+   ASSERT_EQ(vfs_fallocate(h, FALLOC_FL_PUNCH_HOLE, 0, 10), -EOPNOTSUPP);
+
+   vfs_close(h);
+   ASSERT_EQ(vfs_unlink("/test4"), 0);
+}
+
+TEST_F(ramfs_test, punch_hole)
+{
+   const int mode = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+   const size_t tot = 32 * PAGE_SIZE;
+   vector<char> data(tot);
+   struct stat64 st;
+   fs_handle h;
+   int rc;
+
+   for (size_t i = 0; i < tot; i++)
+      data[i] = (char)(i % 251 + 1);
+
+   rc = vfs_open("/test5", &h, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(vfs_write(h, data.data(), tot), (ssize_t)tot);
+
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   const blkcnt_t blocks_before = st.st_blocks;
+
+   /* Partial page only: just zero */
+   rc = vfs_fallocate(h, mode, 100, 200);
+   ASSERT_EQ(rc, 0);
+   memset(&data[100], 0, 200);
+
+   /* In the middle of a block */
+   rc = vfs_fallocate(h, mode, 2 * PAGE_SIZE + 10, 3 * PAGE_SIZE);
+   ASSERT_EQ(rc, 0);
+   memset(&data[2 * PAGE_SIZE + 10], 0, 3 * PAGE_SIZE);
+
+   /* Across the end of a block and the beginning of the next one */
+   rc = vfs_fallocate(h, mode, 12 * PAGE_SIZE, 8 * PAGE_SIZE);
+   ASSERT_EQ(rc, 0);
+   memset(&data[12 * PAGE_SIZE], 0, 8 * PAGE_SIZE);
+
+   check_file_content(h, data);
+
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   ASSERT_EQ(st.st_size, (off_t)tot);
+   ASSERT_EQ(st.st_blocks, blocks_before - 10 * PAGE_SIZE / 512);
+
+   /* Writing in the holes must work as usual */
+   ASSERT_EQ(vfs_seek(h, 14 * PAGE_SIZE, SEEK_SET), 14 * PAGE_SIZE);
+   ASSERT_EQ(vfs_write(h, (void *)"hello", 5), 5);
+   memcpy(&data[14 * PAGE_SIZE], "hello", 5);
+   check_file_content(h, data);
+
+   vfs_close(h);
+   ASSERT_EQ(vfs_unlink("/test5"), 0);
+}
+
+TEST_F(ramfs_test, seek_data_and_seek_hole)
+{
+   fs_handle h;
+   int rc;
+
+   rc = vfs_open("/test6", &h, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+
+   /* Data in [4, 6) pages, a hole in [6, 10), data in [10, 11), EOF at 16 */
+   ASSERT_EQ(vfs_ftruncate(h, 16 * PAGE_SIZE), 0);
+   ASSERT_EQ(vfs_fallocate(h, 0, 4 * PAGE_SIZE, 2 * PAGE_SIZE), 0);
+   ASSERT_EQ(vfs_fallocate(h, 0, 10 * PAGE_SIZE, PAGE_SIZE), 0);
+
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_DATA), 4 * PAGE_SIZE);
+   ASSERT_EQ(vfs_seek(h, 5 * PAGE_SIZE + 1, SEEK_DATA), 5 * PAGE_SIZE + 1);
+   ASSERT_EQ(vfs_seek(h, 6 * PAGE_SIZE, SEEK_DATA), 10 * PAGE_SIZE);
+   ASSERT_EQ(vfs_seek(h, 11 * PAGE_SIZE, SEEK_DATA), -ENXIO);
+
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_HOLE), 0);
+   ASSERT_EQ(vfs_seek(h, 4 * PAGE_SIZE, SEEK_HOLE), 6 * PAGE_SIZE);
+   ASSERT_EQ(vfs_seek(h, 10 * PAGE_SIZE, SEEK_HOLE), 11 * PAGE_SIZE);
+   ASSERT_EQ(vfs_seek(h, 12 * PAGE_SIZE, SEEK_HOLE), 12 * PAGE_SIZE);
+   ASSERT_EQ(vfs_seek(h, 16 * PAGE_SIZE, SEEK_HOLE), -ENXIO);
+
+   /* The current position is not changed on error */
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_CUR), 12 * PAGE_SIZE);
+
+   vfs_close(h);
+   ASSERT_EQ(vfs_unlink("/test6"), 0);
+}
+
+TEST_F(ramfs_test, clone_and_copy_on_write)
+{
+   const size_t tot = 40 * PAGE_SIZE + 123;
+   vector<char> data(tot), data2;
+   struct stat64 st;
+   fs_handle h1, h2;
+   int rc;
+
+   for (size_t i = 0; i < tot; i++)
+      data[i] = (char)(i % 253 + 1);
+
+   rc = vfs_open("/test7", &h1, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+   ASSERT_EQ(vfs_write(h1, data.data(), tot), (ssize_t)tot);
+
+   rc = vfs_open("/test8", &h2, O_CREAT | O_RDWR, 0644);
+   ASSERT_EQ(rc, 0);
+
+   /* Clone the whole file (len == 0 means up to the EOF) */
+   ASSERT_EQ(vfs_clone_range(h1, 0, h2, 0, 0), 0);
+   check_file_content(h2, data);
+
+   ASSERT_EQ(vfs_fstat64(h2, &st), 0);
+   ASSERT_EQ(st.st_size, (off_t)tot);
+   ASSERT_EQ(st.st_blocks, 41 * PAGE_SIZE / 512);
+
+   /* Writing to the clone must not affect the source, and vice versa */
+   data2 = data;
+
+   ASSERT_EQ(vfs_seek(h2, 5 * PAGE_SIZE + 1, SEEK_SET), 5 * PAGE_SIZE + 1);
+   ASSERT_EQ(vfs_write(h2, (void *)"clone", 5), 5);
+   memcpy(&data2[5 * PAGE_SIZE + 1], "clone", 5);
+
+   ASSERT_EQ(vfs_seek(h1, 30 * PAGE_SIZE, SEEK_SET), 30 * PAGE_SIZE);
+   ASSERT_EQ(vfs_write(h1, (void *)"src", 3), 3);
+   memcpy(&data[30 * PAGE_SIZE], "src", 3);
+
+   check_file_content(h1, data);
+   check_file_content(h2, data2);
+
+   /* Truncating and punching holes in the clone must not affect the source */
+   ASSERT_EQ(vfs_ftruncate(h2, 10 * PAGE_SIZE + 7), 0);
+   data2.resize(10 * PAGE_SIZE + 7);
+
+   rc = vfs_fallocate(h2,
+                      FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                      PAGE_SIZE + 10,
+                      2 * PAGE_SIZE);
+   ASSERT_EQ(rc, 0);
+   memset(&data2[PAGE_SIZE + 10], 0, 2 * PAGE_SIZE);
+
+   check_file_content(h1, data);
+   check_file_content(h2, data2);
+
+   /* Unaligned ranges cannot be cloned */
+   ASSERT_EQ(vfs_clone_range(h1, 100, h2, 100, PAGE_SIZE), -EINVAL);
+
+   /* Overlapping ranges in the same file */
+   ASSERT_EQ(vfs_clone_range(h1, 0, h1, PAGE_SIZE, 2 * PAGE_SIZE), -EINVAL);
+
+   vfs_close(h2);
+   ASSERT_EQ(vfs_unlink("/test8"), 0);
+
+   /* The source must be still intact after destroying the clone */
+   check_file_content(h1, data);
+
+   vfs_close(h1);
+   ASSERT_EQ(vfs_unlink("/test7"), 0);
+}
+
+TEST_F(ramfs_test, copy_file_range)
+{
+   const size_t tot = 20 * PAGE_SIZE;
+   vector<char> data(tot), exp(tot + 2 * PAGE_SIZE, 'x');
+   fs_handle h1, h2;
+   offt rc;
+
+   for (size_t i = 0; i < tot; i++)
+      data[i] = (char)(i % 241 + 1);
+
+   ASSERT_EQ(vfs_open("/test9", &h1, O_CREAT | O_RDWR, 0644), 0);
+   ASSERT_EQ(vfs_write(h1, data.data(), tot), (ssize_t)tot);
+
+   ASSERT_EQ(vfs_open("/test10", &h2, O_CREAT | O_RDWR, 0644), 0);
+   ASSERT_EQ(vfs_write(h2, exp.data(), exp.size()), (ssize_t)exp.size());
+
+   /* Same alignment: the middle gets cloned, the head and the tail copied */
+   rc = vfs_copy_file_range(h1, 100, h2, PAGE_SIZE + 100, 10 * PAGE_SIZE);
+   ASSERT_EQ(rc, 10 * PAGE_SIZE);
+   memcpy(&exp[PAGE_SIZE + 100], &data[100], 10 * PAGE_SIZE);
+   check_file_content(h2, exp);
+
+   /* Different alignment: everything gets copied */
+   rc = vfs_copy_file_range(h1, 10, h2, 3 * PAGE_SIZE + 11, 5 * PAGE_SIZE);
+   ASSERT_EQ(rc, 5 * PAGE_SIZE);
+   memcpy(&exp[3 * PAGE_SIZE + 11], &data[10], 5 * PAGE_SIZE);
+   check_file_content(h2, exp);
+
+   /* The range gets truncated at the source's EOF */
+   rc = vfs_copy_file_range(h1, tot - 50, h2, tot, PAGE_SIZE);
+   ASSERT_EQ(rc, 50);
+   memcpy(&exp[tot], &data[tot - 50], 50);
+   check_file_content(h2, exp);
+
+   /* Past the source's EOF, nothing is copied */
+   ASSERT_EQ(vfs_copy_file_range(h1, tot, h2, 0, PAGE_SIZE), 0);
+   check_file_content(h2, exp);
+
+   /* The source must not be affected */
+   check_file_content(h1, data);
+
+   vfs_close(h2);
+   vfs_close(h1);
+   ASSERT_EQ(vfs_unlink("/test10"), 0);
+   ASSERT_EQ(vfs_unlink("/test9"), 0);
+}
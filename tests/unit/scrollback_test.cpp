@@ -0,0 +1,200 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#include <cstdio>
+#include <vector>
+#include <random>
+
+#include <gtest/gtest.h>
+#include "kernel_init_funcs.h"
+
+extern "C" {
+   #include <tilck/common/color_defs.h>
+   #include <tilck/kernel/kmalloc.h>
+   #include "modules/console/scrollback.h" // private header
+}
+
+using namespace std;
+using namespace testing;
+
+#define COLS      80
+
+static const u16 blank = make_vgaentry(' ', DEFAULT_COLOR16);
+
+class scrollback_test : public Test {
+
+protected:
+
+   struct scrollback sb;
+
+   void SetUp() override {
+      init_kmalloc_for_tests();
+      bzero(&sb, sizeof(sb));
+   }
+
+   void TearDown() override {
+      sb_destroy(&sb);
+   }
+};
+
+static vector<u16> make_text_row(const char *s, u8 color = DEFAULT_COLOR16)
+{
+   vector<u16> row(COLS, blank);
+
+   for (u32 i = 0; s[i] && i < COLS; i++)
+      row[i] = make_vgaentry(s[i], color);
+
+   return row;
+}
+
+static vector<u16> get_row(struct scrollback *sb, u32 n)
+{
+   vector<u16> row(COLS);
+   sb_get_row(sb, n, row.data());
+   return row;
+}
+
+TEST_F(scrollback_test, round_trip)
+{
+   vector<vector<u16>> rows;
+   default_random_engine e(1234);
+   uniform_int_distribution<int> ch(0, 255);
+   vector<u16> r;
+
+   ASSERT_EQ(sb_init(&sb, COLS, 100), 0);
+
+   /* Blank row */
+   rows.push_back(vector<u16>(COLS, blank));
+
+   /* Plain text */
+   rows.push_back(make_text_row("hello world"));
+
+   /* Text in a non-default color */
+   rows.push_back(make_text_row("colored", make_color(COLOR_RED, COLOR_BLUE)));
+
+   /* Runs of the same char, longer than a repeat token */
+   r = vector<u16>(COLS, make_vgaentry('=', DEFAULT_COLOR16));
+   r[3] = make_vgaentry('x', DEFAULT_COLOR16);
+   rows.push_back(r);
+
+   /* Full row of random chars: literals longer than a literal token */
+   r = vector<u16>(COLS);
+
+   for (u32 i = 0; i < COLS; i++)
+      r[i] = make_vgaentry((u8)ch(e), DEFAULT_COLOR16);
+
+   rows.push_back(r);
+
+   /* The worst case: every cell with a different color */
+   for (u32 i = 0; i < COLS; i++)
+      r[i] = make_vgaentry((u8)ch(e), (u8)(i & 0xf ? i : 1));
+
+   rows.push_back(r);
+
+   /* Trailing non-blank spaces (a different bg color) must be kept */
+   r = make_text_row("ab");
+   r[COLS - 1] = make_vgaentry(' ', make_color(COLOR_WHITE, COLOR_RED));
+   rows.push_back(r);
+
+   for (auto &row : rows)
+      sb_push_row(&sb, row.data());
+
+   ASSERT_EQ(sb.count, rows.size());
+
+   for (u32 i = 0; i < rows.size(); i++)
+      ASSERT_EQ(get_row(&sb, i), rows[i]) << "row: " << i;
+}
+
+TEST_F(scrollback_test, max_rows)
+{
+   char text[32];
+   ASSERT_EQ(sb_init(&sb, COLS, 10), 0);
+
+   for (u32 i = 0; i < 25; i++) {
+      sprintf(text, "row %u", i);
+      sb_push_row(&sb, make_text_row(text).data());
+   }
+
+   ASSERT_EQ(sb.count, 10u);
+
+   for (u32 i = 0; i < 10; i++) {
+      sprintf(text, "row %u", 15 + i);
+      ASSERT_EQ(get_row(&sb, i), make_text_row(text));
+   }
+}
+
+TEST_F(scrollback_test, full_buffer)
+{
+   default_random_engine e(4321);
+   uniform_int_distribution<int> ch(33, 126);
+   vector<vector<u16>> rows;
+
+   ASSERT_EQ(sb_init(&sb, COLS, 100), 0);
+
+   /* Incompressible rows: they don't fit all in the buffer */
+   for (u32 i = 0; i < 100; i++) {
+
+      vector<u16> r(COLS);
+
+      for (u32 j = 0; j < COLS; j++)
+         r[j] = make_vgaentry((u8)ch(e), DEFAULT_COLOR16);
+
+      sb_push_row(&sb, r.data());
+      rows.push_back(r);
+   }
+
+   ASSERT_LT(sb.count, 100u);
+   ASSERT_GT(sb.count, 0u);
+   ASSERT_LE(sb_get_used_bytes(&sb), sb.buf_size);
+
+   /* The rows kept must be the newest ones */
+   for (u32 i = 0; i < sb.count; i++)
+      ASSERT_EQ(get_row(&sb, i), rows[100 - sb.count + i]);
+}
+
+TEST_F(scrollback_test, compression)
+{
+   ASSERT_EQ(sb_init(&sb, COLS, 1000), 0);
+
+   for (u32 i = 0; i < 1000; i++)
+      sb_push_row(&sb, make_text_row(i % 3 ? "$ ls -l /usr/bin" : "").data());
+
+   ASSERT_EQ(sb.count, 1000u);
+
+   /* Much less than the 2 bytes per cell of the screen buffer */
+   ASSERT_LT(sb_get_used_bytes(&sb), 1000u * COLS * 2 / 10);
+}
+
+TEST_F(scrollback_test, move)
+{
+   struct scrollback dst;
+   char text[32];
+
+   ASSERT_EQ(sb_init(&sb, COLS, 50), 0);
+
+   for (u32 i = 0; i < 50; i++) {
+      sprintf(text, "row %u", i);
+      sb_push_row(&sb, make_text_row(text).data());
+   }
+
+   ASSERT_EQ(sb_init(&dst, COLS, 20), 0);
+   sb_move(&dst, &sb);
+
+   ASSERT_EQ(sb.count, 0u);
+   ASSERT_EQ(dst.count, 20u);
+
+   for (u32 i = 0; i < 20; i++) {
+      sprintf(text, "row %u", 30 + i);
+      ASSERT_EQ(get_row(&dst, i), make_text_row(text));
+   }
+
+   sb_destroy(&dst);
+}
+
+TEST_F(scrollback_test, no_history)
+{
+   ASSERT_EQ(sb_init(&sb, COLS, 0), 0);
+   sb_push_row(&sb, make_text_row("lost").data());
+   ASSERT_EQ(sb.count, 0u);
+}
@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <cstdio>
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace testing;
+
+extern "C" {
+   #include <tilck/kernel/spsc_ringbuf.h>
+}
+
+TEST(spsc_ringbuf, basic)
+{
+   u8 buffer[4] = {0};
+   u8 out[8];
+   struct spsc_ringbuf rb;
+
+   spsc_ringbuf_init(&rb, ARRAY_SIZE(buffer), buffer);
+   ASSERT_TRUE(spsc_ringbuf_is_empty(&rb));
+   ASSERT_EQ(spsc_ringbuf_read(&rb, out, sizeof(out)), 0u);
+
+   for (u8 i = 0; i < 4; i++)
+      ASSERT_TRUE(spsc_ringbuf_write_1(&rb, i));
+
+   /* The ring is full: the new bytes are dropped and counted */
+   ASSERT_FALSE(spsc_ringbuf_write_1(&rb, 100));
+   ASSERT_FALSE(spsc_ringbuf_write_1(&rb, 101));
+   ASSERT_EQ(rb.written, 4ul);
+   ASSERT_EQ(rb.dropped, 2ul);
+
+   ASSERT_EQ(spsc_ringbuf_read(&rb, out, sizeof(out)), 4u);
+   ASSERT_EQ(rb.batches, 1ul);
+
+   for (u8 i = 0; i < 4; i++)
+      ASSERT_EQ(out[i], i);
+
+   ASSERT_TRUE(spsc_ringbuf_is_empty(&rb));
+}
+
+TEST(spsc_ringbuf, wrap_around)
+{
+   u8 buffer[8] = {0};
+   u8 out[8];
+   u8 next_w = 0, next_r = 0;
+   struct spsc_ringbuf rb;
+
+   spsc_ringbuf_init(&rb, ARRAY_SIZE(buffer), buffer);
+
+   /* Read in batches smaller than the writes, in order to wrap around */
+   for (int iter = 0; iter < 100; iter++) {
+
+      for (int i = 0; i < 5; i++)
+         if (spsc_ringbuf_write_1(&rb, next_w))
+            next_w++;
+
+      const u32 n = spsc_ringbuf_read(&rb, out, 3 + iter % 4);
+
+      for (u32 i = 0; i < n; i++)
+         ASSERT_EQ(out[i], next_r++) << "iter: " << iter;
+   }
+
+   while (u32 n = spsc_ringbuf_read(&rb, out, sizeof(out)))
+      for (u32 i = 0; i < n; i++)
+         ASSERT_EQ(out[i], next_r++);
+
+   ASSERT_EQ(next_r, next_w);
+   ASSERT_EQ(rb.written + rb.dropped, 500ul);
+}
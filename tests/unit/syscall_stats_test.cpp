@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <gtest/gtest.h>
+#include "kernel_init_funcs.h"
+
+using namespace std;
+using namespace testing;
+
+extern "C" {
+   #include <tilck/mods/tracing.h>
+}
+
+TEST(syscall_stats, account_and_reset)
+{
+   struct syscall_stats st;
+   init_kmalloc_for_tests();
+
+   ASSERT_EQ(syscall_stats_set_enabled(true), 0);
+   ASSERT_TRUE(syscall_stats_is_enabled());
+   syscall_stats_reset();
+   ASSERT_FALSE(syscall_stats_get(3, &st));
+
+   syscall_stats_account(3, 0);
+   syscall_stats_account(3, 1);
+   syscall_stats_account(3, 1000);            /* 2^9 <= 1000 < 2^10 */
+   syscall_stats_account(3, 1023);
+   syscall_stats_account(3, 1ull << 40);      /* beyond the last bucket */
+
+   ASSERT_TRUE(syscall_stats_get(3, &st));
+   ASSERT_EQ(st.calls, 5u);
+   ASSERT_EQ(st.tot_cycles, 2024u + (1ull << 40));
+   ASSERT_EQ(st.max_cycles, 1ull << 40);
+   ASSERT_EQ(st.hist[0], 2u);
+   ASSERT_EQ(st.hist[9], 2u);
+   ASSERT_EQ(st.hist[SYS_STATS_HIST_SIZE - 1], 1u);
+
+   syscall_stats_reset();
+   ASSERT_FALSE(syscall_stats_get(3, &st));
+   ASSERT_FALSE(syscall_stats_get(MAX_SYSCALLS, &st));
+
+   ASSERT_EQ(syscall_stats_set_enabled(false), 0);
+   ASSERT_FALSE(syscall_stats_is_enabled());
+}
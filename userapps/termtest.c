@@ -224,6 +224,64 @@ void console_perf_test(void)
    free(buf);
 }
 
+/*
+ * TTY throughput benchmark: writes a few MB of text in large chunks, like
+ * `cat` of a big log file would do. It measures both plain text and text
+ * with a color escape sequence in every line, like compilers' output.
+ */
+#define TP_TEST_TOT_SIZE      (4 * 1024 * 1024)
+#define TP_TEST_CHUNK_SIZE    4096
+
+static int64_t tty_throughput_test_int(const char *line)
+{
+   const size_t line_len = strlen(line);
+   char buf[TP_TEST_CHUNK_SIZE];
+   uint64_t start;
+   ssize_t r;
+
+   for (size_t i = 0; i < sizeof(buf); i++)
+      buf[i] = line[i % line_len];
+
+   start = RDTSC();
+
+   for (size_t written = 0; written < TP_TEST_TOT_SIZE; written += r) {
+
+      const size_t off = written % sizeof(buf);
+      r = write(1, buf + off, sizeof(buf) - off);
+
+      if (r < 0) {
+         perror("write() failed");
+         return -1;
+      }
+   }
+
+   return (int64_t)((RDTSC() - start) / TP_TEST_TOT_SIZE);
+}
+
+void tty_throughput_test(void)
+{
+   static const char plain[] =
+      "gcc -c -O2 -Wall -Wextra -o build/obj/module_0123.o src/mod_0123.c\n";
+
+   static const char colored[] =
+      "src/mod_0123.c:42:7: \033[1;35mwarning:\033[0m unused variable 'x'\n";
+
+   int64_t plain_cost, colored_cost;
+
+   if ((plain_cost = tty_throughput_test_int(plain)) < 0)
+      return;
+
+   if ((colored_cost = tty_throughput_test_int(colored)) < 0)
+      return;
+
+   printf("%s", CSI_ERASE_DISPLAY CSI_MOVE_CURSOR_TOP_LEFT);
+   printf("Written %d KB for each test\n", TP_TEST_TOT_SIZE / 1024);
+   printf("Plain text, avg. byte cost:   %6lld cycles\n",
+          (long long)plain_cost);
+   printf("Colored text, avg. byte cost: %6lld cycles\n",
+          (long long)colored_cost);
+}
+
 void read_nonblock(void)
 {
    int rc;
@@ -445,6 +503,7 @@ static struct {
 #endif
 
    CMD_ENTRY("-p", console_perf_test),
+   CMD_ENTRY("-tp", tty_throughput_test),
    CMD_ENTRY("-n", read_nonblock),
    CMD_ENTRY("-nr", read_nonblock_rawmode),
    CMD_ENTRY("-fr", write_full_row),
@@ -0,0 +1,210 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Minimalistic strace-like tool, consuming the binary stream of the syscall
+ * tracing events through the shared buffer of /dev/tracing. It dumps just the
+ * raw values of the events: for the decoded parameters, use the debug panel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/tracing_buf.h>
+
+#define MAX_SYS_NAMES                                         512
+
+static struct trace_buf_hdr *hdr;
+static char *data;
+static char sys_names[MAX_SYS_NAMES][32];
+
+static const char *get_sys_name(int fd, u32 sys)
+{
+   struct trace_sys ts = { .sys = sys };
+
+   if (sys >= MAX_SYS_NAMES)
+      return "?";
+
+   if (!sys_names[sys][0]) {
+
+      if (ioctl(fd, TILCK_TRACE_IOC_GET_SYS_NAME, &ts) < 0)
+         snprintf(ts.name, sizeof(ts.name), "sys_%u", sys);
+
+      memcpy(sys_names[sys], ts.name, sizeof(ts.name));
+   }
+
+   return sys_names[sys];
+}
+
+static void dump_event(int fd, struct trace_event *e)
+{
+   printf("[%5d] %s(%#lx, %#lx, %#lx)",
+          e->tid, get_sys_name(fd, e->sys), e->args[0], e->args[1], e->args[2]);
+
+   if (e->type == te_sys_enter)
+      printf(" ...\n");
+   else
+      printf(" = %ld\n", e->retval);
+}
+
+static void consume_events(int fd)
+{
+   u32 head = atomic_load_explicit(&hdr->head, mo_acquire);
+   u32 tail = atomic_load_explicit(&hdr->tail, mo_relaxed);
+   struct trace_event e;
+   struct trace_rec *r;
+
+   while (tail != head) {
+
+      r = (void *)(data + tail);
+
+      if (!(r->flags & TRACE_REC_PAD)) {
+
+         /* The bytes past the end of the record must be considered zero */
+         memset(&e, 0, sizeof(e));
+         memcpy(&e, &r->e, MIN(r->size - offsetof(struct trace_rec, e),
+                                sizeof(e)));
+         dump_event(fd, &e);
+      }
+
+      tail = (tail + r->size) % hdr->data_size;
+   }
+
+   atomic_store_explicit(&hdr->tail, tail, mo_release);
+}
+
+static int map_trace_buf(int fd)
+{
+   u32 data_off, data_size;
+   void *p;
+
+   p = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+   if (p == MAP_FAILED)
+      return -1;
+
+   hdr = p;
+
+   if (hdr->magic != TRACE_BUF_MAGIC) {
+      fprintf(stderr, "tracer: invalid magic in the tracing buffer\n");
+      munmap(p, 4096);
+      return -1;
+   }
+
+   data_off = hdr->data_off;
+   data_size = hdr->data_size;
+   munmap(p, 4096);
+
+   p = mmap(NULL, data_off + data_size,
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+   if (p == MAP_FAILED)
+      return -1;
+
+   hdr = p;
+   data = (char *)p + data_off;
+   return 0;
+}
+
+static void show_help_and_exit(char *prog)
+{
+   fprintf(stderr, "Usage: %s [-e <trace expr>] <cmd> [args...]\n", prog);
+   exit(1);
+}
+
+int main(int argc, char **argv)
+{
+   struct pollfd pfd;
+   const char *expr = NULL;
+   int fd, pipefd[2], wstatus, rc;
+   bool done = false;
+   pid_t pid;
+   char c = 0;
+
+   if (argc > 2 && !strcmp(argv[1], "-e")) {
+      expr = argv[2];
+      argc -= 2;
+      argv += 2;
+   }
+
+   if (argc < 2)
+      show_help_and_exit(argv[0]);
+
+   if ((fd = open("/dev/tracing", O_RDWR)) < 0) {
+      perror("tracer: open /dev/tracing");
+      return 1;
+   }
+
+   if (map_trace_buf(fd) < 0) {
+      perror("tracer: mmap");
+      return 1;
+   }
+
+   if (expr && ioctl(fd, TILCK_TRACE_IOC_SET_FILTER, expr) < 0) {
+      perror("tracer: invalid trace expr");
+      return 1;
+   }
+
+   if (pipe(pipefd) < 0) {
+      perror("tracer: pipe");
+      return 1;
+   }
+
+   if ((pid = fork()) < 0) {
+      perror("tracer: fork");
+      return 1;
+   }
+
+   if (!pid) {
+
+      /* Wait for the parent to enable the tracing on us */
+      close(pipefd[1]);
+      read(pipefd[0], &c, 1);
+      close(pipefd[0]);
+      close(fd);
+
+      execvp(argv[1], argv + 1);
+      perror("tracer: execvp");
+      exit(127);
+   }
+
+   close(pipefd[0]);
+   ioctl(fd, TILCK_TRACE_IOC_TRACE_TID, (long)pid);
+   ioctl(fd, TILCK_TRACE_IOC_ENABLE, 1L);
+   write(pipefd[1], &c, 1);
+   close(pipefd[1]);
+
+   pfd = (struct pollfd) { .fd = fd, .events = POLLIN };
+
+   while (!done) {
+
+      rc = poll(&pfd, 1, 100 /* ms */);
+
+      if (rc < 0 && errno != EINTR) {
+         perror("tracer: poll");
+         break;
+      }
+
+      /* Check before consuming, in order to not lose the last events */
+      done = waitpid(pid, &wstatus, WNOHANG) == pid;
+      consume_events(fd);
+   }
+
+   ioctl(fd, TILCK_TRACE_IOC_ENABLE, 0L);
+
+   fprintf(stderr,
+           "tracer: %u events written, %u dropped\n",
+           atomic_load_explicit(&hdr->written, mo_relaxed),
+           atomic_load_explicit(&hdr->dropped, mo_relaxed));
+
+   close(fd);
+   return 0;
+}